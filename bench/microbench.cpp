@@ -0,0 +1,194 @@
+/**
+ * Native microbenchmarks of the paths dbmAsyncWorker::Execute() takes, without Node
+ *
+ * Each operation boxes its arguments in std::any and unboxes them by copy, as the worker does, then
+ * calls the DBM from `--threads` threads (the libuv pool has 4 by default). What's left between these
+ * numbers and the Node harness (bench/ycsb.mjs) is the N-API and event loop overhead.
+ *
+ * Prints one JSON object per benchmark, one per line:
+ *   tkrzw-bench [--config tkrzw_config.json] [--path db/microbench.tkh] [--shards 0] [--threads 4]
+ *               [--records 100000] [--value-size 100] [--search-ops 10] [--only set,getSimple,...]
+ */
+#include "../include/utils/key_search.hpp"
+#include "../include/utils/shard_dbm.hpp"
+
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <tkrzw_dbm_poly.h>
+#include <tkrzw_file_util.h>
+#include <tkrzw_str_util.h>
+
+namespace
+{
+    struct bench_options
+    {
+        std::string config = "tkrzw_config.json";
+        std::string path = "db/microbench.tkh";
+        int32_t shards = 0;                 // 0 for a polyDBM, otherwise a polyShardDBM with that many shards
+        int32_t threads = 4;
+        int64_t records = 100000;
+        int32_t value_size = 100;
+        int64_t search_ops = 10;
+        std::vector<std::string> only;      // Empty for every benchmark
+    };
+
+    // The tuning parameters of a flat JSON config such as tkrzw_config.json (string values only)
+    std::map<std::string, std::string> read_config(const std::string& path)
+    {
+        std::ifstream file(path);
+        std::stringstream text;
+        text << file.rdbuf();
+        const std::string json = text.str();
+        std::map<std::string, std::string> params;
+        const std::regex pair("\"([^\"]+)\"\\s*:\\s*\"([^\"]*)\"");
+        for (std::sregex_iterator it(json.begin(), json.end(), pair), end; it != end; ++it) {
+            params[(*it)[1]] = (*it)[2];
+        }
+        return params;
+    }
+
+    std::string make_key(int64_t index)
+    {
+        return tkrzw::SPrintF("user%010lld", static_cast<long long>(index));
+    }
+
+    // Runs `op(i)` for i in [0, ops), split over the threads, and prints the throughput and latencies
+    void run(const bench_options& opts, const std::string& name, const std::string& dbm_class, int64_t ops,
+             const std::function<bool(int64_t)>& op)
+    {
+        if (!opts.only.empty() && std::find(opts.only.begin(), opts.only.end(), name) == opts.only.end()) {
+            return;
+        }
+        std::vector<std::vector<uint64_t>> latencies(opts.threads);
+        std::atomic<int64_t> errors{0};
+        std::vector<std::thread> threads;
+        const auto start = std::chrono::steady_clock::now();
+        for (int32_t t = 0; t < opts.threads; ++t)
+        {
+            threads.emplace_back([&, t] {
+                auto& samples = latencies[t];
+                samples.reserve(ops / opts.threads + 1);
+                for (int64_t i = t; i < ops; i += opts.threads)
+                {
+                    const auto op_start = std::chrono::steady_clock::now();
+                    if (!op(i)) {
+                        errors.fetch_add(1);
+                    }
+                    samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - op_start).count());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<uint64_t> all;
+        for (const auto& samples : latencies) {
+            all.insert(all.end(), samples.begin(), samples.end());
+        }
+        std::sort(all.begin(), all.end());
+        auto percentile = [&](double q) {
+            return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(q * all.size()))] / 1000.0;
+        };
+        std::printf("{\"bench\":\"%s\",\"dbm\":\"%s\",\"shards\":%d,\"threads\":%d,\"ops\":%lld,\"errors\":%lld,"
+                    "\"seconds\":%.6f,\"opsPerSec\":%.1f,\"p50Us\":%.3f,\"p99Us\":%.3f,\"p999Us\":%.3f,\"maxUs\":%.3f}\n",
+                    name.c_str(), dbm_class.c_str(), opts.shards, opts.threads, static_cast<long long>(ops),
+                    static_cast<long long>(errors.load()), seconds, ops / seconds,
+                    percentile(0.5), percentile(0.99), percentile(0.999), all.empty() ? 0.0 : all.back() / 1000.0);
+        std::fflush(stdout);
+    }
+
+    bool parse_args(int argc, char** argv, bench_options* opts)
+    {
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string name = argv[i], value = argv[i + 1];
+            if (name == "--config") opts->config = value;
+            else if (name == "--path") opts->path = value;
+            else if (name == "--shards") opts->shards = tkrzw::StrToInt(value);
+            else if (name == "--threads") opts->threads = std::max<int32_t>(1, tkrzw::StrToInt(value));
+            else if (name == "--records") opts->records = std::max<int64_t>(1, tkrzw::StrToInt(value));
+            else if (name == "--value-size") opts->value_size = tkrzw::StrToInt(value);
+            else if (name == "--search-ops") opts->search_ops = tkrzw::StrToInt(value);
+            else if (name == "--only") opts->only = tkrzw::StrSplit(value, ',', true);
+            else return false;
+        }
+        return argc % 2 == 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bench_options opts;
+    if (!parse_args(argc, argv, &opts)) {
+        std::cerr << "usage: " << argv[0] << " [--config file] [--path file] [--shards n] [--threads n]"
+                  << " [--records n] [--value-size n] [--search-ops n] [--only bench,...]" << std::endl;
+        return 1;
+    }
+    std::map<std::string, std::string> params = read_config(opts.config);
+    std::unique_ptr<tkrzw::ParamDBM> dbm;
+    if (opts.shards > 0) {
+        params["num_shards"] = tkrzw::ToString(opts.shards);
+        dbm = std::make_unique<shard_dbm>();
+    } else {
+        dbm = std::make_unique<tkrzw::PolyDBM>();
+    }
+    const tkrzw::Status status = dbm->OpenAdvanced(opts.path, true, tkrzw::File::OPEN_TRUNCATE, params);
+    if (status != tkrzw::Status::SUCCESS) {
+        std::cerr << "Cannot open " << opts.path << ": " << status << std::endl;
+        return 1;
+    }
+    const std::string dbm_class = tkrzw::SearchMap(params, "dbm", "auto");
+    const std::string value(opts.value_size, 'v');
+
+    //Same boxing as the worker: the constructor copies the arguments into std::any, Execute() copies them out
+    run(opts, "set", dbm_class, opts.records, [&](int64_t i) {
+        std::vector<std::any> args{make_key(i), value};
+        return dbm->Set(std::any_cast<std::string>(args[0]), std::any_cast<std::string>(args[1])) == tkrzw::Status::SUCCESS;
+    });
+    run(opts, "getSimple", dbm_class, opts.records, [&](int64_t i) {
+        std::vector<std::any> args{make_key(i), std::string()};
+        std::any result = dbm->GetSimple(std::any_cast<std::string>(args[0]), std::any_cast<std::string>(args[1]));
+        return !std::any_cast<std::string&>(result).empty();
+    });
+    run(opts, "compareExchange", dbm_class, opts.records, [&](int64_t i) {
+        std::vector<std::any> args{make_key(i), value, std::string(opts.value_size, 'w')};
+        return dbm->CompareExchange(std::any_cast<std::string>(args[0]), std::any_cast<std::string>(args[1]),
+                                    std::any_cast<std::string>(args[2])) == tkrzw::Status::SUCCESS;
+    });
+    run(opts, "increment", dbm_class, opts.records, [&](int64_t i) {
+        std::vector<std::any> args{"counter:" + tkrzw::ToString(i % 64), int64_t(1), int64_t(0)};
+        int64_t current = 0;
+        return dbm->Increment(std::any_cast<std::string>(args[0]), std::any_cast<int64_t>(args[1]), &current,
+                              std::any_cast<int64_t>(args[2])) == tkrzw::Status::SUCCESS;
+    });
+    run(opts, "search", dbm_class, opts.search_ops, [&](int64_t i) {
+        std::vector<std::any> args{std::string("begin"), make_key(i % opts.records).substr(0, 12), size_t(100)};
+        std::vector<std::string> keys;
+        search_keys(dbm.get(), std::any_cast<std::string>(args[0]), std::any_cast<std::string>(args[1]),
+                    std::any_cast<size_t>(args[2]), &keys);
+        return !keys.empty();
+    });
+    run(opts, "remove", dbm_class, opts.records, [&](int64_t i) {
+        std::vector<std::any> args{make_key(i)};
+        return dbm->Remove(std::any_cast<std::string>(args[0])) == tkrzw::Status::SUCCESS;
+    });
+
+    dbm->Close();
+    return 0;
+}
@@ -0,0 +1,238 @@
+// Replays a trace captured with db.startCapture() against a database config.
+//
+//   node bench/replay.mjs <trace> [--config tkrzw_config.json] [--target polyDBM|polyShardDBM]
+//                         [--path db/replay.tkh] [--speed 1] [--max-inflight 256] [--no-preload]
+//                         [--out result.json]
+//
+// Operations are issued open-loop at their captured arrival times divided by `--speed` (2 replays
+// twice as fast; 0 issues them as fast as `--max-inflight` allows). Keys are rebuilt from the
+// captured hash and size, values are filler of the captured size, so the replay has the key
+// popularity and size distributions of the original traffic, not its data. Keys that are read
+// before being written in the trace are preloaded first (with the size of the captured result)
+// unless --no-preload.
+//
+// compareExchange is replayed as set, since the expected values aren't captured; operations without
+// a key-level equivalent (iterators, processors, ...) are skipped and counted.
+//
+// Prints the result as one JSON object: throughput, how late operations were issued, and per
+// operation the replayed latency percentiles next to the captured ones, plus the native stats().
+
+import fs from 'node:fs';
+import path from 'node:path';
+import { polyDBM, polyShardDBM } from '../index.mjs';
+
+function parseArgs(argv) {
+	const args = {
+		trace: null,
+		config: 'tkrzw_config.json',
+		target: 'polyDBM',
+		path: 'db/replay.tkh',
+		speed: 1,
+		maxInflight: 256,
+		preload: true,
+		out: null,
+	};
+	for (let i = 0; i < argv.length; i++) {
+		if (!argv[i].startsWith('--')) {
+			args.trace = argv[i];
+			continue;
+		}
+		const [flag, inline] = argv[i].split('=', 2);
+		if (flag === '--no-preload') {
+			args.preload = false;
+			continue;
+		}
+		const name = flag.slice(2).replace(/-([a-z])/g, (_, c) => c.toUpperCase());
+		if (!(name in args)) {
+			throw new Error(`Unknown option ${flag}`);
+		}
+		const value = inline ?? argv[++i];
+		args[name] = typeof args[name] === 'number' ? Number(value) : value;
+	}
+	if (!args.trace) {
+		throw new Error('usage: node bench/replay.mjs <trace> [options]');
+	}
+	return args;
+}
+
+// Layout written by op_capture (include/utils/op_capture.hpp)
+function readTrace(file) {
+	const buf = fs.readFileSync(file);
+	if (buf.toString('latin1', 0, 8) !== 'TKZTRACE') {
+		throw new Error(`${file} is not a capture trace`);
+	}
+	const version = buf.readUInt32LE(8);
+	const recordSize = buf.readUInt32LE(12);
+	if (version !== 1) {
+		throw new Error(`Unsupported trace version ${version}`);
+	}
+	const startTime = Number(buf.readBigUInt64LE(16));
+	const numOps = buf.readUInt16LE(24);
+	const opNames = [];
+	let offset = 26;
+	for (let i = 0; i < numOps; i++) {
+		const length = buf.readUInt8(offset);
+		opNames.push(buf.toString('latin1', offset + 1, offset + 1 + length));
+		offset += 1 + length;
+	}
+	const records = [];
+	for (; offset + recordSize <= buf.length; offset += recordSize) {
+		records.push({
+			arrivalUs: Number(buf.readBigUInt64LE(offset)),
+			keyHash: buf.readBigUInt64LE(offset + 8),
+			keySize: buf.readUInt32LE(offset + 16),
+			valueSize: buf.readUInt32LE(offset + 20),
+			resultSize: buf.readUInt32LE(offset + 24),
+			latencyUs: buf.readUInt32LE(offset + 28),
+			op: opNames[buf.readUInt16LE(offset + 32)] ?? 'unknown',
+			error: (buf.readUInt16LE(offset + 34) & 1) !== 0,
+		});
+	}
+	records.sort((a, b) => a.arrivalUs - b.arrivalUs);     // Captured in completion order
+	return { startTime, opNames, records };
+}
+
+function keyOf(record) {
+	const base = record.keyHash.toString(16).padStart(16, '0');
+	return record.keySize >= base.length ? base.padEnd(record.keySize, 'k') : base.slice(0, Math.max(record.keySize, 1));
+}
+
+const filler = (size) => 'v'.repeat(size);
+
+// Replayed call of each captured operation; missing entries are skipped
+const REPLAY = {
+	set: (db, r) => db.set(keyOf(r), filler(r.valueSize)),
+	compareExchange: (db, r) => db.set(keyOf(r), filler(r.valueSize)),
+	append: (db, r) => db.append(keyOf(r), filler(r.valueSize)),
+	getSimple: (db, r) => db.get(keyOf(r)),
+	remove: (db, r) => db.remove(keyOf(r)),
+	increment: (db, r) => db.increment(keyOf(r), 1, 0),
+	count: (db) => db.count(),
+	getFileSize: (db) => db.getFileSize(),
+	getTimestamp: (db) => db.getTimestamp(),
+	inspect: (db) => db.inspect(),
+	shouldBeRebuilt: (db) => db.shouldBeRebuilt(),
+	sync: (db) => db.sync(false),
+};
+const WRITES = new Set(['set', 'compareExchange', 'append', 'remove', 'increment']);
+
+function open(args) {
+	const config = JSON.parse(fs.readFileSync(args.config, 'utf8'));
+	const dir = path.dirname(args.path) || '.';
+	fs.mkdirSync(dir, { recursive: true });
+	for (const file of fs.readdirSync(dir)) {
+		if (file.startsWith(path.basename(args.path))) fs.rmSync(path.join(dir, file));
+	}
+	const cls = { polyDBM, polyShardDBM }[args.target];
+	if (!cls) throw new Error(`Unknown target ${args.target}`);
+	return new cls(config, args.path);
+}
+
+async function preload(db, records, maxInflight) {
+	const first = new Map();
+	for (const r of records) {
+		if (r.keySize > 0 && REPLAY[r.op] && !first.has(r.keyHash)) first.set(r.keyHash, r);
+	}
+	const missing = [...first.values()].filter(r => !WRITES.has(r.op));
+	for (let i = 0; i < missing.length; i += maxInflight) {
+		await Promise.all(missing.slice(i, i + maxInflight).map(r =>
+			db.set(keyOf(r), filler(r.resultSize || r.valueSize || 100))));
+	}
+	return missing.length;
+}
+
+function percentiles(values) {
+	values.sort((a, b) => a - b);
+	const at = (q) => values.length ? values[Math.min(values.length - 1, Math.floor(q * values.length))] : 0;
+	return { p50: at(0.5), p99: at(0.99), p999: at(0.999), max: values.length ? values[values.length - 1] : 0 };
+}
+
+async function replay(db, records, args) {
+	const stats = {};
+	const lags = [];
+	let inflight = 0;
+	let skipped = 0;
+	let wakeUp = null;
+	const settled = () => {
+		inflight--;
+		if (wakeUp) {
+			wakeUp();
+			wakeUp = null;
+		}
+	};
+	const pending = [];
+	const start = process.hrtime.bigint();
+	const elapsedUs = () => Number(process.hrtime.bigint() - start) / 1000;
+	const firstUs = records.length ? records[0].arrivalUs : 0;
+
+	for (const r of records) {
+		const call = REPLAY[r.op];
+		if (!call) {
+			skipped++;
+			continue;
+		}
+		if (args.speed > 0) {
+			const dueUs = (r.arrivalUs - firstUs) / args.speed;
+			const waitMs = (dueUs - elapsedUs()) / 1000;
+			if (waitMs >= 1) {
+				await new Promise(resolve => setTimeout(resolve, waitMs));
+			}
+			lags.push(Math.max(0, elapsedUs() - dueUs) / 1000);
+		}
+		while (inflight >= args.maxInflight) {
+			await new Promise(resolve => { wakeUp = resolve; });
+		}
+		const op = (stats[r.op] ??= { latencies: [], original: [], errors: 0, originalErrors: 0 });
+		op.original.push(r.latencyUs);
+		if (r.error) op.originalErrors++;
+		inflight++;
+		const issued = process.hrtime.bigint();
+		pending.push(call(db, r).catch(() => { op.errors++; }).finally(() => {
+			op.latencies.push(Number(process.hrtime.bigint() - issued) / 1000);
+			settled();
+		}));
+	}
+	await Promise.all(pending);
+	const seconds = elapsedUs() / 1e6;
+
+	const operations = {};
+	let replayed = 0;
+	for (const [name, op] of Object.entries(stats)) {
+		replayed += op.latencies.length;
+		const latency = percentiles(op.latencies);
+		const original = percentiles(op.original);
+		operations[name] = {
+			count: op.latencies.length,
+			errors: op.errors,
+			originalErrors: op.originalErrors,
+			p50Us: latency.p50, p99Us: latency.p99, p999Us: latency.p999, maxUs: latency.max,
+			originalP50Us: original.p50, originalP99Us: original.p99, originalP999Us: original.p999,
+		};
+	}
+	const lag = percentiles(lags);
+	return { replayed, skipped, seconds, opsPerSec: replayed / seconds, lagMs: { p50: lag.p50, p99: lag.p99, max: lag.max }, operations };
+}
+
+const args = parseArgs(process.argv.slice(2));
+const trace = readTrace(args.trace);
+const db = open(args);
+const preloaded = args.preload ? await preload(db, trace.records, args.maxInflight) : 0;
+db.stats(true);
+const spanUs = trace.records.length ? trace.records[trace.records.length - 1].arrivalUs - trace.records[0].arrivalUs : 0;
+const result = {
+	trace: args.trace,
+	capturedAt: trace.startTime,
+	capturedSeconds: spanUs / 1e6,
+	target: args.target,
+	config: args.config,
+	speed: args.speed,
+	records: trace.records.length,
+	preloaded,
+	...(await replay(db, trace.records, args)),
+	native: db.stats().operations,
+};
+await db.close();
+console.log(JSON.stringify(result));
+if (args.out) {
+	fs.writeFileSync(args.out, JSON.stringify(result, null, 2));
+}
@@ -0,0 +1,298 @@
+// YCSB core workloads A-F against polyDBM, polyShardDBM or polyIndex.
+//
+//   node bench/ycsb.mjs [--workloads A,B,C,D,E,F] [--target polyDBM|polyShardDBM|polyIndex]
+//                       [--config tkrzw_config.json] [--path db/ycsb.tkh] [--records 100000]
+//                       [--operations 100000] [--concurrency 64] [--value-size 1000] [--max-scan 100]
+//                       [--out results.json]
+//
+// Each workload loads `records` records into a fresh database, then runs `operations` operations from
+// `concurrency` closed-loop clients (one awaited operation at a time each). Results, including the
+// native queue/execute split from stats(), are printed as JSON, one workload per line, and written
+// as an array to `--out` if given.
+//
+// Scans (workload E) go through the handle's single iterator, so they are serialized; the other
+// operations still run concurrently.
+
+import fs from 'node:fs';
+import path from 'node:path';
+import { polyDBM, polyShardDBM, polyIndex } from '../index.mjs';
+
+const WORKLOADS = {
+	A: { read: 0.5, update: 0.5, distribution: 'zipfian' },
+	B: { read: 0.95, update: 0.05, distribution: 'zipfian' },
+	C: { read: 1.0, distribution: 'zipfian' },
+	D: { read: 0.95, insert: 0.05, distribution: 'latest' },
+	E: { scan: 0.95, insert: 0.05, distribution: 'zipfian' },
+	F: { read: 0.5, readModifyWrite: 0.5, distribution: 'zipfian' },
+};
+
+function parseArgs(argv) {
+	const args = {
+		workloads: 'A,B,C,D,E,F',
+		target: 'polyDBM',
+		config: null,
+		path: null,
+		records: 100000,
+		operations: 100000,
+		concurrency: 64,
+		valueSize: 1000,
+		maxScan: 100,
+		out: null,
+	};
+	for (let i = 0; i < argv.length; i++) {
+		const [flag, inline] = argv[i].split('=', 2);
+		const name = flag.replace(/^--/, '').replace(/-([a-z])/g, (_, c) => c.toUpperCase());
+		if (!(name in args)) {
+			throw new Error(`Unknown option ${flag}`);
+		}
+		const value = inline ?? argv[++i];
+		args[name] = typeof args[name] === 'number' ? Number(value) : value;
+	}
+	args.config ??= args.target === 'polyIndex' ? 'tkrzw_index_config.json' : 'tkrzw_config.json';
+	args.path ??= args.target === 'polyIndex' ? 'db/ycsb_index.tkt' : 'db/ycsb.tkh';
+	return args;
+}
+
+// Zipfian over [0, n) with theta 0.99 (Gray et al., as in YCSB's ZipfianGenerator)
+class Zipfian {
+	constructor(n, theta = 0.99) {
+		this.theta = theta;
+		this.alpha = 1 / (1 - theta);
+		this.zeta2 = this.zeta(2);
+		this.resize(n);
+	}
+
+	zeta(n, from = 0, sum = 0) {
+		for (let i = from; i < n; i++) sum += 1 / Math.pow(i + 1, this.theta);
+		return sum;
+	}
+
+	// Grows incrementally, for the "latest" distribution as inserts extend the key space
+	resize(n) {
+		this.zetan = this.zeta(n, this.n ?? 0, this.zetan ?? 0);
+		this.n = n;
+		this.eta = (1 - Math.pow(2 / n, 1 - this.theta)) / (1 - this.zeta2 / this.zetan);
+	}
+
+	next() {
+		const u = Math.random();
+		const uz = u * this.zetan;
+		if (uz < 1) return 0;
+		if (uz < 1 + Math.pow(0.5, this.theta)) return 1;
+		return Math.floor(this.n * Math.pow(this.eta * u - this.eta + 1, this.alpha));
+	}
+}
+
+// FNV-1a 64 of the item number, as YCSB scrambles zipfian ranks so hot keys are spread out
+function fnv64(value) {
+	let hash = 0xcbf29ce484222325n;
+	for (let i = 0; i < 8; i++) {
+		hash ^= BigInt(value & 0xff);
+		hash = (hash * 0x100000001b3n) & 0xffffffffffffffffn;
+		value = Math.floor(value / 256);
+	}
+	return hash;
+}
+
+const keyOf = (i) => `user${String(i).padStart(10, '0')}`;
+
+class KeyChooser {
+	constructor(distribution, records) {
+		this.distribution = distribution;
+		this.count = records;
+		this.zipfian = new Zipfian(records);
+	}
+
+	next() {
+		if (this.distribution === 'latest') {
+			return this.count - 1 - Math.min(this.zipfian.next(), this.count - 1);
+		}
+		return Number(fnv64(this.zipfian.next()) % BigInt(this.count));
+	}
+
+	insert() {
+		const index = this.count++;
+		if (this.distribution === 'latest' && this.count % 1000 === 0) {
+			this.zipfian.resize(this.count);
+		}
+		return index;
+	}
+}
+
+// The YCSB operations on top of each binding
+function makeClient(target, db, valueSize) {
+	const value = () => 'v'.repeat(valueSize - 8) + String(Math.floor(Math.random() * 1e8)).padStart(8, '0');
+	let scanLock = Promise.resolve();
+	const serialize = (fn) => {
+		const run = scanLock.then(fn, fn);
+		scanLock = run.catch(() => {});
+		return run;
+	};
+	if (target === 'polyIndex') {
+		// An index record is a (key, value) pair; an update replaces the value
+		return {
+			insert: (key) => db.add(key, value()),
+			read: (key) => db.getValues(key, 1),
+			update: async (key) => {
+				const [old] = await db.getValues(key, 1);
+				if (old !== undefined) await db.remove(key, old);
+				await db.add(key, value());
+			},
+			scan: (key, length) => serialize(async () => {
+				await db.makeJumpIterator(key);
+				try {
+					for (let i = 0; i < length; i++) {
+						await db.getIteratorValue();
+						await db.continueIteration();
+					}
+				} catch (e) {
+					// End of the index
+				}
+			}),
+		};
+	}
+	return {
+		insert: (key) => db.set(key, value()),
+		read: (key) => db.get(key),
+		update: (key) => db.set(key, value()),
+		scan: (key, length) => serialize(async () => {
+			db.makeIterator();
+			try {
+				await db.iteratorJump(key);
+				for (let i = 0; i < length; i++) {
+					await db.iteratorGet();
+					await db.iteratorNext();
+				}
+			} catch (e) {
+				// End of the database
+			} finally {
+				db.freeIterator();
+			}
+		}),
+	};
+}
+
+class Recorder {
+	constructor() {
+		this.ops = {};
+	}
+
+	async time(name, fn) {
+		const op = (this.ops[name] ??= { latencies: [], errors: 0 });
+		const start = process.hrtime.bigint();
+		try {
+			await fn();
+		} catch (e) {
+			op.errors++;
+		}
+		op.latencies.push(Number(process.hrtime.bigint() - start) / 1000);
+	}
+
+	summary(seconds) {
+		const result = {};
+		for (const [name, { latencies, errors }] of Object.entries(this.ops)) {
+			latencies.sort((a, b) => a - b);
+			const at = (q) => latencies[Math.min(latencies.length - 1, Math.floor(q * latencies.length))];
+			result[name] = {
+				count: latencies.length,
+				errors,
+				opsPerSec: latencies.length / seconds,
+				avgUs: latencies.reduce((sum, l) => sum + l, 0) / latencies.length,
+				p50Us: at(0.5),
+				p95Us: at(0.95),
+				p99Us: at(0.99),
+				p999Us: at(0.999),
+				maxUs: latencies[latencies.length - 1],
+			};
+		}
+		return result;
+	}
+}
+
+function open(args) {
+	const config = JSON.parse(fs.readFileSync(args.config, 'utf8'));
+	for (const file of fs.readdirSync(path.dirname(args.path) || '.')) {
+		if (file.startsWith(path.basename(args.path))) fs.rmSync(path.join(path.dirname(args.path), file));
+	}
+	const cls = { polyDBM, polyShardDBM, polyIndex }[args.target];
+	if (!cls) throw new Error(`Unknown target ${args.target}`);
+	return new cls(config, args.path);
+}
+
+// Runs `count` operations from `concurrency` closed-loop clients
+async function drive(count, concurrency, step) {
+	let issued = 0;
+	const start = process.hrtime.bigint();
+	await Promise.all(Array.from({ length: Math.min(concurrency, count) }, async () => {
+		while (issued < count) {
+			issued++;
+			await step();
+		}
+	}));
+	return Number(process.hrtime.bigint() - start) / 1e9;
+}
+
+async function runWorkload(name, args) {
+	const spec = WORKLOADS[name];
+	if (!spec) throw new Error(`Unknown workload ${name}`);
+	fs.mkdirSync(path.dirname(args.path) || '.', { recursive: true });
+	const db = open(args);
+	const client = makeClient(args.target, db, args.valueSize);
+
+	let next = 0;
+	const loadSeconds = await drive(args.records, args.concurrency, () => client.insert(keyOf(next++)));
+	db.stats(true);
+
+	const chooser = new KeyChooser(spec.distribution, args.records);
+	const recorder = new Recorder();
+	const mix = Object.entries(spec).filter(([op]) => op !== 'distribution');
+	const choose = () => {
+		let r = Math.random();
+		for (const [op, share] of mix) {
+			if ((r -= share) < 0) return op;
+		}
+		return mix[mix.length - 1][0];
+	};
+	const seconds = await drive(args.operations, args.concurrency, () => {
+		const op = choose();
+		switch (op) {
+			case 'insert': return recorder.time(op, () => client.insert(keyOf(chooser.insert())));
+			case 'read': return recorder.time(op, () => client.read(keyOf(chooser.next())));
+			case 'update': return recorder.time(op, () => client.update(keyOf(chooser.next())));
+			case 'scan': return recorder.time(op, () => client.scan(keyOf(chooser.next()), 1 + Math.floor(Math.random() * args.maxScan)));
+			case 'readModifyWrite': return recorder.time(op, async () => {
+				const key = keyOf(chooser.next());
+				await client.read(key);
+				await client.update(key);
+			});
+		}
+	});
+
+	const result = {
+		workload: name,
+		target: args.target,
+		config: args.config,
+		records: args.records,
+		operations: args.operations,
+		concurrency: args.concurrency,
+		valueSize: args.valueSize,
+		load: { seconds: loadSeconds, opsPerSec: args.records / loadSeconds },
+		seconds,
+		opsPerSec: args.operations / seconds,
+		latencies: recorder.summary(seconds),
+		native: db.stats().operations,
+	};
+	await db.close();
+	return result;
+}
+
+const args = parseArgs(process.argv.slice(2));
+const results = [];
+for (const name of args.workloads.split(',').map(w => w.trim().toUpperCase())) {
+	const result = await runWorkload(name, args);
+	console.log(JSON.stringify(result));
+	results.push(result);
+}
+if (args.out) {
+	fs.writeFileSync(args.out, JSON.stringify(results, null, 2));
+}
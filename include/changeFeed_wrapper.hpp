@@ -0,0 +1,51 @@
+#ifndef CHANGEFEED_WRAPPER_HPP
+#define CHANGEFEED_WRAPPER_HPP
+
+#include "utils/ulog_feed.hpp"
+
+#include <deque>
+#include <memory>
+#include <napi.h>
+
+struct feed_requests;
+struct feed_batch
+{
+    std::vector<ulog_change> changes;
+    tkrzw::Status status;               // CANCELED_ERROR once the feed is closed: the request is done
+};
+
+void ResolveBatch(Napi::Env env, Napi::Function jsCallback, feed_requests* requests, feed_batch* batch);
+using FEED_TSFN = Napi::TypedThreadSafeFunction<feed_requests, feed_batch, ResolveBatch>;
+
+struct feed_requests
+{
+    std::deque<Napi::Promise::Deferred> pending;    // next() calls, answered in order
+    FEED_TSFN tsfn;                                 //Ref'ed only while `pending` is not empty
+};
+
+/**
+ * Async iterator over the update log of a database (`for await (const batch of db.changes())`)
+ *
+ * Created by polyDBM::changes() or directly with `new changeFeed(ulogPrefix, options)`.
+ * Every next() reads one batch on the feed's own thread (see ulog_feed), never on the libuv pool;
+ * an empty batch means nothing was logged within `waitMs`.
+ */
+class changeFeed_wrapper : public Napi::ObjectWrap<changeFeed_wrapper>
+{
+    private:
+        std::unique_ptr<ulog_feed> feed;
+        feed_requests* requests = nullptr;      //Owned by the TSFN (freed by its finalizer)
+        bool closed = false;
+
+    public:
+        static Napi::Object Init(Napi::Env env, Napi::Object exports);          //required by Node!
+        changeFeed_wrapper(const Napi::CallbackInfo& info);
+        Napi::Value next(const Napi::CallbackInfo& info);                       //async
+        Napi::Value finish(const Napi::CallbackInfo& info);                     //async, exposed as `return`
+        Napi::Value asyncIterator(const Napi::CallbackInfo& info);
+        Napi::Value getTimestamp(const Napi::CallbackInfo& info);
+        Napi::Value close(const Napi::CallbackInfo& info);
+        void Finalize(Napi::Env env);
+};
+
+#endif //CHANGEFEED_WRAPPER_HPP
@@ -3,12 +3,25 @@
 
 #include <napi.h>
 #include <tkrzw_dbm_poly.h>
+#include <tkrzw_dbm_shard.h>
 #include <tkrzw_index.h>
 #include <any>
 #include <vector>
 #include <map>
 #include <memory>
 #include "../include/utils/tsfn_types.hpp"  // Added include for TSFN
+#include "../include/utils/durability_manager.hpp"
+#include "../include/utils/maintenance_scheduler.hpp"
+#include "../include/utils/op_stats.hpp"
+#include "../include/utils/op_tracer.hpp"
+#include "../include/utils/op_capture.hpp"
+#include "../include/utils/hot_keys.hpp"
+#include "../include/utils/inflight_tracker.hpp"
+#include "../include/utils/cancel_binding.hpp"
+#include "../include/utils/counter_aggregator.hpp"
+#include "../include/utils/write_batch.hpp"
+#include "../include/utils/op_pipeline.hpp"
+#include "../include/utils/scan_aggregate.hpp"
 
 // Async worker for DBM and Index operations
 class dbmAsyncWorker : public Napi::AsyncWorker {
@@ -34,12 +47,20 @@ public:
         DBM_CLEAR,
         DBM_INSPECT,
         DBM_SHOULD_BE_REBUILT,
-        DBM_REBUILD,
         DBM_SYNC,
         DBM_SEARCH,
         DBM_EXPORT_KEYS_AS_LINES,
         DBM_RESTORE_DATABASE,
         DBM_PROCESS,
+        DBM_PREFETCH,
+        DBM_EVICT,
+        DBM_CLOSE,
+        DBM_FLUSH_COUNTERS,
+        DBM_GET_WITH_VERSION,
+        DBM_SET_IF_VERSION,
+        DBM_WRITE_BATCH,
+        DBM_PIPELINE,
+        DBM_AGGREGATE,
 
         // Iterator operations
         ITERATOR_FIRST,
@@ -63,13 +84,15 @@ public:
         INDEX_SYNC,
         INDEX_MAKE_JUMP_ITERATOR,
         INDEX_GET_ITERATOR_VALUE,
-        INDEX_CONTINUE_ITERATION
+        INDEX_CONTINUE_ITERATION,
+
+        OPERATION_TYPE_COUNT
     };
 
     // Constructors
     template <typename... argTypes>
     dbmAsyncWorker(const Napi::Env& env,
-                   tkrzw::PolyDBM& dbmReference,
+                   tkrzw::ParamDBM& dbmReference,
                    OPERATION_TYPE operation,
                    argTypes... paramPack)
         : Napi::AsyncWorker(env),
@@ -108,12 +131,68 @@ public:
     void OnOK() override;
     void OnError(const Napi::Error& err) override;
 
+    // True for operations that may modify the database
+    static bool IsWriteOperation(OPERATION_TYPE operation);
+
+    // True for operations walking the whole database (scans), shed first by the "shed" admission policy
+    static bool IsScanOperation(OPERATION_TYPE operation);
+    OPERATION_TYPE GetOperation() const { return operation; }
+
+    // Keys and values of the parameters, as counted towards `bytesIn` and `max_inflight_bytes`
+    uint64_t ParamBytes() const;
+
+    // Name of the JS method of an operation, as used in stats()
+    static const char* OperationName(size_t operation);
+
+    // Settles without running (e.g. the handle is closing): releases processor TSFNs, rejects with `code` if
+    // given and deletes the worker
+    Napi::Promise RejectUnqueued(const std::string& message, const char* code = nullptr);
+
     // Promise handle
     Napi::Promise::Deferred deferred_promise;
 
+    // Set by the wrapper in "periodic"/"group" durability mode; writes resolve through it
+    std::shared_ptr<durability_manager> durability;
+
+    // Set by the wrapper while maintenance is scheduled; writes count towards its write rate
+    std::shared_ptr<maintenance_scheduler> maintenance;
+
+    // Set by the wrapper along with `queued_at` when the worker is queued
+    std::shared_ptr<op_stats> stats;
+    std::chrono::steady_clock::time_point queued_at;
+    std::shared_ptr<op_tracer> tracer;      // Only while the handle is tracing
+    std::shared_ptr<op_capture> capture;    // Only while the handle is capturing
+    std::shared_ptr<hot_key_tracker> hot_keys;  // Only while the handle tracks hot keys
+    std::shared_ptr<inflight_tracker> inflight; // Settled last in OnOK()/OnError()
+    uint64_t admitted_bytes = 0;                // Counted by `inflight` towards max_inflight_bytes
+    std::shared_ptr<cancel_token> cancel;       // Only if the call passed {signal, deadlineMs}
+    cancel_binding cancel_js;                   // Its "abort" listener, detached when the Promise settles
+    std::shared_ptr<counter_aggregator> counters;   // Only with `counters: "write_behind"`
+
 private:
+    void ExecuteOperation();
+    void ResolveResult();
+    Napi::Value VersionResult();
+    Napi::Value PipelineResult();
+    void Observe(std::chrono::steady_clock::time_point resolve_start, bool error);
+    void RecordHotKeys();
+    const std::string* OperationKey() const;
+    void FlushCounterKeys();
+    bool StopIfCancelled();
+    void ReleaseProcessors();
+    uint64_t ResultBytes() const;
+
+    // Set by Execute() when stats, a tracer, a capture or hot keys are attached
+    std::chrono::steady_clock::time_point execute_start;
+    std::chrono::steady_clock::time_point execute_end;
+    std::thread::id execute_thread;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    bool cancelled = false;     // Stopped by `cancel`; the rejection gets its code
+    bool wrote = false;         // Set by ExecuteOperation() if records may have been written
+
     // References to DBM, Iterator, or Index
-    tkrzw::PolyDBM* dbmReference = nullptr;
+    tkrzw::ParamDBM* dbmReference = nullptr;     // tkrzw::PolyDBM or shard_dbm
     std::unique_ptr<tkrzw::DBM::Iterator>* iteratorReference = nullptr;
     tkrzw::PolyIndex* indexReference = nullptr;
 
@@ -0,0 +1,76 @@
+#ifndef POLYDBMCLIENT_WRAPPER_HPP
+#define POLYDBMCLIENT_WRAPPER_HPP
+
+#include "utils/socket_client.hpp"
+#include "utils/wire_protocol.hpp"
+
+#include <map>
+#include <memory>
+#include <napi.h>
+
+// A request waiting for its response; only touched on the main thread
+struct client_request
+{
+    uint8_t opcode;
+    Napi::Promise::Deferred deferred;
+};
+
+struct client_requests;
+struct client_responses
+{
+    std::vector<wire_message> responses;
+    bool closed;                        // The connection ended: every request left fails
+};
+
+void ResolveResponses(Napi::Env env, Napi::Function jsCallback, client_requests* requests, client_responses* batch);
+using CLIENT_TSFN = Napi::TypedThreadSafeFunction<client_requests, client_responses, ResolveResponses>;
+
+struct client_requests
+{
+    std::map<uint32_t, client_request> pending;
+    CLIENT_TSFN tsfn;                   //Ref'ed only while `pending` is not empty
+};
+
+/**
+ * Client of a database served by `polyDBM.serve()` (e.g. from another cluster process)
+ *
+ * Implements the record and information methods of polyDBM over the server's Unix socket.
+ * Calls never wait for earlier ones to be answered, so many requests can be in flight on one
+ * connection; processors and iterators are not available remotely.
+ */
+class polyDBMClient_wrapper : public Napi::ObjectWrap<polyDBMClient_wrapper>
+{
+    private:
+        std::unique_ptr<socket_client> client;
+        client_requests* requests = nullptr;    //Owned by the TSFN (freed by its finalizer)
+        uint32_t next_id = 1;
+
+        Napi::Value request(Napi::Env env, uint8_t opcode, std::vector<std::string> fields);
+        void shutdown();
+
+    public:
+        static Napi::Object Init(Napi::Env env, Napi::Object exports);          //required by Node!
+        polyDBMClient_wrapper(const Napi::CallbackInfo& info);
+        Napi::Value set(const Napi::CallbackInfo& info);                        //async
+        Napi::Value append(const Napi::CallbackInfo& info);                     //async
+        Napi::Value getSimple(const Napi::CallbackInfo& info);                  //async
+        Napi::Value remove(const Napi::CallbackInfo& info);                     //async
+        Napi::Value compareExchange(const Napi::CallbackInfo& info);            //async
+        Napi::Value increment(const Napi::CallbackInfo& info);                  //async
+        Napi::Value compareExchangeMulti(const Napi::CallbackInfo& info);       //async
+        Napi::Value rekey(const Napi::CallbackInfo& info);                      //async
+        Napi::Value count(const Napi::CallbackInfo& info);                      //async
+        Napi::Value getFileSize(const Napi::CallbackInfo& info);                //async
+        Napi::Value getFilePath(const Napi::CallbackInfo& info);                //async
+        Napi::Value getTimestamp(const Napi::CallbackInfo& info);               //async
+        Napi::Value clear(const Napi::CallbackInfo& info);                      //async
+        Napi::Value sync(const Napi::CallbackInfo& info);                       //async
+        Napi::Value inspect(const Napi::CallbackInfo& info);                    //async
+        Napi::Value search(const Napi::CallbackInfo& info);                     //async
+        Napi::Value ping(const Napi::CallbackInfo& info);                       //async
+        Napi::Value isOpen(const Napi::CallbackInfo& info);
+        Napi::Value close(const Napi::CallbackInfo& info);
+        void Finalize(Napi::Env env);
+};
+
+#endif //POLYDBMCLIENT_WRAPPER_HPP
@@ -2,21 +2,59 @@
 #define POLYDBM_WRAPPER_HPP
 
 #include <tkrzw_dbm_poly.h>
+#include <tkrzw_dbm_shard.h>
 #include "config_parser.hpp"
 #include "dbm_async_worker.hpp"
 #include <napi.h>
 #include "utils/globals.hpp"
+#include "utils/dbm_registry.hpp"
+#include "utils/shard_dbm.hpp"
+#include "utils/socket_server.hpp"
+#include "utils/rebuild_task.hpp"
+#include "utils/ulog_replicator.hpp"
+#include "utils/page_cache.hpp"
+#include "utils/open_task.hpp"
+#include "utils/noack_writer.hpp"
 #include <iostream>
 
+/**
+ * Backs both `polyDBM` (tkrzw::PolyDBM) and `polyShardDBM` (shard_dbm); the JS classes
+ * share every method and differ only in the DBM created by the constructor.
+ */
 class polyDBM_wrapper : public Napi::ObjectWrap<polyDBM_wrapper>
 {
     private:
-        tkrzw::PolyDBM dbm;
+        std::shared_ptr<tkrzw::ParamDBM> dbm;     //Shared through dbm_registry with other instances on the same path
         std::unique_ptr<tkrzw::DBM::Iterator> iterator;
+        std::string ulog_prefix;        //Empty unless the update log is enabled
+        std::unique_ptr<ulog_replicator> replicator;    //Set by replicate(); stopped before the DBM is closed
+        std::shared_ptr<durability_manager> durability; //Only in "periodic"/"group" durability mode
+        std::unique_ptr<socket_server> server;          //Set by serve(); stopped before the DBM is closed
+        std::unique_ptr<rebuild_task> rebuilder;        //The last rebuild(); cancelled and joined before the DBM is closed
+        std::shared_ptr<maintenance_scheduler> maintenance; //Set by startMaintenance(); also held by queued workers
+        std::vector<std::shared_ptr<maintenance_scheduler>> stopped_maintenance;  //May still finish a rebuild; joined by close()
+        std::shared_ptr<op_stats> stats = std::make_shared<op_stats>(dbmAsyncWorker::OPERATION_TYPE_COUNT);
+        std::shared_ptr<op_tracer> tracer;  //The last startTrace(); kept after stopTrace() for writeTrace()/slowOps()
+        bool tracing = false;
+        std::shared_ptr<op_capture> capture;    //Set by startCapture(); also held by queued workers
+        std::shared_ptr<hot_key_tracker> hot_keys;  //Set by trackHotKeys(); also held by queued workers
+        bool cache_buckets = false;     //From the config, for memoryStats(); tkrzw has no getter for it
+        std::shared_ptr<inflight_tracker> inflight = std::make_shared<inflight_tracker>();  //With the admission limits of the config
+        Napi::ObjectReference closing;  //Promise of the first close(), returned by later calls
+        std::shared_ptr<noack_writer> noack;    //Started by the first unacknowledged write; drained before the DBM is closed
+        std::shared_ptr<counter_aggregator> counters;   //Only with `counters: "write_behind"`; flushed before the DBM is closed
+
+        Napi::Value queueWorker(dbmAsyncWorker* asyncWorker, const Napi::CallbackInfo& info);
+        noack_writer* noAckWriter(Napi::Env env);
+        Napi::Value queueNoAck(Napi::Env env, noack_write* write);
+        static bool ParseOpenConfig(Napi::Env env, Napi::Value config, const std::string& path, bool sharded,
+                                    std::map<std::string, std::string>* params, durability_config* durability_conf,
+                                    admission_config* admission_conf, counter_config* counter_conf);
     
     public:
         static Napi::Object Init(Napi::Env env, Napi::Object exports);
         polyDBM_wrapper(const Napi::CallbackInfo& info);
+        static Napi::Value open(const Napi::CallbackInfo& info);
         
         // Existing methods
         Napi::Value set(const Napi::CallbackInfo& info);
@@ -24,16 +62,43 @@ class polyDBM_wrapper : public Napi::ObjectWrap<polyDBM_wrapper>
         Napi::Value getSimple(const Napi::CallbackInfo& info);
         Napi::Value shouldBeRebuilt(const Napi::CallbackInfo& info);
         Napi::Value rebuild(const Napi::CallbackInfo& info);
+        Napi::Value cancelRebuild(const Napi::CallbackInfo& info);
+        Napi::Value startMaintenance(const Napi::CallbackInfo& info);
+        Napi::Value maintenanceStatus(const Napi::CallbackInfo& info);
+        Napi::Value stopMaintenance(const Napi::CallbackInfo& info);
+        Napi::Value getStats(const Napi::CallbackInfo& info);
+        Napi::Value startTrace(const Napi::CallbackInfo& info);
+        Napi::Value stopTrace(const Napi::CallbackInfo& info);
+        Napi::Value writeTrace(const Napi::CallbackInfo& info);
+        Napi::Value slowOps(const Napi::CallbackInfo& info);
+        Napi::Value startCapture(const Napi::CallbackInfo& info);
+        Napi::Value stopCapture(const Napi::CallbackInfo& info);
+        Napi::Value trackHotKeys(const Napi::CallbackInfo& info);
+        Napi::Value hotKeys(const Napi::CallbackInfo& info);
+        Napi::Value memoryStats(const Napi::CallbackInfo& info);
+        Napi::Value prefetch(const Napi::CallbackInfo& info);
+        Napi::Value evict(const Napi::CallbackInfo& info);
         Napi::Value sync(const Napi::CallbackInfo& info);
         Napi::Value process(const Napi::CallbackInfo& info);
         Napi::Value close(const Napi::CallbackInfo& info);
+        Napi::Value setNoAck(const Napi::CallbackInfo& info);
+        Napi::Value appendNoAck(const Napi::CallbackInfo& info);
+        Napi::Value incrementNoAck(const Napi::CallbackInfo& info);
+        Napi::Value flushNoAck(const Napi::CallbackInfo& info);
+        Napi::Value onNoAckError(const Napi::CallbackInfo& info);
+        Napi::Value noAckStats(const Napi::CallbackInfo& info);
+        Napi::Value flushCounters(const Napi::CallbackInfo& info);
         
         // NEW: Additional DBM methods
         Napi::Value get(const Napi::CallbackInfo& info);
         Napi::Value remove(const Napi::CallbackInfo& info);
         Napi::Value compareExchange(const Napi::CallbackInfo& info);
+        Napi::Value getWithVersion(const Napi::CallbackInfo& info);
+        Napi::Value setIfVersion(const Napi::CallbackInfo& info);
         Napi::Value increment(const Napi::CallbackInfo& info);
         Napi::Value compareExchangeMulti(const Napi::CallbackInfo& info);
+        Napi::Value batch(const Napi::CallbackInfo& info);
+        Napi::Value pipeline(const Napi::CallbackInfo& info);
         Napi::Value rekey(const Napi::CallbackInfo& info);
         Napi::Value processMulti(const Napi::CallbackInfo& info);
         Napi::Value processFirst(const Napi::CallbackInfo& info);
@@ -49,6 +114,7 @@ class polyDBM_wrapper : public Napi::ObjectWrap<polyDBM_wrapper>
         Napi::Value isHealthy(const Napi::CallbackInfo& info);
         Napi::Value isOrdered(const Napi::CallbackInfo& info);
         Napi::Value search(const Napi::CallbackInfo& info);
+        Napi::Value aggregate(const Napi::CallbackInfo& info);
         
         // NEW: Iterator methods
         Napi::Value makeIterator(const Napi::CallbackInfo& info);
@@ -71,7 +137,20 @@ class polyDBM_wrapper : public Napi::ObjectWrap<polyDBM_wrapper>
         
         // NEW: Restoration methods
         Napi::Value restoreDatabase(const Napi::CallbackInfo& info);
+
+        // Update log
+        Napi::Value changes(const Napi::CallbackInfo& info);
+        Napi::Value replicate(const Napi::CallbackInfo& info);
+        Napi::Value replicationStatus(const Napi::CallbackInfo& info);
+        Napi::Value stopReplication(const Napi::CallbackInfo& info);
+
+        // Server mode (see polyDBMClient)
+        Napi::Value serve(const Napi::CallbackInfo& info);
+        Napi::Value stopServing(const Napi::CallbackInfo& info);
         
+        // Queues writeBatch::commit(); `info` carries its options
+        Napi::Value commitBatch(std::shared_ptr<const write_batch> ops, bool atomic, const Napi::CallbackInfo& info);
+
         void Finalize(Napi::Env env);
 };
 
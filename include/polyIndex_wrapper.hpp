@@ -4,6 +4,7 @@
 #include <tkrzw_index.h>
 #include "config_parser.hpp"
 #include "dbm_async_worker.hpp"
+#include "utils/open_task.hpp"
 
 #include <memory>       //For std::unique_ptr
 #include <napi.h>
@@ -11,12 +12,17 @@
 class polyIndex_wrapper : public Napi::ObjectWrap<polyIndex_wrapper>
 {
     private:
-        tkrzw::PolyIndex index;
+        std::unique_ptr<tkrzw::PolyIndex> index = std::make_unique<tkrzw::PolyIndex>();     //Replaced by the one polyIndex.open() opened
         std::unique_ptr<tkrzw::PolyIndex::Iterator> jump_iter;
+        std::shared_ptr<durability_manager> durability;     //Only in "periodic"/"group" durability mode
+        std::shared_ptr<op_stats> stats = std::make_shared<op_stats>(dbmAsyncWorker::OPERATION_TYPE_COUNT);
+
+        Napi::Value queueWorker(dbmAsyncWorker* asyncWorker);
 
     public:
         static Napi::Object Init(Napi::Env env, Napi::Object exports);          //required by Node!
         polyIndex_wrapper(const Napi::CallbackInfo& info);
+        static Napi::Value open(const Napi::CallbackInfo& info);                //async
         Napi::Value add(const Napi::CallbackInfo& info);                        //async
         Napi::Value getValues(const Napi::CallbackInfo& info);                  //async
         Napi::Value check(const Napi::CallbackInfo& info);                      //async
@@ -28,6 +34,7 @@ class polyIndex_wrapper : public Napi::ObjectWrap<polyIndex_wrapper>
         Napi::Value getIteratorValue(const Napi::CallbackInfo& info);           //async
         Napi::Value continueIteration(const Napi::CallbackInfo& info);          //async
         Napi::Value freeIterator(const Napi::CallbackInfo& info);
+        Napi::Value getStats(const Napi::CallbackInfo& info);
         Napi::Value close(const Napi::CallbackInfo& info);
         void Finalize(Napi::Env env);
 };
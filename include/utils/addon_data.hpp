@@ -0,0 +1,22 @@
+#ifndef ADDON_DATA_HPP
+#define ADDON_DATA_HPP
+
+#include <napi.h>
+
+/**
+ * Per-environment data of the addon (one instance per main thread / worker_thread)
+ *
+ * Set with `env.SetInstanceData()` in InitAll(); each class stores its constructor here so
+ * native code can create instances (e.g. polyDBM::changes() returning a changeFeed).
+ */
+struct addon_data
+{
+    Napi::FunctionReference polyDBM_constructor;
+    Napi::FunctionReference polyShardDBM_constructor;
+    Napi::FunctionReference polyIndex_constructor;
+    Napi::FunctionReference changeFeed_constructor;
+    Napi::FunctionReference polyDBMClient_constructor;
+    Napi::FunctionReference writeBatch_constructor;
+};
+
+#endif //ADDON_DATA_HPP
@@ -0,0 +1,35 @@
+#ifndef CANCEL_BINDING_HPP
+#define CANCEL_BINDING_HPP
+
+#include <memory>
+#include <napi.h>
+#include "cancel_token.hpp"
+
+/**
+ * The JS side of a cancel_token: the "abort" listener it added to an AbortSignal
+ *
+ * Only used on the JS thread. Detach() removes the listener once the operation has settled, so a
+ * long-lived signal doesn't collect one listener per operation.
+ */
+class cancel_binding
+{
+    public:
+        /**
+         * Reads `{signal, deadlineMs}`; nullptr if `options` has neither. The token of a signal that
+         * is already aborted comes back cancelled.
+         */
+        static std::shared_ptr<cancel_token> FromOptions(Napi::Env env, Napi::Value options, cancel_binding* binding);
+
+        /**
+         * True if `value` is an options object for FromOptions(), as the last argument of any async method
+         */
+        static bool IsOptions(Napi::Value value);
+
+        void Detach();
+
+    private:
+        Napi::ObjectReference signal;
+        Napi::FunctionReference listener;
+};
+
+#endif //CANCEL_BINDING_HPP
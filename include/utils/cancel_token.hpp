@@ -0,0 +1,63 @@
+#ifndef CANCEL_TOKEN_HPP
+#define CANCEL_TOKEN_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string_view>
+#include <tkrzw_dbm.h>
+
+/**
+ * Cancellation of one operation by an AbortSignal, a deadline, or both
+ *
+ * Aborted on the JS thread by the signal's "abort" listener and polled from any thread: by Execute()
+ * before an operation starts, and between records by the loops of the scans. Holds no JS state, so
+ * it may be released on whichever thread drops it last; cancel_binding is its JS side.
+ */
+class cancel_token
+{
+    public:
+        explicit cancel_token(double deadline_ms)       // Negative: no deadline
+            : has_deadline(deadline_ms >= 0),
+              deadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double, std::milli>(deadline_ms >= 0 ? deadline_ms : 0.0))) {}
+
+        void Abort() { aborted.store(true, std::memory_order_relaxed); }
+        bool IsAborted() const { return aborted.load(std::memory_order_relaxed); }
+        bool IsCancelled() const
+        {
+            return IsAborted() || (has_deadline && std::chrono::steady_clock::now() >= deadline);
+        }
+
+        // Message and `code` of the error an operation is rejected with once cancelled
+        const char* Message() const { return IsAborted() ? "The operation was aborted" : "Deadline exceeded"; }
+        const char* Code() const { return IsAborted() ? "ABORT_ERR" : "ETIMEDOUT"; }
+
+    private:
+        std::atomic<bool> aborted{false};
+        bool has_deadline;
+        std::chrono::steady_clock::time_point deadline;
+};
+
+/**
+ * Forwards to `proc` until the token is cancelled; the remaining records are then left as they are
+ * without calling `proc`, since tkrzw's ProcessEach() can't be stopped midway
+ */
+class cancellable_processor final : public tkrzw::DBM::RecordProcessor
+{
+    public:
+        cancellable_processor(tkrzw::DBM::RecordProcessor* proc, const cancel_token* cancel) : proc(proc), cancel(cancel) {}
+
+        std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+            return cancel->IsCancelled() ? NOOP : proc->ProcessFull(key, value);
+        }
+        std::string_view ProcessEmpty(std::string_view key) override {
+            return proc->ProcessEmpty(key);
+        }
+
+    private:
+        tkrzw::DBM::RecordProcessor* proc;
+        const cancel_token* cancel;
+};
+
+#endif //CANCEL_TOKEN_HPP
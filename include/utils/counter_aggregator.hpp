@@ -0,0 +1,131 @@
+#ifndef COUNTER_AGGREGATOR_HPP
+#define COUNTER_AGGREGATOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <tkrzw_dbm.h>
+
+/**
+ * Binding-level config keys (removed from the config before it reaches tkrzw):
+ *   counters                    "direct" (default) | "write_behind"
+ *   counter_flush_interval_ms   Period of the background flush in "write_behind" mode (default 1000)
+ *   counter_flush_threshold     Increments since the last flush that start one early (default 10000; 0: interval only)
+ */
+struct counter_config
+{
+    bool write_behind = false;
+    double interval = 1.0;          // Seconds
+    int64_t threshold = 10000;
+
+    /**
+     * Moves the counter keys out of `params`
+     * @return false with `error` set if a key has an invalid value
+     */
+    static bool Extract(std::map<std::string, std::string>& params, counter_config* config, std::string* error);
+};
+
+/**
+ * Write-behind counters: increment() adds to an in-memory delta instead of writing the record
+ *
+ * Deltas live in sharded maps of atomics. A flush thread applies each key's delta to the DBM with
+ * one read-modify-write, every interval or once `threshold` increments have accumulated. A delta
+ * is taken inside the flush's writable Process() on the key, so a read, which adds the delta inside
+ * a read-only Process() on the same key, sees either the old record plus the delta or the new
+ * record; never both or neither. A delta whose write fails is put back and retried by the next
+ * flush, so nothing acknowledged is lost while the process runs (at-least-once); a crash loses at
+ * most one interval of increments. Keys idle for a whole interval are dropped from memory.
+ * Other writes of a counter go through Set()/Remove(), which drop its delta in the same write, or
+ * run after FlushKeys(), so no later flush undoes them.
+ */
+class counter_aggregator
+{
+    public:
+        counter_aggregator(tkrzw::DBM* dbm, const counter_config& config, std::function<void()> on_flushed);
+        ~counter_aggregator();
+
+        /**
+         * Adds `delta` to the key; `current` is set to the stored value plus the pending delta, like DBM::Increment()
+         */
+        tkrzw::Status Increment(std::string_view key, int64_t delta, int64_t* current, int64_t initial);
+
+        /**
+         * Like DBM::GetSimple(), with the pending delta of a counter applied to its value
+         */
+        std::string GetSimple(std::string_view key, std::string_view default_value);
+
+        /**
+         * Like DBM::Set() and DBM::Remove(), dropping the pending delta of a counter in the same write
+         */
+        tkrzw::Status Set(std::string_view key, std::string_view value);
+        tkrzw::Status Remove(std::string_view key);
+
+        /**
+         * Applies the pending deltas of `keys` now, before another write of those records
+         */
+        tkrzw::Status FlushKeys(const std::vector<std::string_view>& keys);
+
+        /**
+         * Applies every pending delta now; the last failure if any
+         */
+        tkrzw::Status Flush();
+
+        /**
+         * Forgets the pending deltas and clears the DBM
+         */
+        tkrzw::Status Clear();
+
+        /**
+         * Flushes what is pending and stops the thread; later increments go straight to the DBM
+         */
+        void Stop();
+
+        size_t Keys();
+        int64_t Pending() const { return unflushed.load(); }
+        uint64_t Flushes() const { return flushes.load(); }
+        uint64_t Failed() const { return failed.load(); }
+
+    private:
+        struct counter
+        {
+            std::atomic<int64_t> delta{0};
+            std::atomic<int64_t> initial{0};    // Of the latest increment, used if the record doesn't exist
+            std::atomic<bool> touched{true};    // Incremented since the previous flush
+        };
+        struct shard
+        {
+            std::shared_mutex mutex;            // Shared by increments and reads, exclusive to add or drop keys
+            std::unordered_map<std::string, std::shared_ptr<counter>> counters;
+        };
+        static constexpr size_t NUM_SHARDS = 64;
+
+        shard& ShardOf(std::string_view key);
+        tkrzw::Status Replace(std::string_view key, std::string_view value);
+        void Run();
+
+        tkrzw::DBM* dbm;
+        counter_config config;
+        std::function<void()> on_flushed;   // Called by the flush thread after it wrote something
+        shard shards[NUM_SHARDS];
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool flush_requested = false;
+        bool stopping = false;
+        std::atomic<bool> stopped{false};
+        std::mutex flush_mutex;             // One flush at a time (the thread's, flushCounters() or Stop()'s), or Clear()
+        std::atomic<int64_t> unflushed{0};  // Increments since the last flush
+        std::atomic<uint64_t> flushes{0};
+        std::atomic<uint64_t> failed{0};
+};
+
+#endif //COUNTER_AGGREGATOR_HPP
@@ -0,0 +1,73 @@
+#ifndef DBM_REGISTRY_HPP
+#define DBM_REGISTRY_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tkrzw_dbm_poly.h>      // tkrzw::ParamDBM
+
+/**
+ * Process-wide registry of open databases, keyed by absolute path
+ *
+ * Native addons are loaded once per process, so this registry is shared by the main thread and
+ * every worker_thread. Opening a path that is already open attaches to the same tkrzw DBM
+ * (same mmap regions, caches and locks) instead of opening the files a second time; the DBM is
+ * closed when its last user releases it. In-memory databases (empty path) are never shared.
+ *
+ * Opening and closing run outside the registry lock, so a long crash recovery on one path doesn't
+ * hold up the other paths: the entry of the path is marked as opening or closing meanwhile, and
+ * other callers for that path wait until it is settled.
+ */
+class dbm_registry
+{
+    public:
+        /**
+         * Attaches to the DBM open at `path`, or creates one with `make` and opens it with `open`
+         * @param path Database path as given by the user
+         * @param sharded Kind of DBM wanted; attaching to the other kind is an error
+         * @param make Creates an unopened DBM
+         * @param open Opens the DBM created by `make` (called without the registry lock; other
+         *             callers for the path wait for it)
+         * @param handle Receives the shared DBM
+         * @param attached Set to true if an already open DBM was shared
+         */
+        static tkrzw::Status Acquire(const std::string& path, bool sharded,
+                                     const std::function<std::shared_ptr<tkrzw::ParamDBM>()>& make,
+                                     const std::function<tkrzw::Status(tkrzw::ParamDBM*)>& open,
+                                     std::shared_ptr<tkrzw::ParamDBM>* handle, bool* attached = nullptr);
+
+        /**
+         * Drops one user of `*handle`; the last one closes the DBM and gets the status of Close()
+         *
+         * `*handle` is replaced by an unopened DBM of the same kind, so the caller behaves like
+         * a closed database afterwards while other users keep working.
+         */
+        static tkrzw::Status Release(std::shared_ptr<tkrzw::ParamDBM>* handle);
+
+        /**
+         * Number of users of the DBM open at `path` (0 if not open)
+         */
+        static size_t CountUsers(const std::string& path);
+
+    private:
+        struct entry
+        {
+            enum state_type { OPENING, OPEN, CLOSING };
+
+            std::shared_ptr<tkrzw::ParamDBM> dbm;   // Null while opening
+            bool sharded;
+            size_t users;
+            state_type state;
+        };
+
+        static std::string MakeKey(const std::string& path);
+
+        static std::mutex mutex;                    // Guards `entries`, never held while opening or closing
+        static std::condition_variable settled;     // Notified when an entry stops opening or closing
+        static std::map<std::string, entry> entries;
+};
+
+#endif //DBM_REGISTRY_HPP
@@ -0,0 +1,121 @@
+#ifndef DURABILITY_MANAGER_HPP
+#define DURABILITY_MANAGER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <napi.h>
+#include <tkrzw_lib_common.h>
+
+/**
+ * Binding-level config keys (removed from the config before it reaches tkrzw):
+ *   durability              "close" (default) | "none" | "periodic" | "group"
+ *   durability_interval_ms  Period of the background sync in "periodic" mode (default 1000)
+ *   group_commit_window_ms  How long a group waits for more writers before syncing (default 2)
+ */
+struct durability_config
+{
+    enum MODE
+    {
+        DURABILITY_CLOSE,       // tkrzw::File::OPEN_SYNC_HARD: physical sync when the file is closed
+        DURABILITY_NONE,        // No physical sync at all, not even on close
+        DURABILITY_PERIODIC,    // Background Synchronize(true) every interval while there are writes
+        DURABILITY_GROUP        // Write Promises resolve after a Synchronize(true) shared by the group
+    };
+
+    MODE mode = DURABILITY_CLOSE;
+    double interval = 1.0;          // Seconds
+    double group_window = 0.002;    // Seconds
+
+    /**
+     * Moves the durability keys out of `params`
+     * @return false with `error` set if a key has an invalid value
+     */
+    static bool Extract(std::map<std::string, std::string>& params, durability_config* config, std::string* error);
+
+    /**
+     * Open options for tkrzw matching the mode
+     */
+    int32_t GetOpenOptions() const;
+};
+
+// A write waiting for the group sync; only touched on the main thread
+struct durability_waiter
+{
+    uint64_t ticket;
+    Napi::Promise::Deferred deferred;
+    Napi::Reference<Napi::Value> result;
+};
+
+struct durability_waiters;
+struct durability_synced
+{
+    uint64_t ticket;                // Every waiter with a ticket up to this one is covered
+    tkrzw::Status status;
+};
+
+void ResolveDurable(Napi::Env env, Napi::Function jsCallback, durability_waiters* waiters, durability_synced* synced);
+using DURABILITY_TSFN = Napi::TypedThreadSafeFunction<durability_waiters, durability_synced, ResolveDurable>;
+
+struct durability_waiters
+{
+    std::deque<durability_waiter> pending;
+    DURABILITY_TSFN tsfn;           //Ref'ed only while `pending` is not empty
+};
+
+/**
+ * Runs the sync thread of the "periodic" and "group" modes
+ *
+ * Workers hand their Promise to OnWrite() (main thread) after a write was executed. In group
+ * mode the Promise is parked with the ticket of the next sync to start; the sync thread waits
+ * `group_window` for more writers, runs one Synchronize(true) and resolves every parked Promise
+ * through a thread-safe function.
+ */
+class durability_manager
+{
+    public:
+        durability_manager(Napi::Env env, std::function<tkrzw::Status(bool)> sync, const durability_config& config);
+        ~durability_manager();
+
+        /**
+         * Resolves (or parks) the Promise of an executed write; main thread only
+         */
+        void OnWrite(Napi::Env env, Napi::Promise::Deferred deferred, Napi::Value result);
+
+        /**
+         * Counts a write that has no Promise (an unacknowledged write) towards the next sync; any thread
+         */
+        void NoteWrite();
+
+        /**
+         * Syncs what is pending and stops the thread; later writes resolve at once
+         */
+        void Stop();
+
+        int64_t GetSyncCount() const { return sync_count.load(); }
+
+    private:
+        void Run();
+
+        std::function<tkrzw::Status(bool)> sync;
+        durability_config config;
+        durability_waiters* waiters;    //Owned by the TSFN (freed by its finalizer)
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cond;
+        uint64_t next_ticket = 1;       //Ticket of the next sync to start
+        bool has_waiters = false;
+        bool dirty = false;
+        bool stopping = false;
+        bool stopped = false;
+        std::atomic<int64_t> sync_count{0};
+};
+
+#endif //DURABILITY_MANAGER_HPP
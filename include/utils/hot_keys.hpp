@@ -0,0 +1,77 @@
+#ifndef HOT_KEYS_HPP
+#define HOT_KEYS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Top-K heavy hitters of a stream of weighted keys: a count-min sketch estimates every key's total,
+ * and the K keys with the largest estimates are kept as candidates (space-saving style eviction)
+ *
+ * Add() is called from the pool threads. The sketch counters are relaxed atomics; the candidate
+ * table is only locked when a key that isn't a candidate beats the smallest one, which after a
+ * warm-up is rare, and with try_lock, so a contended update is dropped rather than waited for (the
+ * key retries on its next occurrence). Estimates never undercount and overcount by at most
+ * e/width of the stream total with probability 1 - e^-depth.
+ */
+class heavy_hitters
+{
+    public:
+        struct entry
+        {
+            std::string key;
+            uint64_t estimate;
+        };
+
+        heavy_hitters(size_t k, size_t width, size_t depth);
+
+        void Add(std::string_view key, uint64_t hash, uint64_t amount);
+        std::vector<entry> Top(size_t limit) const;     // Largest first
+        void Reset();
+        size_t MemoryUsage() const;
+
+    private:
+        uint64_t Estimate(uint64_t hash) const;
+
+        size_t k, width, depth;
+        std::unique_ptr<std::atomic<uint64_t>[]> counters;      // depth rows of width counters
+        std::unique_ptr<std::atomic<uint64_t>[]> member_hashes; // Hashes of the candidates, 0 for a free slot
+        std::atomic<uint64_t> threshold{0};                     // Smallest candidate estimate once full
+        mutable std::mutex mutex;                               // Guards `candidates`
+        std::vector<std::pair<std::string, uint64_t>> candidates;   // Key and hash; slot i matches member_hashes[i]
+};
+
+/**
+ * Hot keys of a handle by reads, writes and bytes (keys and values in and out)
+ */
+class hot_key_tracker
+{
+    public:
+        struct options
+        {
+            size_t k = 32;          // Keys kept per metric
+            size_t width = 4096;    // Counters per sketch row
+            size_t depth = 4;       // Sketch rows
+        };
+
+        explicit hot_key_tracker(const options& opts);
+
+        void Record(std::string_view key, bool write, uint64_t bytes);
+        void Reset();
+        int64_t Since() const { return since.load(); }      // Milliseconds since epoch of the start or last reset
+        size_t MemoryUsage() const { return reads.MemoryUsage() + writes.MemoryUsage() + bytes.MemoryUsage(); }
+
+        heavy_hitters reads;
+        heavy_hitters writes;
+        heavy_hitters bytes;
+
+    private:
+        std::atomic<int64_t> since;
+};
+
+#endif //HOT_KEYS_HPP
@@ -0,0 +1,102 @@
+#ifndef INFLIGHT_TRACKER_HPP
+#define INFLIGHT_TRACKER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+
+/**
+ * Binding-level config keys limiting the operations of one handle (removed from the config before it reaches tkrzw):
+ *   max_inflight_ops    Operations queued or running at once (default 0: no limit)
+ *   max_inflight_bytes  Keys and values held by those operations (default 0: no limit)
+ *   admission           Over a limit: "wait" (default) | "reject" | "shed"
+ *   noack_max_pending   Unacknowledged writes queued at once; over it they are dropped (default 0: no limit)
+ */
+struct admission_config
+{
+    enum POLICY
+    {
+        ADMISSION_WAIT,         // The operation is held, unqueued, until it fits
+        ADMISSION_REJECT,       // The Promise rejects at once with code ERR_OVERLOADED
+        ADMISSION_SHED          // Scans reject like "reject", other operations wait
+    };
+
+    POLICY policy = ADMISSION_WAIT;
+    uint64_t max_ops = 0;
+    uint64_t max_bytes = 0;
+    uint64_t max_noack_pending = 0;
+
+    /**
+     * Moves the admission keys out of `params`
+     * @return false with `error` set if a key has an invalid value
+     */
+    static bool Extract(std::map<std::string, std::string>& params, admission_config* config, std::string* error);
+};
+
+/**
+ * Operations of one handle between queueing and settling: admission control and a draining close()
+ *
+ * Only used on the JS thread: workers are admitted by queueWorker() and settled at the end of
+ * OnOK()/OnError(), so plain counters are enough. An operation waiting for admission is not queued
+ * to the libuv pool; it is queued by Settle() once the operations ahead of it have made room, in
+ * the order they came. An idle handle always admits, so an operation larger than
+ * `max_inflight_bytes` runs alone instead of waiting forever.
+ */
+class inflight_tracker
+{
+    public:
+        enum admission { ADMITTED, WAITING, CLOSED, OVERLOADED };
+
+        explicit inflight_tracker(const admission_config& config = admission_config());
+
+        /**
+         * Counts a new operation, or parks `on_admitted` to be called by Settle() when it fits (WAITING)
+         * `low_priority` operations are refused instead of waiting under the "shed" policy
+         */
+        admission Admit(uint64_t bytes, bool low_priority, std::function<void()> on_admitted);
+
+        /**
+         * Uncounts a settled operation and admits the waiting ones that fit; the last one after Drain()
+         * runs its callback
+         */
+        void Settle(uint64_t bytes);
+
+        /**
+         * Refuses new operations and calls `on_drained` once none is in flight or waiting (at once if idle)
+         */
+        void Drain(std::function<void()> on_drained);
+
+        bool LimitsBytes() const { return config.max_bytes > 0; }
+        const admission_config& Config() const { return config; }
+        size_t InFlight() const { return in_flight; }
+        uint64_t InFlightBytes() const { return in_flight_bytes; }
+        size_t Waiting() const { return waiting.size(); }
+        uint64_t Waited() const { return waited; }           // Operations admitted after waiting, in total
+        uint64_t Rejected() const { return rejected; }       // Refused over a limit, in total (shed ones included)
+        uint64_t Shed() const { return shed; }
+        bool IsDraining() const { return draining; }
+
+    private:
+        struct waiter
+        {
+            uint64_t bytes;
+            std::function<void()> on_admitted;
+        };
+
+        bool Fits(uint64_t bytes) const;
+
+        admission_config config;
+        size_t in_flight = 0;
+        uint64_t in_flight_bytes = 0;
+        std::deque<waiter> waiting;
+        uint64_t waited = 0;
+        uint64_t rejected = 0;
+        uint64_t shed = 0;
+        bool draining = false;
+        std::function<void()> on_drained;
+};
+
+#endif //INFLIGHT_TRACKER_HPP
@@ -0,0 +1,19 @@
+#ifndef KEY_SEARCH_HPP
+#define KEY_SEARCH_HPP
+
+#include <string>
+#include <vector>
+#include <tkrzw_dbm_poly.h>
+#include "cancel_token.hpp"
+
+/**
+ * Keys matching `pattern` in a search mode ("begin", "contain", "end" or "regex"), at most `max`
+ *
+ * Shared by `search()` and the socket server. A polyShardDBM is scanned on one thread per shard.
+ * Throws std::regex_error for an invalid "regex" pattern. Once `cancel` is cancelled, the scans
+ * stop at the next record and `keys` holds what was found so far.
+ */
+void search_keys(tkrzw::ParamDBM* dbm, const std::string& mode, const std::string& pattern, size_t max,
+                 std::vector<std::string>* keys, const cancel_token* cancel = nullptr);
+
+#endif //KEY_SEARCH_HPP
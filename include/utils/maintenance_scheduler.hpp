@@ -0,0 +1,103 @@
+#ifndef MAINTENANCE_SCHEDULER_HPP
+#define MAINTENANCE_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <tkrzw_dbm_poly.h>
+
+class rebuild_task;
+
+/**
+ * Runs syncs and rebuilds of a DBM by itself, when the database is idle or in configured windows
+ *
+ * A background thread samples the write rate (writes noted by the handle) and the fragmentation of
+ * every file (from Inspect(): the share of the file that a rebuild would drop). During an idle
+ * window, or inside a scheduled time window, it syncs if anything was written since the last sync
+ * and rebuilds the most fragmented file above the threshold, one file (shard) per check, so the
+ * idleness is checked again between shards. Rebuilds go through rebuild_task, paced by the throttle:
+ * after a file of N bytes, the next rebuild waits until N / throttle seconds have passed since it began.
+ */
+class maintenance_scheduler
+{
+    public:
+        struct window
+        {
+            int begin_minute;                   // Minutes after local midnight
+            int end_minute;                     // May be before begin_minute (the window spans midnight)
+        };
+
+        struct options
+        {
+            double check_interval = 1.0;        // Seconds between checks
+            bool idle = true;                   // Run in detected idle windows
+            double idle_writes_per_sec = 10;    // At or below this rate the database counts as idle...
+            double idle_time = 5.0;             // ...once it has been for this many seconds
+            double rebuild_fragmentation = 0.3; // Rebuild a file once this share of it is garbage
+            int64_t min_rebuild_bytes = 1 << 20;    // Smaller files are never rebuilt
+            bool sync = true;
+            int64_t throttle_bytes_per_sec = 0; // Pace of the rebuilds; 0 is unlimited
+            std::vector<window> schedule;       // Run inside these windows whatever the load
+
+            // Parses "HH:MM-HH:MM"
+            static bool ParseWindow(const std::string& text, window* result);
+        };
+
+        struct run_info
+        {
+            int64_t count = 0;
+            int64_t last_time = -1;             // Milliseconds since the epoch, -1 if never run
+            double last_duration = 0;           // Seconds
+            std::string last_error;             // Empty if the last run succeeded
+        };
+
+        struct status
+        {
+            bool running;
+            std::string state;                  // "waiting", "syncing" or "rebuilding"
+            double writes_per_sec;
+            double fragmentation;               // Of the most fragmented file
+            bool idle;
+            bool in_schedule;
+            run_info sync;
+            run_info rebuild;
+        };
+
+        maintenance_scheduler(std::shared_ptr<tkrzw::ParamDBM> dbm, const options& opts);
+        ~maintenance_scheduler();               // Stops the thread
+
+        void Start();
+
+        /**
+         * Stops starting syncs and rebuilds and cancels the rebuild in progress (a polyShardDBM
+         * stops after the current shard); doesn't wait, so it is safe on the JS thread
+         */
+        void RequestStop();
+
+        void Stop();                            // RequestStop(), then waits for the thread
+        bool IsRunning();
+        void NoteWrite() { writes.fetch_add(1, std::memory_order_relaxed); }
+        status GetStatus();
+
+    private:
+        void Run();
+        bool InSchedule() const;
+        void Record(run_info* info, const tkrzw::Status& status, std::chrono::steady_clock::time_point start);
+
+        std::shared_ptr<tkrzw::ParamDBM> dbm;   // Keeps the DBM open while scheduled
+        options opts;
+        std::thread thread;
+        std::mutex mutex;                       // Guards the status fields below and `stopping`
+        std::condition_variable cond;
+        bool stopping = false;
+        rebuild_task* rebuilding = nullptr;     // The rebuild in progress, for RequestStop() to cancel
+        std::atomic<int64_t> writes{0};
+        status current{false, "waiting", 0, 0, false, false, {}, {}};
+};
+
+#endif //MAINTENANCE_SCHEDULER_HPP
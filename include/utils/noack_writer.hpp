@@ -0,0 +1,128 @@
+#ifndef NOACK_WRITER_HPP
+#define NOACK_WRITER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tkrzw_dbm_poly.h>
+#include <napi.h>
+
+// One unacknowledged write, or a flush marker; a node of the queue
+struct noack_write
+{
+    enum kind_type { SET, APPEND, INCREMENT, FLUSH };
+
+    explicit noack_write(kind_type kind) : kind(kind) {}
+
+    kind_type kind;
+    std::string key;
+    std::string value;                  // Value of SET and APPEND
+    std::string delimiter;              // APPEND only
+    int64_t increment = 0;              // INCREMENT only
+    int64_t initial = 0;                // INCREMENT only
+    uint64_t flush_id = 0;              // FLUSH only
+    std::atomic<noack_write*> next{nullptr};
+};
+
+// Sent to the main thread when a flush marker is reached, or when writes have failed
+struct noack_event
+{
+    bool flushed;
+    uint64_t flush_id;
+};
+
+struct noack_context;
+void ReportNoAck(Napi::Env env, Napi::Function jsCallback, noack_context* context, noack_event* event);
+using NOACK_TSFN = Napi::TypedThreadSafeFunction<noack_context, noack_event, ReportNoAck>;
+
+struct noack_context
+{
+    std::map<uint64_t, Napi::Promise::Deferred> flushes;   // Main thread only
+    Napi::FunctionReference on_error;                       // Main thread only; empty if no handler
+    std::atomic<bool> has_handler{false};
+    std::atomic<bool> report_pending{false};                // An error report is on its way to the main thread
+    std::atomic<uint64_t> unreported{0};                    // Failures since the last report
+    std::mutex mutex;
+    std::string last_error;                                 // Guarded by `mutex`
+    NOACK_TSFN tsfn;                                        // Ref'ed only while flushes are pending
+};
+
+/**
+ * Applies the unacknowledged writes of one handle (setNoAck() and friends) on its own thread
+ *
+ * The main thread links each write into a lock-free multi-producer queue (Vyukov's intrusive MPSC
+ * list) and returns: no Promise, no worker, no call back into JS per write. The writer thread
+ * drains the queue in order and sleeps on a condition variable only when it finds it empty, so a
+ * steady stream of writes never takes a lock. Failures are only counted; an error handler, if
+ * set, gets them aggregated, one call per batch at most. A flush marker resolves its Promise once
+ * every write queued before it has been applied.
+ */
+class noack_writer
+{
+    public:
+        /**
+         * `max_pending`: writes queued at once, 0 for no limit; over it they are dropped and counted.
+         * `on_written` is called on the writer thread after each batch that applied writes.
+         */
+        noack_writer(Napi::Env env, tkrzw::ParamDBM* dbm, uint64_t max_pending, std::function<void()> on_written);
+        ~noack_writer();                        // Stop()
+
+        /**
+         * Queues a write (main thread); false, with the write deleted, once stopped or over `max_pending`
+         */
+        bool Push(noack_write* write);
+
+        /**
+         * Promise resolved once the writes queued so far are applied (main thread)
+         */
+        Napi::Promise Flush(Napi::Env env);
+
+        /**
+         * Sets or, with an empty function, clears the handler of aggregated errors (main thread)
+         */
+        void SetErrorHandler(Napi::Function on_error);
+
+        /**
+         * Applies what is still queued and stops the thread; later writes are refused
+         */
+        void Stop();
+
+        uint64_t Pending() const { return pushed.load() - applied.load(); }
+        uint64_t Written() const { return written.load(); }
+        uint64_t Failed() const { return failed.load(); }
+        uint64_t Dropped() const { return dropped.load(); }
+        std::string LastError();
+
+    private:
+        void Run();
+        noack_write* Pop();                     // The returned node becomes the stub: not to be deleted
+        bool IsEmpty() const { return tail->next.load() == nullptr; }
+        void Apply(noack_write* write);
+        void Report(noack_event* event);
+
+        tkrzw::ParamDBM* dbm;
+        uint64_t max_pending;
+        std::function<void()> on_written;
+        noack_context* context;                 // Owned by the TSFN (freed by its finalizer)
+        std::atomic<noack_write*> head;         // Producers link new writes here
+        noack_write* tail;                      // Writer thread only
+        std::atomic<bool> sleeping{false};      // The writer found the queue empty and waits on `cond`
+        std::atomic<bool> stopping{false};
+        bool stopped = false;                   // Main thread or the thread that calls Stop()
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::thread thread;
+        uint64_t next_flush_id = 1;
+        std::atomic<uint64_t> pushed{0};        // Writes queued, flush markers excluded
+        std::atomic<uint64_t> applied{0};       // Written or failed
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> failed{0};
+        std::atomic<uint64_t> dropped{0};
+};
+
+#endif //NOACK_WRITER_HPP
@@ -0,0 +1,80 @@
+#ifndef OP_CAPTURE_HPP
+#define OP_CAPTURE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * Writes the operations of a handle to a compact binary trace, for bench/replay.mjs
+ *
+ * Keys and values aren't captured, only a 64-bit hash of the key and the sizes, so a trace can leave
+ * production. File layout, little-endian:
+ * - header: "TKZTRACE", u32 version, u32 record size, u64 capture start (ms since epoch),
+ *   u16 number of operation names, then each name as u8 length + bytes
+ * - records (RECORD_SIZE bytes): u64 arrival (µs since the start), u64 key hash, u32 key size,
+ *   u32 value size, u32 result size, u32 latency (µs, arrival to resolve), u16 operation, u16 flags
+ *   (bit 0: error), u32 reserved
+ *
+ * Records are appended on the main thread when operations settle, so they are in completion order,
+ * and written by a background thread. Sampling is by key hash, so a sampled key keeps its whole history;
+ * operations with no key (scans, batches, ...) are recorded with hash 0 and sampled by share.
+ */
+class op_capture
+{
+    public:
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint32_t RECORD_SIZE = 40;
+        static constexpr uint16_t FLAG_ERROR = 1;
+
+        struct options
+        {
+            double sample_rate = 1.0;       // Share of the keys captured
+        };
+
+        op_capture(const std::string& path, const options& opts, const std::vector<std::string>& op_names);
+        ~op_capture();                      // Close()
+
+        /**
+         * Creates the file and starts the writer thread; returns false with `error` set on failure
+         */
+        bool Open(std::string* error);
+
+        void Record(uint16_t operation, std::string_view key, uint32_t value_size, uint32_t result_size,
+                    std::chrono::steady_clock::time_point arrival, std::chrono::steady_clock::time_point end, bool error);
+
+        /**
+         * Flushes, stops the thread and closes the file; later Record() calls are ignored
+         */
+        void Close();
+
+        uint64_t NumRecords() const { return num_records; }
+        uint64_t NumBytes() const { return num_bytes; }
+        const std::string& Path() const { return path; }
+        size_t MemoryUsage();               // Records waiting for the writer thread
+
+    private:
+        void Run();
+
+        std::string path;
+        options opts;
+        std::vector<std::string> op_names;
+        std::chrono::steady_clock::time_point start;
+        std::FILE* file = nullptr;
+        std::thread writer;
+        std::mutex mutex;                   // Guards `pending` and `closing`
+        std::condition_variable cond;
+        std::vector<char> pending;
+        bool closing = false;
+        uint64_t num_records = 0;           // Main thread only
+        double keyless_credit = 0;          // Main thread only: sampling of the operations with no key
+        uint64_t num_bytes = 0;             // Set by Close()
+};
+
+#endif //OP_CAPTURE_HPP
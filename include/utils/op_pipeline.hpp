@@ -0,0 +1,82 @@
+#ifndef OP_PIPELINE_HPP
+#define OP_PIPELINE_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tkrzw_dbm.h>
+
+// A key or value of a step: literal text, or the value read by an earlier `get` step
+struct pipeline_operand
+{
+    std::string text;
+    int ref = -1;               // Index of the `get` step, or -1 for `text`
+};
+
+struct pipeline_step
+{
+    enum STEP_TYPE : uint8_t { GET, SET, APPEND, REMOVE, INCREMENT };
+    enum CONDITION : uint8_t { ALWAYS, EXISTS, MISSING, EQUALS, NOT_EQUALS };
+
+    STEP_TYPE type = GET;
+    pipeline_operand key;
+    pipeline_operand value;     // SET and APPEND
+    std::string delimiter;      // APPEND
+    int64_t delta = 1;          // INCREMENT
+    int64_t initial = 0;        // INCREMENT
+
+    // Runs only if the value read by step `condition_step` (a `get`) meets the condition
+    CONDITION condition = ALWAYS;
+    int condition_step = -1;
+    pipeline_operand expected;  // EQUALS and NOT_EQUALS
+};
+
+struct pipeline_result
+{
+    bool ran = false;           // False if skipped by its condition
+    bool found = false;         // GET: a record was read; REMOVE: a record was removed
+    std::string value;          // GET
+    int64_t number = 0;         // INCREMENT
+};
+
+/**
+ * Steps of `db.pipeline()`, validated once on the main thread and run by one worker
+ *
+ * A step whose condition is not met, or which refers to a `get` that read nothing, is skipped.
+ * Without `atomic` every step is its own Process() call, so its key may come from an earlier step.
+ * With `atomic` every step is a processor of one ProcessMulti() in step order, so all the records
+ * stay locked from the first step to the last; the keys must then be known before it starts.
+ */
+class op_pipeline
+{
+    public:
+        op_pipeline(std::vector<pipeline_step> steps, bool atomic) : steps(std::move(steps)), atomic(atomic) {}
+
+        /**
+         * @return false with `error` set if a reference is not to an earlier `get`, or an atomic key is not literal
+         */
+        bool Validate(std::string* error) const;
+
+        /**
+         * Runs the steps; `results` gets one entry per step
+         */
+        tkrzw::Status Run(tkrzw::DBM* dbm, std::vector<pipeline_result>* results) const;
+
+        size_t Size() const { return steps.size(); }
+        pipeline_step::STEP_TYPE Type(size_t index) const { return steps[index].type; }
+        uint64_t Bytes() const;
+
+        /**
+         * @return false if a key is read by an earlier step, so the keys are not known before running
+         */
+        bool Keys(std::vector<std::string_view>* keys) const;
+
+    private:
+        class step_processor;
+
+        std::vector<pipeline_step> steps;
+        bool atomic;
+};
+
+#endif //OP_PIPELINE_HPP
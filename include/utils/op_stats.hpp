@@ -0,0 +1,89 @@
+#ifndef OP_STATS_HPP
+#define OP_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <napi.h>
+
+/**
+ * Lock-free latency histogram with log-linear buckets (HDR style)
+ *
+ * Values below 64 get a bucket each; above, every power of two is split into 32 linear buckets,
+ * so a percentile is off by at most ~3%. Values are nanoseconds, up to 2^41 (~36 minutes).
+ */
+class latency_histogram
+{
+    public:
+        static constexpr int SUB_BITS = 5;                          // 32 buckets per power of two
+        static constexpr int MAX_BITS = 41;
+        static constexpr int NUM_BUCKETS = (2 << SUB_BITS) + ((MAX_BITS - SUB_BITS - 1) << SUB_BITS);
+
+        void Record(uint64_t value);
+        uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+        uint64_t Max() const { return max.load(std::memory_order_relaxed); }
+        double Mean() const;
+        uint64_t Percentile(double quantile) const;     // quantile in [0, 1]
+        void Reset();
+
+    private:
+        static int BucketOf(uint64_t value);
+        static uint64_t ValueOf(int bucket);            // Middle of the bucket
+
+        std::atomic<uint64_t> buckets[NUM_BUCKETS] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+};
+
+/**
+ * Per-operation latency and throughput counters of one handle
+ *
+ * Workers record from the pool threads with relaxed atomics only. An operation's histograms are
+ * allocated the first time it is used, so unused operations cost one null pointer.
+ */
+class op_stats
+{
+    public:
+        struct op_record
+        {
+            latency_histogram queue_wait;       // Queue() to the start of Execute()
+            latency_histogram execute;
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> errors{0};
+            std::atomic<uint64_t> bytes_in{0};  // Keys and values sent to the DBM
+            std::atomic<uint64_t> bytes_out{0}; // Keys and values returned
+        };
+
+        explicit op_stats(size_t num_operations);
+        ~op_stats();
+
+        void Begin() { in_flight.fetch_add(1, std::memory_order_relaxed); }
+        void End() { in_flight.fetch_sub(1, std::memory_order_relaxed); }
+        // Results computed by the pool but not yet converted to JS
+        void HoldResult(uint64_t bytes) { result_bytes.fetch_add(bytes, std::memory_order_relaxed); }
+        void ReleaseResult(uint64_t bytes) { result_bytes.fetch_sub(bytes, std::memory_order_relaxed); }
+        int64_t InFlight() const { return in_flight.load(std::memory_order_relaxed); }
+        uint64_t InFlightResultBytes() const { return result_bytes.load(std::memory_order_relaxed); }
+        size_t MemoryUsage() const;         // Bytes of the histograms allocated so far
+        void Record(size_t operation, uint64_t queue_wait_ns, uint64_t execute_ns, uint64_t bytes_in, uint64_t bytes_out);
+        void RecordError(size_t operation);
+
+        /**
+         * Snapshot as a JS object; with `reset`, the counters restart (approximately, under load)
+         */
+        Napi::Object ToObject(Napi::Env env, const std::function<const char*(size_t)>& name_of, bool reset);
+
+    private:
+        op_record* Get(size_t operation);
+
+        size_t num_operations;
+        std::unique_ptr<std::atomic<op_record*>[]> records;
+        std::atomic<int64_t> in_flight{0};
+        std::atomic<uint64_t> result_bytes{0};
+        std::atomic<int64_t> since;             // steady_clock nanoseconds of the start or last reset
+};
+
+#endif //OP_STATS_HPP
@@ -0,0 +1,75 @@
+#ifndef OP_TRACER_HPP
+#define OP_TRACER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <napi.h>
+
+/**
+ * Timeline of one operation: queued on the main thread, executed on a pool thread, then resolved
+ * (result converted to JS) back on the main thread
+ */
+struct op_span
+{
+    const char* name;                               // JS method name
+    uint64_t key_bytes;
+    uint64_t bytes_in;                              // All keys and values passed in
+    std::chrono::steady_clock::time_point enqueue;
+    std::chrono::steady_clock::time_point execute_start;
+    std::chrono::steady_clock::time_point execute_end;
+    std::chrono::steady_clock::time_point resolve_start;
+    std::chrono::steady_clock::time_point resolve_end;
+    std::thread::id thread;                         // Pool thread that executed it
+    bool error;
+};
+
+/**
+ * Opt-in recorder of operation spans, exported as Chrome trace-event JSON (chrome://tracing, Perfetto)
+ *
+ * Spans are recorded on the main thread when an operation settles, into a ring buffer that keeps the
+ * latest `max_spans`. Operations slower than the threshold, end to end, also go to the slow-op log.
+ * Not thread-safe: a tracer belongs to one handle and is only used from its JS thread.
+ */
+class op_tracer
+{
+    public:
+        struct options
+        {
+            size_t max_spans = 100000;
+            double slow_threshold = 0.1;    // Seconds; negative disables the slow-op log
+            size_t max_slow_ops = 1000;     // The oldest entries are dropped first
+        };
+
+        explicit op_tracer(const options& opts);
+
+        void Record(const op_span& span);
+        size_t NumSpans() const { return spans.size(); }
+        uint64_t NumDropped() const { return recorded - spans.size(); }
+        size_t MemoryUsage() const { return sizeof(*this) + (spans.capacity() + slow_ops.size()) * sizeof(op_span); }
+
+        /**
+         * Writes the buffered spans to `path`; returns false with `error` set on I/O failure
+         */
+        bool WriteChromeTrace(const std::string& path, std::string* error) const;
+
+        Napi::Array SlowOps(Napi::Env env, bool clear);
+
+    private:
+        int ThreadIndex(std::thread::id thread);
+
+        options opts;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::system_clock::time_point start_wall;   // To report wall-clock times of slow ops
+        std::vector<op_span> spans;                         // Ring buffer, oldest at `next` once full
+        size_t next = 0;
+        uint64_t recorded = 0;
+        std::deque<op_span> slow_ops;
+        std::map<std::thread::id, int> threads;             // Pool threads numbered in order of appearance
+};
+
+#endif //OP_TRACER_HPP
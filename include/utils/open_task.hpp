@@ -0,0 +1,81 @@
+#ifndef OPEN_TASK_HPP
+#define OPEN_TASK_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <tkrzw_dbm_poly.h>
+#include <tkrzw_index.h>
+#include <napi.h>
+
+struct open_progress
+{
+    enum phase_type { PHASE_OPEN, PHASE_RESTORE, PHASE_PREFETCH, PHASE_DONE };
+
+    phase_type phase;
+    int64_t bytes_done;                 // Restore: size of the `.tmp.restore` files; prefetch: bytes read
+    int64_t bytes_total;                // Size of the database files before opening
+    double elapsed;                     // Seconds since open() was called
+    bool restored;                      // Only meaningful when done: a file was recovered after a crash
+    tkrzw::Status status;               // Only meaningful when done
+};
+
+struct open_context;
+void ReportOpen(Napi::Env env, Napi::Function jsCallback, open_context* context, open_progress* progress);
+using OPEN_TSFN = Napi::TypedThreadSafeFunction<open_context, open_progress, ReportOpen>;
+
+struct open_context
+{
+    Napi::Promise::Deferred deferred;
+    Napi::FunctionReference on_progress;    // Empty if no onProgress was given
+    Napi::FunctionReference constructor;    // Class of the instance the Promise resolves to
+    Napi::Reference<Napi::Value> config;    // Passed again to the constructor
+    std::string path;
+    std::shared_ptr<tkrzw::ParamDBM> dbm;   // Acquired by the thread, adopted by the constructor
+    std::unique_ptr<tkrzw::PolyIndex> index;    // Set instead of `dbm` by StartIndex()
+    OPEN_TSFN tsfn;                         // Ref'ed until the Promise settles
+    std::thread thread;                     // Joined by the TSFN finalizer, once it has released the TSFN
+};
+
+/**
+ * Opens a DBM through dbm_registry, or a PolyIndex, on its own native thread, for the static `open()`
+ *
+ * A crashed database is recovered by OpenAdvanced() in one call with no hooks, so progress is
+ * estimated like rebuild_task does: from the growth of the `<file>.tmp.restore` files tkrzw writes
+ * while restoring. Reports keep coming while opening, so a caller can tell a long recovery from a
+ * hang. The thread is not a libuv pool thread: a recovery of several minutes doesn't take one of
+ * the threads every other handle runs its operations on.
+ */
+class open_task
+{
+    public:
+        struct options
+        {
+            bool prefetch = false;              // Read the files into the page cache before resolving
+            double progress_interval = 0.2;     // Seconds between onProgress calls
+        };
+
+        /**
+         * Starts opening `path`; the Promise resolves to `constructor(config, path, <adopted DBM>)`
+         */
+        static Napi::Promise Start(Napi::Env env, Napi::Function constructor, Napi::Value config, const std::string& path,
+                                   bool sharded, std::map<std::string, std::string> params, int32_t open_options,
+                                   const options& opts, Napi::Function on_progress);
+
+        /**
+         * Same for a PolyIndex; the Promise resolves to `constructor(config, path, <adopted index>)`
+         */
+        static Napi::Promise StartIndex(Napi::Env env, Napi::Function constructor, Napi::Value config, const std::string& path,
+                                        std::map<std::string, std::string> params, int32_t open_options,
+                                        const options& opts, Napi::Function on_progress);
+
+    private:
+        static Napi::Promise Launch(Napi::Env env, Napi::Function constructor, Napi::Value config, const std::string& path,
+                                    std::vector<std::string> files, std::function<tkrzw::Status(open_context*)> open,
+                                    const options& opts, Napi::Function on_progress);
+};
+
+#endif //OPEN_TASK_HPP
@@ -0,0 +1,48 @@
+#ifndef PAGE_CACHE_HPP
+#define PAGE_CACHE_HPP
+
+#include <tkrzw_dbm_poly.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Memory held by one database file: its page-cache residency and the caches the DBM keeps in front of it
+ */
+struct file_memory
+{
+    std::string path;
+    int64_t size = 0;
+    int64_t resident = 0;               // Bytes of the file in the page cache
+    bool memory_mapped = false;         // The DBM maps the file (MemoryMapParallelFile/MemoryMapAtomicFile)
+    int64_t bucket_cache = 0;           // HashDBM bucket array copied to the heap (cache_buckets)
+    int64_t page_cache = 0;             // TreeDBM node cache, an upper bound: cached pages x max_page_size, at most the file size
+};
+
+/**
+ * Files of a PolyDBM or shard_dbm (one per shard), with their residency
+ *
+ * Residency is measured like fincore(1): the file is mapped read-only on its own and mincore() is
+ * asked which pages are in the page cache, so it doesn't depend on how the DBM accesses the file.
+ * On-memory DBMs have no file and give an empty list. tkrzw has no getter for the bucket cache, so
+ * `cache_buckets` says whether the handle's config enabled it.
+ */
+std::vector<file_memory> inspect_memory(tkrzw::ParamDBM* dbm, bool cache_buckets);
+
+/**
+ * Reads every file of the DBM into the page cache (MADV_POPULATE_READ, or plain reads on kernels
+ * before 5.14); `resident` is set to the resident bytes afterwards. `on_read`, if given, is called
+ * on the calling thread with the bytes read so far, every 256MiB or less.
+ */
+tkrzw::Status prefetch_pages(tkrzw::ParamDBM* dbm, int64_t* resident,
+                             const std::function<void(int64_t)>& on_read = nullptr);
+
+/**
+ * Writes back and drops the page-cache pages of every file (POSIX_FADV_DONTNEED); `resident` is set
+ * to the resident bytes afterwards. Best effort: pages mapped by a memory-mapped DBM stay until
+ * the kernel reclaims them.
+ */
+tkrzw::Status evict_pages(tkrzw::ParamDBM* dbm, int64_t* resident);
+
+#endif //PAGE_CACHE_HPP
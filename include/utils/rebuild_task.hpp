@@ -0,0 +1,106 @@
+#ifndef REBUILD_TASK_HPP
+#define REBUILD_TASK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tkrzw_dbm_poly.h>
+#include <napi.h>
+#include "cancel_binding.hpp"
+
+struct rebuild_progress
+{
+    bool done;
+    double percent;
+    int64_t bytes_done;                 // Bytes of the source files rebuilt so far (estimated within a shard)
+    int64_t bytes_total;
+    int32_t shards_done;
+    int32_t num_shards;
+    tkrzw::Status status;               // Only meaningful when `done`
+};
+
+struct rebuild_context;
+void ReportRebuild(Napi::Env env, Napi::Function jsCallback, rebuild_context* context, rebuild_progress* progress);
+using REBUILD_TSFN = Napi::TypedThreadSafeFunction<rebuild_context, rebuild_progress, ReportRebuild>;
+
+struct rebuild_context
+{
+    Napi::Promise::Deferred deferred;
+    Napi::FunctionReference on_progress;    // Empty if no onProgress was given
+    REBUILD_TSFN tsfn;                      // Ref'ed until the Promise settles
+    std::shared_ptr<cancel_token> cancel;   // From {signal, deadlineMs}, if given
+    cancel_binding cancel_js;
+};
+
+/**
+ * Rebuilds a DBM on its own native thread instead of a libuv pool thread
+ *
+ * The thread runs at low CPU and I/O priority, and a polyShardDBM is rebuilt one shard at
+ * a time, so foreground operations keep most of the machine. tkrzw rebuilds a file in one call with
+ * no hooks, which sets the granularity of the other controls:
+ * - throttle: after each shard, the thread sleeps until the average rate is back under the limit
+ * - progress: within a shard it's estimated from the growth of the `.tmp.rebuild` file
+ * - cancel: takes effect before the next shard; the shard being rebuilt is finished. An AbortSignal
+ *   or deadline of the options cancels the same way.
+ *
+ * Native callers (the maintenance scheduler) construct it without a Promise and call Rebuild() on
+ * their own thread, with the same throttle and cancellation and no progress reports.
+ */
+class rebuild_task
+{
+    public:
+        struct options
+        {
+            int64_t throttle_bytes_per_sec = 0;     // Source bytes per second; 0 is unlimited
+            double progress_interval = 0.2;         // Seconds between onProgress calls
+        };
+
+        rebuild_task(Napi::Env env, std::shared_ptr<tkrzw::ParamDBM> dbm, std::map<std::string, std::string> params,
+                     const options& opts, Napi::Promise::Deferred deferred, Napi::Function on_progress,
+                     Napi::Value cancel_options);
+        rebuild_task(std::shared_ptr<tkrzw::ParamDBM> dbm, std::map<std::string, std::string> params, const options& opts);
+        ~rebuild_task();                        // Cancels and waits for the thread
+
+        void Start();
+
+        /**
+         * Rebuilds on the calling thread, as the thread of Start() does; CANCELED_ERROR if cancelled first
+         */
+        tkrzw::Status Rebuild();
+
+        void Cancel();
+        bool IsRunning() const { return running.load(); }
+
+        /**
+         * Expected file size of `dbm` once rebuilt (live data plus overhead), or -1 if unknown
+         */
+        static int64_t EstimateRebuiltSize(tkrzw::DBM* dbm);
+
+        /**
+         * Best effort (Linux): low CPU and I/O priority for the calling thread
+         */
+        static void LowerThreadPriority();
+
+    private:
+        void Run();
+        tkrzw::Status RebuildUnit(tkrzw::ParamDBM* unit, int64_t unit_bytes, const rebuild_progress& before);
+        void Report(const rebuild_progress& progress);
+        bool IsCancelled() const { return cancelled.load() || (cancel && cancel->IsCancelled()); }
+
+        std::shared_ptr<tkrzw::ParamDBM> dbm;   // Keeps the DBM open while rebuilding
+        std::map<std::string, std::string> params;
+        options opts;
+        rebuild_context* context = nullptr;     // Owned by the TSFN (freed by its finalizer); null for native callers
+        std::shared_ptr<cancel_token> cancel;   // Shared with `context`, which the thread must not touch
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cond;           // Wakes the pacing sleep on Cancel()
+        std::atomic<bool> cancelled{false};
+        std::atomic<bool> running{false};
+};
+
+#endif //REBUILD_TASK_HPP
@@ -0,0 +1,43 @@
+#ifndef RECORD_VERSION_HPP
+#define RECORD_VERSION_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <tkrzw_dbm.h>
+
+/**
+ * Versions of records for optimistic concurrency: `getWithVersion()` and `setIfVersion()`
+ *
+ * A version is a 64-bit fingerprint of the value (MurmurHash), given to JS as 16 hex digits, so an
+ * update sends 8 bytes back to be compared instead of the whole expected value as
+ * compareExchange() does. Nothing is stored with the record: every write, through any method,
+ * changes the version, and the stored format stays what every other method and tool expects. Like
+ * compareExchange(), a value written back to an earlier one gets its earlier version again.
+ */
+namespace record_version
+{
+    uint64_t Of(std::string_view value);
+
+    std::string ToString(uint64_t version);
+
+    /**
+     * Parses 16 hex digits; false if `text` is not a version
+     */
+    bool Parse(const std::string& text, uint64_t* version);
+
+    /**
+     * Reads the value and its version; NOT_FOUND_ERROR if there is no record
+     */
+    tkrzw::Status Get(tkrzw::DBM* dbm, std::string_view key, std::string* value, uint64_t* version);
+
+    /**
+     * Sets the value if the record's version is `expected`, or if there is no record and `expected` is empty
+     * @param written Set to whether the value was written
+     * @param version Set to the version after the call: the new one if written, else the current one (0 if none)
+     */
+    tkrzw::Status SetIf(tkrzw::DBM* dbm, std::string_view key, std::optional<uint64_t> expected, std::string_view value,
+                        bool* written, uint64_t* version);
+}
+
+#endif //RECORD_VERSION_HPP
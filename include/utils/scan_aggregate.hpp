@@ -0,0 +1,55 @@
+#ifndef SCAN_AGGREGATE_HPP
+#define SCAN_AGGREGATE_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <tkrzw_dbm_poly.h>
+#include "cancel_token.hpp"
+
+struct aggregate_query
+{
+    enum OP_TYPE : uint8_t { COUNT, SUM, MIN, MAX, TOP_K };
+
+    OP_TYPE op = COUNT;
+
+    // Records scanned: keys starting with `prefix`, else keys in [from, to) (an empty bound is open)
+    std::string prefix;
+    std::string from;
+    std::string to;
+
+    // Number of a record: its value, or field `field` (0-based) of the value split at `delimiter`
+    int field = -1;
+    std::string delimiter = ",";
+    bool int64 = false;         // The 8-byte big-endian integer written by increment() instead of decimal text
+
+    // Groups by the first `group_depth` segments of the key split at `key_delimiter`; 0: no groups
+    int group_depth = 0;
+    std::string key_delimiter = ":";
+
+    size_t k = 10;              // TOP_K
+};
+
+struct aggregate_result
+{
+    uint64_t records = 0;       // Records in the range
+    uint64_t skipped = 0;       // Of those, records whose value is not a number (not counted by sum/min/max/topK)
+    bool has_value = false;     // False for min/max of no number
+    double value = 0;
+    std::vector<std::pair<std::string, double>> groups;    // In key order of the groups
+    std::vector<std::pair<std::string, double>> top;       // Largest first
+};
+
+/**
+ * Scan-side aggregation for `aggregate()`: only the aggregate leaves the pool thread
+ *
+ * An ordered database jumps to the start of the range and stops after its end (a prefix is a range
+ * only with the default lexical comparator); other databases are scanned whole. A polyShardDBM is
+ * scanned on one thread per shard and the partial aggregates are merged. With groups, `topK` ranks
+ * the groups by their sum. Once `cancel` is cancelled the scans stop at the next record.
+ */
+tkrzw::Status aggregate_records(tkrzw::ParamDBM* dbm, const aggregate_query& query, aggregate_result* result,
+                                const cancel_token* cancel = nullptr);
+
+#endif //SCAN_AGGREGATE_HPP
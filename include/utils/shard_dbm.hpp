@@ -0,0 +1,155 @@
+#ifndef SHARD_DBM_HPP
+#define SHARD_DBM_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tkrzw_dbm.h>
+#include <tkrzw_key_comparators.h>
+#include <tkrzw_dbm_poly.h>
+#include <tkrzw_dbm_ulog.h>
+#include <tkrzw_message_queue.h>
+
+/**
+ * Sharded database, file-compatible with tkrzw::ShardDBM
+ *
+ * Adapted from tkrzw::ShardDBM (Apache License 2.0): the same `<path>-NNNNN-of-NNNNN` files,
+ * `num_shards` parameter and SecondaryHash routing, so databases can be opened by either class.
+ * Unlike tkrzw::ShardDBM (final, shards private) it exposes its shards, so the binding can run
+ * whole-database work on one thread per shard (see ForEachShard()).
+ */
+class shard_dbm final : public tkrzw::ParamDBM
+{
+    public:
+        /**
+         * Iterator merging the iterators of all shards (in key order for ordered DBMs)
+         */
+        class Iterator final : public tkrzw::DBM::Iterator
+        {
+            public:
+                explicit Iterator(std::vector<std::shared_ptr<tkrzw::PolyDBM>>* dbms);
+                ~Iterator() override;
+
+                tkrzw::Status First() override;
+                tkrzw::Status Last() override;
+                tkrzw::Status Jump(std::string_view key) override;
+                tkrzw::Status JumpLower(std::string_view key, bool inclusive = false) override;
+                tkrzw::Status JumpUpper(std::string_view key, bool inclusive = false) override;
+                tkrzw::Status Next() override;
+                tkrzw::Status Previous() override;
+                tkrzw::Status Process(RecordProcessor* proc, bool writable) override;
+                tkrzw::Status Get(std::string* key = nullptr, std::string* value = nullptr) override;
+                tkrzw::Status Set(std::string_view value, std::string* old_key = nullptr,
+                                  std::string* old_value = nullptr) override;
+                tkrzw::Status Remove(std::string* old_key = nullptr, std::string* old_value = nullptr) override;
+
+            private:
+                struct slot
+                {
+                    std::string key;            // Last key retrieved from `iter`
+                    std::string value;
+                    std::unique_ptr<tkrzw::DBM::Iterator> iter;
+                };
+
+                // Positions every shard iterator with `position` and rebuilds the heap
+                tkrzw::Status Reset(const std::function<tkrzw::Status(tkrzw::DBM::Iterator*)>& position, bool asc);
+                // Re-reads the front slot, after stepping its iterator if `step` (Next/Previous)
+                tkrzw::Status Advance(bool step);
+                // Heap order: true if `lhs` is visited after `rhs` in the current direction
+                bool Later(const slot* lhs, const slot* rhs) const;
+
+                std::vector<slot> slots;
+                std::vector<slot*> heap;        // Front is the current record
+                tkrzw::KeyComparator comp = nullptr;
+                bool asc = true;
+        };
+
+        /**
+         * Forwards only ProcessFull: a shard's ProcessEach would otherwise make the start/end
+         * ProcessEmpty(NOOP) calls once per shard instead of once per database
+         */
+        class full_only_processor final : public RecordProcessor
+        {
+            public:
+                explicit full_only_processor(RecordProcessor* proc) : proc(proc) {}
+                std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+                    return proc->ProcessFull(key, value);
+                }
+            private:
+                RecordProcessor* proc;
+        };
+
+        shard_dbm() = default;
+        ~shard_dbm() override;
+
+        tkrzw::Status Open(const std::string& path, bool writable,
+                           int32_t options = tkrzw::File::OPEN_DEFAULT) override {
+            return OpenAdvanced(path, writable, options);
+        }
+        tkrzw::Status OpenAdvanced(const std::string& path, bool writable,
+                                   int32_t options = tkrzw::File::OPEN_DEFAULT,
+                                   const std::map<std::string, std::string>& params = {}) override;
+        tkrzw::Status Close() override;
+
+        tkrzw::Status Process(std::string_view key, RecordProcessor* proc, bool writable) override;
+        tkrzw::Status Get(std::string_view key, std::string* value = nullptr) override;
+        tkrzw::Status Set(std::string_view key, std::string_view value, bool overwrite = true,
+                          std::string* old_value = nullptr) override;
+        tkrzw::Status Remove(std::string_view key, std::string* old_value = nullptr) override;
+        tkrzw::Status Append(std::string_view key, std::string_view value, std::string_view delim = "") override;
+        tkrzw::Status ProcessFirst(RecordProcessor* proc, bool writable) override;
+        tkrzw::Status ProcessMulti(const std::vector<std::pair<std::string_view, RecordProcessor*>>& key_proc_pairs,
+                                   bool writable) override;
+        tkrzw::Status CompareExchangeMulti(const std::vector<std::pair<std::string_view, std::string_view>>& expected,
+                                           const std::vector<std::pair<std::string_view, std::string_view>>& desired) override;
+        tkrzw::Status ProcessEach(RecordProcessor* proc, bool writable) override;
+        tkrzw::Status Count(int64_t* count) override;
+        tkrzw::Status GetFileSize(int64_t* size) override;
+        tkrzw::Status GetFilePath(std::string* path) override;
+        tkrzw::Status GetTimestamp(double* timestamp) override;
+        tkrzw::Status Clear() override;
+        tkrzw::Status Rebuild() override { return RebuildAdvanced(); }
+        tkrzw::Status RebuildAdvanced(const std::map<std::string, std::string>& params = {}) override;
+        tkrzw::Status ShouldBeRebuilt(bool* tobe) override;
+        tkrzw::Status Synchronize(bool hard, FileProcessor* proc = nullptr) override {
+            return SynchronizeAdvanced(hard, proc);
+        }
+        tkrzw::Status SynchronizeAdvanced(bool hard, FileProcessor* proc = nullptr,
+                                          const std::map<std::string, std::string>& params = {}) override;
+        tkrzw::Status CopyFileData(const std::string& dest_path, bool sync_hard = false) override;
+        std::vector<std::pair<std::string, std::string>> Inspect() override;
+        bool IsOpen() const override { return open; }
+        bool IsWritable() const override;
+        bool IsHealthy() const override;
+        bool IsOrdered() const override;
+        std::unique_ptr<tkrzw::DBM::Iterator> MakeIterator() override;
+        std::unique_ptr<tkrzw::DBM> MakeDBM() const override;
+        UpdateLogger* GetUpdateLogger() const override;
+        void SetUpdateLogger(UpdateLogger* update_logger) override;
+
+        size_t GetNumShards() const { return dbms.size(); }
+        tkrzw::PolyDBM* GetShard(size_t index) const { return dbms[index].get(); }
+        // Order of the keys of an ordered database (the comparator of its TreeDBM/BabyDBM shards)
+        tkrzw::KeyComparator GetKeyComparator() const;
+        // The same for one PolyDBM (a shard or an unsharded database); lexical unless it is a TreeDBM/BabyDBM
+        static tkrzw::KeyComparator KeyComparatorOf(const tkrzw::PolyDBM* dbm);
+
+        /**
+         * Runs `fn` for every shard, one thread per shard, and merges the statuses
+         * (the first error wins). For any other DBM `fn(dbm, 0)` runs on the calling thread.
+         */
+        static tkrzw::Status ForEachShard(tkrzw::DBM* dbm, const std::function<tkrzw::Status(tkrzw::DBM*, size_t)>& fn);
+
+    private:
+        std::vector<std::shared_ptr<tkrzw::PolyDBM>> dbms;
+        std::unique_ptr<tkrzw::MessageQueue> ulog_mq;     // Owned update logger (ulog_* params)
+        std::unique_ptr<tkrzw::DBM::UpdateLogger> ulog;
+        tkrzw::DBMUpdateLoggerSecondShard ulog_second;    // Keeps shards > 0 from logging CLEAR twice
+        bool open = false;
+        std::string path;
+};
+
+#endif //SHARD_DBM_HPP
@@ -0,0 +1,58 @@
+#ifndef SOCKET_CLIENT_HPP
+#define SOCKET_CLIENT_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <tkrzw_lib_common.h>
+#include "wire_protocol.hpp"
+
+/**
+ * Connection of a polyDBMClient to a socket_server
+ *
+ * Send() only appends the request to an outbound buffer: a writer thread sends everything
+ * buffered in one write, so requests issued in the same tick travel together, and never waits
+ * for answers (pipelining). A reader thread hands over the responses of each read as one batch.
+ */
+class socket_client
+{
+    public:
+        // Called on the reader thread; `closed` is set once, on the last call, when the connection ends
+        typedef std::function<void(std::vector<wire_message>* responses, bool closed)> response_handler;
+
+        ~socket_client();
+
+        tkrzw::Status Connect(const std::string& path, response_handler handler);
+
+        /**
+         * Queues a request; false if the connection is closed
+         */
+        bool Send(const wire_message& request);
+
+        /**
+         * Sends what is queued, then closes the connection and joins both threads
+         */
+        void Close();
+
+        bool IsOpen() const { return open.load(); }
+
+    private:
+        void Write();
+        void Read();
+
+        int fd = -1;
+        response_handler handler;
+        std::thread writer;
+        std::thread reader;
+        std::mutex mutex;                   // Guards `outbound` and `closing`
+        std::condition_variable cond;
+        std::string outbound;
+        bool closing = false;
+        std::atomic<bool> open{false};
+};
+
+#endif //SOCKET_CLIENT_HPP
@@ -0,0 +1,70 @@
+#ifndef SOCKET_SERVER_HPP
+#define SOCKET_SERVER_HPP
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <sys/types.h>
+#include <tkrzw_dbm_poly.h>
+#include "wire_protocol.hpp"
+
+/**
+ * Serves a database over a Unix-domain socket (see wire_protocol.hpp), for polyDBMClient
+ *
+ * One native thread accepts connections and every connection gets its own thread, so clients
+ * run in parallel on the DBM just like local callers. A connection thread executes every request
+ * it has received before answering, and sends the answers in one write (pipelined requests
+ * are batched both ways).
+ */
+class socket_server
+{
+    public:
+        socket_server(std::shared_ptr<tkrzw::ParamDBM> dbm, const std::string& path);
+        ~socket_server();
+
+        /**
+         * Binds the socket (replacing a stale socket file) and starts accepting;
+         * DUPLICATION_ERROR if a server is already listening on the path
+         */
+        tkrzw::Status Start();
+
+        /**
+         * Closes the socket and every connection, and waits for their threads; removes the socket
+         * file unless it is no longer the one bound by Start()
+         */
+        void Stop();
+
+        const std::string& GetPath() const { return path; }
+        int64_t GetConnectionCount() const { return active_connections.load(); }
+        int64_t GetRequestCount() const { return request_count.load(); }
+
+    private:
+        struct connection
+        {
+            int fd;
+            std::thread thread;
+            std::atomic<bool> done{false};
+        };
+
+        void Accept();
+        void Serve(connection* conn);
+        void Execute(const wire_message& request, wire_message* response);
+        void Reap(bool all);
+
+        std::shared_ptr<tkrzw::ParamDBM> dbm;   // Keeps the DBM open while serving
+        std::string path;
+        int listen_fd = -1;
+        dev_t bound_dev = 0;                    // Identity of the socket file bound by Start()
+        ino_t bound_ino = 0;
+        std::thread accept_thread;
+        std::mutex mutex;                       // Guards `connections`
+        std::list<connection> connections;
+        std::atomic<bool> stopping{false};
+        std::atomic<int64_t> active_connections{0};
+        std::atomic<int64_t> request_count{0};
+};
+
+#endif //SOCKET_SERVER_HPP
@@ -0,0 +1,61 @@
+#ifndef ULOG_FEED_HPP
+#define ULOG_FEED_HPP
+
+#include "ulog_reader.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Reads the batches of a changeFeed on its own thread
+ *
+ * Waiting for new records can take the whole `wait_time`, so it must not hold a libuv pool thread:
+ * every Request() is answered in order by one thread of the feed, which hands the batch to the
+ * handler. The thread is started by the first request.
+ */
+class ulog_feed
+{
+    public:
+        // Called on the feed thread once per request; CANCELED_ERROR once the feed is cancelled
+        typedef std::function<void(std::vector<ulog_change>* changes, const tkrzw::Status& status)> batch_handler;
+
+        ulog_feed(const std::string& prefix, int64_t min_timestamp, size_t batch_size, double wait_time,
+                  batch_handler handler);
+        ~ulog_feed();                           // Close()
+
+        /**
+         * Asks for the next batch
+         */
+        void Request();
+
+        /**
+         * Makes the pending and later reads end with CANCELED_ERROR, without waiting for the thread
+         */
+        void Cancel();
+
+        /**
+         * Cancel(), then waits until every request has been answered and the thread has exited
+         */
+        void Close();
+
+        int64_t GetTimestamp() const { return reader.GetTimestamp(); }
+
+    private:
+        void Run();
+
+        ulog_reader reader;
+        size_t batch_size;
+        double wait_time;
+        batch_handler handler;
+        std::thread thread;
+        std::mutex mutex;                       // Guards `requested` and `cancelled`
+        std::condition_variable cond;
+        size_t requested = 0;                   // Requests not answered yet
+        bool cancelled = false;
+};
+
+#endif //ULOG_FEED_HPP
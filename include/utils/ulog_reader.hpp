@@ -0,0 +1,95 @@
+#ifndef ULOG_READER_HPP
+#define ULOG_READER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <tkrzw_dbm_ulog.h>
+#include <tkrzw_file_pos.h>
+#include <tkrzw_message_queue.h>
+
+/**
+ * One decoded record of the update log
+ */
+struct ulog_change
+{
+    tkrzw::DBMUpdateLoggerMQ::OpType op_type;   // OP_SET, OP_REMOVE or OP_CLEAR
+    int32_t server_id;                          // ulog_server_id of the writer
+    int32_t dbm_index;                          // ulog_dbm_index of the writer
+    int64_t timestamp;                          // Milliseconds since the UNIX epoch
+    std::string key;
+    std::string value;
+};
+
+/**
+ * Tails the message-queue files of an update log (`<ulog_prefix>.0000000000`, ...)
+ *
+ * The reader keeps its own cursor (file ID + offset) and reads the files with the static
+ * tkrzw::MessageQueue helpers, so it never takes the writer's lock and can follow a log
+ * written by a DBM open in this process or in another one.
+ * tkrzw::MessageQueue::Reader is not used directly: in read-only mode it rewinds to the start
+ * of the newest file every time it runs dry, and it caches the size of the file when opened.
+ */
+class ulog_reader
+{
+    public:
+        /**
+         * Constructor
+         * @param prefix The `ulog_prefix` of the database
+         * @param min_timestamp Records older than this (in milliseconds) are skipped
+         */
+        ulog_reader(const std::string& prefix, int64_t min_timestamp);
+
+        /**
+         * Reads the next batch of records
+         * @param max_records Upper bound of records to return
+         * @param wait_time Seconds to wait for new records when the log is drained (0 = no wait)
+         * @param changes Receives the records; cleared first
+         * @return SUCCESS even if nothing arrived in time, CANCELED_ERROR after Cancel()
+         */
+        tkrzw::Status ReadBatch(size_t max_records, double wait_time, std::vector<ulog_change>* changes);
+
+        /**
+         * Bytes written to the log after the cursor (how far the reader is behind); thread-safe
+         */
+        int64_t GetPendingBytes();
+
+        /**
+         * Timestamp of the newest record in the log, as far as the file metadata tells
+         */
+        int64_t GetLatestTimestamp();
+
+        /**
+         * Timestamp of the last record read, or -1 if nothing has been read yet
+         */
+        int64_t GetTimestamp() const { return last_timestamp.load(); }
+
+        /**
+         * Makes a pending and every later ReadBatch return CANCELED_ERROR at once (thread-safe)
+         */
+        void Cancel();
+
+        const std::string& GetPrefix() const { return prefix; }
+
+    private:
+        tkrzw::Status ReadAvailable(size_t max_records, std::vector<ulog_change>* changes);
+        std::string MakeFilePath(int64_t id) const;
+
+        std::string prefix;
+        int64_t min_timestamp;
+        int64_t file_id = -1;                   // -1 until the first file is found
+        int64_t file_offset = 0;                // Offset of the next record in the current file
+        std::atomic<int64_t> cursor_file_id{-1};    // Copies of the cursor for GetPendingBytes
+        std::atomic<int64_t> cursor_file_offset{0};
+        std::atomic<int64_t> last_timestamp{-1};
+        std::atomic<bool> canceled{false};
+        std::mutex mutex;                       // Serializes ReadBatch on the cursor
+        std::mutex wait_mutex;                  // Pairs with `wake`, notified by Cancel()
+        std::condition_variable wake;
+};
+
+#endif //ULOG_READER_HPP
@@ -0,0 +1,71 @@
+#ifndef ULOG_REPLICATOR_HPP
+#define ULOG_REPLICATOR_HPP
+
+#include "ulog_reader.hpp"
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tkrzw_dbm.h>
+
+/**
+ * Keeps a local DBM in step with the update log of another database
+ *
+ * A background thread tails the master's ulog files with ulog_reader and applies every batch
+ * to the local DBM, with the same server ID / DBM index filters as DBMUpdateLoggerMQ::ApplyUpdateLog.
+ * Updates are applied under the master's server ID, so a replica that logs its own updates
+ * can be told apart from (and filtered out by) the master.
+ */
+class ulog_replicator
+{
+    public:
+        struct options
+        {
+            int32_t server_id = INT32_MIN + 1;  // >= 0 adopts only this server ID, < 0 ignores its absolute value
+            int32_t dbm_index = INT32_MIN + 1;  // Same rule for the DBM index; the defaults filter nothing
+            int64_t from_timestamp = 0;         // Milliseconds; 0 applies everything still retained
+            size_t batch_size = 1024;
+            double wait_time = 0.1;             // Seconds to wait for new records before checking again,
+                                                // and the longest backoff after a failed read
+        };
+
+        struct status
+        {
+            bool running;
+            int64_t applied_count;              // Records applied since Start()
+            int64_t applied_timestamp;          // Timestamp of the last record applied, -1 if none
+            int64_t lag_time;                   // Milliseconds the replica is behind the master
+            int64_t lag_bytes;                  // Log bytes not applied yet
+            std::string last_error;
+        };
+
+        ulog_replicator(tkrzw::DBM* dbm, const std::string& prefix, const options& opts);
+        ~ulog_replicator();                     // Stops the thread
+
+        void Start();
+        void Stop();                            // Returns once the current batch is applied
+        status GetStatus();
+        const std::string& GetPrefix() const { return reader.GetPrefix(); }
+
+    private:
+        void Run();
+        tkrzw::Status Apply(const ulog_change& change);
+
+        tkrzw::DBM* dbm;
+        ulog_reader reader;
+        options opts;
+        std::thread thread;
+        std::atomic<bool> running{false};
+        std::atomic<int64_t> applied_count{0};
+        std::atomic<int64_t> applied_timestamp{-1};
+        std::mutex error_mutex;                 // Guards `last_error` and `stopping`
+        std::condition_variable wake;           // Notified by Stop() to cut a backoff short
+        bool stopping = false;
+        std::string last_error;
+};
+
+#endif //ULOG_REPLICATOR_HPP
@@ -0,0 +1,73 @@
+#ifndef WIRE_PROTOCOL_HPP
+#define WIRE_PROTOCOL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Binary protocol between socket_server and polyDBMClient (local Unix socket only, host byte order)
+ *
+ * Frame:  u32 body size | u32 request id | u8 code | fields...
+ * Field:  u32 size | bytes
+ *
+ * In a request `code` is a WIRE_OPCODE, in a response WIRE_OK or WIRE_ERROR (the only field
+ * of an error is its message). Responses on a connection come in request order, and a client
+ * may send any number of requests before reading (pipelining).
+ * Numbers travel as 8-byte fields (wire_int64 / wire_double).
+ */
+enum WIRE_OPCODE : uint8_t
+{
+    WIRE_PING,
+    WIRE_GET,                       // key, default                 -> value
+    WIRE_SET,                       // key, value
+    WIRE_APPEND,                    // key, value, delimiter
+    WIRE_REMOVE,                    // key
+    WIRE_COMPARE_EXCHANGE,          // key, expected, desired
+    WIRE_INCREMENT,                 // key, increment, initial      -> value
+    WIRE_COMPARE_EXCHANGE_MULTI,    // expected count, key/value pairs (expected, then desired)
+    WIRE_REKEY,                     // old key, new key, overwrite, copying
+    WIRE_COUNT,                     //                              -> count
+    WIRE_GET_FILE_SIZE,             //                              -> size
+    WIRE_GET_FILE_PATH,             //                              -> path
+    WIRE_GET_TIMESTAMP,             //                              -> timestamp (double)
+    WIRE_CLEAR,
+    WIRE_SYNC,                      // hard
+    WIRE_INSPECT,                   //                              -> name/value pairs
+    WIRE_SEARCH,                    // mode, pattern, max           -> keys
+    WIRE_OPCODE_COUNT
+};
+
+enum WIRE_STATUS : uint8_t
+{
+    WIRE_OK,
+    WIRE_ERROR
+};
+
+struct wire_message
+{
+    uint32_t id = 0;
+    uint8_t code = 0;
+    std::vector<std::string> fields;
+};
+
+// Frames larger than this are treated as a protocol error
+constexpr uint32_t WIRE_MAX_FRAME_SIZE = 1u << 30;
+
+/**
+ * Appends the frame of `message` to `out`
+ */
+void wire_append(std::string* out, const wire_message& message);
+
+/**
+ * Moves every complete frame at the front of `in` to `messages`; a partial frame stays in `in`
+ * @return false if `in` holds a malformed frame (the connection should be dropped)
+ */
+bool wire_parse(std::string* in, std::vector<wire_message>* messages);
+
+std::string wire_int64(int64_t value);
+int64_t wire_to_int64(const std::string& field);
+std::string wire_double(double value);
+double wire_to_double(const std::string& field);
+
+#endif //WIRE_PROTOCOL_HPP
@@ -0,0 +1,56 @@
+#ifndef WRITE_BATCH_HPP
+#define WRITE_BATCH_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tkrzw_dbm.h>
+
+/**
+ * Mixed writes (set, remove, append, increment) accumulated natively by a `writeBatch` and applied by one worker
+ *
+ * Atomic mode groups the operations by key, in the order they were added, and applies each group with
+ * one processor inside a single ProcessMulti(): every record of the batch is locked together, so no reader
+ * sees part of the batch. The other mode applies the operations one by one with the plain DBM calls, which
+ * skips grouping and multi-record locking; readers may then see a partly applied batch.
+ */
+class write_batch
+{
+    public:
+        enum OP_TYPE : uint8_t { SET, REMOVE, APPEND, INCREMENT };
+
+        void Set(std::string key, std::string value);
+        void Remove(std::string key);
+        void Append(std::string key, std::string value, std::string delimiter);
+        void Increment(std::string key, int64_t delta, int64_t initial);
+
+        size_t Size() const { return ops.size(); }
+        uint64_t Bytes() const { return bytes; }
+        std::vector<std::string_view> Keys() const;
+
+        /**
+         * Applies every operation; a missing record to remove is not an error
+         */
+        tkrzw::Status Apply(tkrzw::DBM* dbm, bool atomic) const;
+
+    private:
+        struct op
+        {
+            OP_TYPE type;
+            std::string key;
+            std::string value;          // Or empty for REMOVE and INCREMENT
+            std::string delimiter;      // APPEND only
+            int64_t delta = 0;          // INCREMENT only
+            int64_t initial = 0;        // INCREMENT only
+        };
+        class key_processor;            // Applies the operations of one key in atomic mode
+
+        tkrzw::Status ApplyAtomic(tkrzw::DBM* dbm) const;
+        tkrzw::Status ApplyEach(tkrzw::DBM* dbm) const;
+
+        std::vector<op> ops;
+        uint64_t bytes = 0;             // Keys and values, as counted towards max_inflight_bytes
+};
+
+#endif //WRITE_BATCH_HPP
@@ -0,0 +1,34 @@
+#ifndef WRITEBATCH_WRAPPER_HPP
+#define WRITEBATCH_WRAPPER_HPP
+
+#include "utils/write_batch.hpp"
+
+#include <memory>       //For std::shared_ptr
+#include <napi.h>
+
+/**
+ * Builder of mixed multi-key writes, applied together by `commit()` (`db.batch().set(a, 1).remove(b).commit()`)
+ *
+ * Created by polyDBM::batch() or directly with `new writeBatch(db)`. Every call appends to a native
+ * buffer and returns the batch, so no JS object is made per operation; commit() hands the buffer to
+ * one worker and leaves the batch empty for reuse.
+ */
+class writeBatch_wrapper : public Napi::ObjectWrap<writeBatch_wrapper>
+{
+    private:
+        Napi::ObjectReference owner;            //The polyDBM/polyShardDBM, kept alive by the batch
+        std::shared_ptr<write_batch> ops = std::make_shared<write_batch>();
+
+    public:
+        static Napi::Object Init(Napi::Env env, Napi::Object exports);          //required by Node!
+        writeBatch_wrapper(const Napi::CallbackInfo& info);
+        Napi::Value set(const Napi::CallbackInfo& info);
+        Napi::Value remove(const Napi::CallbackInfo& info);
+        Napi::Value append(const Napi::CallbackInfo& info);
+        Napi::Value increment(const Napi::CallbackInfo& info);
+        Napi::Value size(const Napi::CallbackInfo& info);
+        Napi::Value clear(const Napi::CallbackInfo& info);
+        Napi::Value commit(const Napi::CallbackInfo& info);                     //async
+};
+
+#endif //WRITEBATCH_WRAPPER_HPP
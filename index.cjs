@@ -1,9 +1,13 @@
 'use strict'
 
 const tkrzw = require('bindings')('tkrzw-node')
-module.exports = { polyDBM: tkrzw.polyDBM, polyIndex: tkrzw.polyIndex } ;
+module.exports = { polyDBM: tkrzw.polyDBM, polyShardDBM: tkrzw.polyShardDBM, polyIndex: tkrzw.polyIndex, changeFeed: tkrzw.changeFeed, polyDBMClient: tkrzw.polyDBMClient, writeBatch: tkrzw.writeBatch } ;
 module.exports.polyDBM = tkrzw.polyDBM;
+module.exports.polyShardDBM = tkrzw.polyShardDBM;
 module.exports.polyIndex = tkrzw.polyIndex;
+module.exports.changeFeed = tkrzw.changeFeed;
+module.exports.polyDBMClient = tkrzw.polyDBMClient;
+module.exports.writeBatch = tkrzw.writeBatch;
 /*var fs = require('fs');
 let tkrzw_config = fs.readFileSync('./tkrzw_config.json', 'utf8');
 const db1 = new tkrzw.polyDBM(JSON.parse(tkrzw_config), "YaHeidar.tkh");*/
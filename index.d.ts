@@ -55,6 +55,39 @@ declare module 'tkrzw-node' {
         
         /** Maximum number of branches in B-tree nodes */
         max_branches?: string;
+
+        /** Number of shards of a polyShardDBM (default: existing files, else one per CPU core) */
+        num_shards?: string;
+
+        /** When data is synced to disk: "close" (default), "none", "periodic", "group" (binding-level) */
+        durability?: 'close' | 'none' | 'periodic' | 'group';
+
+        /** Sync period in "periodic" durability mode (default: 1000) */
+        durability_interval_ms?: string;
+
+        /** How long a group commit waits for more writers (default: 2) */
+        group_commit_window_ms?: string;
+
+        /** Operations queued or running at once per handle (default: 0, no limit; binding-level) */
+        max_inflight_ops?: string;
+
+        /** Bytes of keys and values held by those operations (default: 0, no limit; binding-level) */
+        max_inflight_bytes?: string;
+
+        /** Over a limit: wait for room (default), reject, or reject scans only (binding-level) */
+        admission?: 'wait' | 'reject' | 'shed';
+
+        /** Unacknowledged writes queued at once per handle (default: 0, no limit; binding-level) */
+        noack_max_pending?: string;
+
+        /** How increment() writes: at once (default) or write-behind, flushed periodically (binding-level) */
+        counters?: 'direct' | 'write_behind';
+
+        /** Period of the write-behind counter flush (default: 1000; binding-level) */
+        counter_flush_interval_ms?: string;
+
+        /** Increments since the last flush that start one early (default: 10000, 0 for interval only; binding-level) */
+        counter_flush_threshold?: string;
         
         [key: string]: string | undefined;
     }
@@ -96,6 +129,443 @@ declare module 'tkrzw-node' {
         | 'edit'       // Keys within edit distance
         | 'editbin';   // Keys within binary edit distance
 
+    /**
+     * One record of the update log, as delivered by a change feed
+     */
+    export interface ChangeRecord {
+        /** Kind of update; `clear` has empty key and value */
+        op: 'set' | 'remove' | 'clear';
+        key: string;
+        /** New value for `set`, empty otherwise */
+        value: string;
+        /** Milliseconds since the UNIX epoch */
+        timestamp: number;
+        /** `ulog_server_id` of the writer */
+        serverId: number;
+        /** `ulog_dbm_index` of the writer */
+        dbmIndex: number;
+    }
+
+    /**
+     * Options of a change feed
+     */
+    export interface ChangeFeedOptions {
+        /** Skip records older than this (ms since epoch). Default: now; 0 replays everything retained */
+        fromTimestamp?: number;
+        /** Maximum records per batch (default: 256) */
+        batchSize?: number;
+        /** How long next() waits for new records before yielding an empty batch (default: 1000) */
+        waitMs?: number;
+    }
+
+    /**
+     * Async iterator over the update log; every step yields a batch of records
+     */
+    export class changeFeed implements AsyncIterableIterator<ChangeRecord[]> {
+        /**
+         * Tail an update log directly (e.g. one written by another process)
+         * @param ulogPrefix - The `ulog_prefix` of the database
+         * @param options - Feed options
+         */
+        constructor(ulogPrefix: string, options?: ChangeFeedOptions);
+
+        /**
+         * Read the next batch; empty if nothing was logged within `waitMs`
+         */
+        next(): Promise<IteratorResult<ChangeRecord[], undefined>>;
+
+        /**
+         * Close the feed (called by `break` in `for await`)
+         */
+        return(value?: any): Promise<IteratorResult<ChangeRecord[], any>>;
+
+        /**
+         * Timestamp of the last record delivered (-1 if none), usable as `fromTimestamp` to resume
+         */
+        getTimestamp(): number;
+
+        /**
+         * Close the feed; a pending next() resolves with `done: true`
+         */
+        close(): boolean;
+
+        [Symbol.asyncIterator](): changeFeed;
+    }
+
+    export interface CommitOptions extends CallOptions {
+        /** Lock every record of the batch together, so readers never see part of it (default: true) */
+        atomic?: boolean;
+    }
+
+    /**
+     * Mixed writes accumulated natively and applied together by commit(); every builder method returns the batch
+     */
+    export class writeBatch {
+        /**
+         * A batch for `db` (same as `db.batch()`)
+         */
+        constructor(db: polyDBM);
+
+        set(key: string, value: string): writeBatch;
+
+        /** A missing record is not an error */
+        remove(key: string): writeBatch;
+
+        append(key: string, value: string, delimiter?: string): writeBatch;
+
+        increment(key: string, increment?: number, initial?: number): writeBatch;
+
+        /**
+         * Number of operations added since the last commit() or clear()
+         */
+        size(): number;
+
+        /**
+         * Drop the operations added so far
+         */
+        clear(): writeBatch;
+
+        /**
+         * Apply the operations in order, in one worker, and empty the batch for reuse
+         */
+        commit(options?: CommitOptions): Promise<boolean>;
+    }
+
+    export interface AggregateOptions extends CallOptions {
+        /** Default: 'count' */
+        op?: 'count' | 'sum' | 'min' | 'max' | 'topK';
+        /** Records whose key starts with this */
+        prefix?: string;
+        /** Without `prefix`: records with `from` <= key < `to` */
+        range?: { from?: string; to?: string };
+        /** Use this field (0-based) of the value split at `delimiter` */
+        field?: number;
+        /** Default: ',' */
+        delimiter?: string;
+        /** 'text' (default): decimal numbers; 'int64': counters written by increment() */
+        format?: 'text' | 'int64';
+        /** Aggregate per group: the first `groupBy` segments of the key split at `keyDelimiter` */
+        groupBy?: number;
+        /** Default: ':' */
+        keyDelimiter?: string;
+        /** Entries of topK (default: 10) */
+        k?: number;
+    }
+
+    export interface AggregateResult {
+        /** Records in the range */
+        records: number;
+        /** Records in the range whose value is not a number */
+        skipped: number;
+        /** Not for topK; null for the min/max of no number */
+        value?: number | null;
+        /** With groupBy, not for topK */
+        groups?: Record<string, number>;
+        /** topK: records, or with groupBy groups ranked by sum, largest first */
+        top?: Array<{ key: string; value: number }>;
+    }
+
+    /** The value read by the earlier `get` step at this index */
+    export interface PipelineRef {
+        ref: number;
+    }
+
+    export interface PipelineStep {
+        op: 'get' | 'set' | 'append' | 'remove' | 'increment';
+        /** Must be a string in an atomic pipeline */
+        key: string | PipelineRef;
+        /** Required by set and append */
+        value?: string | PipelineRef;
+        /** append only */
+        delimiter?: string;
+        /** increment only (default: 1) */
+        increment?: number;
+        /** increment only (default: 0) */
+        initial?: number;
+        /** Run only if the `get` step `step` read a record (or not), or read the given value (or not) */
+        if?: { step: number; exists?: boolean; equals?: string | PipelineRef; notEquals?: string | PipelineRef };
+    }
+
+    export interface PipelineOptions extends CallOptions {
+        /** Keep every record locked from the first step to the last (default: false) */
+        atomic?: boolean;
+    }
+
+    /**
+     * Options of polyDBM.replicate()
+     */
+    export interface ReplicationOptions {
+        /** Apply only records of this server ID; a negative value ignores records of its absolute value */
+        serverId?: number;
+        /** Same rule for the DBM index */
+        dbmIndex?: number;
+        /** Skip records older than this (ms since epoch). Default: 0 (everything retained) */
+        fromTimestamp?: number;
+        /** Maximum records applied per batch (default: 1024) */
+        batchSize?: number;
+        /** How often the master's log is polled when the replica is caught up (default: 100) */
+        intervalMs?: number;
+    }
+
+    /**
+     * State of a replica, as returned by polyDBM.replicationStatus()
+     */
+    export interface RebuildProgress {
+        percent: number;
+        bytesDone: number;
+        bytesTotal: number;
+        shardsDone: number;
+        numShards: number;
+    }
+
+    export interface RebuildOptions extends CallOptions {
+        /** Cap on the average rate, applied between shards (default: unlimited) */
+        throttleBytesPerSec?: number;
+        onProgress?: (progress: RebuildProgress) => void;
+        /** Interval of progress reports during a shard (default: 200) */
+        progressIntervalMs?: number;
+    }
+
+    export interface MaintenanceOptions {
+        /** Run in detected idle windows (default: true) */
+        idle?: boolean;
+        /** Write rate at or below which the database counts as idle (default: 10) */
+        idleWritesPerSec?: number;
+        /** How long the rate must stay low before an idle window opens (default: 5000) */
+        idleMs?: number;
+        /** Local time windows, e.g. ['02:00-04:00'], in which maintenance runs whatever the load */
+        schedule?: string[];
+        /** Share of a file that must be garbage before it is rebuilt (default: 0.3) */
+        rebuildFragmentation?: number;
+        /** Files smaller than this are never rebuilt (default: 1 MiB) */
+        minRebuildBytes?: number;
+        /** Sync during the windows (default: true) */
+        sync?: boolean;
+        /** Pace of the rebuilds in bytes per second, as for rebuild() (default: unlimited) */
+        throttleBytesPerSec?: number;
+        /** Sampling interval (default: 1000) */
+        checkIntervalMs?: number;
+    }
+
+    export interface MaintenanceRun {
+        count: number;
+        /** Milliseconds since epoch, null if never run */
+        lastRun: number | null;
+        lastDurationMs: number;
+        lastError: string | null;
+    }
+
+    export interface MaintenanceStatus {
+        running: boolean;
+        state: 'waiting' | 'syncing' | 'rebuilding';
+        writesPerSec: number;
+        fragmentation: number;
+        idle: boolean;
+        inSchedule: boolean;
+        sync: MaintenanceRun;
+        rebuild: MaintenanceRun;
+    }
+
+    export interface LatencySummary {
+        /** Microseconds */
+        p50: number;
+        p99: number;
+        p999: number;
+        max: number;
+        mean: number;
+    }
+
+    export interface OperationStats {
+        count: number;
+        opsPerSec: number;
+        errors: number;
+        /** Bytes of keys and values passed in */
+        bytesIn: number;
+        /** Bytes of keys and values returned */
+        bytesOut: number;
+        /** Time waiting for a pool thread */
+        queueWait: LatencySummary;
+        /** Time inside the database */
+        execute: LatencySummary;
+    }
+
+    export interface CallOptions {
+        /** Cancels the operation: dropped if still queued, stopped at the next record if it's a scan */
+        signal?: AbortSignal;
+        /** Milliseconds from the call after which the operation is cancelled the same way */
+        deadlineMs?: number;
+    }
+
+    export interface OpStats {
+        elapsedMs: number;
+        /** Operations queued or running */
+        inFlight: number;
+        totalOps: number;
+        opsPerSec: number;
+        /** Keyed by method name; only methods that were called */
+        operations: { [operation: string]: OperationStats };
+        /** Admission control of a polyDBM handle */
+        admission?: AdmissionStats;
+        /** Only with write-behind counters */
+        counters?: CounterStats;
+    }
+
+    export interface AdmissionStats {
+        /** Operations admitted and not yet settled */
+        inFlight: number;
+        /** Keys and values they hold (counted only with max_inflight_bytes) */
+        inFlightBytes: number;
+        /** Operations waiting for room, not yet queued */
+        waiting: number;
+        /** Operations admitted after waiting, in total */
+        waited: number;
+        /** Operations rejected with ERR_OVERLOADED, in total */
+        rejected: number;
+        /** Of those, scans shed by the "shed" policy */
+        shed: number;
+    }
+
+    export interface CounterStats {
+        /** Counter keys held in memory */
+        keys: number;
+        /** Increments since the last flush */
+        pending: number;
+        /** Flushes run, in total */
+        flushes: number;
+        /** Delta writes that failed and were kept for the next flush, in total */
+        failed: number;
+    }
+
+    export interface NoAckStats {
+        /** Queued and not yet applied */
+        pending: number;
+        /** Applied successfully, in total */
+        written: number;
+        /** Applied with an error, in total */
+        failed: number;
+        /** Refused with false (closing, or noack_max_pending reached), in total */
+        dropped: number;
+        /** Key and status of the last failure */
+        lastError: string | null;
+    }
+
+    export interface TraceOptions {
+        /** Spans kept in the ring buffer (default: 100000) */
+        maxSpans?: number;
+        /** Operations at least this slow end to end go to the slow-op log; negative disables it (default: 100) */
+        slowMs?: number;
+        /** Entries kept in the slow-op log (default: 1000) */
+        maxSlowOps?: number;
+    }
+
+    export interface SlowOp {
+        op: string;
+        keyBytes: number;
+        bytesIn: number;
+        /** Milliseconds since epoch when the operation was queued */
+        startTime: number;
+        queueWaitUs: number;
+        executeUs: number;
+        /** Between the end of the execution and the resolve, waiting for the event loop */
+        callbackWaitUs: number;
+        resolveUs: number;
+        totalUs: number;
+        error: boolean;
+    }
+
+    export interface HotKeyOptions {
+        /** Keys kept per metric (default: 32) */
+        k?: number;
+        /** Counters per sketch row (default: 4096) */
+        width?: number;
+        /** Sketch rows (default: 4) */
+        depth?: number;
+    }
+
+    export interface HotKeys {
+        /** Milliseconds since epoch of the start or last reset */
+        since: number;
+        reads: { key: string; count: number }[];
+        writes: { key: string; count: number }[];
+        bytes: { key: string; bytes: number }[];
+    }
+
+    export interface OpenProgress {
+        /** 'open', 'restore' (recovering after a crash), 'prefetch', then 'ready' */
+        phase: 'open' | 'restore' | 'prefetch' | 'ready';
+        /** Estimated while restoring, from the size of the `.tmp.restore` files */
+        percent: number;
+        bytesDone: number;
+        /** Size of the database files before opening */
+        bytesTotal: number;
+        elapsedMs: number;
+        /** Only in the 'ready' report: a file was recovered */
+        restored?: boolean;
+    }
+
+    export interface OpenOptions {
+        /** Called while opening, every progressIntervalMs, and once more when ready */
+        onProgress?: (progress: OpenProgress) => void;
+        /** Milliseconds between onProgress calls (default: 200) */
+        progressIntervalMs?: number;
+        /** Read the files into the page cache before resolving (default: false) */
+        prefetch?: boolean;
+    }
+
+    export interface FileMemory {
+        path: string;
+        size: number;
+        /** Bytes of the file in the page cache */
+        residentBytes: number;
+        /** The DBM maps the file (MemoryMapParallelFile, MemoryMapAtomicFile) */
+        memoryMapped: boolean;
+    }
+
+    export interface MemoryStats {
+        fileBytes: number;
+        /** Size of the memory-mapped files */
+        mappedBytes: number;
+        /** Bytes of the files in the page cache */
+        residentBytes: number;
+        /** HashDBM bucket array on the heap (cache_buckets) */
+        bucketCacheBytes: number;
+        /** TreeDBM node cache, an upper bound */
+        pageCacheBytes: number;
+        addonBytes: number;
+        addon: { stats: number; tracer: number; capture: number; hotKeys: number };
+        inFlight: number;
+        /** Keys and values read by operations not resolved yet */
+        inFlightResultBytes: number;
+        /** One per shard; empty for on-memory databases */
+        files: FileMemory[];
+    }
+
+    export interface CaptureOptions {
+        /** Share of the keys captured, each with its whole history (default: 1) */
+        sampleRate?: number;
+    }
+
+    export interface CaptureResult {
+        path: string;
+        records: number;
+        bytes: number;
+    }
+
+    export interface ReplicationStatus {
+        running: boolean;
+        masterUlogPrefix: string;
+        /** Records applied since replicate() */
+        appliedCount: number;
+        /** Timestamp of the last record applied (-1 if none) */
+        appliedTimestamp: number;
+        /** Milliseconds the replica is behind the master (0 when caught up) */
+        lagMs: number;
+        /** Bytes of the master's log not applied yet */
+        lagBytes: number;
+        /** Last read or apply error; an apply error stops replication */
+        lastError: string | null;
+    }
+
     /**
      * Main database class - Polymorphic database manager
      */
@@ -112,11 +582,21 @@ declare module 'tkrzw-node' {
 
         /**
          * Create a new polyDBM instance
+         *
+         * If `path` is already open in this process (any thread), the instance attaches to that
+         * database and `config` is ignored.
          * @param config - Configuration object or JSON string
          * @param path - Database file path
          */
         constructor(config: DBMConfig | string, path: string);
 
+        /**
+         * Open on a native thread, including any crash recovery, without blocking the event loop
+         * @param config - Configuration object or JSON string
+         * @param path - Database file path
+         */
+        static open(config: DBMConfig | string, path: string, options?: OpenOptions): Promise<polyDBM>;
+
         // ====== Basic Operations ======
         
         /**
@@ -124,7 +604,7 @@ declare module 'tkrzw-node' {
          * @param key - Record key
          * @param value - Record value
          */
-        set(key: string, value: string): Promise<void>;
+        set(key: string, value: string, options?: CallOptions): Promise<void>;
 
         /**
          * Get a record value
@@ -132,7 +612,7 @@ declare module 'tkrzw-node' {
          * @returns Promise resolving to the value
          * @throws If key doesn't exist
          */
-        get(key: string): Promise<string>;
+        get(key: string, options?: CallOptions): Promise<string>;
 
         /**
          * Get a record value with default fallback
@@ -140,13 +620,13 @@ declare module 'tkrzw-node' {
          * @param defaultValue - Value to return if key doesn't exist
          * @returns Promise resolving to the value or default
          */
-        getSimple(key: string, defaultValue: string): Promise<string>;
+        getSimple(key: string, defaultValue: string, options?: CallOptions): Promise<string>;
 
         /**
          * Remove a record
          * @param key - Record key to remove
          */
-        remove(key: string): Promise<void>;
+        remove(key: string, options?: CallOptions): Promise<void>;
 
         /**
          * Append data to an existing record
@@ -154,7 +634,7 @@ declare module 'tkrzw-node' {
          * @param value - Value to append
          * @param delimiter - Optional delimiter to insert before appending
          */
-        append(key: string, value: string, delimiter?: string): Promise<void>;
+        append(key: string, value: string, delimiter?: string, options?: CallOptions): Promise<void>;
 
         // ====== Atomic Operations ======
 
@@ -168,7 +648,8 @@ declare module 'tkrzw-node' {
         compareExchange(
             key: string,
             expected: string | null,
-            desired: string | null
+            desired: string | null,
+            options?: CallOptions
         ): Promise<void>;
 
         /**
@@ -178,7 +659,24 @@ declare module 'tkrzw-node' {
          * @param initial - Initial value if key doesn't exist (default: 0)
          * @returns Promise resolving to the new value
          */
-        increment(key: string, increment: number, initial?: number): Promise<number>;
+        increment(key: string, increment: number, initial?: number, options?: CallOptions): Promise<number>;
+
+        /**
+         * Read a record with its version (16 hex digits, a fingerprint of the value)
+         * @returns null if there is no record
+         */
+        getWithVersion(key: string, options?: CallOptions): Promise<{ value: string; version: string } | null>;
+
+        /**
+         * Write a record only if it still has `version`, or if there is none when `version` is null
+         * @returns The new version, or null if the record has another version
+         */
+        setIfVersion(key: string, version: string | null, value: string, options?: CallOptions): Promise<string | null>;
+
+        /**
+         * Write the pending deltas of write-behind counters now (config `counters: 'write_behind'`)
+         */
+        flushCounters(options?: CallOptions): Promise<boolean>;
 
         /**
          * Compare and exchange multiple records atomically
@@ -187,9 +685,22 @@ declare module 'tkrzw-node' {
          */
         compareExchangeMulti(
             expected: Array<{ key: string; value: string | null }>,
-            desired: Array<{ key: string; value: string | null }>
+            desired: Array<{ key: string; value: string | null }>,
+            options?: CallOptions
         ): Promise<void>;
 
+        /**
+         * Start a batch of set/remove/append/increment operations applied together by its commit()
+         */
+        batch(): writeBatch;
+
+        /**
+         * Run dependent steps in one worker
+         * @returns Per step: the value read (null if none), true for set/append, whether a record was removed,
+         *          the new count, or undefined if skipped
+         */
+        pipeline(steps: PipelineStep[], options?: PipelineOptions): Promise<Array<string | number | boolean | null | undefined>>;
+
         /**
          * Rename a key atomically
          * @param oldKey - Current key name
@@ -201,9 +712,43 @@ declare module 'tkrzw-node' {
             oldKey: string,
             newKey: string,
             overwrite?: boolean,
-            copying?: boolean
+            copying?: boolean,
+            options?: CallOptions
         ): Promise<void>;
 
+        // ====== Unacknowledged Writes ======
+
+        /**
+         * Queue a set applied in order by the handle's writer thread, without a Promise
+         * @returns false if not queued (closing, or noack_max_pending reached)
+         */
+        setNoAck(key: string, value: string): boolean;
+
+        /**
+         * Queue an append, like setNoAck()
+         */
+        appendNoAck(key: string, value: string, delimiter?: string): boolean;
+
+        /**
+         * Queue an increment, like setNoAck(); the new value is not reported
+         */
+        incrementNoAck(key: string, increment: number, initial?: number): boolean;
+
+        /**
+         * Resolves once the unacknowledged writes queued before the call are applied
+         */
+        flushNoAck(): Promise<boolean>;
+
+        /**
+         * Be told of failed unacknowledged writes, aggregated per batch; null removes the handler
+         */
+        onNoAckError(callback: ((info: { failed: number; lastError: string }) => void) | null): boolean;
+
+        /**
+         * Counters of the unacknowledged writes
+         */
+        noAckStats(): NoAckStats;
+
         // ====== Record Processing ======
 
         /**
@@ -215,7 +760,8 @@ declare module 'tkrzw-node' {
         process(
             key: string,
             processor: RecordProcessor,
-            writable: boolean
+            writable: boolean,
+            options?: CallOptions
         ): Promise<void>;
 
         /**
@@ -227,7 +773,8 @@ declare module 'tkrzw-node' {
         processMulti(
             keys: string[],
             processor: RecordProcessor,
-            writable: boolean
+            writable: boolean,
+            options?: CallOptions
         ): Promise<void>;
 
         /**
@@ -235,42 +782,42 @@ declare module 'tkrzw-node' {
          * @param processor - Function to process the record
          * @param writable - Whether processor can modify the record
          */
-        processFirst(processor: RecordProcessor, writable: boolean): Promise<void>;
+        processFirst(processor: RecordProcessor, writable: boolean, options?: CallOptions): Promise<void>;
 
         /**
          * Process each record in the database
          * @param processor - Function to process each record
          * @param writable - Whether processor can modify records
          */
-        processEach(processor: RecordProcessor, writable: boolean): Promise<void>;
+        processEach(processor: RecordProcessor, writable: boolean, options?: CallOptions): Promise<void>;
 
         // ====== Database Information ======
 
         /**
          * Get the number of records in the database
          */
-        count(): Promise<number>;
+        count(options?: CallOptions): Promise<number>;
 
         /**
          * Get the file size in bytes
          */
-        getFileSize(): Promise<number>;
+        getFileSize(options?: CallOptions): Promise<number>;
 
         /**
          * Get the database file path
          */
-        getFilePath(): Promise<string>;
+        getFilePath(options?: CallOptions): Promise<string>;
 
         /**
          * Get the last modification timestamp (Unix time)
          */
-        getTimestamp(): Promise<number>;
+        getTimestamp(options?: CallOptions): Promise<number>;
 
         /**
          * Get database inspection information
          * @returns Object with database metadata
          */
-        inspect(): Promise<Record<string, string>>;
+        inspect(options?: CallOptions): Promise<Record<string, string>>;
 
         /**
          * Check if database is open
@@ -292,6 +839,71 @@ declare module 'tkrzw-node' {
          */
         isOrdered(): boolean;
 
+        /**
+         * Latency percentiles and throughput per operation since open or the last reset
+         * @param reset - Restart the counters after reading them
+         */
+        stats(reset?: boolean): OpStats;
+
+        /**
+         * Record the queue, execute and resolve phases of every operation until stopTrace()
+         * @param options - Buffer sizes and the slow-op threshold
+         */
+        startTrace(options?: TraceOptions): boolean;
+
+        /**
+         * Stop recording; the trace stays available until the next startTrace()
+         */
+        stopTrace(): boolean;
+
+        /**
+         * Write the recorded spans as Chrome trace-event JSON
+         * @returns The number of operations written
+         */
+        writeTrace(path: string): number;
+
+        /**
+         * Operations over the slowMs threshold, oldest first
+         * @param clear - Empty the log after reading it
+         */
+        slowOps(clear?: boolean): SlowOp[];
+
+        /**
+         * Write every operation (key hash, sizes, timing) to a binary trace for bench/replay.mjs
+         * @param path - Trace file, overwritten
+         */
+        startCapture(path: string, options?: CaptureOptions): boolean;
+
+        /**
+         * Track the top keys by reads, writes and bytes with count-min sketches; false stops tracking
+         */
+        trackHotKeys(options?: HotKeyOptions | false): boolean;
+
+        /**
+         * Hot keys, largest first, or null if not tracking
+         */
+        hotKeys(options?: { limit?: number; reset?: boolean }): HotKeys | null;
+
+        /**
+         * Page-cache residency of the files, DBM caches and addon buffers of this handle
+         */
+        memoryStats(): MemoryStats;
+
+        /**
+         * Read the files into the page cache; resolves to the resident bytes
+         */
+        prefetch(options?: CallOptions): Promise<number>;
+
+        /**
+         * Drop the files from the page cache (best effort when memory-mapped); resolves to the resident bytes
+         */
+        evict(options?: CallOptions): Promise<number>;
+
+        /**
+         * Flush and close the trace, or return null if not capturing
+         */
+        stopCapture(): CaptureResult | null;
+
         // ====== Search Operations ======
 
         /**
@@ -301,7 +913,12 @@ declare module 'tkrzw-node' {
          * @param capacity - Maximum number of results (0 for unlimited)
          * @returns Array of matching keys
          */
-        search(mode: SearchMode, pattern: string, capacity?: number): Promise<string[]>;
+        search(mode: SearchMode, pattern: string, capacity?: number, options?: CallOptions): Promise<string[]>;
+
+        /**
+         * Aggregate the values of a key range on the worker; only the result is returned
+         */
+        aggregate(options: AggregateOptions): Promise<AggregateResult>;
 
         // ====== Iterator Operations ======
 
@@ -313,58 +930,58 @@ declare module 'tkrzw-node' {
         /**
          * Move iterator to the first record
          */
-        iteratorFirst(): Promise<void>;
+        iteratorFirst(options?: CallOptions): Promise<void>;
 
         /**
          * Move iterator to the last record
          */
-        iteratorLast(): Promise<void>;
+        iteratorLast(options?: CallOptions): Promise<void>;
 
         /**
          * Jump iterator to a specific key
          * @param key - Key to jump to
          */
-        iteratorJump(key: string): Promise<void>;
+        iteratorJump(key: string, options?: CallOptions): Promise<void>;
 
         /**
          * Jump iterator to lower bound
          * @param key - Key bound
          * @param inclusive - Whether to include the key itself
          */
-        iteratorJumpLower(key: string, inclusive?: boolean): Promise<void>;
+        iteratorJumpLower(key: string, inclusive?: boolean, options?: CallOptions): Promise<void>;
 
         /**
          * Jump iterator to upper bound
          * @param key - Key bound
          * @param inclusive - Whether to include the key itself
          */
-        iteratorJumpUpper(key: string, inclusive?: boolean): Promise<void>;
+        iteratorJumpUpper(key: string, inclusive?: boolean, options?: CallOptions): Promise<void>;
 
         /**
          * Move iterator to next record
          */
-        iteratorNext(): Promise<void>;
+        iteratorNext(options?: CallOptions): Promise<void>;
 
         /**
          * Move iterator to previous record
          */
-        iteratorPrevious(): Promise<void>;
+        iteratorPrevious(options?: CallOptions): Promise<void>;
 
         /**
          * Get the current key-value pair from iterator
          */
-        iteratorGet(): Promise<KeyValuePair>;
+        iteratorGet(options?: CallOptions): Promise<KeyValuePair>;
 
         /**
          * Set the value at current iterator position
          * @param value - New value
          */
-        iteratorSet(value: string): Promise<void>;
+        iteratorSet(value: string, options?: CallOptions): Promise<void>;
 
         /**
          * Remove the record at current iterator position
          */
-        iteratorRemove(): Promise<void>;
+        iteratorRemove(options?: CallOptions): Promise<void>;
 
         /**
          * Free the iterator resources
@@ -376,24 +993,46 @@ declare module 'tkrzw-node' {
         /**
          * Check if database should be rebuilt for optimization
          */
-        shouldBeRebuilt(): Promise<void>;
+        shouldBeRebuilt(options?: CallOptions): Promise<void>;
 
         /**
-         * Rebuild database for optimization
+         * Rebuild database for optimization, on a low-priority native thread
          * @param config - Rebuild configuration
+         * @param options - Throttling and progress reporting
+         */
+        rebuild(config?: DBMConfig | string, options?: RebuildOptions): Promise<boolean>;
+
+        /**
+         * Cancel a running rebuild before its next shard; false if none is running
+         */
+        cancelRebuild(): boolean;
+
+        /**
+         * Sync and rebuild the database automatically in idle or scheduled windows, on a native thread
+         * @param options - Idle detection, schedule and thresholds
+         */
+        startMaintenance(options?: MaintenanceOptions): boolean;
+
+        /**
+         * State of the maintenance scheduler, or null if it isn't running
+         */
+        maintenanceStatus(): MaintenanceStatus | null;
+
+        /**
+         * Stop the maintenance scheduler without waiting; a rebuild in progress is cancelled (also done by close())
          */
-        rebuild(config: DBMConfig | string): Promise<void>;
+        stopMaintenance(): boolean;
 
         /**
          * Synchronize database to disk
          * @param hard - If true, use hard sync (fsync)
          */
-        sync(hard: boolean): Promise<void>;
+        sync(hard: boolean, options?: CallOptions): Promise<void>;
 
         /**
          * Clear all records from the database
          */
-        clear(): Promise<void>;
+        clear(options?: CallOptions): Promise<void>;
 
         // ====== Export/Import ======
 
@@ -413,7 +1052,7 @@ declare module 'tkrzw-node' {
          * Export all keys as text lines
          * @param destPath - Destination file path
          */
-        exportKeysAsLines(destPath: string): Promise<void>;
+        exportKeysAsLines(destPath: string, options?: CallOptions): Promise<void>;
 
         // ====== Restoration ======
 
@@ -428,11 +1067,117 @@ declare module 'tkrzw-node' {
             oldFilePath: string,
             newFilePath: string,
             className?: string,
-            endOffset?: number
+            endOffset?: number,
+            options?: CallOptions
         ): Promise<void>;
 
+        // ====== Update Log ======
+
+        /**
+         * Follow the update log of this database (requires `ulog_prefix` in the config)
+         * @param options - Feed options
+         */
+        changes(options?: ChangeFeedOptions): changeFeed;
+
+        /**
+         * Keep this database in step with another database's update log, on a background thread
+         * @param masterUlogPrefix - The `ulog_prefix` of the master
+         * @param options - Replication options
+         */
+        replicate(masterUlogPrefix: string, options?: ReplicationOptions): boolean;
+
+        /**
+         * Replication progress and lag, or null if replicate() was never called
+         */
+        replicationStatus(): ReplicationStatus | null;
+
+        /**
+         * Stop replication (also done by close())
+         */
+        stopReplication(): boolean;
+
+        // ====== Server Mode ======
+
+        /**
+         * Serve this database to polyDBMClient instances (e.g. other cluster processes) over a Unix socket
+         * @param socketPath - Path of the socket file; a stale socket file is replaced, a live one throws
+         */
+        serve(socketPath: string): boolean;
+
+        /**
+         * Stop serving and close every client connection (also done by close())
+         */
+        stopServing(): boolean;
+
+        /**
+         * Close the database: new operations are rejected with `Database is closed`, queued ones complete,
+         * then the database is flushed and closed off the event loop. The files stay open while other
+         * instances on the same path are open. Later calls return the same Promise.
+         */
+        close(): Promise<boolean>;
+    }
+
+    /**
+     * Sharded database: records are spread over `num_shards` files (`<path>-00000-of-0000N`, ...)
+     * by key hash, so writers on different shards don't contend. Same API as polyDBM;
+     * iterators merge the shards and multi-key operations are fanned out per shard.
+     * processEach and search scan all shards in parallel, one thread per shard.
+     */
+    export class polyShardDBM extends polyDBM {
+        /**
+         * Open or create a sharded database
+         * @param config - Database configuration; `num_shards` sets the shard count of a new database
+         * @param path - Base path of the shard files
+         */
+        constructor(config: DBMConfig | string, path: string);
+
+        /**
+         * Open on a native thread, including the recovery of every shard, without blocking the event loop
+         */
+        static open(config: DBMConfig | string, path: string, options?: OpenOptions): Promise<polyShardDBM>;
+    }
+
+    /**
+     * Client of a database served by `polyDBM.serve()`. Calls are pipelined: many requests can be
+     * in flight on one connection. Processors and iterators are not available remotely.
+     */
+    export class polyDBMClient {
         /**
-         * Close the database
+         * Connect to a served database
+         * @param socketPath - The path given to `serve()`
+         */
+        constructor(socketPath: string);
+
+        set(key: string, value: string): Promise<boolean>;
+        append(key: string, value: string, delimiter?: string): Promise<boolean>;
+        get(key: string, defaultValue?: string): Promise<string>;
+        getSimple(key: string, defaultValue?: string): Promise<string>;
+        remove(key: string): Promise<boolean>;
+        compareExchange(key: string, expected: string, desired: string): Promise<boolean>;
+        increment(key: string, increment?: number, initial?: number): Promise<number>;
+        compareExchangeMulti(expected: KeyValuePair[], desired: KeyValuePair[]): Promise<boolean>;
+        rekey(oldKey: string, newKey: string, overwrite?: boolean, copying?: boolean): Promise<boolean>;
+        count(): Promise<number>;
+        getFileSize(): Promise<number>;
+        getFilePath(): Promise<string>;
+        getTimestamp(): Promise<number>;
+        clear(): Promise<boolean>;
+        sync(hard?: boolean): Promise<boolean>;
+        inspect(): Promise<Record<string, string>>;
+        search(mode: SearchMode, pattern: string, capacity: number): Promise<string[]>;
+
+        /**
+         * Round trip to the server
+         */
+        ping(): Promise<boolean>;
+
+        /**
+         * Whether the connection is up (false once the server stopped serving)
+         */
+        isOpen(): boolean;
+
+        /**
+         * Close the connection; requests still unanswered are rejected
          */
         close(): boolean;
     }
@@ -448,6 +1193,13 @@ declare module 'tkrzw-node' {
          */
         constructor(config: IndexConfig | string, path: string);
 
+        /**
+         * Open on a native thread, including any crash recovery, without blocking the event loop
+         * @param config - Index configuration
+         * @param path - Index file path
+         */
+        static open(config: IndexConfig | string, path: string, options?: OpenOptions): Promise<polyIndex>;
+
         /**
          * Add a key-value pair to the index
          * @param key - Index key
@@ -514,6 +1266,12 @@ declare module 'tkrzw-node' {
          */
         freeIterator(): boolean;
 
+        /**
+         * Latency percentiles and throughput per operation since open or the last reset
+         * @param reset - Restart the counters after reading them
+         */
+        stats(reset?: boolean): OpStats;
+
         /**
          * Close the index
          */
@@ -522,7 +1280,9 @@ declare module 'tkrzw-node' {
 
     const tkrzw: {
         polyDBM: typeof polyDBM;
+        polyShardDBM: typeof polyShardDBM;
         polyIndex: typeof polyIndex;
+        changeFeed: typeof changeFeed;
     };
 
     export default tkrzw;
@@ -4,9 +4,13 @@ import { createRequire } from "module"
 const tkrzw =  createRequire(import.meta.url)('bindings')('tkrzw-node')
 
 export const polyDBM = tkrzw.polyDBM;
+export const polyShardDBM = tkrzw.polyShardDBM;
 export const polyIndex = tkrzw.polyIndex;
+export const changeFeed = tkrzw.changeFeed;
+export const polyDBMClient = tkrzw.polyDBMClient;
+export const writeBatch = tkrzw.writeBatch;
 
-export default { polyDBM: tkrzw.polyDBM, polyIndex: tkrzw.polyIndex };
+export default { polyDBM: tkrzw.polyDBM, polyShardDBM: tkrzw.polyShardDBM, polyIndex: tkrzw.polyIndex, changeFeed: tkrzw.changeFeed, polyDBMClient: tkrzw.polyDBMClient, writeBatch: tkrzw.writeBatch };
 
 /*import fs from "node:fs"
 
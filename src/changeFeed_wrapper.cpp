@@ -0,0 +1,163 @@
+#include "../include/changeFeed_wrapper.hpp"
+#include "../include/utils/addon_data.hpp"
+#include <tkrzw_lib_common.h>
+
+// Runs on the main thread with the batch read for the oldest pending next()
+void ResolveBatch(Napi::Env env, Napi::Function jsCallback, feed_requests* requests, feed_batch* batch)
+{
+    if (env != nullptr && !requests->pending.empty())
+    {
+        Napi::Promise::Deferred deferred = requests->pending.front();
+        requests->pending.pop_front();
+        if (requests->pending.empty()) {
+            requests->tsfn.Unref(env);
+        }
+        Napi::Object result = Napi::Object::New(env);
+        if (batch->status == tkrzw::Status::CANCELED_ERROR) {       //Closed while waiting
+            result.Set("value", env.Undefined());
+            result.Set("done", Napi::Boolean::New(env, true));
+            deferred.Resolve(result);
+        } else if (batch->status != tkrzw::Status::SUCCESS) {
+            deferred.Reject(Napi::Error::New(env, "Change feed read failed: " + batch->status.GetMessage()).Value());
+        } else {
+            Napi::Array arr = Napi::Array::New(env, batch->changes.size());
+            for (size_t i = 0; i < batch->changes.size(); ++i) {
+                const ulog_change& change = batch->changes[i];
+                Napi::Object obj = Napi::Object::New(env);
+                obj.Set("op", change.op_type == tkrzw::DBMUpdateLoggerMQ::OP_SET ? "set" :
+                              change.op_type == tkrzw::DBMUpdateLoggerMQ::OP_REMOVE ? "remove" : "clear");
+                obj.Set("key", Napi::String::New(env, change.key));
+                obj.Set("value", Napi::String::New(env, change.value));
+                obj.Set("timestamp", Napi::Number::New(env, static_cast<double>(change.timestamp)));
+                obj.Set("serverId", Napi::Number::New(env, change.server_id));
+                obj.Set("dbmIndex", Napi::Number::New(env, change.dbm_index));
+                arr.Set(i, obj);
+            }
+            result.Set("value", arr);
+            result.Set("done", Napi::Boolean::New(env, false));
+            deferred.Resolve(result);
+        }
+    }
+    delete batch;
+}
+
+// Constructor: new changeFeed(ulogPrefix, {fromTimestamp, batchSize, waitMs})
+changeFeed_wrapper::changeFeed_wrapper(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<changeFeed_wrapper>(info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString() || (info.Length() > 1 && !info[1].IsObject() && !info[1].IsUndefined())) {
+        Napi::TypeError::New(env, "Invalid arguments for changeFeed").ThrowAsJavaScriptException();
+        return;
+    }
+    std::string prefix = info[0].As<Napi::String>().Utf8Value();
+    size_t batch_size = 256;
+    double wait_time = 1.0;             //Seconds
+
+    //By default only records logged from now on are delivered; 0 replays everything still retained
+    int64_t from_timestamp = static_cast<int64_t>(tkrzw::GetWallTime() * 1000);
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object opts = info[1].As<Napi::Object>();
+        if (opts.Has("fromTimestamp") && opts.Get("fromTimestamp").IsNumber()) {
+            from_timestamp = opts.Get("fromTimestamp").As<Napi::Number>().Int64Value();
+        }
+        if (opts.Has("batchSize") && opts.Get("batchSize").IsNumber()) {
+            int64_t size = opts.Get("batchSize").As<Napi::Number>().Int64Value();
+            if (size < 1) {
+                Napi::RangeError::New(env, "batchSize must be positive").ThrowAsJavaScriptException();
+                return;
+            }
+            batch_size = static_cast<size_t>(size);
+        }
+        if (opts.Has("waitMs") && opts.Get("waitMs").IsNumber()) {
+            wait_time = std::max(0.0, opts.Get("waitMs").As<Napi::Number>().DoubleValue()) / 1000.0;
+        }
+    }
+
+    requests = new feed_requests();
+    requests->tsfn = FEED_TSFN::New(env, "changeFeed tsfn", 0, 1, requests,
+                                    [](Napi::Env, void*, feed_requests* context) { delete context; });
+    requests->tsfn.Unref(env);
+    feed_requests* context = requests;
+    feed = std::make_unique<ulog_feed>(prefix, from_timestamp, batch_size, wait_time,
+        [context](std::vector<ulog_change>* changes, const tkrzw::Status& status) {
+            auto* batch = new feed_batch{std::move(*changes), status};
+            if (context->tsfn.BlockingCall(batch) != napi_ok) {
+                delete batch;       //The environment is shutting down
+            }
+        });
+}
+
+Napi::Value changeFeed_wrapper::next(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (closed) {
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("value", env.Undefined());
+        result.Set("done", Napi::Boolean::New(env, true));
+        deferred.Resolve(result);
+        return deferred.Promise();
+    }
+
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    if (requests->pending.empty()) {
+        requests->tsfn.Ref(env);
+    }
+    requests->pending.push_back(deferred);
+    feed->Request();
+    return deferred.Promise();
+}
+
+// `return()` of the async iterator protocol: called by `break` inside `for await`
+Napi::Value changeFeed_wrapper::finish(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    close(info);
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("value", info.Length() > 0 ? info[0] : env.Undefined());
+    result.Set("done", Napi::Boolean::New(env, true));
+    deferred.Resolve(result);
+    return deferred.Promise();
+}
+
+Napi::Value changeFeed_wrapper::asyncIterator(const Napi::CallbackInfo& info) {
+    return info.This();
+}
+
+// Timestamp of the last record delivered, usable as `fromTimestamp` to resume a feed later
+Napi::Value changeFeed_wrapper::getTimestamp(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(feed->GetTimestamp()));
+}
+
+Napi::Value changeFeed_wrapper::close(const Napi::CallbackInfo& info) {
+    closed = true;
+    if (feed) {
+        feed->Cancel();     //Pending next() calls resolve with {done: true}; the thread is joined by Finalize
+    }
+    return Napi::Boolean::New(info.Env(), true);
+}
+
+Napi::Object changeFeed_wrapper::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function functionList = DefineClass(env, "changeFeed",
+    {
+        InstanceMethod<&changeFeed_wrapper::next>("next", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&changeFeed_wrapper::finish>("return", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&changeFeed_wrapper::getTimestamp>("getTimestamp", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&changeFeed_wrapper::close>("close", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&changeFeed_wrapper::asyncIterator>(Napi::Symbol::WellKnown(env, "asyncIterator"), static_cast<napi_property_attributes>(napi_writable | napi_configurable))
+    });
+
+    env.GetInstanceData<addon_data>()->changeFeed_constructor = Napi::Persistent(functionList);
+
+    exports.Set("changeFeed", functionList);
+    return exports;
+}
+
+void changeFeed_wrapper::Finalize(Napi::Env env)
+{
+    if (feed) {
+        feed->Close();      //Answers the pending next() calls
+    }
+    if (requests) {
+        requests->tsfn.Release();
+    }
+}
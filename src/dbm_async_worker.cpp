@@ -1,10 +1,204 @@
 #include "../include/dbm_async_worker.hpp"
 #include "../include/utils/processor_jsfunc_wrapper.hpp"
 #include "../include/utils/tsfn_types.hpp"
+#include "../include/utils/key_search.hpp"
+#include "../include/utils/shard_dbm.hpp"
+#include "../include/utils/page_cache.hpp"
+#include "../include/utils/record_version.hpp"
 #include <fstream>
-#include <regex>
 
 void dbmAsyncWorker::Execute()
+{
+    if (StopIfCancelled()) {
+        //Dropped unstarted: cancelled while queued. Observe() still runs, so its span ends here, with no execution
+        execute_start = execute_end = std::chrono::steady_clock::now();
+        execute_thread = std::this_thread::get_id();
+        ReleaseProcessors();
+        return;
+    }
+    if (!stats && !tracer && !capture && !hot_keys) {
+        ExecuteOperation();
+        return;
+    }
+    execute_start = std::chrono::steady_clock::now();
+    execute_thread = std::this_thread::get_id();
+    bytes_in = ParamBytes();
+    ExecuteOperation();
+    execute_end = std::chrono::steady_clock::now();
+    bytes_out = ResultBytes();
+    if (hot_keys) {
+        RecordHotKeys();
+    }
+    if (stats) {
+        stats->HoldResult(bytes_out);
+        stats->Record(operation,
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(execute_start - queued_at).count(),
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(execute_end - execute_start).count(),
+                      bytes_in, bytes_out);
+    }
+}
+
+// True, with the error set, once the caller's signal or deadline has cancelled the operation
+bool dbmAsyncWorker::StopIfCancelled()
+{
+    if (!cancel || !cancel->IsCancelled()) {
+        return false;
+    }
+    cancelled = true;
+    SetError(cancel->Message());
+    return true;
+}
+
+// Feeds the keys of key-level operations to the hot-key sketches, on the pool thread
+void dbmAsyncWorker::RecordHotKeys()
+{
+    switch (operation)
+    {
+        case DBM_SET: case DBM_APPEND: case DBM_GET_SIMPLE: case DBM_REMOVE:
+        case DBM_COMPARE_EXCHANGE: case DBM_INCREMENT: case DBM_REKEY:
+        case DBM_GET_WITH_VERSION: case DBM_SET_IF_VERSION:
+            hot_keys->Record(std::any_cast<const std::string&>(params[0]), IsWriteOperation(operation), bytes_in + bytes_out);
+            break;
+        case DBM_PROCESS:
+            hot_keys->Record(std::any_cast<const std::string&>(params[0]), std::any_cast<bool>(params[1]), bytes_in + bytes_out);
+            break;
+        case DBM_PROCESS_MULTI:
+            for (const auto& key : std::any_cast<const std::vector<std::string>&>(params[0])) {
+                hot_keys->Record(key, std::any_cast<bool>(params[2]), key.size());
+            }
+            break;
+        case DBM_COMPARE_EXCHANGE_MULTI:
+            for (const auto& [key, value] : std::any_cast<const std::vector<std::pair<std::string, std::string>>&>(params[1])) {
+                hot_keys->Record(key, true, key.size() + value.size());
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// The key of a key-level operation, the same ones RecordHotKeys() records; nullptr for the others,
+// whose first string param is a mode or a path
+const std::string* dbmAsyncWorker::OperationKey() const
+{
+    switch (operation)
+    {
+        case DBM_SET: case DBM_APPEND: case DBM_GET_SIMPLE: case DBM_REMOVE:
+        case DBM_COMPARE_EXCHANGE: case DBM_INCREMENT: case DBM_REKEY:
+        case DBM_GET_WITH_VERSION: case DBM_SET_IF_VERSION: case DBM_PROCESS:
+        case INDEX_ADD: case INDEX_GET_VALUES: case INDEX_CHECK: case INDEX_REMOVE:
+            return std::any_cast<std::string>(&params[0]);
+        default:
+            return nullptr;
+    }
+}
+
+// Applies the pending write-behind deltas of the counters an operation is about to write, so that the next
+// flush doesn't add them on top of that write; set and remove drop them instead (see counter_aggregator)
+void dbmAsyncWorker::FlushCounterKeys()
+{
+    std::vector<std::string_view> keys;
+    switch (operation)
+    {
+        case DBM_APPEND: case DBM_COMPARE_EXCHANGE: case DBM_PROCESS: case DBM_SET_IF_VERSION:
+            keys.emplace_back(std::any_cast<const std::string&>(params[0]));
+            break;
+        case DBM_REKEY:
+            keys.emplace_back(std::any_cast<const std::string&>(params[0]));
+            keys.emplace_back(std::any_cast<const std::string&>(params[1]));
+            break;
+        case DBM_PROCESS_MULTI:
+            for (const auto& key : std::any_cast<const std::vector<std::string>&>(params[0])) {
+                keys.emplace_back(key);
+            }
+            break;
+        case DBM_COMPARE_EXCHANGE_MULTI:
+            for (const auto& [key, value] : std::any_cast<const std::vector<std::pair<std::string, std::string>>&>(params[1])) {
+                keys.emplace_back(key);
+            }
+            break;
+        case DBM_WRITE_BATCH:
+            keys = std::any_cast<const std::shared_ptr<const write_batch>&>(params[0])->Keys();
+            break;
+        case DBM_PIPELINE:
+            if (!std::any_cast<const std::shared_ptr<const op_pipeline>&>(params[0])->Keys(&keys)) {
+                counters->Flush();      //A key is read by the pipeline itself
+                return;
+            }
+            break;
+        case DBM_PROCESS_FIRST: case DBM_PROCESS_EACH:
+            if (std::any_cast<bool>(params[1])) {
+                counters->Flush();      //Any record may be written
+            }
+            return;
+        default:
+            return;
+    }
+    counters->FlushKeys(keys);
+}
+
+// Called last on the main thread, once the Promise is settled (or parked by the durability manager)
+void dbmAsyncWorker::Observe(std::chrono::steady_clock::time_point resolve_start, bool error)
+{
+    const auto resolve_end = std::chrono::steady_clock::now();
+    const std::string* key = OperationKey();
+    const uint64_t key_bytes = key ? key->size() : 0;
+    if (tracer) {
+        tracer->Record(op_span{OperationName(operation), key_bytes, bytes_in, queued_at,
+                               execute_start, execute_end, resolve_start, resolve_end, execute_thread, error});
+    }
+    if (capture) {
+        capture->Record(static_cast<uint16_t>(operation), key ? std::string_view(*key) : std::string_view(),
+                        static_cast<uint32_t>(std::min<uint64_t>(bytes_in > key_bytes ? bytes_in - key_bytes : 0, UINT32_MAX)),
+                        static_cast<uint32_t>(std::min<uint64_t>(bytes_out, UINT32_MAX)), queued_at, resolve_end, error);
+    }
+}
+
+// Sizes of the keys and values passed in
+uint64_t dbmAsyncWorker::ParamBytes() const
+{
+    uint64_t bytes = 0;
+    for (const auto& param : params)
+    {
+        if (const auto* str = std::any_cast<std::string>(&param)) {
+            bytes += str->size();
+        } else if (const auto* strs = std::any_cast<std::vector<std::string>>(&param)) {
+            for (const auto& s : *strs) bytes += s.size();
+        } else if (const auto* pairs = std::any_cast<std::vector<std::pair<std::string, std::string>>>(&param)) {
+            for (const auto& [k, v] : *pairs) bytes += k.size() + v.size();
+        } else if (const auto* batch = std::any_cast<std::shared_ptr<const write_batch>>(&param)) {
+            bytes += (*batch)->Bytes();
+        } else if (const auto* pipeline = std::any_cast<std::shared_ptr<const op_pipeline>>(&param)) {
+            bytes += (*pipeline)->Bytes();
+        } else if (const auto* query = std::any_cast<aggregate_query>(&param)) {
+            bytes += query->prefix.size() + query->from.size() + query->to.size();
+        }
+    }
+    return bytes;
+}
+
+// Sizes of the keys and values returned
+uint64_t dbmAsyncWorker::ResultBytes() const
+{
+    uint64_t bytes = 0;
+    if (const auto* str = std::any_cast<std::string>(&any_result)) {
+        bytes = str->size();
+    } else if (const auto* strs = std::any_cast<std::vector<std::string>>(&any_result)) {
+        for (const auto& s : *strs) bytes += s.size();
+    } else if (const auto* pair = std::any_cast<std::pair<std::string, std::string>>(&any_result)) {
+        bytes = pair->first.size() + pair->second.size();
+    } else if (const auto* pairs = std::any_cast<std::vector<std::pair<std::string, std::string>>>(&any_result)) {
+        for (const auto& [k, v] : *pairs) bytes += k.size() + v.size();
+    } else if (const auto* results = std::any_cast<std::vector<pipeline_result>>(&any_result)) {
+        for (const auto& result : *results) bytes += result.value.size();
+    } else if (const auto* aggregate = std::any_cast<aggregate_result>(&any_result)) {
+        for (const auto& [name, value] : aggregate->groups) bytes += name.size();
+        for (const auto& [key, value] : aggregate->top) bytes += key.size();
+    }
+    return bytes;
+}
+
+void dbmAsyncWorker::ExecuteOperation()
 {
     auto get_view = [](const std::string& s) -> std::string_view {
         if (s == std::string(tkrzw::DBM::ANY_DATA)) {
@@ -12,9 +206,21 @@ void dbmAsyncWorker::Execute()
         }
         return s;
     };
+    //Narrowed below for the operations that may end up writing nothing
+    wrote = IsWriteOperation(operation);
+    if (counters) {
+        FlushCounterKeys();
+    }
 
     // ---------------- DBM operations ----------------
-    if (operation == DBM_SET) {
+    if (operation == DBM_SET && counters) {
+        //Drops the pending delta of a counter, which the next flush would add to the new value
+        tkrzw::Status s = counters->Set(
+            std::any_cast<std::string>(params[0]),
+            std::any_cast<std::string>(params[1]));
+        if (s != tkrzw::Status::SUCCESS) SetError("DBM Set failed");
+    }
+    else if (operation == DBM_SET) {
         tkrzw::Status s = dbmReference->Set(
             std::any_cast<std::string>(params[0]),
             std::any_cast<std::string>(params[1]));
@@ -27,6 +233,12 @@ void dbmAsyncWorker::Execute()
             std::any_cast<std::string>(params[2]));
         if (s != tkrzw::Status::SUCCESS) SetError("DBM Append failed");
     }
+    else if (operation == DBM_GET_SIMPLE && counters) {
+        //A counter's pending delta is part of its value
+        any_result = counters->GetSimple(
+            std::any_cast<std::string>(params[0]),
+            std::any_cast<std::string>(params[1]));
+    }
     else if (operation == DBM_GET_SIMPLE) {
         any_result = dbmReference->GetSimple(
             std::any_cast<std::string>(params[0]),
@@ -37,6 +249,12 @@ void dbmAsyncWorker::Execute()
 //            SetError("Key not found");
 //        }
     }
+    else if (operation == DBM_REMOVE && counters) {
+        //Drops the pending delta of a counter, which the next flush would write back
+        tkrzw::Status s = counters->Remove(
+            std::any_cast<std::string>(params[0]));
+        if (s != tkrzw::Status::SUCCESS) SetError("DBM Remove failed");
+    }
     else if (operation == DBM_REMOVE) {
         tkrzw::Status s = dbmReference->Remove(
             std::any_cast<std::string>(params[0]));
@@ -53,7 +271,11 @@ void dbmAsyncWorker::Execute()
     }
     else if (operation == DBM_INCREMENT) {
         int64_t current = 0;
-        tkrzw::Status s = dbmReference->Increment(
+        tkrzw::Status s = counters ? counters->Increment(
+            std::any_cast<std::string>(params[0]),
+            std::any_cast<int64_t>(params[1]),
+            &current,
+            std::any_cast<int64_t>(params[2])) : dbmReference->Increment(
             std::any_cast<std::string>(params[0]),
             std::any_cast<int64_t>(params[1]),
             &current,
@@ -93,6 +315,7 @@ void dbmAsyncWorker::Execute()
         }
         tkrzw::Status s = dbmReference->ProcessMulti(key_proc_pairs, writable);
         tsfn.Release();
+        wrote = writable;
         if (s != tkrzw::Status::SUCCESS) SetError("DBM ProcessMulti failed");
     }
     else if (operation == DBM_PROCESS_FIRST) {
@@ -101,15 +324,39 @@ void dbmAsyncWorker::Execute()
         processor_jsfunc_wrapper processor(tsfn);
         tkrzw::Status s = dbmReference->ProcessFirst(&processor, writable);
         tsfn.Release();
+        wrote = writable;
         if (s != tkrzw::Status::SUCCESS) SetError("DBM ProcessFirst failed");
     }
     else if (operation == DBM_PROCESS_EACH) {
         TSFN tsfn = std::any_cast<TSFN>(params[0]);
         bool writable = std::any_cast<bool>(params[1]);
         processor_jsfunc_wrapper processor(tsfn);
-        tkrzw::Status s = dbmReference->ProcessEach(&processor, writable);
+        tkrzw::Status s;
+        //Once cancelled, the remaining records are skipped without a call into JS
+        if (dynamic_cast<shard_dbm*>(dbmReference) != nullptr) {
+            //One thread per shard, each with its own processor (and new-value buffer) on the shared TSFN;
+            //the start and end calls a single ProcessEach makes are issued once, around all shards
+            processor.ProcessEmpty(tkrzw::DBM::RecordProcessor::NOOP);
+            s = shard_dbm::ForEachShard(dbmReference, [&](tkrzw::DBM* dbm, size_t) {
+                processor_jsfunc_wrapper shard_processor(tsfn);
+                cancellable_processor shard_cancellable(&shard_processor, cancel.get());
+                shard_dbm::full_only_processor proxy(cancel ? static_cast<tkrzw::DBM::RecordProcessor*>(&shard_cancellable)
+                                                            : &shard_processor);
+                return dbm->ProcessEach(&proxy, writable);
+            });
+            if (s == tkrzw::Status::SUCCESS) {
+                processor.ProcessEmpty(tkrzw::DBM::RecordProcessor::NOOP);
+            }
+        } else if (cancel) {
+            cancellable_processor cancellable(&processor, cancel.get());
+            s = dbmReference->ProcessEach(&cancellable, writable);
+        } else {
+            s = dbmReference->ProcessEach(&processor, writable);
+        }
         tsfn.Release();
+        wrote = writable;
         if (s != tkrzw::Status::SUCCESS) SetError("DBM ProcessEach failed");
+        else StopIfCancelled();
     }
     else if (operation == DBM_COUNT) {
         int64_t count = 0;
@@ -136,7 +383,7 @@ void dbmAsyncWorker::Execute()
         any_result = timestamp;
     }
     else if (operation == DBM_CLEAR) {
-        tkrzw::Status s = dbmReference->Clear();
+        tkrzw::Status s = counters ? counters->Clear() : dbmReference->Clear();
         if (s != tkrzw::Status::SUCCESS) SetError("DBM Clear failed");
     }
     else if (operation == DBM_INSPECT) {
@@ -149,13 +396,6 @@ void dbmAsyncWorker::Execute()
             SetError("ShouldBeRebuilt check failed or not needed");
         }
     }
-    else if (operation == DBM_REBUILD) {
-        tkrzw::Status s = dbmReference->RebuildAdvanced(
-            std::any_cast<std::map<std::string,std::string>>(params[0]));
-        if (s != tkrzw::Status::SUCCESS) {
-            SetError("DBM Rebuild failed");
-        }
-    }
     else if (operation == DBM_SYNC) {
         tkrzw::Status s = dbmReference->Synchronize(
             std::any_cast<bool>(params[0]));
@@ -168,72 +408,10 @@ void dbmAsyncWorker::Execute()
         std::string pattern = std::any_cast<std::string>(params[1]);
         size_t max = std::any_cast<std::size_t>(params[2]);
         std::vector<std::string> keys;
-        auto iter = dbmReference->MakeIterator();
-        bool is_ordered = dbmReference->IsOrdered();
-        tkrzw::Status s;
-
-        if (mode == "begin") {
-            if (is_ordered) {
-                s = iter->Jump(pattern);
-                if (s == tkrzw::Status::SUCCESS) {
-                    while (keys.size() < max) {
-                        std::string key;
-                        s = iter->Get(&key, nullptr);
-                        if (s != tkrzw::Status::SUCCESS) break;
-                        if (key.rfind(pattern, 0) != 0) break;
-                        keys.push_back(key);
-                        s = iter->Next();
-                    }
-                }
-            } else {
-                s = iter->First();
-                while (keys.size() < max) {
-                    std::string key;
-                    s = iter->Get(&key, nullptr);
-                    if (s != tkrzw::Status::SUCCESS) break;
-                    if (key.rfind(pattern, 0) == 0) {
-                        keys.push_back(key);
-                    }
-                    s = iter->Next();
-                }
-            }
-        }else if (mode == "contain") {
-			s = iter->First();
-			while (keys.size() < max) {
-				 std::string key;
-				 s = iter->Get(&key, nullptr);
-				 if (s != tkrzw::Status::SUCCESS) break;
-				 if (key.find(pattern) != std::string::npos) {
-					 keys.push_back(key);
-				 }
-				 s = iter->Next();
-			}
-		}else if (mode == "end") {
-			s = iter->First();
-			while (keys.size() < max) {
-				 std::string key;
-				 s = iter->Get(&key, nullptr);
-				 if (s != tkrzw::Status::SUCCESS) break;
-				 if (key.length() >= pattern.length() &&
-					 key.compare(key.length() - pattern.length(), pattern.length(), pattern) == 0) {
-					 keys.push_back(key);
-				 }
-				 s = iter->Next();
-			}
-		}else if (mode == "regex") {
-            std::regex re(pattern);
-            s = iter->First();
-            while (keys.size() < max) {
-                std::string key;
-                s = iter->Get(&key, nullptr);
-                if (s != tkrzw::Status::SUCCESS) break;
-                if (std::regex_match(key, re)) {
-                    keys.push_back(key);
-                }
-                s = iter->Next();
-            }
-        } // add other modes if needed
-        any_result = keys;
+        search_keys(dbmReference, mode, pattern, max, &keys, cancel.get());
+        if (!StopIfCancelled()) {
+            any_result = keys;
+        }
     }
     else if (operation == DBM_EXPORT_KEYS_AS_LINES) {
         std::string dest_path = std::any_cast<std::string>(params[0]);
@@ -249,6 +427,9 @@ void dbmAsyncWorker::Execute()
             return;
         }
         while (true) {
+            if (StopIfCancelled()) {
+                return;
+            }
             std::string key;
             s = iter->Get(&key, nullptr);
             if (s != tkrzw::Status::SUCCESS) break;
@@ -263,11 +444,15 @@ void dbmAsyncWorker::Execute()
         if (file.fail()) SetError("DBM ExportKeysAsLines failed");
     }
     else if (operation == DBM_RESTORE_DATABASE) {
-        tkrzw::Status s = tkrzw::PolyDBM::RestoreDatabase(
+        //A sharded database is restored shard by shard (`<path>-NNNNN-of-NNNNN` files)
+        auto restore = dynamic_cast<shard_dbm*>(dbmReference) != nullptr ?
+            tkrzw::ShardDBM::RestoreDatabase : tkrzw::PolyDBM::RestoreDatabase;
+        tkrzw::Status s = restore(
             std::any_cast<std::string>(params[0]),
             std::any_cast<std::string>(params[1]),
             std::any_cast<std::string>(params[2]),
-            std::any_cast<int64_t>(params[3]));
+            std::any_cast<int64_t>(params[3]),
+            "");
         if (s != tkrzw::Status::SUCCESS) SetError("DBM RestoreDatabase failed");
     }
     else if (operation == DBM_PROCESS) {
@@ -277,8 +462,79 @@ void dbmAsyncWorker::Execute()
         processor_jsfunc_wrapper processor(tsfn);
         tkrzw::Status s = dbmReference->Process(key, &processor, writable);
         tsfn.Release();
+        wrote = writable;
         if (s != tkrzw::Status::SUCCESS) SetError("DBM Process failed");
     }
+    else if (operation == DBM_PREFETCH || operation == DBM_EVICT) {
+        int64_t resident = 0;
+        tkrzw::Status s = operation == DBM_PREFETCH ?
+            prefetch_pages(dbmReference, &resident) : evict_pages(dbmReference, &resident);
+        if (s != tkrzw::Status::SUCCESS) SetError(s.GetMessage());
+        any_result = resident;
+    }
+    else if (operation == DBM_CLOSE) {
+        //Teardown of the handle, queued once its operations are drained; the DBM is closed by its last user
+        tkrzw::Status s = std::any_cast<std::function<tkrzw::Status()>>(params[0])();
+        if (s != tkrzw::Status::SUCCESS) SetError(s.GetMessage());
+    }
+    else if (operation == DBM_FLUSH_COUNTERS) {
+        tkrzw::Status s = counters ? counters->Flush() : tkrzw::Status(tkrzw::Status::SUCCESS);
+        if (s != tkrzw::Status::SUCCESS) SetError("Counter flush failed: " + tkrzw::ToString(s));
+    }
+    else if (operation == DBM_GET_WITH_VERSION) {
+        std::string value;
+        uint64_t version = 0;
+        tkrzw::Status s = record_version::Get(dbmReference, std::any_cast<std::string>(params[0]), &value, &version);
+        if (s == tkrzw::Status::SUCCESS) {
+            any_result = std::make_pair(std::move(value), record_version::ToString(version));
+        } else if (s != tkrzw::Status::NOT_FOUND_ERROR) {       //Not found: any_result stays empty (null)
+            SetError("DBM GetWithVersion failed");
+        }
+    }
+    else if (operation == DBM_SET_IF_VERSION) {
+        std::optional<uint64_t> expected;
+        if (std::any_cast<bool>(params[1])) {
+            expected = std::any_cast<uint64_t>(params[2]);
+        }
+        bool written = false;
+        uint64_t version = 0;
+        tkrzw::Status s = record_version::SetIf(dbmReference, std::any_cast<std::string>(params[0]), expected,
+                                                std::any_cast<std::string>(params[3]), &written, &version);
+        if (s != tkrzw::Status::SUCCESS) {
+            SetError("DBM SetIfVersion failed");
+        } else if (written) {               //Another version: any_result stays empty (null)
+            any_result = record_version::ToString(version);
+        }
+        wrote = written;
+    }
+    else if (operation == DBM_WRITE_BATCH) {
+        const auto& batch = std::any_cast<const std::shared_ptr<const write_batch>&>(params[0]);
+        tkrzw::Status s = batch->Apply(dbmReference, std::any_cast<bool>(params[1]));
+        if (s != tkrzw::Status::SUCCESS) SetError("DBM WriteBatch failed: " + tkrzw::ToString(s));
+        wrote = batch->Size() > 0;
+    }
+    else if (operation == DBM_PIPELINE) {
+        std::vector<pipeline_result> results;
+        const auto& pipeline = std::any_cast<const std::shared_ptr<const op_pipeline>&>(params[0]);
+        tkrzw::Status s = pipeline->Run(dbmReference, &results);
+        if (s != tkrzw::Status::SUCCESS) SetError("DBM Pipeline failed: " + tkrzw::ToString(s));
+        //Only `get` steps, or writes skipped by their condition: nothing for the group commit to wait for
+        wrote = false;
+        for (size_t i = 0; i < results.size(); ++i) {
+            wrote = wrote || (results[i].ran && pipeline->Type(i) != pipeline_step::GET &&
+                              !(pipeline->Type(i) == pipeline_step::REMOVE && !results[i].found));
+        }
+        any_result = std::move(results);
+    }
+    else if (operation == DBM_AGGREGATE) {
+        aggregate_result result;
+        tkrzw::Status s = aggregate_records(dbmReference, std::any_cast<const aggregate_query&>(params[0]), &result, cancel.get());
+        if (s != tkrzw::Status::SUCCESS) {
+            SetError("DBM Aggregate failed: " + tkrzw::ToString(s));
+        } else if (!StopIfCancelled()) {
+            any_result = std::move(result);
+        }
+    }
 
     // ---------------- Iterator operations ----------------
     if (operation == ITERATOR_FIRST) {
@@ -393,12 +649,129 @@ void dbmAsyncWorker::Execute()
     }
 }
 
+bool dbmAsyncWorker::IsWriteOperation(OPERATION_TYPE operation)
+{
+    switch (operation) {
+        case DBM_SET: case DBM_APPEND: case DBM_REMOVE: case DBM_COMPARE_EXCHANGE: case DBM_INCREMENT:
+        case DBM_COMPARE_EXCHANGE_MULTI: case DBM_REKEY: case DBM_PROCESS_MULTI: case DBM_PROCESS_FIRST:
+        case DBM_PROCESS_EACH: case DBM_CLEAR: case DBM_PROCESS: case DBM_FLUSH_COUNTERS: case DBM_SET_IF_VERSION:
+        case DBM_WRITE_BATCH: case DBM_PIPELINE:
+        case ITERATOR_SET: case ITERATOR_REMOVE:
+        case INDEX_ADD: case INDEX_REMOVE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool dbmAsyncWorker::IsScanOperation(OPERATION_TYPE operation)
+{
+    switch (operation) {
+        //Not iterator steps: they are point operations, and shedding one would strand a loop half-way
+        case DBM_PROCESS_EACH: case DBM_SEARCH: case DBM_EXPORT_KEYS_AS_LINES: case DBM_AGGREGATE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+const char* dbmAsyncWorker::OperationName(size_t operation)
+{
+    static const char* const names[OPERATION_TYPE_COUNT] = {
+        "set", "append", "getSimple", "remove", "compareExchange", "increment", "compareExchangeMulti", "rekey",
+        "processMulti", "processFirst", "processEach", "count", "getFileSize", "getFilePath", "getTimestamp",
+        "clear", "inspect", "shouldBeRebuilt", "sync", "search", "exportKeysAsLines", "restoreDatabase", "process",
+        "prefetch", "evict", "close", "flushCounters", "getWithVersion", "setIfVersion", "commit", "pipeline", "aggregate",
+        "iteratorFirst", "iteratorLast", "iteratorJump", "iteratorJumpLower", "iteratorJumpUpper", "iteratorNext",
+        "iteratorPrevious", "iteratorGet", "iteratorSet", "iteratorRemove",
+        "add", "getValues", "check", "remove", "shouldBeRebuilt", "rebuild", "sync",
+        "makeJumpIterator", "getIteratorValue", "continueIteration"
+    };
+    return operation < OPERATION_TYPE_COUNT ? names[operation] : "unknown";
+}
+
 void dbmAsyncWorker::OnOK()
 {
+    if (stats) {
+        stats->End();
+        stats->ReleaseResult(bytes_out);
+    }
+    if (maintenance && wrote) {
+        maintenance->NoteWrite();
+    }
+    if (!tracer && !capture) {
+        ResolveResult();
+    } else {
+        const auto resolve_start = std::chrono::steady_clock::now();
+        ResolveResult();
+        Observe(resolve_start, false);
+    }
+    cancel_js.Detach();
+    if (inflight) {
+        inflight->Settle(admitted_bytes);
+    }
+}
+
+// The new version written by setIfVersion(), or null if the record had another version
+Napi::Value dbmAsyncWorker::VersionResult()
+{
+    if (!any_result.has_value()) {
+        return Env().Null();
+    }
+    return Napi::String::New(Env(), std::any_cast<std::string>(any_result));
+}
+
+// One entry per step: the value read (null if none), true, whether a record was removed, or the new
+// count; undefined for a skipped step
+Napi::Value dbmAsyncWorker::PipelineResult()
+{
+    const auto& pipeline = std::any_cast<const std::shared_ptr<const op_pipeline>&>(params[0]);
+    const auto& results = std::any_cast<const std::vector<pipeline_result>&>(any_result);
+    Napi::Array arr = Napi::Array::New(Env(), results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const pipeline_result& result = results[i];
+        if (!result.ran) {
+            arr.Set(i, Env().Undefined());
+            continue;
+        }
+        switch (pipeline->Type(i))
+        {
+            case pipeline_step::GET:
+                arr.Set(i, result.found ? static_cast<Napi::Value>(Napi::String::New(Env(), result.value)) : Env().Null());
+                break;
+            case pipeline_step::REMOVE:
+                arr.Set(i, Napi::Boolean::New(Env(), result.found));
+                break;
+            case pipeline_step::INCREMENT:
+                arr.Set(i, Napi::Number::New(Env(), static_cast<double>(result.number)));
+                break;
+            default:
+                arr.Set(i, Napi::Boolean::New(Env(), true));
+                break;
+        }
+    }
+    return arr;
+}
+
+// Converts the result to JS and settles the Promise
+void dbmAsyncWorker::ResolveResult()
+{
+    //Only what was written waits for the sync. A write-behind increment is not written yet; the flush that
+    //writes it counts for durability
+    if (durability && wrote && !(counters && operation == DBM_INCREMENT)) {
+        Napi::Value result = operation == DBM_INCREMENT ?
+            static_cast<Napi::Value>(Napi::Number::New(Env(), std::any_cast<int64_t>(any_result))) :
+            operation == DBM_SET_IF_VERSION ? VersionResult() :
+            operation == DBM_PIPELINE ? PipelineResult() :
+            static_cast<Napi::Value>(Napi::Boolean::New(Env(), true));
+        durability->OnWrite(Env(), deferred_promise, result);
+        return;
+    }
     if (operation == DBM_GET_SIMPLE || operation == DBM_GET_FILE_PATH) {
         deferred_promise.Resolve(
             Napi::String::New(Env(), std::any_cast<std::string>(any_result)));
-    } else if (operation == DBM_COUNT || operation == DBM_GET_FILE_SIZE || operation == DBM_INCREMENT) {
+    } else if (operation == DBM_COUNT || operation == DBM_GET_FILE_SIZE || operation == DBM_INCREMENT ||
+               operation == DBM_PREFETCH || operation == DBM_EVICT) {
         deferred_promise.Resolve(
             Napi::Number::New(Env(), std::any_cast<int64_t>(any_result)));
     } else if (operation == DBM_CLEAR) {
@@ -428,6 +801,49 @@ void dbmAsyncWorker::OnOK()
         obj.Set("value", Napi::String::New(Env(), pair.second));
         deferred_promise.Resolve(obj);
     }
+    else if (operation == DBM_GET_WITH_VERSION) {
+        if (!any_result.has_value()) {
+            deferred_promise.Resolve(Env().Null());
+            return;
+        }
+        auto& pair = std::any_cast<std::pair<std::string, std::string>&>(any_result);
+        Napi::Object obj = Napi::Object::New(Env());
+        obj.Set("value", Napi::String::New(Env(), pair.first));
+        obj.Set("version", Napi::String::New(Env(), pair.second));
+        deferred_promise.Resolve(obj);
+    }
+    else if (operation == DBM_SET_IF_VERSION) {
+        deferred_promise.Resolve(VersionResult());
+    }
+    else if (operation == DBM_PIPELINE) {
+        deferred_promise.Resolve(PipelineResult());
+    }
+    else if (operation == DBM_AGGREGATE) {
+        const auto& result = std::any_cast<const aggregate_result&>(any_result);
+        Napi::Object obj = Napi::Object::New(Env());
+        obj.Set("records", Napi::Number::New(Env(), static_cast<double>(result.records)));
+        obj.Set("skipped", Napi::Number::New(Env(), static_cast<double>(result.skipped)));
+        if (std::any_cast<const aggregate_query&>(params[0]).op == aggregate_query::TOP_K) {
+            Napi::Array top = Napi::Array::New(Env(), result.top.size());
+            for (size_t i = 0; i < result.top.size(); ++i) {
+                Napi::Object entry = Napi::Object::New(Env());
+                entry.Set("key", Napi::String::New(Env(), result.top[i].first));
+                entry.Set("value", Napi::Number::New(Env(), result.top[i].second));
+                top.Set(i, entry);
+            }
+            obj.Set("top", top);
+        } else {
+            obj.Set("value", result.has_value ? static_cast<Napi::Value>(Napi::Number::New(Env(), result.value)) : Env().Null());
+            if (std::any_cast<const aggregate_query&>(params[0]).group_depth > 0) {
+                Napi::Object groups = Napi::Object::New(Env());
+                for (const auto& [name, value] : result.groups) {
+                    groups.Set(name, Napi::Number::New(Env(), value));
+                }
+                obj.Set("groups", groups);
+            }
+        }
+        deferred_promise.Resolve(obj);
+    }
     else {
         deferred_promise.Resolve(Napi::Boolean::New(Env(), true));
     }
@@ -435,5 +851,45 @@ void dbmAsyncWorker::OnOK()
 
 void dbmAsyncWorker::OnError(const Napi::Error& err)
 {
+    if (stats) {
+        stats->RecordError(operation);
+        stats->End();
+        stats->ReleaseResult(bytes_out);
+    }
+    const auto resolve_start = std::chrono::steady_clock::now();
+    if (cancelled) {
+        err.Value().Set("code", Napi::String::New(Env(), cancel->Code()));
+    }
     deferred_promise.Reject(err.Value());
-}
\ No newline at end of file
+    if (tracer || capture) {
+        Observe(resolve_start, true);
+    }
+    cancel_js.Detach();
+    if (inflight) {
+        inflight->Settle(admitted_bytes);
+    }
+}
+
+// Releases the TSFN of a JS processor that will never run, so it doesn't keep the process alive
+void dbmAsyncWorker::ReleaseProcessors()
+{
+    for (auto& param : params) {
+        if (auto* tsfn = std::any_cast<TSFN>(&param)) {
+            tsfn->Release();
+        }
+    }
+}
+
+Napi::Promise dbmAsyncWorker::RejectUnqueued(const std::string& message, const char* code)
+{
+    ReleaseProcessors();
+    Napi::Promise promise = deferred_promise.Promise();
+    Napi::Error error = Napi::Error::New(Env(), message);
+    if (code != nullptr) {
+        error.Value().Set("code", Napi::String::New(Env(), code));
+    }
+    deferred_promise.Reject(error.Value());
+    cancel_js.Detach();
+    delete this;
+    return promise;
+}
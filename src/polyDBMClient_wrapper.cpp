@@ -0,0 +1,325 @@
+#include "../include/polyDBMClient_wrapper.hpp"
+#include "../include/utils/addon_data.hpp"
+#include <set>
+
+// Runs on the main thread with the responses of one read (or the end of the connection)
+void ResolveResponses(Napi::Env env, Napi::Function jsCallback, client_requests* requests, client_responses* batch)
+{
+    if (env != nullptr)
+    {
+        for (auto& response : batch->responses)
+        {
+            auto it = requests->pending.find(response.id);
+            if (it == requests->pending.end()) continue;
+            Napi::Promise::Deferred deferred = it->second.deferred;
+            const uint8_t opcode = it->second.opcode;
+            requests->pending.erase(it);
+
+            const auto& f = response.fields;
+            if (response.code != WIRE_OK) {
+                deferred.Reject(Napi::Error::New(env, f.empty() ? "Request failed" : f[0]).Value());
+                continue;
+            }
+            switch (opcode)
+            {
+                case WIRE_GET:
+                case WIRE_GET_FILE_PATH:
+                    deferred.Resolve(Napi::String::New(env, f.empty() ? "" : f[0]));
+                    break;
+                case WIRE_INCREMENT:
+                case WIRE_COUNT:
+                case WIRE_GET_FILE_SIZE:
+                    deferred.Resolve(Napi::Number::New(env, f.empty() ? 0 : wire_to_int64(f[0])));
+                    break;
+                case WIRE_GET_TIMESTAMP:
+                    deferred.Resolve(Napi::Number::New(env, f.empty() ? 0 : wire_to_double(f[0])));
+                    break;
+                case WIRE_INSPECT: {
+                    Napi::Object result = Napi::Object::New(env);
+                    for (size_t i = 0; i + 1 < f.size(); i += 2) {
+                        result.Set(f[i], f[i + 1]);
+                    }
+                    deferred.Resolve(result);
+                    break;
+                }
+                case WIRE_SEARCH: {
+                    Napi::Array result = Napi::Array::New(env, f.size());
+                    for (size_t i = 0; i < f.size(); ++i) {
+                        result.Set(i, f[i]);
+                    }
+                    deferred.Resolve(result);
+                    break;
+                }
+                default:
+                    deferred.Resolve(Napi::Boolean::New(env, true));
+                    break;
+            }
+        }
+        if (batch->closed)
+        {
+            for (auto& [id, request] : requests->pending) {
+                request.deferred.Reject(Napi::Error::New(env, "Connection closed").Value());
+            }
+            requests->pending.clear();
+        }
+        if (requests->pending.empty()) {
+            requests->tsfn.Unref(env);
+        }
+    }
+    delete batch;
+}
+
+polyDBMClient_wrapper::polyDBMClient_wrapper(const Napi::CallbackInfo& info) : Napi::ObjectWrap<polyDBMClient_wrapper>(info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for polyDBMClient").ThrowAsJavaScriptException();
+        return;
+    }
+    std::string socket_path = info[0].As<Napi::String>().Utf8Value();
+
+    requests = new client_requests();
+    requests->tsfn = CLIENT_TSFN::New(env, "polyDBMClient tsfn", 0, 1, requests,
+                                      [](Napi::Env, void*, client_requests* context) { delete context; });
+    requests->tsfn.Unref(env);
+
+    client = std::make_unique<socket_client>();
+    client_requests* context = requests;
+    tkrzw::Status status = client->Connect(socket_path, [context](std::vector<wire_message>* responses, bool closed) {
+        auto* batch = new client_responses{std::move(*responses), closed};
+        if (context->tsfn.BlockingCall(batch) != napi_ok) {
+            delete batch;       //The environment is shutting down
+        }
+    });
+    if (status != tkrzw::Status::SUCCESS) {
+        client.reset();
+        requests->tsfn.Release();
+        requests = nullptr;
+        Napi::Error::New(env, status.GetMessage()).ThrowAsJavaScriptException();
+    }
+}
+
+Napi::Value polyDBMClient_wrapper::request(Napi::Env env, uint8_t opcode, std::vector<std::string> fields)
+{
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    if (!client || !client->IsOpen()) {
+        deferred.Reject(Napi::Error::New(env, "Connection closed").Value());
+        return deferred.Promise();
+    }
+    const uint32_t id = next_id++;
+    if (requests->pending.empty()) {
+        requests->tsfn.Ref(env);
+    }
+    requests->pending.emplace(id, client_request{opcode, deferred});
+    if (!client->Send(wire_message{id, opcode, std::move(fields)}))
+    {
+        requests->pending.erase(id);
+        if (requests->pending.empty()) {
+            requests->tsfn.Unref(env);
+        }
+        deferred.Reject(Napi::Error::New(env, "Connection closed").Value());
+    }
+    return deferred.Promise();
+}
+
+Napi::Value polyDBMClient_wrapper::set(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for set").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return request(env, WIRE_SET, {info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value()});
+}
+
+Napi::Value polyDBMClient_wrapper::append(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for append").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string delimiter = info.Length() > 2 && info[2].IsString() ? info[2].As<Napi::String>().Utf8Value() : "";
+    return request(env, WIRE_APPEND, {info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value(), delimiter});
+}
+
+Napi::Value polyDBMClient_wrapper::getSimple(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for getSimple").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string default_value = info.Length() > 1 && info[1].IsString() ? info[1].As<Napi::String>().Utf8Value() : "";
+    return request(env, WIRE_GET, {info[0].As<Napi::String>().Utf8Value(), default_value});
+}
+
+Napi::Value polyDBMClient_wrapper::remove(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for remove").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return request(env, WIRE_REMOVE, {info[0].As<Napi::String>().Utf8Value()});
+}
+
+Napi::Value polyDBMClient_wrapper::compareExchange(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsString() || !info[2].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for compareExchange").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return request(env, WIRE_COMPARE_EXCHANGE, {info[0].As<Napi::String>().Utf8Value(),
+                                                info[1].As<Napi::String>().Utf8Value(),
+                                                info[2].As<Napi::String>().Utf8Value()});
+}
+
+Napi::Value polyDBMClient_wrapper::increment(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for increment").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    int64_t inc = info.Length() > 1 ? info[1].As<Napi::Number>().Int64Value() : 1;
+    int64_t init = info.Length() > 2 ? info[2].As<Napi::Number>().Int64Value() : 0;
+    return request(env, WIRE_INCREMENT, {info[0].As<Napi::String>().Utf8Value(), wire_int64(inc), wire_int64(init)});
+}
+
+Napi::Value polyDBMClient_wrapper::compareExchangeMulti(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsArray()) {
+        Napi::TypeError::New(env, "Invalid arguments for compareExchangeMulti").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    //Fields: number of expected pairs, then the expected and the desired pairs
+    std::vector<std::string> fields(1);
+    auto add_pairs = [&fields](Napi::Array arr) {
+        size_t added = 0;
+        for (uint32_t i = 0; i < arr.Length(); ++i) {
+            if (!arr.Get(i).IsObject()) continue;
+            Napi::Object obj = arr.Get(i).As<Napi::Object>();
+            if (!obj.Has("key") || !obj.Has("value")) continue;
+            fields.push_back(obj.Get("key").IsString() ? obj.Get("key").As<Napi::String>().Utf8Value() : "");
+            fields.push_back(obj.Get("value").IsString() ? obj.Get("value").As<Napi::String>().Utf8Value() : "");
+            ++added;
+        }
+        return added;
+    };
+    fields[0] = wire_int64(add_pairs(info[0].As<Napi::Array>()));
+    add_pairs(info[1].As<Napi::Array>());
+    return request(env, WIRE_COMPARE_EXCHANGE_MULTI, std::move(fields));
+}
+
+Napi::Value polyDBMClient_wrapper::rekey(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for rekey").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    bool overwrite = info.Length() > 2 ? info[2].As<Napi::Boolean>() : true;
+    bool copying = info.Length() > 3 ? info[3].As<Napi::Boolean>() : false;
+    return request(env, WIRE_REKEY, {info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value(),
+                                     overwrite ? "1" : "0", copying ? "1" : "0"});
+}
+
+Napi::Value polyDBMClient_wrapper::count(const Napi::CallbackInfo& info) {
+    return request(info.Env(), WIRE_COUNT, {});
+}
+
+Napi::Value polyDBMClient_wrapper::getFileSize(const Napi::CallbackInfo& info) {
+    return request(info.Env(), WIRE_GET_FILE_SIZE, {});
+}
+
+Napi::Value polyDBMClient_wrapper::getFilePath(const Napi::CallbackInfo& info) {
+    return request(info.Env(), WIRE_GET_FILE_PATH, {});
+}
+
+Napi::Value polyDBMClient_wrapper::getTimestamp(const Napi::CallbackInfo& info) {
+    return request(info.Env(), WIRE_GET_TIMESTAMP, {});
+}
+
+Napi::Value polyDBMClient_wrapper::clear(const Napi::CallbackInfo& info) {
+    return request(info.Env(), WIRE_CLEAR, {});
+}
+
+Napi::Value polyDBMClient_wrapper::sync(const Napi::CallbackInfo& info) {
+    bool sync_hard = info.Length() > 0 ? info[0].As<Napi::Boolean>() : false;
+    return request(info.Env(), WIRE_SYNC, {sync_hard ? "1" : "0"});
+}
+
+Napi::Value polyDBMClient_wrapper::inspect(const Napi::CallbackInfo& info) {
+    return request(info.Env(), WIRE_INSPECT, {});
+}
+
+Napi::Value polyDBMClient_wrapper::search(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsString() || !info[2].IsNumber()) {
+        Napi::TypeError::New(env, "Invalid arguments for search").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string mode = info[0].As<Napi::String>().Utf8Value();
+    std::set<std::string> supported_modes{"contain", "begin", "end", "regex", "edit", "token", "tokenprefix"};
+    if (supported_modes.find(mode) == supported_modes.end()) {
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        deferred.Reject(Napi::TypeError::New(env, "Search failed: unknown search mode").Value());
+        return deferred.Promise();
+    }
+    return request(env, WIRE_SEARCH, {mode, info[1].As<Napi::String>().Utf8Value(),
+                                      wire_int64(info[2].As<Napi::Number>().Int64Value())});
+}
+
+Napi::Value polyDBMClient_wrapper::ping(const Napi::CallbackInfo& info) {
+    return request(info.Env(), WIRE_PING, {});
+}
+
+Napi::Value polyDBMClient_wrapper::isOpen(const Napi::CallbackInfo& info) {
+    return Napi::Boolean::New(info.Env(), client && client->IsOpen());
+}
+
+// Sends what is queued and closes the connection; requests still unanswered are rejected
+void polyDBMClient_wrapper::shutdown()
+{
+    if (!client) return;
+    client->Close();
+    client.reset();
+    requests->tsfn.Release();       //Responses already queued are still delivered
+    requests = nullptr;
+}
+
+Napi::Value polyDBMClient_wrapper::close(const Napi::CallbackInfo& info) {
+    shutdown();
+    return Napi::Boolean::New(info.Env(), true);
+}
+
+Napi::Object polyDBMClient_wrapper::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function functionList = DefineClass(env, "polyDBMClient",
+    {
+        InstanceMethod<&polyDBMClient_wrapper::set>("set", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::append>("append", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::getSimple>("getSimple", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::getSimple>("get", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::remove>("remove", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::compareExchange>("compareExchange", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::increment>("increment", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::compareExchangeMulti>("compareExchangeMulti", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::rekey>("rekey", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::count>("count", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::getFileSize>("getFileSize", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::getFilePath>("getFilePath", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::getTimestamp>("getTimestamp", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::clear>("clear", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::sync>("sync", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::inspect>("inspect", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::search>("search", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::ping>("ping", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::isOpen>("isOpen", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBMClient_wrapper::close>("close", static_cast<napi_property_attributes>(napi_writable | napi_configurable))
+    });
+
+    env.GetInstanceData<addon_data>()->polyDBMClient_constructor = Napi::Persistent(functionList);
+
+    exports.Set("polyDBMClient", functionList);
+    return exports;
+}
+
+void polyDBMClient_wrapper::Finalize(Napi::Env env)
+{
+    shutdown();
+}
@@ -1,24 +1,172 @@
 #include "../include/polyDBM_wrapper.hpp"
 #include "../include/dbm_async_worker.hpp"
 #include "../include/utils/tsfn_types.hpp"
+#include "../include/utils/addon_data.hpp"
+#include "../include/utils/record_version.hpp"
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
-// Constructor
+// Passed as the `data` of the polyShardDBM class; both JS classes share this C++ wrapper
+static char SHARD_CLASS_TAG[] = "polyShardDBM";
+
+// Tuning params as given to OpenAdvanced(), without the durability and admission settings; false with a JS
+// exception pending on error
+bool polyDBM_wrapper::ParseOpenConfig(Napi::Env env, Napi::Value config, const std::string& path, bool sharded,
+                                      std::map<std::string, std::string>* params, durability_config* durability_conf,
+                                      admission_config* admission_conf, counter_config* counter_conf) {
+    *params = parseConfig(env, config);
+    if (sharded) {
+        //A new sharded database gets one shard per core unless `num_shards` says otherwise
+        int32_t existing_shards = 0;
+        if (params->find("num_shards") == params->end() &&
+            tkrzw::ShardDBM::GetNumberOfShards(path, &existing_shards) != tkrzw::Status::SUCCESS) {
+            (*params)["num_shards"] = std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+        }
+    }
+    std::string config_error;
+    if (!durability_config::Extract(*params, durability_conf, &config_error) ||
+        !admission_config::Extract(*params, admission_conf, &config_error) ||
+        !counter_config::Extract(*params, counter_conf, &config_error)) {
+        Napi::TypeError::New(env, config_error).ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+// Constructor; the third argument is internal, the DBM opened by open()
 polyDBM_wrapper::polyDBM_wrapper(const Napi::CallbackInfo& info)
     : Napi::ObjectWrap<polyDBM_wrapper>(info) {
     Napi::Env env = info.Env();
 
-    std::map<std::string, std::string> optional_tuning_params = parseConfig(env, info[0]);
     std::string dbmPath = info[1].As<Napi::String>();
+    bool sharded = info.Data() == SHARD_CLASS_TAG;
+    std::map<std::string, std::string> optional_tuning_params;
+    durability_config durability_conf;
+    admission_config admission_conf;
+    counter_config counter_conf;
+    if (!ParseOpenConfig(env, info[0], dbmPath, sharded, &optional_tuning_params, &durability_conf, &admission_conf,
+                         &counter_conf)) {
+        return;
+    }
+    inflight = std::make_shared<inflight_tracker>(admission_conf);
+    auto ulog_it = optional_tuning_params.find("ulog_prefix");
+    if (ulog_it != optional_tuning_params.end()) {
+        ulog_prefix = ulog_it->second;
+    }
+    auto cache_buckets_it = optional_tuning_params.find("cache_buckets");
+    cache_buckets = cache_buckets_it != optional_tuning_params.end() && tkrzw::StrToBool(cache_buckets_it->second);
+
+    if (info.Length() > 2 && info[2].IsExternal()) {
+        dbm = *info[2].As<Napi::External<std::shared_ptr<tkrzw::ParamDBM>>>().Data();
+    } else {
+        //A path already open in this process (e.g. by another worker_thread) shares that DBM;
+        //the config of the first opener applies
+        tkrzw::Status opening_status = dbm_registry::Acquire(dbmPath, sharded,
+            [sharded]() -> std::shared_ptr<tkrzw::ParamDBM> {
+                if (sharded) {
+                    return std::make_shared<shard_dbm>();
+                }
+                return std::make_shared<tkrzw::PolyDBM>();
+            },
+            [&](tkrzw::ParamDBM* unopened) {
+                return unopened->OpenAdvanced(dbmPath, true,
+                                              durability_conf.GetOpenOptions(),
+                                              optional_tuning_params);
+            },
+            &dbm);
+        if (opening_status != tkrzw::Status::SUCCESS) {
+            Napi::TypeError::New(env, opening_status.GetMessage().c_str())
+                .ThrowAsJavaScriptException();
+            return;
+        }
+    }
+    if (durability_conf.mode == durability_config::DURABILITY_PERIODIC || durability_conf.mode == durability_config::DURABILITY_GROUP) {
+        //Not through `this`: close() hands the manager and the DBM over to its teardown
+        durability = std::make_shared<durability_manager>(env, [synced = dbm.get()](bool hard) { return synced->Synchronize(hard); }, durability_conf);
+    }
+    if (counter_conf.write_behind) {
+        counters = std::make_shared<counter_aggregator>(dbm.get(), counter_conf, [durability = durability]() {
+            if (durability) {
+                durability->NoteWrite();
+            }
+        });
+    }
+}
+
+// polyDBM.open(config, path, {onProgress, progressIntervalMs, prefetch}): opens and recovers on a native
+// thread instead of blocking the event loop; resolves to the instance
+Napi::Value polyDBM_wrapper::open(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !(info[0].IsObject() || info[0].IsString()) || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for open").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string path = info[1].As<Napi::String>();
+    bool sharded = info.Data() == SHARD_CLASS_TAG;
+    open_task::options opts;
+    Napi::Function on_progress;
+    if (info.Length() > 2 && info[2].IsObject()) {
+        Napi::Object js_opts = info[2].As<Napi::Object>();
+        opts.prefetch = js_opts.Get("prefetch").ToBoolean();
+        if (js_opts.Get("progressIntervalMs").IsNumber()) {
+            opts.progress_interval = std::max(0.01, js_opts.Get("progressIntervalMs").As<Napi::Number>().DoubleValue() / 1000.0);
+        }
+        if (js_opts.Get("onProgress").IsFunction()) {
+            on_progress = js_opts.Get("onProgress").As<Napi::Function>();
+        }
+    }
+    std::map<std::string, std::string> params;
+    durability_config durability_conf;
+    admission_config admission_conf;        //Read again by the constructor, like the counter keys
+    counter_config counter_conf;
+    if (!ParseOpenConfig(env, info[0], path, sharded, &params, &durability_conf, &admission_conf, &counter_conf)) {
+        return env.Undefined();
+    }
+    auto* data = env.GetInstanceData<addon_data>();
+    Napi::Function constructor = (sharded ? data->polyShardDBM_constructor : data->polyDBM_constructor).Value();
+    return open_task::Start(env, constructor, info[0], path, sharded, std::move(params),
+                            durability_conf.GetOpenOptions(), opts, on_progress);
+}
 
-    tkrzw::Status opening_status =
-        dbm.OpenAdvanced(dbmPath, true,
-                         tkrzw::File::OPEN_DEFAULT | tkrzw::File::OPEN_SYNC_HARD,
-                         optional_tuning_params).OrDie();
-    if (opening_status != tkrzw::Status::SUCCESS) {
-        Napi::TypeError::New(env, opening_status.GetMessage().c_str())
-            .ThrowAsJavaScriptException();
+// Every method queues through here; a last argument `{signal, deadlineMs}` makes the operation cancellable
+Napi::Value polyDBM_wrapper::queueWorker(dbmAsyncWorker* asyncWorker, const Napi::CallbackInfo& info) {
+    if (info.Length() > 0 && cancel_binding::IsOptions(info[info.Length() - 1])) {
+        asyncWorker->cancel = cancel_binding::FromOptions(info.Env(), info[info.Length() - 1], &asyncWorker->cancel_js);
+        if (asyncWorker->cancel && asyncWorker->cancel->IsCancelled()) {
+            return asyncWorker->RejectUnqueued(asyncWorker->cancel->Message(), asyncWorker->cancel->Code());
+        }
+    }
+    const uint64_t bytes = inflight->LimitsBytes() ? asyncWorker->ParamBytes() : 0;
+    const bool scan = dbmAsyncWorker::IsScanOperation(asyncWorker->GetOperation());
+    //A waiting worker is queued by the settling worker that makes room for it, not through `this`
+    const auto admission = inflight->Admit(bytes, scan, [asyncWorker]() { asyncWorker->Queue(); });
+    if (admission == inflight_tracker::CLOSED) {
+        return asyncWorker->RejectUnqueued("Database is closed");
     }
+    if (admission == inflight_tracker::OVERLOADED) {
+        const bool shed = scan && inflight->Config().policy == admission_config::ADMISSION_SHED;
+        return asyncWorker->RejectUnqueued(shed ? "Scan shed: too many operations in flight" : "Too many operations in flight",
+                                           "ERR_OVERLOADED");
+    }
+    asyncWorker->inflight = inflight;
+    asyncWorker->admitted_bytes = bytes;
+    asyncWorker->durability = durability;
+    asyncWorker->maintenance = maintenance;
+    asyncWorker->stats = stats;
+    asyncWorker->queued_at = std::chrono::steady_clock::now();
+    if (tracing) {
+        asyncWorker->tracer = tracer;
+    }
+    asyncWorker->capture = capture;
+    asyncWorker->hot_keys = hot_keys;
+    asyncWorker->counters = counters;
+    stats->Begin();
+    Napi::Promise promise = asyncWorker->deferred_promise.Promise();
+    if (admission == inflight_tracker::ADMITTED) {
+        asyncWorker->Queue();
+    }
+    return promise;
 }
 
 // Basic methods
@@ -31,9 +179,8 @@ Napi::Value polyDBM_wrapper::set(const Napi::CallbackInfo& info) {
     std::string key = info[0].As<Napi::String>().Utf8Value();
     std::string value = info[1].As<Napi::String>().Utf8Value();
 
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_SET, key, value);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_SET, key, value);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::append(const Napi::CallbackInfo& info) {
@@ -46,9 +193,8 @@ Napi::Value polyDBM_wrapper::append(const Napi::CallbackInfo& info) {
     std::string value = info[1].As<Napi::String>().Utf8Value();
     std::string delimiter = info.Length() > 2 && info[2].IsString() ? info[2].As<Napi::String>().Utf8Value() : "";
 
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_APPEND, key, value, delimiter);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_APPEND, key, value, delimiter);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::getSimple(const Napi::CallbackInfo& info) {
@@ -60,16 +206,14 @@ Napi::Value polyDBM_wrapper::getSimple(const Napi::CallbackInfo& info) {
     std::string key = info[0].As<Napi::String>().Utf8Value();
     std::string default_value = info.Length() > 1 && info[1].IsString() ? info[1].As<Napi::String>().Utf8Value() : "";
 
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_GET_SIMPLE, key, default_value);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_GET_SIMPLE, key, default_value);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::shouldBeRebuilt(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_SHOULD_BE_REBUILT);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_SHOULD_BE_REBUILT);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::rebuild(const Napi::CallbackInfo& info) {
@@ -78,17 +222,400 @@ Napi::Value polyDBM_wrapper::rebuild(const Napi::CallbackInfo& info) {
     if (info.Length() > 0 && info[0].IsObject()) {
         optional_tuning_params = parseConfig(env, info[0]);
     }
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_REBUILD, optional_tuning_params);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    rebuild_task::options opts;
+    Napi::Function on_progress;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object js_opts = info[1].As<Napi::Object>();
+        if (js_opts.Get("throttleBytesPerSec").IsNumber()) {
+            opts.throttle_bytes_per_sec = js_opts.Get("throttleBytesPerSec").As<Napi::Number>().Int64Value();
+        }
+        if (js_opts.Get("progressIntervalMs").IsNumber()) {
+            opts.progress_interval = std::max(0.01, js_opts.Get("progressIntervalMs").As<Napi::Number>().DoubleValue() / 1000.0);
+        }
+        if (js_opts.Get("onProgress").IsFunction()) {
+            on_progress = js_opts.Get("onProgress").As<Napi::Function>();
+        }
+    }
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    if (!dbm->IsOpen() || !dbm->IsWritable()) {
+        deferred.Reject(Napi::Error::New(env, "rebuild() requires an open, writable database").Value());
+        return deferred.Promise();
+    }
+    if (rebuilder && rebuilder->IsRunning()) {
+        deferred.Reject(Napi::Error::New(env, "A rebuild is already running").Value());
+        return deferred.Promise();
+    }
+    rebuilder.reset();          //Joins the thread of the previous, finished rebuild
+    rebuilder = std::make_unique<rebuild_task>(env, dbm, optional_tuning_params, opts, deferred, on_progress,
+                                               info.Length() > 1 ? info[1] : env.Undefined());
+    rebuilder->Start();
+    return deferred.Promise();
+}
+
+Napi::Value polyDBM_wrapper::cancelRebuild(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!rebuilder || !rebuilder->IsRunning()) {
+        return Napi::Boolean::New(env, false);
+    }
+    rebuilder->Cancel();        //The Promise of rebuild() is rejected once the current shard is done
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value polyDBM_wrapper::startMaintenance(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!dbm->IsOpen() || !dbm->IsWritable()) {
+        Napi::Error::New(env, "startMaintenance() requires an open, writable database").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (maintenance) {
+        Napi::Error::New(env, "Maintenance is already running; call stopMaintenance() first").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    maintenance_scheduler::options opts;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object js_opts = info[0].As<Napi::Object>();
+        if (js_opts.Get("checkIntervalMs").IsNumber()) {
+            opts.check_interval = std::max(0.01, js_opts.Get("checkIntervalMs").As<Napi::Number>().DoubleValue() / 1000.0);
+        }
+        if (js_opts.Get("idle").IsBoolean()) {
+            opts.idle = js_opts.Get("idle").As<Napi::Boolean>();
+        }
+        if (js_opts.Get("idleWritesPerSec").IsNumber()) {
+            opts.idle_writes_per_sec = js_opts.Get("idleWritesPerSec").As<Napi::Number>().DoubleValue();
+        }
+        if (js_opts.Get("idleMs").IsNumber()) {
+            opts.idle_time = js_opts.Get("idleMs").As<Napi::Number>().DoubleValue() / 1000.0;
+        }
+        if (js_opts.Get("rebuildFragmentation").IsNumber()) {
+            opts.rebuild_fragmentation = js_opts.Get("rebuildFragmentation").As<Napi::Number>().DoubleValue();
+        }
+        if (js_opts.Get("minRebuildBytes").IsNumber()) {
+            opts.min_rebuild_bytes = js_opts.Get("minRebuildBytes").As<Napi::Number>().Int64Value();
+        }
+        if (js_opts.Get("sync").IsBoolean()) {
+            opts.sync = js_opts.Get("sync").As<Napi::Boolean>();
+        }
+        if (js_opts.Get("throttleBytesPerSec").IsNumber()) {
+            opts.throttle_bytes_per_sec = std::max<int64_t>(0, js_opts.Get("throttleBytesPerSec").As<Napi::Number>().Int64Value());
+        }
+        if (js_opts.Get("schedule").IsArray()) {
+            Napi::Array schedule = js_opts.Get("schedule").As<Napi::Array>();
+            for (uint32_t i = 0; i < schedule.Length(); ++i) {
+                std::string text = schedule.Get(i).ToString().Utf8Value();
+                maintenance_scheduler::window w;
+                if (!maintenance_scheduler::options::ParseWindow(text, &w)) {
+                    Napi::TypeError::New(env, "Invalid schedule window: " + text + " (expected HH:MM-HH:MM)").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+                opts.schedule.push_back(w);
+            }
+        }
+    }
+    maintenance = std::make_shared<maintenance_scheduler>(dbm, opts);
+    maintenance->Start();
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value polyDBM_wrapper::maintenanceStatus(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!maintenance) {
+        return env.Null();
+    }
+    maintenance_scheduler::status st = maintenance->GetStatus();
+    auto run_info = [&env](const maintenance_scheduler::run_info& run) {
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("count", Napi::Number::New(env, static_cast<double>(run.count)));
+        obj.Set("lastRun", run.last_time < 0 ? env.Null() : Napi::Number::New(env, static_cast<double>(run.last_time)));
+        obj.Set("lastDurationMs", Napi::Number::New(env, run.last_duration * 1000.0));
+        obj.Set("lastError", run.last_error.empty() ? env.Null() : Napi::String::New(env, run.last_error));
+        return obj;
+    };
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("running", Napi::Boolean::New(env, st.running));
+    obj.Set("state", Napi::String::New(env, st.state));
+    obj.Set("writesPerSec", Napi::Number::New(env, st.writes_per_sec));
+    obj.Set("fragmentation", Napi::Number::New(env, st.fragmentation));
+    obj.Set("idle", Napi::Boolean::New(env, st.idle));
+    obj.Set("inSchedule", Napi::Boolean::New(env, st.in_schedule));
+    obj.Set("sync", run_info(st.sync));
+    obj.Set("rebuild", run_info(st.rebuild));
+    return obj;
+}
+
+Napi::Value polyDBM_wrapper::stopMaintenance(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!maintenance) {
+        return Napi::Boolean::New(env, false);
+    }
+    //Doesn't wait for a rebuild in progress: close() joins the scheduler, which keeps the DBM open meanwhile
+    maintenance->RequestStop();
+    stopped_maintenance.push_back(std::move(maintenance));
+    stopped_maintenance.erase(std::remove_if(stopped_maintenance.begin(), stopped_maintenance.end(),
+        [](const std::shared_ptr<maintenance_scheduler>& stopped) { return !stopped->IsRunning(); }),
+        stopped_maintenance.end());
+    return Napi::Boolean::New(env, true);
+}
+
+// stats(reset = false): latency percentiles and counters per operation since open or the last reset
+Napi::Value polyDBM_wrapper::getStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    bool reset = info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+    Napi::Object result = stats->ToObject(env, dbmAsyncWorker::OperationName, reset);
+    Napi::Object admission = Napi::Object::New(env);
+    admission.Set("inFlight", Napi::Number::New(env, static_cast<double>(inflight->InFlight())));
+    admission.Set("inFlightBytes", Napi::Number::New(env, static_cast<double>(inflight->InFlightBytes())));
+    admission.Set("waiting", Napi::Number::New(env, static_cast<double>(inflight->Waiting())));
+    admission.Set("waited", Napi::Number::New(env, static_cast<double>(inflight->Waited())));
+    admission.Set("rejected", Napi::Number::New(env, static_cast<double>(inflight->Rejected())));
+    admission.Set("shed", Napi::Number::New(env, static_cast<double>(inflight->Shed())));
+    result.Set("admission", admission);
+    if (counters) {
+        Napi::Object counter_stats = Napi::Object::New(env);
+        counter_stats.Set("keys", Napi::Number::New(env, static_cast<double>(counters->Keys())));
+        counter_stats.Set("pending", Napi::Number::New(env, static_cast<double>(counters->Pending())));
+        counter_stats.Set("flushes", Napi::Number::New(env, static_cast<double>(counters->Flushes())));
+        counter_stats.Set("failed", Napi::Number::New(env, static_cast<double>(counters->Failed())));
+        result.Set("counters", counter_stats);
+    }
+    return result;
+}
+
+// startTrace({maxSpans, slowMs, maxSlowOps}): records the phases of every operation until stopTrace()
+Napi::Value polyDBM_wrapper::startTrace(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (tracing) {
+        Napi::Error::New(env, "Tracing is already running; call stopTrace() first").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    op_tracer::options opts;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object js_opts = info[0].As<Napi::Object>();
+        if (js_opts.Get("maxSpans").IsNumber()) {
+            opts.max_spans = static_cast<size_t>(std::max<int64_t>(0, js_opts.Get("maxSpans").As<Napi::Number>().Int64Value()));
+        }
+        if (js_opts.Get("slowMs").IsNumber()) {
+            opts.slow_threshold = js_opts.Get("slowMs").As<Napi::Number>().DoubleValue() / 1000.0;
+        }
+        if (js_opts.Get("maxSlowOps").IsNumber()) {
+            opts.max_slow_ops = static_cast<size_t>(std::max<int64_t>(0, js_opts.Get("maxSlowOps").As<Napi::Number>().Int64Value()));
+        }
+    }
+    tracer = std::make_shared<op_tracer>(opts);
+    tracing = true;
+    return Napi::Boolean::New(env, true);
+}
+
+// Operations already queued are still recorded when they settle
+Napi::Value polyDBM_wrapper::stopTrace(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    const bool was_tracing = tracing;
+    tracing = false;
+    return Napi::Boolean::New(env, was_tracing);
+}
+
+// writeTrace(path): Chrome trace-event JSON of the buffered spans; returns the number of operations written
+Napi::Value polyDBM_wrapper::writeTrace(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for writeTrace").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (!tracer) {
+        Napi::Error::New(env, "No trace recorded; call startTrace() first").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string error;
+    if (!tracer->WriteChromeTrace(info[0].As<Napi::String>().Utf8Value(), &error)) {
+        Napi::Error::New(env, "writeTrace() failed: " + error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return Napi::Number::New(env, static_cast<double>(tracer->NumSpans()));
+}
+
+// slowOps(clear = false): operations over the slowMs threshold, oldest first
+Napi::Value polyDBM_wrapper::slowOps(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!tracer) {
+        return Napi::Array::New(env);
+    }
+    bool clear = info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+    return tracer->SlowOps(env, clear);
+}
+
+// startCapture(path, {sampleRate}): writes every operation (key hash, sizes, timing) to a binary trace
+Napi::Value polyDBM_wrapper::startCapture(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for startCapture").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (capture) {
+        Napi::Error::New(env, "Already capturing to " + capture->Path() + "; call stopCapture() first").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    op_capture::options opts;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object js_opts = info[1].As<Napi::Object>();
+        if (js_opts.Get("sampleRate").IsNumber()) {
+            opts.sample_rate = std::clamp(js_opts.Get("sampleRate").As<Napi::Number>().DoubleValue(), 0.0, 1.0);
+        }
+    }
+    std::vector<std::string> op_names;
+    for (size_t i = 0; i < dbmAsyncWorker::OPERATION_TYPE_COUNT; ++i) {
+        op_names.push_back(dbmAsyncWorker::OperationName(i));
+    }
+    auto new_capture = std::make_shared<op_capture>(info[0].As<Napi::String>().Utf8Value(), opts, op_names);
+    std::string error;
+    if (!new_capture->Open(&error)) {
+        Napi::Error::New(env, "startCapture() failed: " + error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    capture = std::move(new_capture);
+    return Napi::Boolean::New(env, true);
+}
+
+// Operations still queued are not captured; returns {path, records, bytes} or null if not capturing
+Napi::Value polyDBM_wrapper::stopCapture(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!capture) {
+        return env.Null();
+    }
+    capture->Close();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("path", Napi::String::New(env, capture->Path()));
+    result.Set("records", Napi::Number::New(env, static_cast<double>(capture->NumRecords())));
+    result.Set("bytes", Napi::Number::New(env, static_cast<double>(capture->NumBytes())));
+    capture.reset();
+    return result;
+}
+
+// trackHotKeys({k, width, depth}) starts the sketches, trackHotKeys(false) drops them
+Napi::Value polyDBM_wrapper::trackHotKeys(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() > 0 && info[0].IsBoolean() && !info[0].As<Napi::Boolean>().Value()) {
+        const bool was_tracking = static_cast<bool>(hot_keys);
+        hot_keys.reset();
+        return Napi::Boolean::New(env, was_tracking);
+    }
+    hot_key_tracker::options opts;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object js_opts = info[0].As<Napi::Object>();
+        if (js_opts.Get("k").IsNumber()) {
+            opts.k = static_cast<size_t>(std::clamp<int64_t>(js_opts.Get("k").As<Napi::Number>().Int64Value(), 1, 10000));
+        }
+        if (js_opts.Get("width").IsNumber()) {
+            opts.width = static_cast<size_t>(std::clamp<int64_t>(js_opts.Get("width").As<Napi::Number>().Int64Value(), 16, 1 << 24));
+        }
+        if (js_opts.Get("depth").IsNumber()) {
+            opts.depth = static_cast<size_t>(std::clamp<int64_t>(js_opts.Get("depth").As<Napi::Number>().Int64Value(), 1, 16));
+        }
+    }
+    hot_keys = std::make_shared<hot_key_tracker>(opts);
+    return Napi::Boolean::New(env, true);
+}
+
+// hotKeys({limit, reset}): {since, reads, writes, bytes} largest first, or null if not tracking
+Napi::Value polyDBM_wrapper::hotKeys(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!hot_keys) {
+        return env.Null();
+    }
+    size_t limit = SIZE_MAX;
+    bool reset = false;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object js_opts = info[0].As<Napi::Object>();
+        if (js_opts.Get("limit").IsNumber()) {
+            limit = static_cast<size_t>(std::max<int64_t>(0, js_opts.Get("limit").As<Napi::Number>().Int64Value()));
+        }
+        reset = js_opts.Get("reset").ToBoolean();
+    }
+    auto to_array = [&](const heavy_hitters& sketch, const char* field) {
+        const auto top = sketch.Top(limit);
+        Napi::Array arr = Napi::Array::New(env, top.size());
+        for (size_t i = 0; i < top.size(); ++i) {
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("key", Napi::String::New(env, top[i].key));
+            obj.Set(field, Napi::Number::New(env, static_cast<double>(top[i].estimate)));
+            arr.Set(i, obj);
+        }
+        return arr;
+    };
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("since", Napi::Number::New(env, static_cast<double>(hot_keys->Since())));
+    result.Set("reads", to_array(hot_keys->reads, "count"));
+    result.Set("writes", to_array(hot_keys->writes, "count"));
+    result.Set("bytes", to_array(hot_keys->bytes, "bytes"));
+    if (reset) {
+        hot_keys->Reset();
+    }
+    return result;
+}
+
+// memoryStats(): page-cache residency of the files, DBM-side caches and memory held by the addon
+Napi::Value polyDBM_wrapper::memoryStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!dbm) {
+        Napi::Error::New(env, "Database is not open").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    const auto files = inspect_memory(dbm.get(), cache_buckets);
+    Napi::Array js_files = Napi::Array::New(env, files.size());
+    int64_t file_bytes = 0, mapped_bytes = 0, resident_bytes = 0, bucket_cache_bytes = 0, page_cache_bytes = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        Napi::Object file = Napi::Object::New(env);
+        file.Set("path", Napi::String::New(env, files[i].path));
+        file.Set("size", Napi::Number::New(env, static_cast<double>(files[i].size)));
+        file.Set("residentBytes", Napi::Number::New(env, static_cast<double>(files[i].resident)));
+        file.Set("memoryMapped", Napi::Boolean::New(env, files[i].memory_mapped));
+        js_files.Set(i, file);
+        file_bytes += files[i].size;
+        mapped_bytes += files[i].memory_mapped ? files[i].size : 0;
+        resident_bytes += files[i].resident;
+        bucket_cache_bytes += files[i].bucket_cache;
+        page_cache_bytes += files[i].page_cache;
+    }
+    Napi::Object addon = Napi::Object::New(env);
+    addon.Set("stats", Napi::Number::New(env, static_cast<double>(stats->MemoryUsage())));
+    addon.Set("tracer", Napi::Number::New(env, static_cast<double>(tracer ? tracer->MemoryUsage() : 0)));
+    addon.Set("capture", Napi::Number::New(env, static_cast<double>(capture ? capture->MemoryUsage() : 0)));
+    addon.Set("hotKeys", Napi::Number::New(env, static_cast<double>(hot_keys ? hot_keys->MemoryUsage() : 0)));
+    double addon_bytes = 0;
+    for (const char* name : {"stats", "tracer", "capture", "hotKeys"}) {
+        addon_bytes += addon.Get(name).As<Napi::Number>().DoubleValue();
+    }
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("fileBytes", Napi::Number::New(env, static_cast<double>(file_bytes)));
+    result.Set("mappedBytes", Napi::Number::New(env, static_cast<double>(mapped_bytes)));
+    result.Set("residentBytes", Napi::Number::New(env, static_cast<double>(resident_bytes)));
+    result.Set("bucketCacheBytes", Napi::Number::New(env, static_cast<double>(bucket_cache_bytes)));
+    result.Set("pageCacheBytes", Napi::Number::New(env, static_cast<double>(page_cache_bytes)));
+    result.Set("addonBytes", Napi::Number::New(env, addon_bytes));
+    result.Set("addon", addon);
+    result.Set("inFlight", Napi::Number::New(env, static_cast<double>(stats->InFlight())));
+    result.Set("inFlightResultBytes", Napi::Number::New(env, static_cast<double>(stats->InFlightResultBytes())));
+    result.Set("files", js_files);
+    return result;
+}
+
+// Reads the files into the page cache; resolves to the resident bytes afterwards
+Napi::Value polyDBM_wrapper::prefetch(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_PREFETCH);
+    return queueWorker(asyncWorker, info);
+}
+
+// Drops the files from the page cache (best effort for memory-mapped DBMs); resolves to the resident bytes afterwards
+Napi::Value polyDBM_wrapper::evict(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_EVICT);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::sync(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     bool sync_hard = info.Length() > 0 ? info[0].As<Napi::Boolean>() : false;
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_SYNC, sync_hard);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_SYNC, sync_hard);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::process(const Napi::CallbackInfo& info) {
@@ -103,21 +630,179 @@ Napi::Value polyDBM_wrapper::process(const Napi::CallbackInfo& info) {
 
     TSFN tsfn = TSFN::New(env, jsprocessor, "processor_jsfunc_wrapper tsfn", 0, 1);
 
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_PROCESS, key, writable, tsfn);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_PROCESS, key, writable, tsfn);
+    return queueWorker(asyncWorker, info);
 }
 
+// Stops admitting operations and resolves once the ones in flight are drained, the helpers are stopped
+// and the DBM is released (closed, and flushed, by its last user) on the pool
 Napi::Value polyDBM_wrapper::close(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    tkrzw::Status close_status = dbm.Close();
-    if (close_status != tkrzw::Status::SUCCESS) {
-        Napi::TypeError::New(env, close_status.GetMessage().c_str()).ThrowAsJavaScriptException();
+    if (!closing.IsEmpty()) {
+        return closing.Value();
+    }
+    if (rebuilder) {
+        rebuilder->Cancel();        //Takes effect after the shard being rebuilt; joined by the teardown
+    }
+    if (maintenance) {
+        maintenance->RequestStop(); //Same for its rebuild
+    }
+    //Everything that may wait moves to the teardown; from here on this handle behaves as closed
+    std::shared_ptr<tkrzw::ParamDBM> closed_dbm = dbm;
+    if (dynamic_cast<shard_dbm*>(dbm.get()) != nullptr) {
+        dbm = std::make_shared<shard_dbm>();
+    } else {
+        dbm = std::make_shared<tkrzw::PolyDBM>();
+    }
+    std::function<tkrzw::Status()> teardown =
+        [closed_dbm, server = std::shared_ptr<socket_server>(std::move(server)),
+         rebuilder = std::shared_ptr<rebuild_task>(std::move(rebuilder)), maintenance = std::move(maintenance),
+         stopped_maintenance = std::move(stopped_maintenance),
+         replicator = std::shared_ptr<ulog_replicator>(std::move(replicator)), durability = std::move(durability),
+         capture = std::move(capture), noack = std::move(noack), counters = std::move(counters)]() mutable {
+            server.reset();             //Joins the client connections: they lose it before the DBM goes away
+            rebuilder.reset();
+            if (maintenance) {
+                maintenance->Stop();
+            }
+            for (auto& stopped : stopped_maintenance) {
+                stopped->Stop();
+            }
+            replicator.reset();
+            if (noack) {
+                noack->Stop();          //Applies the unacknowledged writes still queued
+            }
+            if (counters) {
+                counters->Stop();       //Writes the pending counter deltas
+            }
+            if (durability) {
+                durability->Stop();     //Final sync; parked write Promises resolve
+            }
+            if (capture) {
+                capture->Close();       //Flushes the trace
+            }
+            return dbm_registry::Release(&closed_dbm);
+        };
+    auto* asyncWorker = new dbmAsyncWorker(env, *closed_dbm, dbmAsyncWorker::DBM_CLOSE, teardown);
+    closing = Napi::Persistent(static_cast<Napi::Object>(asyncWorker->deferred_promise.Promise()));
+    Ref();                          //The iterator of in-flight workers is a member
+    inflight->Drain([this, asyncWorker]() {
+        iterator.reset(nullptr);
+        asyncWorker->Queue();
+        Unref();
+    });
+    return closing.Value();
+}
+
+// The writer of unacknowledged writes, started on first use; nullptr once closed
+noack_writer* polyDBM_wrapper::noAckWriter(Napi::Env env) {
+    if (inflight->IsDraining()) {
+        return nullptr;
+    }
+    if (!noack) {
+        noack = std::make_shared<noack_writer>(env, dbm.get(), inflight->Config().max_noack_pending,
+            [durability = durability]() {
+                if (durability) {
+                    durability->NoteWrite();
+                }
+            });
+    }
+    return noack.get();
+}
+
+// Queues an unacknowledged write; false if refused (closed, or over noack_max_pending)
+Napi::Value polyDBM_wrapper::queueNoAck(Napi::Env env, noack_write* write) {
+    noack_writer* writer = noAckWriter(env);
+    if (writer == nullptr) {
+        delete write;
+        return Napi::Boolean::New(env, false);
+    }
+    return Napi::Boolean::New(env, writer->Push(write));
+}
+
+Napi::Value polyDBM_wrapper::setNoAck(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for setNoAck").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    auto* write = new noack_write(noack_write::SET);
+    write->key = info[0].As<Napi::String>().Utf8Value();
+    write->value = info[1].As<Napi::String>().Utf8Value();
+    return queueNoAck(env, write);
+}
+
+Napi::Value polyDBM_wrapper::appendNoAck(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for appendNoAck").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    auto* write = new noack_write(noack_write::APPEND);
+    write->key = info[0].As<Napi::String>().Utf8Value();
+    write->value = info[1].As<Napi::String>().Utf8Value();
+    write->delimiter = info.Length() > 2 && info[2].IsString() ? info[2].As<Napi::String>().Utf8Value() : "";
+    return queueNoAck(env, write);
+}
+
+Napi::Value polyDBM_wrapper::incrementNoAck(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "Invalid arguments for incrementNoAck").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    auto* write = new noack_write(noack_write::INCREMENT);
+    write->key = info[0].As<Napi::String>().Utf8Value();
+    write->increment = info[1].As<Napi::Number>().Int64Value();
+    write->initial = info.Length() > 2 && info[2].IsNumber() ? info[2].As<Napi::Number>().Int64Value() : 0;
+    return queueNoAck(env, write);
+}
+
+// flushNoAck(): resolves once the unacknowledged writes queued so far are applied
+Napi::Value polyDBM_wrapper::flushNoAck(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!noack) {
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        deferred.Resolve(Napi::Boolean::New(env, true));
+        return deferred.Promise();
+    }
+    return noack->Flush(env);
+}
+
+// onNoAckError(callback | null): callback({failed, lastError}) with the failures of unacknowledged writes, aggregated
+Napi::Value polyDBM_wrapper::onNoAckError(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !(info[0].IsFunction() || info[0].IsNull())) {
+        Napi::TypeError::New(env, "Invalid arguments for onNoAckError").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    noack_writer* writer = noAckWriter(env);
+    if (writer == nullptr) {
         return Napi::Boolean::New(env, false);
     }
+    writer->SetErrorHandler(info[0].IsFunction() ? info[0].As<Napi::Function>() : Napi::Function());
     return Napi::Boolean::New(env, true);
 }
 
+// noAckStats(): {pending, written, failed, dropped, lastError} of the unacknowledged writes
+Napi::Value polyDBM_wrapper::noAckStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("pending", Napi::Number::New(env, static_cast<double>(noack ? noack->Pending() : 0)));
+    result.Set("written", Napi::Number::New(env, static_cast<double>(noack ? noack->Written() : 0)));
+    result.Set("failed", Napi::Number::New(env, static_cast<double>(noack ? noack->Failed() : 0)));
+    result.Set("dropped", Napi::Number::New(env, static_cast<double>(noack ? noack->Dropped() : 0)));
+    result.Set("lastError", noack && !noack->LastError().empty() ? Napi::String::New(env, noack->LastError()) : env.Null());
+    return result;
+}
+
+// flushCounters(): writes the pending deltas of write-behind counters now
+Napi::Value polyDBM_wrapper::flushCounters(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_FLUSH_COUNTERS);
+    return queueWorker(asyncWorker, info);
+}
+
 // Additional DBM methods
 Napi::Value polyDBM_wrapper::get(const Napi::CallbackInfo& info) {
     return getSimple(info);
@@ -130,9 +815,8 @@ Napi::Value polyDBM_wrapper::remove(const Napi::CallbackInfo& info) {
         return env.Undefined();
     }
     std::string key = info[0].As<Napi::String>().Utf8Value();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_REMOVE, key);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_REMOVE, key);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::compareExchange(const Napi::CallbackInfo& info) {
@@ -144,9 +828,37 @@ Napi::Value polyDBM_wrapper::compareExchange(const Napi::CallbackInfo& info) {
     std::string key = info[0].As<Napi::String>().Utf8Value();
     std::string expected = info[1].As<Napi::String>().Utf8Value();
     std::string desired = info[2].As<Napi::String>().Utf8Value();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_COMPARE_EXCHANGE, key, expected, desired);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_COMPARE_EXCHANGE, key, expected, desired);
+    return queueWorker(asyncWorker, info);
+}
+
+// getWithVersion(key): {value, version}, or null if there is no record
+Napi::Value polyDBM_wrapper::getWithVersion(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for getWithVersion").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string key = info[0].As<Napi::String>().Utf8Value();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_GET_WITH_VERSION, key);
+    return queueWorker(asyncWorker, info);
+}
+
+// setIfVersion(key, version | null, value): the new version, or null if the record has another version;
+// a null version creates the record only if there is none
+Napi::Value polyDBM_wrapper::setIfVersion(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint64_t version = 0;
+    if (info.Length() < 3 || !info[0].IsString() || !(info[1].IsString() || info[1].IsNull()) || !info[2].IsString() ||
+        (info[1].IsString() && !record_version::Parse(info[1].As<Napi::String>().Utf8Value(), &version))) {
+        Napi::TypeError::New(env, "Invalid arguments for setIfVersion").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string key = info[0].As<Napi::String>().Utf8Value();
+    bool has_version = info[1].IsString();
+    std::string value = info[2].As<Napi::String>().Utf8Value();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_SET_IF_VERSION, key, has_version, version, value);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::increment(const Napi::CallbackInfo& info) {
@@ -158,9 +870,8 @@ Napi::Value polyDBM_wrapper::increment(const Napi::CallbackInfo& info) {
     std::string key = info[0].As<Napi::String>().Utf8Value();
     int64_t inc = info.Length() > 1 ? info[1].As<Napi::Number>().Int64Value() : 1;
     int64_t init = info.Length() > 2 ? info[2].As<Napi::Number>().Int64Value() : 0;
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_INCREMENT, key, inc, init);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_INCREMENT, key, inc, init);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::compareExchangeMulti(const Napi::CallbackInfo& info) {
@@ -190,9 +901,122 @@ Napi::Value polyDBM_wrapper::compareExchangeMulti(const Napi::CallbackInfo& info
         if (obj.Get("value").IsNull() || obj.Get("value").IsUndefined()) v = "";
         desired.emplace_back(k, v);
     }
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_COMPARE_EXCHANGE_MULTI, expected, desired);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_COMPARE_EXCHANGE_MULTI, expected, desired);
+    return queueWorker(asyncWorker, info);
+}
+
+// batch(): a writeBatch applying its operations to this database
+Napi::Value polyDBM_wrapper::batch(const Napi::CallbackInfo& info) {
+    return info.Env().GetInstanceData<addon_data>()->writeBatch_constructor.New({info.This()});
+}
+
+Napi::Value polyDBM_wrapper::commitBatch(std::shared_ptr<const write_batch> ops, bool atomic, const Napi::CallbackInfo& info) {
+    auto* asyncWorker = new dbmAsyncWorker(info.Env(), *dbm, dbmAsyncWorker::DBM_WRITE_BATCH, std::move(ops), atomic);
+    return queueWorker(asyncWorker, info);
+}
+
+// A key or value of a pipeline step: a string, or {ref: n} for the value read by step n
+static bool ParsePipelineOperand(Napi::Value value, pipeline_operand* operand) {
+    if (value.IsString()) {
+        operand->text = value.As<Napi::String>().Utf8Value();
+        return true;
+    }
+    if (!value.IsObject() || !value.As<Napi::Object>().Get("ref").IsNumber()) {
+        return false;
+    }
+    operand->ref = value.As<Napi::Object>().Get("ref").As<Napi::Number>().Int32Value();
+    return operand->ref >= 0;
+}
+
+// {op, key, value?, delimiter?, increment?, initial?, if?: {step, exists | equals | notEquals}}; the error names the field
+static bool ParsePipelineStep(Napi::Value value, pipeline_step* step, std::string* error) {
+    if (!value.IsObject() || !value.As<Napi::Object>().Get("op").IsString()) {
+        *error = "op";
+        return false;
+    }
+    Napi::Object obj = value.As<Napi::Object>();
+    const std::string op = obj.Get("op").As<Napi::String>().Utf8Value();
+    if (op == "get") step->type = pipeline_step::GET;
+    else if (op == "set") step->type = pipeline_step::SET;
+    else if (op == "append") step->type = pipeline_step::APPEND;
+    else if (op == "remove") step->type = pipeline_step::REMOVE;
+    else if (op == "increment") step->type = pipeline_step::INCREMENT;
+    else {
+        *error = "op";
+        return false;
+    }
+    if (!ParsePipelineOperand(obj.Get("key"), &step->key)) {
+        *error = "key";
+        return false;
+    }
+    if ((step->type == pipeline_step::SET || step->type == pipeline_step::APPEND) &&
+        !ParsePipelineOperand(obj.Get("value"), &step->value)) {
+        *error = "value";
+        return false;
+    }
+    if (obj.Get("delimiter").IsString()) {
+        step->delimiter = obj.Get("delimiter").As<Napi::String>().Utf8Value();
+    }
+    if (obj.Get("increment").IsNumber()) {
+        step->delta = obj.Get("increment").As<Napi::Number>().Int64Value();
+    }
+    if (obj.Get("initial").IsNumber()) {
+        step->initial = obj.Get("initial").As<Napi::Number>().Int64Value();
+    }
+    Napi::Value condition = obj.Get("if");
+    if (condition.IsUndefined()) {
+        return true;
+    }
+    if (!condition.IsObject() || !condition.As<Napi::Object>().Get("step").IsNumber()) {
+        *error = "if";
+        return false;
+    }
+    Napi::Object cond = condition.As<Napi::Object>();
+    step->condition_step = cond.Get("step").As<Napi::Number>().Int32Value();
+    if (cond.Get("exists").IsBoolean()) {
+        step->condition = cond.Get("exists").As<Napi::Boolean>() ? pipeline_step::EXISTS : pipeline_step::MISSING;
+    } else if (cond.Has("equals") && ParsePipelineOperand(cond.Get("equals"), &step->expected)) {
+        step->condition = pipeline_step::EQUALS;
+    } else if (cond.Has("notEquals") && ParsePipelineOperand(cond.Get("notEquals"), &step->expected)) {
+        step->condition = pipeline_step::NOT_EQUALS;
+    } else {
+        *error = "if";
+        return false;
+    }
+    if (step->condition_step < 0) {
+        *error = "if.step";
+        return false;
+    }
+    return true;
+}
+
+// pipeline(steps, {atomic, signal, deadlineMs}): runs the steps in one worker; resolves to one result per step
+Napi::Value polyDBM_wrapper::pipeline(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsArray() || (info.Length() > 1 && !info[1].IsObject() && !info[1].IsUndefined())) {
+        Napi::TypeError::New(env, "Invalid arguments for pipeline").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    Napi::Array arr = info[0].As<Napi::Array>();
+    std::vector<pipeline_step> steps(arr.Length());
+    std::string error;
+    for (uint32_t i = 0; i < arr.Length(); ++i) {
+        if (!ParsePipelineStep(arr.Get(i), &steps[i], &error)) {
+            Napi::TypeError::New(env, "Invalid pipeline step " + std::to_string(i) + ": " + error).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+    bool atomic = false;
+    if (info.Length() > 1 && info[1].IsObject() && info[1].As<Napi::Object>().Get("atomic").IsBoolean()) {
+        atomic = info[1].As<Napi::Object>().Get("atomic").As<Napi::Boolean>();
+    }
+    auto steps_pipeline = std::make_shared<const op_pipeline>(std::move(steps), atomic);
+    if (!steps_pipeline->Validate(&error)) {
+        Napi::TypeError::New(env, "Invalid pipeline " + error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_PIPELINE, steps_pipeline);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::rekey(const Napi::CallbackInfo& info) {
@@ -205,9 +1029,8 @@ Napi::Value polyDBM_wrapper::rekey(const Napi::CallbackInfo& info) {
     std::string new_key = info[1].As<Napi::String>().Utf8Value();
     bool overwrite = info.Length() > 2 ? info[2].As<Napi::Boolean>() : true;
     bool copying = info.Length() > 3 ? info[3].As<Napi::Boolean>() : false;
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_REKEY, old_key, new_key, overwrite, copying);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_REKEY, old_key, new_key, overwrite, copying);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::processMulti(const Napi::CallbackInfo& info) {
@@ -224,9 +1047,8 @@ Napi::Value polyDBM_wrapper::processMulti(const Napi::CallbackInfo& info) {
         keys.push_back(keysArr.Get(i).As<Napi::String>().Utf8Value());
     }
     TSFN tsfn = TSFN::New(env, jsprocessor, "processMulti tsfn", 0, 1);
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_PROCESS_MULTI, keys, tsfn, writable);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_PROCESS_MULTI, keys, tsfn, writable);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::processFirst(const Napi::CallbackInfo& info) {
@@ -238,9 +1060,8 @@ Napi::Value polyDBM_wrapper::processFirst(const Napi::CallbackInfo& info) {
     Napi::Function jsprocessor = info[0].As<Napi::Function>();
     bool writable = info.Length() > 1 ? info[1].As<Napi::Boolean>() : false;
     TSFN tsfn = TSFN::New(env, jsprocessor, "processFirst tsfn", 0, 1);
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_PROCESS_FIRST, tsfn, writable);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_PROCESS_FIRST, tsfn, writable);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::processEach(const Napi::CallbackInfo& info) {
@@ -252,71 +1073,64 @@ Napi::Value polyDBM_wrapper::processEach(const Napi::CallbackInfo& info) {
     Napi::Function jsprocessor = info[0].As<Napi::Function>();
     bool writable = info.Length() > 1 ? info[1].As<Napi::Boolean>() : false;
     TSFN tsfn = TSFN::New(env, jsprocessor, "processEach tsfn", 0, 1);
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_PROCESS_EACH, tsfn, writable);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_PROCESS_EACH, tsfn, writable);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::count(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_COUNT);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_COUNT);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::getFileSize(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_GET_FILE_SIZE);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_GET_FILE_SIZE);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::getFilePath(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_GET_FILE_PATH);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_GET_FILE_PATH);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::getTimestamp(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_GET_TIMESTAMP);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_GET_TIMESTAMP);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::clear(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_CLEAR);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_CLEAR);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::inspect(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_INSPECT);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_INSPECT);
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::isOpen(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    return Napi::Boolean::New(env, dbm.IsOpen());
+    return Napi::Boolean::New(env, dbm->IsOpen());
 }
 
 Napi::Value polyDBM_wrapper::isWritable(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    return Napi::Boolean::New(env, dbm.IsWritable());
+    return Napi::Boolean::New(env, dbm->IsWritable());
 }
 
 Napi::Value polyDBM_wrapper::isHealthy(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    return Napi::Boolean::New(env, dbm.IsHealthy());
+    return Napi::Boolean::New(env, dbm->IsHealthy());
 }
 
 Napi::Value polyDBM_wrapper::isOrdered(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    return Napi::Boolean::New(env, dbm.IsOrdered());
+    return Napi::Boolean::New(env, dbm->IsOrdered());
 }
 
 Napi::Value polyDBM_wrapper::search(const Napi::CallbackInfo& info) {
@@ -335,15 +1149,68 @@ Napi::Value polyDBM_wrapper::search(const Napi::CallbackInfo& info) {
     std::string pattern = info[1].As<Napi::String>().Utf8Value();
     size_t capacity = info[2].As<Napi::Number>().Int64Value();
 
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_SEARCH, mode, pattern, capacity);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_SEARCH, mode, pattern, capacity);
+    return queueWorker(asyncWorker, info);
+}
+
+// aggregate({op, prefix | range: {from, to}, field, delimiter, format, groupBy, keyDelimiter, k, signal, deadlineMs})
+Napi::Value polyDBM_wrapper::aggregate(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Invalid arguments for aggregate").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    Napi::Object opts = info[0].As<Napi::Object>();
+    aggregate_query query;
+    const std::string op = opts.Get("op").IsString() ? opts.Get("op").As<Napi::String>().Utf8Value() : "count";
+    if (op == "count") query.op = aggregate_query::COUNT;
+    else if (op == "sum") query.op = aggregate_query::SUM;
+    else if (op == "min") query.op = aggregate_query::MIN;
+    else if (op == "max") query.op = aggregate_query::MAX;
+    else if (op == "topK") query.op = aggregate_query::TOP_K;
+    else {
+        Napi::TypeError::New(env, "Invalid arguments for aggregate: unknown op " + op).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (opts.Get("prefix").IsString()) {
+        query.prefix = opts.Get("prefix").As<Napi::String>().Utf8Value();
+    }
+    if (opts.Get("range").IsObject()) {
+        Napi::Object range = opts.Get("range").As<Napi::Object>();
+        if (range.Get("from").IsString()) query.from = range.Get("from").As<Napi::String>().Utf8Value();
+        if (range.Get("to").IsString()) query.to = range.Get("to").As<Napi::String>().Utf8Value();
+    }
+    if (opts.Get("field").IsNumber()) {
+        query.field = opts.Get("field").As<Napi::Number>().Int32Value();
+    }
+    if (opts.Get("delimiter").IsString()) {
+        query.delimiter = opts.Get("delimiter").As<Napi::String>().Utf8Value();
+    }
+    if (opts.Get("format").IsString()) {
+        const std::string format = opts.Get("format").As<Napi::String>().Utf8Value();
+        if (format != "text" && format != "int64") {
+            Napi::TypeError::New(env, "Invalid arguments for aggregate: unknown format " + format).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        query.int64 = format == "int64";
+    }
+    if (opts.Get("groupBy").IsNumber()) {
+        query.group_depth = std::max(0, opts.Get("groupBy").As<Napi::Number>().Int32Value());
+    }
+    if (opts.Get("keyDelimiter").IsString()) {
+        query.key_delimiter = opts.Get("keyDelimiter").As<Napi::String>().Utf8Value();
+    }
+    if (opts.Get("k").IsNumber()) {
+        query.k = static_cast<size_t>(std::max<int64_t>(0, opts.Get("k").As<Napi::Number>().Int64Value()));
+    }
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_AGGREGATE, query);
+    return queueWorker(asyncWorker, info);
 }
 
 // Iterator methods
 Napi::Value polyDBM_wrapper::makeIterator(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    iterator = dbm.MakeIterator();
+    iterator = dbm->MakeIterator();
     return Napi::Boolean::New(env, true);
 }
 
@@ -355,8 +1222,7 @@ Napi::Value polyDBM_wrapper::iteratorFirst(const Napi::CallbackInfo& info) {
         return deferred.Promise();
     }
     dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_FIRST);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorLast(const Napi::CallbackInfo& info) {
@@ -367,8 +1233,7 @@ Napi::Value polyDBM_wrapper::iteratorLast(const Napi::CallbackInfo& info) {
 		return deferred.Promise();
 	}
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_LAST);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorJump(const Napi::CallbackInfo& info) {
@@ -384,8 +1249,7 @@ Napi::Value polyDBM_wrapper::iteratorJump(const Napi::CallbackInfo& info) {
     }
     std::string key = info[0].As<Napi::String>().Utf8Value();
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_JUMP, key);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorJumpLower(const Napi::CallbackInfo& info) {
@@ -401,8 +1265,7 @@ Napi::Value polyDBM_wrapper::iteratorJumpLower(const Napi::CallbackInfo& info) {
     }
     std::string key = info[0].As<Napi::String>().Utf8Value();
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_JUMP_LOWER, key);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorJumpUpper(const Napi::CallbackInfo& info) {
@@ -418,8 +1281,7 @@ Napi::Value polyDBM_wrapper::iteratorJumpUpper(const Napi::CallbackInfo& info) {
     }
     std::string key = info[0].As<Napi::String>().Utf8Value();
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_JUMP_UPPER, key);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorNext(const Napi::CallbackInfo& info) {
@@ -430,8 +1292,7 @@ Napi::Value polyDBM_wrapper::iteratorNext(const Napi::CallbackInfo& info) {
 		return deferred.Promise();
 	}
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_NEXT);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorPrevious(const Napi::CallbackInfo& info) {
@@ -442,8 +1303,7 @@ Napi::Value polyDBM_wrapper::iteratorPrevious(const Napi::CallbackInfo& info) {
 		return deferred.Promise();
 	}
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_PREVIOUS);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorGet(const Napi::CallbackInfo& info) {
@@ -454,8 +1314,7 @@ Napi::Value polyDBM_wrapper::iteratorGet(const Napi::CallbackInfo& info) {
 		return deferred.Promise();
 	}
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_GET);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorSet(const Napi::CallbackInfo& info) {
@@ -471,8 +1330,7 @@ Napi::Value polyDBM_wrapper::iteratorSet(const Napi::CallbackInfo& info) {
     }
     std::string value = info[0].As<Napi::String>().Utf8Value();
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_SET, value);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::iteratorRemove(const Napi::CallbackInfo& info) {
@@ -483,8 +1341,7 @@ Napi::Value polyDBM_wrapper::iteratorRemove(const Napi::CallbackInfo& info) {
 		return deferred.Promise();
 	}
     auto* asyncWorker = new dbmAsyncWorker(env, iterator, dbmAsyncWorker::ITERATOR_REMOVE);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    return queueWorker(asyncWorker, info);
 }
 
 Napi::Value polyDBM_wrapper::freeIterator(const Napi::CallbackInfo& info) {
@@ -500,9 +1357,8 @@ Napi::Value polyDBM_wrapper::exportKeysAsLines(const Napi::CallbackInfo& info) {
         return env.Undefined();
     }
     std::string dest_path = info[0].As<Napi::String>().Utf8Value();
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_EXPORT_KEYS_AS_LINES, dest_path);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_EXPORT_KEYS_AS_LINES, dest_path);
+    return queueWorker(asyncWorker, info);
 }
 
 // Restoration methods
@@ -516,27 +1372,174 @@ Napi::Value polyDBM_wrapper::restoreDatabase(const Napi::CallbackInfo& info) {
     std::string new_path = info[1].As<Napi::String>().Utf8Value();
     std::string class_name = info.Length() > 2 ? info[2].As<Napi::String>().Utf8Value() : "";
     int64_t end_offset = info.Length() > 3 ? info[3].As<Napi::Number>().Int64Value() : -1;
-    auto* asyncWorker = new dbmAsyncWorker(env, dbm, dbmAsyncWorker::DBM_RESTORE_DATABASE, old_path, new_path, class_name, end_offset);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    auto* asyncWorker = new dbmAsyncWorker(env, *dbm, dbmAsyncWorker::DBM_RESTORE_DATABASE, old_path, new_path, class_name, end_offset);
+    return queueWorker(asyncWorker, info);
+}
+
+// Change feed over the update log (requires `ulog_prefix` in the config)
+Napi::Value polyDBM_wrapper::changes(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() > 0 && !info[0].IsObject() && !info[0].IsUndefined()) {
+        Napi::TypeError::New(env, "Invalid arguments for changes").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (ulog_prefix.empty()) {
+        Napi::Error::New(env, "changes() requires the database to be opened with `ulog_prefix`").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    Napi::Value opts = info.Length() > 0 ? info[0] : env.Undefined();
+    return env.GetInstanceData<addon_data>()->changeFeed_constructor.New({Napi::String::New(env, ulog_prefix), opts});
+}
+
+// Follow another database's update log (a local replica): replicate(masterUlogPrefix, {serverId, dbmIndex, fromTimestamp, batchSize, intervalMs})
+Napi::Value polyDBM_wrapper::replicate(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString() || (info.Length() > 1 && !info[1].IsObject() && !info[1].IsUndefined())) {
+        Napi::TypeError::New(env, "Invalid arguments for replicate").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string master_prefix = info[0].As<Napi::String>().Utf8Value();
+    if (!dbm->IsOpen() || !dbm->IsWritable()) {
+        Napi::Error::New(env, "replicate() requires an open, writable database").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (master_prefix == ulog_prefix) {
+        Napi::Error::New(env, "replicate() can't follow the database's own update log").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (replicator && replicator->GetStatus().running) {
+        Napi::Error::New(env, "Replication is already running; call stopReplication() first").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ulog_replicator::options opts;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object js_opts = info[1].As<Napi::Object>();
+        if (js_opts.Get("serverId").IsNumber()) {
+            opts.server_id = js_opts.Get("serverId").As<Napi::Number>().Int32Value();
+        }
+        if (js_opts.Get("dbmIndex").IsNumber()) {
+            opts.dbm_index = js_opts.Get("dbmIndex").As<Napi::Number>().Int32Value();
+        }
+        if (js_opts.Get("fromTimestamp").IsNumber()) {
+            opts.from_timestamp = js_opts.Get("fromTimestamp").As<Napi::Number>().Int64Value();
+        }
+        if (js_opts.Get("batchSize").IsNumber()) {
+            opts.batch_size = static_cast<size_t>(std::max<int64_t>(1, js_opts.Get("batchSize").As<Napi::Number>().Int64Value()));
+        }
+        if (js_opts.Get("intervalMs").IsNumber()) {
+            opts.wait_time = std::max(1.0, js_opts.Get("intervalMs").As<Napi::Number>().DoubleValue()) / 1000.0;
+        }
+    }
+
+    replicator.reset();
+    replicator = std::make_unique<ulog_replicator>(dbm.get(), master_prefix, opts);
+    replicator->Start();
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value polyDBM_wrapper::replicationStatus(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!replicator) {
+        return env.Null();
+    }
+    ulog_replicator::status st = replicator->GetStatus();
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("running", Napi::Boolean::New(env, st.running));
+    obj.Set("masterUlogPrefix", Napi::String::New(env, replicator->GetPrefix()));
+    obj.Set("appliedCount", Napi::Number::New(env, static_cast<double>(st.applied_count)));
+    obj.Set("appliedTimestamp", Napi::Number::New(env, static_cast<double>(st.applied_timestamp)));
+    obj.Set("lagMs", Napi::Number::New(env, static_cast<double>(st.lag_time)));
+    obj.Set("lagBytes", Napi::Number::New(env, static_cast<double>(st.lag_bytes)));
+    obj.Set("lastError", st.last_error.empty() ? env.Null() : Napi::String::New(env, st.last_error));
+    return obj;
+}
+
+Napi::Value polyDBM_wrapper::stopReplication(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!replicator) {
+        return Napi::Boolean::New(env, false);
+    }
+    replicator->Stop();             //The status stays readable until the next replicate()
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value polyDBM_wrapper::serve(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for serve").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (!dbm->IsOpen()) {
+        Napi::Error::New(env, "serve() requires an open database").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (server) {
+        Napi::Error::New(env, "Already serving on " + server->GetPath() + "; call stopServing() first").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    auto new_server = std::make_unique<socket_server>(dbm, info[0].As<Napi::String>().Utf8Value());
+    tkrzw::Status status = new_server->Start();
+    if (status != tkrzw::Status::SUCCESS) {
+        Napi::Error::New(env, "serve() failed: " + tkrzw::ToString(status)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    server = std::move(new_server);
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value polyDBM_wrapper::stopServing(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!server) {
+        return Napi::Boolean::New(env, false);
+    }
+    server.reset();                 //Closes every client connection and joins their threads
+    return Napi::Boolean::New(env, true);
 }
 
 Napi::Object polyDBM_wrapper::Init(Napi::Env env, Napi::Object exports) {
-    Napi::Function functionList = DefineClass(env, "polyDBM",
+    std::vector<PropertyDescriptor> properties =
     {
         InstanceMethod<&polyDBM_wrapper::set>("set", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::append>("append", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::getSimple>("getSimple", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::shouldBeRebuilt>("shouldBeRebuilt", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::rebuild>("rebuild", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::cancelRebuild>("cancelRebuild", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::startMaintenance>("startMaintenance", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::maintenanceStatus>("maintenanceStatus", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::stopMaintenance>("stopMaintenance", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::getStats>("stats", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::startTrace>("startTrace", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::stopTrace>("stopTrace", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::writeTrace>("writeTrace", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::slowOps>("slowOps", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::startCapture>("startCapture", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::stopCapture>("stopCapture", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::trackHotKeys>("trackHotKeys", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::hotKeys>("hotKeys", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::memoryStats>("memoryStats", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::prefetch>("prefetch", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::evict>("evict", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::sync>("sync", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::process>("process", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::close>("close", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::setNoAck>("setNoAck", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::appendNoAck>("appendNoAck", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::incrementNoAck>("incrementNoAck", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::flushNoAck>("flushNoAck", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::onNoAckError>("onNoAckError", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::noAckStats>("noAckStats", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::flushCounters>("flushCounters", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::get>("get", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::remove>("remove", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::compareExchange>("compareExchange", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::getWithVersion>("getWithVersion", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::setIfVersion>("setIfVersion", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::increment>("increment", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::compareExchangeMulti>("compareExchangeMulti", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::batch>("batch", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::pipeline>("pipeline", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::rekey>("rekey", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::processMulti>("processMulti", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::processFirst>("processFirst", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
@@ -551,6 +1554,7 @@ Napi::Object polyDBM_wrapper::Init(Napi::Env env, Napi::Object exports) {
         InstanceMethod<&polyDBM_wrapper::isWritable>("isWritable", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::isHealthy>("isHealthy", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::isOrdered>("isOrdered", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::aggregate>("aggregate", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyDBM_wrapper::search>("search", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         
         // NEW: Iterator methods
@@ -575,25 +1579,67 @@ Napi::Object polyDBM_wrapper::Init(Napi::Env env, Napi::Object exports) {
         // NEW: Restoration methods
         InstanceMethod<&polyDBM_wrapper::restoreDatabase>("restoreDatabase", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         
+        // Update log
+        InstanceMethod<&polyDBM_wrapper::changes>("changes", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::replicate>("replicate", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::replicationStatus>("replicationStatus", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::stopReplication>("stopReplication", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+
+        // Server mode
+        InstanceMethod<&polyDBM_wrapper::serve>("serve", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyDBM_wrapper::stopServing>("stopServing", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+
         // Static symbols for processor return values
         StaticValue("NOOP", noopSym, static_cast<napi_property_attributes>(napi_enumerable)),
         StaticValue("REMOVE", removeSym, static_cast<napi_property_attributes>(napi_enumerable))
-    });
+    };
+
+    //open() tells the classes apart by its data, like the constructor
+    std::vector<PropertyDescriptor> shard_properties = properties;
+    properties.push_back(StaticMethod<&polyDBM_wrapper::open>("open", static_cast<napi_property_attributes>(napi_writable | napi_configurable)));
+    shard_properties.push_back(StaticMethod<&polyDBM_wrapper::open>("open", static_cast<napi_property_attributes>(napi_writable | napi_configurable), SHARD_CLASS_TAG));
+
+    Napi::Function functionList = DefineClass(env, "polyDBM", properties);
+    Napi::Function shardFunctionList = DefineClass(env, "polyShardDBM", shard_properties, SHARD_CLASS_TAG);
 
-    Napi::FunctionReference* constructor = new Napi::FunctionReference();
-    *constructor = Napi::Persistent(functionList);
-    env.SetInstanceData<Napi::FunctionReference>(constructor);
+    env.GetInstanceData<addon_data>()->polyDBM_constructor = Napi::Persistent(functionList);
+    env.GetInstanceData<addon_data>()->polyShardDBM_constructor = Napi::Persistent(shardFunctionList);
     
     exports.Set("polyDBM", functionList);
+    exports.Set("polyShardDBM", shardFunctionList);
     return exports;
 }
 
 void polyDBM_wrapper::Finalize(Napi::Env env)
 {
+    server.reset();
+    if (maintenance) {
+        maintenance->RequestStop(); //Cancels its rebuild while the rebuilder is joined
+    }
+    rebuilder.reset();
+    if (maintenance) {
+        maintenance->Stop();
+    }
+    for (auto& stopped : stopped_maintenance) {
+        stopped->Stop();
+    }
+    replicator.reset();             //Joins the replication thread, which writes to `dbm`
+    if (noack) {
+        noack->Stop();
+    }
+    if (counters) {
+        counters->Stop();
+    }
+    if (durability) {
+        durability->Stop();
+    }
+    if (capture) {
+        capture->Close();
+    }
     iterator.reset(nullptr);
-    if( dbm.IsOpen() )
+    if( dbm && dbm->IsOpen() )
     {
-        if( dbm.Close() != tkrzw::Status::SUCCESS)
+        if( dbm_registry::Release(&dbm) != tkrzw::Status::SUCCESS)
         {
             std::cerr << "DBM finalize: Failed!" << std::endl;
         }
@@ -1,4 +1,5 @@
 #include "../include/polyIndex_wrapper.hpp"
+#include "../include/utils/addon_data.hpp"
 
 polyIndex_wrapper::polyIndex_wrapper(const Napi::CallbackInfo& info) : Napi::ObjectWrap<polyIndex_wrapper>(info)
 {
@@ -6,12 +7,81 @@ polyIndex_wrapper::polyIndex_wrapper(const Napi::CallbackInfo& info) : Napi::Obj
     
     std::map<std::string, std::string> optional_tuning_params = parseConfig(env, info[0]);
     std::string indexPath = info[1].As<Napi::String>();         //The operator std::string() is implicitly invoked
+    durability_config durability_conf;
+    std::string config_error;
+    if( !durability_config::Extract(optional_tuning_params, &durability_conf, &config_error) )
+    {
+        Napi::TypeError::New(env, config_error).ThrowAsJavaScriptException();
+        return;
+    }
+
+    if( info.Length() > 2 && info[2].IsExternal() )
+    {
+        index = std::move(*info[2].As<Napi::External<std::unique_ptr<tkrzw::PolyIndex>>>().Data());
+    }
+    else
+    {
+        tkrzw::Status opening_status = index->Open(indexPath, true, durability_conf.GetOpenOptions(), optional_tuning_params);
+        if( opening_status != tkrzw::Status::SUCCESS)
+        {
+            Napi::TypeError::New(env, opening_status.GetMessage().c_str()).ThrowAsJavaScriptException();
+            return;
+        }
+    }
+    if( durability_conf.mode == durability_config::DURABILITY_PERIODIC || durability_conf.mode == durability_config::DURABILITY_GROUP )
+    {
+        durability = std::make_shared<durability_manager>(env, [synced = index.get()](bool hard) { return synced->Synchronize(hard); }, durability_conf);
+    }
+}
 
-    tkrzw::Status opening_status = index.Open(indexPath, true, tkrzw::File::OPEN_DEFAULT | tkrzw::File::OPEN_SYNC_HARD, optional_tuning_params).OrDie();
-    if( opening_status != tkrzw::Status::SUCCESS)
+// polyIndex.open(config, path, {onProgress, progressIntervalMs, prefetch}): like polyDBM.open(), opens and
+// recovers the index on a native thread; resolves to the instance
+Napi::Value polyIndex_wrapper::open(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if( info.Length() < 2 || !(info[0].IsObject() || info[0].IsString()) || !info[1].IsString() )
+    {
+        Napi::TypeError::New(env, "Invalid arguments for open").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string indexPath = info[1].As<Napi::String>();
+    open_task::options opts;
+    Napi::Function on_progress;
+    if( info.Length() > 2 && info[2].IsObject() )
+    {
+        Napi::Object js_opts = info[2].As<Napi::Object>();
+        opts.prefetch = js_opts.Get("prefetch").ToBoolean();
+        if( js_opts.Get("progressIntervalMs").IsNumber() )
+        {
+            opts.progress_interval = std::max(0.01, js_opts.Get("progressIntervalMs").As<Napi::Number>().DoubleValue() / 1000.0);
+        }
+        if( js_opts.Get("onProgress").IsFunction() )
+        {
+            on_progress = js_opts.Get("onProgress").As<Napi::Function>();
+        }
+    }
+    std::map<std::string, std::string> optional_tuning_params = parseConfig(env, info[0]);
+    durability_config durability_conf;
+    std::string config_error;
+    if( !durability_config::Extract(optional_tuning_params, &durability_conf, &config_error) )
     {
-        Napi::TypeError::New(env, opening_status.GetMessage().c_str()).ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, config_error).ThrowAsJavaScriptException();
+        return env.Undefined();
     }
+    Napi::Function constructor = env.GetInstanceData<addon_data>()->polyIndex_constructor.Value();
+    return open_task::StartIndex(env, constructor, info[0], indexPath, std::move(optional_tuning_params),
+                                 durability_conf.GetOpenOptions(), opts, on_progress);
+}
+
+// Queues a worker and returns its Promise; writes are routed through the durability manager if any
+Napi::Value polyIndex_wrapper::queueWorker(dbmAsyncWorker* asyncWorker)
+{
+    asyncWorker->durability = durability;
+    asyncWorker->stats = stats;
+    asyncWorker->queued_at = std::chrono::steady_clock::now();
+    stats->Begin();
+    asyncWorker->Queue();
+    return asyncWorker->deferred_promise.Promise();
 }
 
 Napi::Value polyIndex_wrapper::add(const Napi::CallbackInfo& info)
@@ -25,9 +95,8 @@ Napi::Value polyIndex_wrapper::add(const Napi::CallbackInfo& info)
     std::string key = info[0].As<Napi::String>().ToString().Utf8Value();
     std::string value = info[1].As<Napi::String>().ToString().Utf8Value();
 
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_ADD, key, value);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_ADD, key, value);
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::getValues(const Napi::CallbackInfo& info)
@@ -36,9 +105,8 @@ Napi::Value polyIndex_wrapper::getValues(const Napi::CallbackInfo& info)
     std::string key = info[0].As<Napi::String>().ToString().Utf8Value();
     size_t max_number_of_records = info[1].As<Napi::Number>().Int64Value();
 
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_GET_VALUES, key, max_number_of_records);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_GET_VALUES, key, max_number_of_records);
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::check(const Napi::CallbackInfo& info)
@@ -47,9 +115,8 @@ Napi::Value polyIndex_wrapper::check(const Napi::CallbackInfo& info)
     std::string key = info[0].As<Napi::String>().ToString().Utf8Value();
     std::string value = info[1].As<Napi::String>().ToString().Utf8Value();
 
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_CHECK, key, value);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_CHECK, key, value);
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::remove(const Napi::CallbackInfo& info)
@@ -58,25 +125,22 @@ Napi::Value polyIndex_wrapper::remove(const Napi::CallbackInfo& info)
     std::string key = info[0].As<Napi::String>().ToString().Utf8Value();
     std::string value = info[1].As<Napi::String>().ToString().Utf8Value();
 
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_REMOVE, key, value);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_REMOVE, key, value);
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::shouldBeRebuilt(const Napi::CallbackInfo& info)
 {
     Napi::Env env = info.Env();
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_SHOULD_BE_REBUILT);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_SHOULD_BE_REBUILT);
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::rebuild(const Napi::CallbackInfo& info)
 {
     Napi::Env env = info.Env();
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_REBUILD);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_REBUILD);
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::sync(const Napi::CallbackInfo& info)
@@ -84,9 +148,8 @@ Napi::Value polyIndex_wrapper::sync(const Napi::CallbackInfo& info)
     Napi::Env env = info.Env();
     bool sync_hard = info[0].As<Napi::Boolean>();
 
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_SYNC, sync_hard);
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_SYNC, sync_hard);
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::makeJumpIterator(const Napi::CallbackInfo& info)
@@ -116,30 +179,27 @@ Napi::Value polyIndex_wrapper::makeJumpIterator(const Napi::CallbackInfo& info)
      * 2. https://dbmx.net/tkrzw/#index_overview
      */
     Napi::Env env = info.Env();
-    jump_iter = index.MakeIterator();
+    jump_iter = index->MakeIterator();
     std::string partialKey = info[0].As<Napi::String>();
 
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_MAKE_JUMP_ITERATOR, partialKey, jump_iter.get());
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_MAKE_JUMP_ITERATOR, partialKey, jump_iter.get());
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::getIteratorValue(const Napi::CallbackInfo& info)
 {
     Napi::Env env = info.Env();
 
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_GET_ITERATOR_VALUE, jump_iter.get());
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_GET_ITERATOR_VALUE, jump_iter.get());
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::continueIteration(const Napi::CallbackInfo& info)
 {
     Napi::Env env = info.Env();
 
-    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, index, dbmAsyncWorker::INDEX_CONTINUE_ITERATION, jump_iter.get());
-    asyncWorker->Queue();
-    return asyncWorker->deferred_promise.Promise();
+    dbmAsyncWorker* asyncWorker = new dbmAsyncWorker(env, *index, dbmAsyncWorker::INDEX_CONTINUE_ITERATION, jump_iter.get());
+    return queueWorker(asyncWorker);
 }
 
 Napi::Value polyIndex_wrapper::freeIterator(const Napi::CallbackInfo& info)
@@ -149,11 +209,19 @@ Napi::Value polyIndex_wrapper::freeIterator(const Napi::CallbackInfo& info)
     return Napi::Boolean::New(env, true);
 }
 
+Napi::Value polyIndex_wrapper::getStats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    bool reset = info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+    return stats->ToObject(env, dbmAsyncWorker::OperationName, reset);
+}
+
 Napi::Value polyIndex_wrapper::close(const Napi::CallbackInfo& info)
 {
     std::cout << "CLOSE INDEX" << std::endl;
     Napi::Env env = info.Env();
-    tkrzw::Status close_status = index.Close();
+    if( durability ) { durability->Stop(); }         //Final sync; parked write Promises resolve
+    tkrzw::Status close_status = index->Close();
     if( close_status != tkrzw::Status::SUCCESS)
     {
         Napi::TypeError::New(env, close_status.GetMessage().c_str()).ThrowAsJavaScriptException();
@@ -171,6 +239,7 @@ Napi::Object polyIndex_wrapper::Init(Napi::Env env, Napi::Object exports)
     // This method is used to hook the accessor and method callbacks
     Napi::Function functionList = DefineClass(env, "polyIndex",
     {
+        StaticMethod<&polyIndex_wrapper::open>("open", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyIndex_wrapper::add>("add", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyIndex_wrapper::getValues>("getValues", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyIndex_wrapper::check>("check", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
@@ -182,14 +251,12 @@ Napi::Object polyIndex_wrapper::Init(Napi::Env env, Napi::Object exports)
         InstanceMethod<&polyIndex_wrapper::getIteratorValue>("getIteratorValue", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyIndex_wrapper::continueIteration>("continueIteration", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyIndex_wrapper::freeIterator>("freeIterator", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&polyIndex_wrapper::getStats>("stats", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
         InstanceMethod<&polyIndex_wrapper::close>("close", static_cast<napi_property_attributes>(napi_writable | napi_configurable))
     });
 
-    Napi::FunctionReference* constructor = new Napi::FunctionReference();
-
-    *constructor = Napi::Persistent(functionList);
+    env.GetInstanceData<addon_data>()->polyIndex_constructor = Napi::Persistent(functionList);
     exports.Set("polyIndex", functionList);
-    env.SetInstanceData<Napi::FunctionReference>(constructor);
 
     return exports;
 }
@@ -197,9 +264,10 @@ Napi::Object polyIndex_wrapper::Init(Napi::Env env, Napi::Object exports)
 void polyIndex_wrapper::Finalize(Napi::Env env)
 {
     jump_iter.reset(nullptr);       //Same as `reset()` with no argument. Calls deleter of the current internal pointer if not `nullptr` already.
-    if( index.IsOpen() )
+    if( durability ) { durability->Stop(); }
+    if( index->IsOpen() )
     {
-        if( index.Close() != tkrzw::Status::SUCCESS)
+        if( index->Close() != tkrzw::Status::SUCCESS)
         {
             std::cerr << "Index finalize: Failed!" << std::endl;
         }
@@ -1,10 +1,18 @@
 #include "../include/polyDBM_wrapper.hpp"
 #include "../include/polyIndex_wrapper.hpp"
+#include "../include/changeFeed_wrapper.hpp"
+#include "../include/polyDBMClient_wrapper.hpp"
+#include "../include/writeBatch_wrapper.hpp"
+#include "../include/utils/addon_data.hpp"
 
 Napi::Object InitAll (Napi::Env env, Napi::Object exports)
 {
+    env.SetInstanceData<addon_data>(new addon_data());     //Freed by N-API when the environment shuts down
     polyDBM_wrapper::Init(env, exports);
     polyIndex_wrapper::Init(env, exports);
+    changeFeed_wrapper::Init(env, exports);
+    polyDBMClient_wrapper::Init(env, exports);
+    writeBatch_wrapper::Init(env, exports);
     return exports;
 }
 
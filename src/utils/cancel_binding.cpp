@@ -0,0 +1,57 @@
+#include "../../include/utils/cancel_binding.hpp"
+
+bool cancel_binding::IsOptions(Napi::Value value)
+{
+    if (!value.IsObject() || value.IsArray() || value.IsFunction()) {
+        return false;
+    }
+    Napi::Object obj = value.As<Napi::Object>();
+    return obj.Has("signal") || obj.Has("deadlineMs");
+}
+
+std::shared_ptr<cancel_token> cancel_binding::FromOptions(Napi::Env env, Napi::Value options, cancel_binding* binding)
+{
+    if (!options.IsObject()) {
+        return nullptr;
+    }
+    Napi::Object obj = options.As<Napi::Object>();
+    Napi::Value js_signal = obj.Get("signal");
+    Napi::Value js_deadline = obj.Get("deadlineMs");
+    const bool has_signal = js_signal.IsObject();
+    if (!has_signal && !js_deadline.IsNumber()) {
+        return nullptr;
+    }
+    auto token = std::make_shared<cancel_token>(js_deadline.IsNumber() ? js_deadline.As<Napi::Number>().DoubleValue() : -1.0);
+    if (has_signal)
+    {
+        Napi::Object signal = js_signal.As<Napi::Object>();
+        if (signal.Get("aborted").ToBoolean()) {
+            token->Abort();
+            return token;
+        }
+        Napi::Value add = signal.Get("addEventListener");
+        if (add.IsFunction())
+        {
+            //The listener keeps the token alive, not the other way around: it may fire after the operation is gone
+            Napi::Function listener = Napi::Function::New(env, [token](const Napi::CallbackInfo&) { token->Abort(); });
+            add.As<Napi::Function>().Call(signal, {Napi::String::New(env, "abort"), listener});
+            binding->signal = Napi::Persistent(signal);
+            binding->listener = Napi::Persistent(listener);
+        }
+    }
+    return token;
+}
+
+void cancel_binding::Detach()
+{
+    if (signal.IsEmpty()) {
+        return;
+    }
+    Napi::Env env = signal.Env();
+    Napi::Value remove = signal.Value().Get("removeEventListener");
+    if (remove.IsFunction()) {
+        remove.As<Napi::Function>().Call(signal.Value(), {Napi::String::New(env, "abort"), listener.Value()});
+    }
+    signal.Reset();
+    listener.Reset();
+}
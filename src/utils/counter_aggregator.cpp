@@ -0,0 +1,373 @@
+#include "../../include/utils/counter_aggregator.hpp"
+#include <chrono>
+#include <vector>
+#include <tkrzw_hash_util.h>
+#include <tkrzw_str_util.h>
+
+namespace
+{
+    // Read-only: the stored value, or `initial` if there is none, plus the delta `pending()` returns
+    class read_processor : public tkrzw::DBM::RecordProcessor
+    {
+        public:
+            read_processor(int64_t initial, std::function<int64_t()> pending)
+                : initial(initial), pending(std::move(pending)) {}
+
+            std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+                found = true;
+                delta = pending();
+                current = tkrzw::StrToIntBigEndian(value) + delta;
+                if (delta == 0) {
+                    stored = std::string(value);
+                }
+                return NOOP;
+            }
+
+            std::string_view ProcessEmpty(std::string_view key) override {
+                delta = pending();
+                current = initial + delta;
+                return NOOP;
+            }
+
+            bool found = false;
+            int64_t delta = 0;
+            int64_t current = 0;
+            std::string stored;     // The value as is, when there is no delta to apply
+
+        private:
+            int64_t initial;
+            std::function<int64_t()> pending;
+    };
+
+    // Writable: takes the delta of a counter and adds it to the stored value
+    class flush_processor : public tkrzw::DBM::RecordProcessor
+    {
+        public:
+            flush_processor(std::atomic<int64_t>* delta, int64_t initial) : delta(delta), initial(initial) {}
+
+            std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+                return Apply(tkrzw::StrToIntBigEndian(value));
+            }
+
+            std::string_view ProcessEmpty(std::string_view key) override {
+                return Apply(initial);
+            }
+
+            int64_t taken = 0;
+
+        private:
+            std::string_view Apply(int64_t base) {
+                taken = delta->exchange(0);
+                if (taken == 0) {
+                    return NOOP;
+                }
+                value = tkrzw::IntToStrBigEndian(base + taken);
+                return value;
+            }
+
+            std::atomic<int64_t>* delta;
+            int64_t initial;
+            std::string value;
+    };
+
+    // Writable: drops the delta of a counter and writes `value` (or REMOVE) instead
+    class replace_processor : public tkrzw::DBM::RecordProcessor
+    {
+        public:
+            replace_processor(std::atomic<int64_t>* delta, std::string_view value) : delta(delta), value(value) {}
+
+            std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+                found = true;
+                return Apply();
+            }
+
+            std::string_view ProcessEmpty(std::string_view key) override {
+                return Apply();
+            }
+
+            bool found = false;
+            int64_t dropped = 0;
+
+        private:
+            std::string_view Apply() {
+                dropped = delta->exchange(0);
+                return value;
+            }
+
+            std::atomic<int64_t>* delta;
+            std::string_view value;
+    };
+}
+
+bool counter_config::Extract(std::map<std::string, std::string>& params, counter_config* config, std::string* error)
+{
+    auto it = params.find("counters");
+    if (it != params.end())
+    {
+        if (it->second == "direct") config->write_behind = false;
+        else if (it->second == "write_behind") config->write_behind = true;
+        else {
+            *error = "unknown counters mode: " + it->second + " (expected direct or write_behind)";
+            return false;
+        }
+        params.erase(it);
+    }
+    it = params.find("counter_flush_interval_ms");
+    if (it != params.end())
+    {
+        config->interval = tkrzw::StrToDouble(it->second, 0) / 1000.0;
+        params.erase(it);
+        if (config->interval <= 0) {
+            *error = "counter_flush_interval_ms must be positive";
+            return false;
+        }
+    }
+    it = params.find("counter_flush_threshold");
+    if (it != params.end())
+    {
+        config->threshold = tkrzw::StrToInt(it->second, -1);
+        params.erase(it);
+        if (config->threshold < 0) {
+            *error = "counter_flush_threshold must not be negative";
+            return false;
+        }
+    }
+    return true;
+}
+
+counter_aggregator::counter_aggregator(tkrzw::DBM* dbm, const counter_config& config, std::function<void()> on_flushed)
+    : dbm(dbm), config(config), on_flushed(std::move(on_flushed))
+{
+    thread = std::thread(&counter_aggregator::Run, this);
+}
+
+counter_aggregator::~counter_aggregator()
+{
+    Stop();
+}
+
+counter_aggregator::shard& counter_aggregator::ShardOf(std::string_view key)
+{
+    return shards[tkrzw::HashMurmur(key, 19780211) % NUM_SHARDS];
+}
+
+tkrzw::Status counter_aggregator::Increment(std::string_view key, int64_t delta, int64_t* current, int64_t initial)
+{
+    if (stopped.load()) {
+        return dbm->Increment(key, delta, current, initial);
+    }
+    if (delta == INT64_MIN) {
+        //Reads without incrementing or creating the record
+        *current = tkrzw::StrToIntBigEndian(GetSimple(key, tkrzw::IntToStrBigEndian(initial)));
+        return tkrzw::Status(tkrzw::Status::SUCCESS);
+    }
+    shard& s = ShardOf(key);
+    std::shared_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.counters.find(std::string(key));
+    while (it == s.counters.end())
+    {
+        lock.unlock();
+        {
+            std::unique_lock<std::shared_mutex> adding(s.mutex);
+            s.counters.try_emplace(std::string(key), std::make_shared<counter>());
+        }
+        lock.lock();
+        it = s.counters.find(std::string(key));
+    }
+    counter* c = it->second.get();
+    c->initial.store(initial);
+    c->touched.store(true);
+    //The delta is added under the record's read lock, so each caller gets its own value, like DBM::Increment()
+    read_processor reader(initial, [&] { return c->delta.fetch_add(delta) + delta; });
+    tkrzw::Status status = dbm->Process(key, &reader, false);
+    lock.unlock();
+    if (status != tkrzw::Status::SUCCESS) {
+        return status;
+    }
+    *current = reader.current;
+    if (config.threshold > 0 && unflushed.fetch_add(1) + 1 == config.threshold)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        flush_requested = true;
+        cond.notify_one();
+    }
+    return status;
+}
+
+std::string counter_aggregator::GetSimple(std::string_view key, std::string_view default_value)
+{
+    shard& s = ShardOf(key);
+    std::shared_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.counters.find(std::string(key));
+    if (it == s.counters.end()) {
+        lock.unlock();
+        return dbm->GetSimple(key, default_value);
+    }
+    counter* c = it->second.get();
+    read_processor reader(c->initial.load(), [c] { return c->delta.load(); });
+    if (dbm->Process(key, &reader, false) != tkrzw::Status::SUCCESS) {
+        return std::string(default_value);
+    }
+    if (reader.delta != 0) {
+        return tkrzw::IntToStrBigEndian(reader.current);
+    }
+    return reader.found ? reader.stored : std::string(default_value);
+}
+
+tkrzw::Status counter_aggregator::Set(std::string_view key, std::string_view value)
+{
+    return Replace(key, value);
+}
+
+tkrzw::Status counter_aggregator::Remove(std::string_view key)
+{
+    return Replace(key, tkrzw::DBM::RecordProcessor::REMOVE);
+}
+
+tkrzw::Status counter_aggregator::Replace(std::string_view key, std::string_view value)
+{
+    const bool removing = value.data() == tkrzw::DBM::RecordProcessor::REMOVE.data();
+    shard& s = ShardOf(key);
+    //Held like Increment() does, so no increment can add the key until the write is done
+    std::shared_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.counters.find(std::string(key));
+    if (it == s.counters.end()) {
+        return removing ? dbm->Remove(key) : dbm->Set(key, value);
+    }
+    replace_processor writer(&it->second->delta, value);
+    tkrzw::Status status = dbm->Process(key, &writer, true);
+    if (status == tkrzw::Status::SUCCESS && removing && !writer.found && writer.dropped == 0) {
+        return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+    }
+    return status;
+}
+
+tkrzw::Status counter_aggregator::FlushKeys(const std::vector<std::string_view>& keys)
+{
+    tkrzw::Status result(tkrzw::Status::SUCCESS);
+    for (const auto& key : keys)
+    {
+        std::shared_ptr<counter> c;
+        {
+            shard& s = ShardOf(key);
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            auto it = s.counters.find(std::string(key));
+            if (it == s.counters.end()) {
+                continue;
+            }
+            c = it->second;
+        }
+        if (c->delta.load() == 0) {
+            continue;
+        }
+        flush_processor writer(&c->delta, c->initial.load());
+        tkrzw::Status status = dbm->Process(key, &writer, true);
+        if (status != tkrzw::Status::SUCCESS) {
+            c->delta.fetch_add(writer.taken);
+            failed.fetch_add(1);
+            result = status;
+        } else if (writer.taken != 0 && on_flushed) {
+            on_flushed();
+        }
+    }
+    return result;
+}
+
+tkrzw::Status counter_aggregator::Flush()
+{
+    std::lock_guard<std::mutex> flushing(flush_mutex);
+    unflushed.store(0);
+    tkrzw::Status result(tkrzw::Status::SUCCESS);
+    bool wrote = false;
+    std::vector<std::pair<std::string, std::shared_ptr<counter>>> work;
+    for (shard& s : shards)
+    {
+        work.clear();
+        {
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            for (const auto& [key, c] : s.counters) {
+                if (c->delta.load() != 0) {
+                    work.emplace_back(key, c);
+                }
+            }
+        }
+        //No shard lock while writing: increments of the same keys go on, into the next flush
+        for (const auto& [key, c] : work)
+        {
+            flush_processor writer(&c->delta, c->initial.load());
+            tkrzw::Status status = dbm->Process(key, &writer, true);
+            if (status != tkrzw::Status::SUCCESS) {
+                c->delta.fetch_add(writer.taken);       //Retried by the next flush
+                failed.fetch_add(1);
+                result = status;
+            } else if (writer.taken != 0) {
+                wrote = true;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        for (auto it = s.counters.begin(); it != s.counters.end(); ) {
+            if (it->second->delta.load() == 0 && !it->second->touched.exchange(false)) {
+                it = s.counters.erase(it);      //Idle for a whole interval
+            } else {
+                ++it;
+            }
+        }
+    }
+    flushes.fetch_add(1);
+    if (wrote && on_flushed) {
+        on_flushed();
+    }
+    return result;
+}
+
+tkrzw::Status counter_aggregator::Clear()
+{
+    std::lock_guard<std::mutex> flushing(flush_mutex);
+    for (shard& s : shards)
+    {
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        s.counters.clear();
+    }
+    unflushed.store(0);
+    return dbm->Clear();
+}
+
+void counter_aggregator::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    cond.notify_one();
+    thread.join();
+    Flush();
+    stopped.store(true);
+}
+
+size_t counter_aggregator::Keys()
+{
+    size_t keys = 0;
+    for (shard& s : shards)
+    {
+        std::shared_lock<std::shared_mutex> lock(s.mutex);
+        keys += s.counters.size();
+    }
+    return keys;
+}
+
+void counter_aggregator::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        cond.wait_for(lock, std::chrono::duration<double>(config.interval), [this] { return flush_requested || stopping; });
+        if (stopping) {
+            break;          //Stop() runs the last flush
+        }
+        flush_requested = false;
+        lock.unlock();
+        Flush();
+        lock.lock();
+    }
+}
@@ -0,0 +1,110 @@
+#include "../../include/utils/dbm_registry.hpp"
+#include "../../include/utils/shard_dbm.hpp"
+#include <filesystem>
+
+std::mutex dbm_registry::mutex;
+std::condition_variable dbm_registry::settled;
+std::map<std::string, dbm_registry::entry> dbm_registry::entries;
+
+// "db/x.tkh", "./db/x.tkh" and "/abs/db/x.tkh" must name the same entry; the file may not exist yet
+std::string dbm_registry::MakeKey(const std::string& path)
+{
+    std::error_code ec;
+    std::filesystem::path key = std::filesystem::weakly_canonical(std::filesystem::absolute(path, ec), ec);
+    return ec ? path : key.string();
+}
+
+tkrzw::Status dbm_registry::Acquire(const std::string& path, bool sharded,
+                                    const std::function<std::shared_ptr<tkrzw::ParamDBM>()>& make,
+                                    const std::function<tkrzw::Status(tkrzw::ParamDBM*)>& open,
+                                    std::shared_ptr<tkrzw::ParamDBM>* handle, bool* attached)
+{
+    if (attached != nullptr) {
+        *attached = false;
+    }
+    if (path.empty()) {
+        std::shared_ptr<tkrzw::ParamDBM> dbm = make();
+        tkrzw::Status status = open(dbm.get());
+        *handle = dbm;
+        return status;
+    }
+
+    std::string key = MakeKey(path);
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    //A second opener must not race the first on the same files, nor reopen them before they are closed
+    while (it != entries.end() && it->second.state != entry::OPEN) {
+        settled.wait(lock);
+        it = entries.find(key);
+    }
+    if (it != entries.end()) {
+        if (it->second.sharded != sharded) {
+            return tkrzw::Status(tkrzw::Status::PRECONDITION_ERROR,
+                                 sharded ? "already open as a polyDBM" : "already open as a polyShardDBM");
+        }
+        it->second.users++;
+        *handle = it->second.dbm;
+        if (attached != nullptr) {
+            *attached = true;
+        }
+        return tkrzw::Status(tkrzw::Status::SUCCESS);
+    }
+    it = entries.emplace(key, entry{nullptr, sharded, 0, entry::OPENING}).first;
+    lock.unlock();
+
+    std::shared_ptr<tkrzw::ParamDBM> dbm = make();
+    tkrzw::Status status = open(dbm.get());
+    *handle = dbm;
+
+    lock.lock();
+    if (status == tkrzw::Status::SUCCESS) {
+        it->second.dbm = dbm;
+        it->second.users = 1;
+        it->second.state = entry::OPEN;
+    } else {
+        entries.erase(it);
+    }
+    lock.unlock();
+    settled.notify_all();
+    return status;
+}
+
+tkrzw::Status dbm_registry::Release(std::shared_ptr<tkrzw::ParamDBM>* handle)
+{
+    std::shared_ptr<tkrzw::ParamDBM> dbm = *handle;
+    bool sharded = dynamic_cast<shard_dbm*>(dbm.get()) != nullptr;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.begin();
+    while (it != entries.end() && (it->second.state != entry::OPEN || it->second.dbm != dbm)) {
+        ++it;
+    }
+    if (it == entries.end()) {
+        lock.unlock();
+        return dbm->Close();        //Not shared (in-memory, or already released)
+    }
+    if (--it->second.users > 0) {
+        //Still used elsewhere: detach this caller only
+        if (sharded) {
+            *handle = std::make_shared<shard_dbm>();
+        } else {
+            *handle = std::make_shared<tkrzw::PolyDBM>();
+        }
+        return tkrzw::Status(tkrzw::Status::SUCCESS);
+    }
+    //The entry stays, as closing, so a concurrent Acquire of the path reopens only after this
+    it->second.state = entry::CLOSING;
+    lock.unlock();
+    tkrzw::Status status = dbm->Close();
+    lock.lock();
+    entries.erase(it);
+    lock.unlock();
+    settled.notify_all();
+    return status;
+}
+
+size_t dbm_registry::CountUsers(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(MakeKey(path));
+    return it == entries.end() || it->second.state != entry::OPEN ? 0 : it->second.users;
+}
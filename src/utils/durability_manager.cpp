@@ -0,0 +1,165 @@
+#include "../../include/utils/durability_manager.hpp"
+#include <chrono>
+#include <tkrzw_file.h>
+#include <tkrzw_str_util.h>
+
+bool durability_config::Extract(std::map<std::string, std::string>& params, durability_config* config, std::string* error)
+{
+    auto it = params.find("durability");
+    if (it != params.end())
+    {
+        if (it->second == "close") config->mode = DURABILITY_CLOSE;
+        else if (it->second == "none") config->mode = DURABILITY_NONE;
+        else if (it->second == "periodic") config->mode = DURABILITY_PERIODIC;
+        else if (it->second == "group") config->mode = DURABILITY_GROUP;
+        else {
+            *error = "unknown durability mode: " + it->second + " (expected close, none, periodic or group)";
+            return false;
+        }
+        params.erase(it);
+    }
+    it = params.find("durability_interval_ms");
+    if (it != params.end())
+    {
+        config->interval = tkrzw::StrToDouble(it->second, 0) / 1000.0;
+        params.erase(it);
+        if (config->interval <= 0) {
+            *error = "durability_interval_ms must be positive";
+            return false;
+        }
+    }
+    it = params.find("group_commit_window_ms");
+    if (it != params.end())
+    {
+        config->group_window = tkrzw::StrToDouble(it->second, -1) / 1000.0;
+        params.erase(it);
+        if (config->group_window < 0) {
+            *error = "group_commit_window_ms must not be negative";
+            return false;
+        }
+    }
+    return true;
+}
+
+int32_t durability_config::GetOpenOptions() const
+{
+    //In the other modes the physical sync is done by durability_manager (or never)
+    return mode == DURABILITY_CLOSE ? tkrzw::File::OPEN_DEFAULT | tkrzw::File::OPEN_SYNC_HARD : tkrzw::File::OPEN_DEFAULT;
+}
+
+// Runs on the main thread once a group sync has finished
+void ResolveDurable(Napi::Env env, Napi::Function jsCallback, durability_waiters* waiters, durability_synced* synced)
+{
+    if (env != nullptr)
+    {
+        while (!waiters->pending.empty() && waiters->pending.front().ticket <= synced->ticket)
+        {
+            durability_waiter& waiter = waiters->pending.front();
+            if (synced->status == tkrzw::Status::SUCCESS) {
+                waiter.deferred.Resolve(waiter.result.Value());
+            } else {
+                waiter.deferred.Reject(Napi::Error::New(env, "Group commit sync failed: " + tkrzw::ToString(synced->status)).Value());
+            }
+            waiters->pending.pop_front();
+        }
+        if (waiters->pending.empty()) {
+            waiters->tsfn.Unref(env);
+        }
+    }
+    delete synced;
+}
+
+durability_manager::durability_manager(Napi::Env env, std::function<tkrzw::Status(bool)> sync, const durability_config& config)
+    : sync(std::move(sync)), config(config), waiters(new durability_waiters())
+{
+    waiters->tsfn = DURABILITY_TSFN::New(env, "durability_manager tsfn", 0, 1, waiters,
+                                         [](Napi::Env, void*, durability_waiters* context) { delete context; });
+    waiters->tsfn.Unref(env);
+    thread = std::thread(&durability_manager::Run, this);
+}
+
+durability_manager::~durability_manager()
+{
+    Stop();
+}
+
+void durability_manager::OnWrite(Napi::Env env, Napi::Promise::Deferred deferred, Napi::Value result)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (stopped || config.mode != durability_config::DURABILITY_GROUP)
+    {
+        dirty = true;
+        lock.unlock();
+        deferred.Resolve(result);
+        return;
+    }
+    if (waiters->pending.empty()) {
+        waiters->tsfn.Ref(env);
+    }
+    waiters->pending.push_back(durability_waiter{next_ticket, deferred, Napi::Persistent(result)});
+    has_waiters = true;
+    lock.unlock();
+    cond.notify_one();
+}
+
+void durability_manager::NoteWrite()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    dirty = true;
+}
+
+void durability_manager::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped) return;
+        stopping = true;
+    }
+    cond.notify_one();
+    thread.join();      //The thread syncs whatever is still pending before it exits
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+    waiters->tsfn.Release();
+}
+
+void durability_manager::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        if (config.mode == durability_config::DURABILITY_GROUP)
+        {
+            cond.wait(lock, [this] { return has_waiters || stopping; });
+            if (has_waiters && !stopping && config.group_window > 0) {
+                //Let more writers join the group
+                cond.wait_for(lock, std::chrono::duration<double>(config.group_window), [this] { return stopping; });
+            }
+        }
+        else
+        {
+            cond.wait_for(lock, std::chrono::duration<double>(config.interval), [this] { return stopping; });
+        }
+
+        const bool need_sync = has_waiters || dirty;
+        const uint64_t ticket = next_ticket++;
+        const bool covers_waiters = has_waiters;
+        has_waiters = false;
+        dirty = false;
+        const bool exiting = stopping;
+
+        if (need_sync)
+        {
+            lock.unlock();
+            tkrzw::Status s = sync(true);
+            sync_count.fetch_add(1);
+            if (covers_waiters) {
+                auto* synced = new durability_synced{ticket, s};
+                if (waiters->tsfn.BlockingCall(synced) != napi_ok) {
+                    delete synced;      //The environment is shutting down
+                }
+            }
+            lock.lock();
+        }
+        if (exiting) break;
+    }
+}
@@ -0,0 +1,150 @@
+#include "../../include/utils/hot_keys.hpp"
+#include <algorithm>
+#include <chrono>
+#include <tkrzw_hash_util.h>
+
+namespace
+{
+    int64_t now_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+heavy_hitters::heavy_hitters(size_t k, size_t width, size_t depth)
+    : k(std::max<size_t>(k, 1)), width(std::max<size_t>(width, 16)), depth(std::max<size_t>(depth, 1)),
+      counters(new std::atomic<uint64_t>[this->width * this->depth]()),
+      member_hashes(new std::atomic<uint64_t>[this->k]())
+{
+    candidates.reserve(this->k);
+}
+
+// Row d uses the counter at h1 + d * h2 (Kirsch-Mitzenmacher double hashing)
+uint64_t heavy_hitters::Estimate(uint64_t hash) const
+{
+    const uint64_t h1 = hash & 0xffffffff, h2 = (hash >> 32) | 1;
+    uint64_t estimate = UINT64_MAX;
+    for (size_t d = 0; d < depth; ++d) {
+        estimate = std::min(estimate, counters[d * width + (h1 + d * h2) % width].load(std::memory_order_relaxed));
+    }
+    return estimate;
+}
+
+void heavy_hitters::Add(std::string_view key, uint64_t hash, uint64_t amount)
+{
+    hash |= 1;                  //0 marks a free candidate slot
+    const uint64_t h1 = hash & 0xffffffff, h2 = (hash >> 32) | 1;
+    uint64_t estimate = UINT64_MAX;
+    for (size_t d = 0; d < depth; ++d) {
+        auto& counter = counters[d * width + (h1 + d * h2) % width];
+        estimate = std::min(estimate, counter.fetch_add(amount, std::memory_order_relaxed) + amount);
+    }
+    if (estimate <= threshold.load(std::memory_order_relaxed)) {
+        return;
+    }
+    for (size_t i = 0; i < k; ++i) {
+        if (member_hashes[i].load(std::memory_order_relaxed) == hash) {
+            return;             //Already a candidate; its estimate is read from the sketch
+        }
+    }
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    for (const auto& candidate : candidates) {
+        if (candidate.second == hash) {
+            return;             //Added by another thread since the check above
+        }
+    }
+    size_t slot = candidates.size();
+    if (slot < k) {
+        candidates.emplace_back(std::string(key), hash);
+    } else {
+        //Evict the smallest candidate if the new key beats it
+        uint64_t smallest = UINT64_MAX;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const uint64_t candidate = Estimate(candidates[i].second);
+            if (candidate < smallest) {
+                smallest = candidate;
+                slot = i;
+            }
+        }
+        if (estimate <= smallest) {
+            threshold.store(smallest, std::memory_order_relaxed);
+            return;
+        }
+        candidates[slot] = {std::string(key), hash};
+    }
+    member_hashes[slot].store(hash, std::memory_order_relaxed);
+    if (candidates.size() == k) {
+        uint64_t smallest = UINT64_MAX;
+        for (const auto& candidate : candidates) {
+            smallest = std::min(smallest, Estimate(candidate.second));
+        }
+        threshold.store(smallest, std::memory_order_relaxed);
+    }
+}
+
+std::vector<heavy_hitters::entry> heavy_hitters::Top(size_t limit) const
+{
+    std::vector<entry> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [key, hash] : candidates) {
+            result.push_back({key, Estimate(hash)});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const entry& a, const entry& b) { return a.estimate > b.estimate; });
+    if (result.size() > limit) {
+        result.resize(limit);
+    }
+    return result;
+}
+
+void heavy_hitters::Reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < width * depth; ++i) {
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < k; ++i) {
+        member_hashes[i].store(0, std::memory_order_relaxed);
+    }
+    candidates.clear();
+    threshold.store(0, std::memory_order_relaxed);
+}
+
+size_t heavy_hitters::MemoryUsage() const
+{
+    size_t bytes = sizeof(*this) + (width * depth + k) * sizeof(std::atomic<uint64_t>);
+    std::lock_guard<std::mutex> lock(mutex);
+    bytes += candidates.capacity() * sizeof(candidates[0]);
+    for (const auto& candidate : candidates) {
+        bytes += candidate.first.capacity();
+    }
+    return bytes;
+}
+
+hot_key_tracker::hot_key_tracker(const options& opts)
+    : reads(opts.k, opts.width, opts.depth), writes(opts.k, opts.width, opts.depth),
+      bytes(opts.k, opts.width, opts.depth), since(now_ms())
+{
+}
+
+void hot_key_tracker::Record(std::string_view key, bool write, uint64_t num_bytes)
+{
+    const uint64_t hash = tkrzw::HashMurmur(key, 19780211);
+    (write ? writes : reads).Add(key, hash, 1);
+    if (num_bytes > 0) {
+        bytes.Add(key, hash, num_bytes);
+    }
+}
+
+void hot_key_tracker::Reset()
+{
+    reads.Reset();
+    writes.Reset();
+    bytes.Reset();
+    since.store(now_ms());
+}
@@ -0,0 +1,97 @@
+#include "../../include/utils/inflight_tracker.hpp"
+#include <tkrzw_str_util.h>
+
+bool admission_config::Extract(std::map<std::string, std::string>& params, admission_config* config, std::string* error)
+{
+    auto it = params.find("admission");
+    if (it != params.end())
+    {
+        if (it->second == "wait") config->policy = ADMISSION_WAIT;
+        else if (it->second == "reject") config->policy = ADMISSION_REJECT;
+        else if (it->second == "shed") config->policy = ADMISSION_SHED;
+        else {
+            *error = "unknown admission policy: " + it->second + " (expected wait, reject or shed)";
+            return false;
+        }
+        params.erase(it);
+    }
+    for (const auto& [key, limit] : {std::make_pair("max_inflight_ops", &config->max_ops),
+                                     std::make_pair("max_inflight_bytes", &config->max_bytes),
+                                     std::make_pair("noack_max_pending", &config->max_noack_pending)})
+    {
+        it = params.find(key);
+        if (it == params.end()) {
+            continue;
+        }
+        const int64_t value = tkrzw::StrToInt(it->second, -1);
+        params.erase(it);
+        if (value < 0) {
+            *error = std::string(key) + " must not be negative";
+            return false;
+        }
+        *limit = static_cast<uint64_t>(value);
+    }
+    return true;
+}
+
+inflight_tracker::inflight_tracker(const admission_config& config) : config(config)
+{
+}
+
+bool inflight_tracker::Fits(uint64_t bytes) const
+{
+    return in_flight == 0 ||
+           ((config.max_ops == 0 || in_flight < config.max_ops) &&
+            (config.max_bytes == 0 || in_flight_bytes + bytes <= config.max_bytes));
+}
+
+inflight_tracker::admission inflight_tracker::Admit(uint64_t bytes, bool low_priority, std::function<void()> on_admitted)
+{
+    if (draining) {
+        return CLOSED;
+    }
+    //Nothing overtakes a waiting operation
+    if (waiting.empty() && Fits(bytes)) {
+        in_flight++;
+        in_flight_bytes += bytes;
+        return ADMITTED;
+    }
+    if (config.policy == admission_config::ADMISSION_REJECT ||
+        (config.policy == admission_config::ADMISSION_SHED && low_priority)) {
+        rejected++;
+        shed += config.policy == admission_config::ADMISSION_SHED;
+        return OVERLOADED;
+    }
+    waiting.push_back({bytes, std::move(on_admitted)});
+    return WAITING;
+}
+
+void inflight_tracker::Settle(uint64_t bytes)
+{
+    in_flight--;
+    in_flight_bytes -= bytes;
+    while (!waiting.empty() && Fits(waiting.front().bytes))
+    {
+        waiter next = std::move(waiting.front());
+        waiting.pop_front();
+        in_flight++;
+        in_flight_bytes += next.bytes;
+        waited++;
+        next.on_admitted();
+    }
+    if (in_flight == 0 && on_drained) {
+        auto callback = std::move(on_drained);
+        on_drained = nullptr;
+        callback();
+    }
+}
+
+void inflight_tracker::Drain(std::function<void()> callback)
+{
+    draining = true;
+    if (in_flight == 0) {
+        callback();
+    } else {
+        on_drained = std::move(callback);
+    }
+}
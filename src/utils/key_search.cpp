@@ -0,0 +1,104 @@
+#include "../../include/utils/key_search.hpp"
+#include "../../include/utils/shard_dbm.hpp"
+#include <algorithm>
+#include <regex>
+
+// Scan of one DBM (a shard or a whole database); `re` is the compiled pattern of the "regex" mode
+static void search_shard(tkrzw::DBM* dbm, const std::string& mode, const std::string& pattern, const std::regex& re,
+                         size_t max, const cancel_token* cancel, std::vector<std::string>* result)
+{
+    std::vector<std::string>& keys = *result;
+    auto more = [&] { return keys.size() < max && (cancel == nullptr || !cancel->IsCancelled()); };
+    auto iter = dbm->MakeIterator();
+    bool is_ordered = dbm->IsOrdered();
+    tkrzw::Status s;
+
+    if (mode == "begin") {
+        if (is_ordered) {
+            s = iter->Jump(pattern);
+            if (s == tkrzw::Status::SUCCESS) {
+                while (more()) {
+                    std::string key;
+                    s = iter->Get(&key, nullptr);
+                    if (s != tkrzw::Status::SUCCESS) break;
+                    if (key.rfind(pattern, 0) != 0) break;
+                    keys.push_back(key);
+                    s = iter->Next();
+                }
+            }
+        } else {
+            s = iter->First();
+            while (more()) {
+                std::string key;
+                s = iter->Get(&key, nullptr);
+                if (s != tkrzw::Status::SUCCESS) break;
+                if (key.rfind(pattern, 0) == 0) {
+                    keys.push_back(key);
+                }
+                s = iter->Next();
+            }
+        }
+    } else if (mode == "contain") {
+        s = iter->First();
+        while (more()) {
+            std::string key;
+            s = iter->Get(&key, nullptr);
+            if (s != tkrzw::Status::SUCCESS) break;
+            if (key.find(pattern) != std::string::npos) {
+                keys.push_back(key);
+            }
+            s = iter->Next();
+        }
+    } else if (mode == "end") {
+        s = iter->First();
+        while (more()) {
+            std::string key;
+            s = iter->Get(&key, nullptr);
+            if (s != tkrzw::Status::SUCCESS) break;
+            if (key.length() >= pattern.length() &&
+                key.compare(key.length() - pattern.length(), pattern.length(), pattern) == 0) {
+                keys.push_back(key);
+            }
+            s = iter->Next();
+        }
+    } else if (mode == "regex") {
+        s = iter->First();
+        while (more()) {
+            std::string key;
+            s = iter->Get(&key, nullptr);
+            if (s != tkrzw::Status::SUCCESS) break;
+            if (std::regex_match(key, re)) {
+                keys.push_back(key);
+            }
+            s = iter->Next();
+        }
+    } // add other modes if needed
+}
+
+void search_keys(tkrzw::ParamDBM* dbm, const std::string& mode, const std::string& pattern, size_t max,
+                 std::vector<std::string>* keys, const cancel_token* cancel)
+{
+    std::regex re;
+    if (mode == "regex") {
+        re = std::regex(pattern);       //Compiled here, so a bad pattern throws on the calling thread
+    }
+
+    //One scan per shard, in parallel; each returns at most `max` keys, in key order if ordered
+    auto* sharded = dynamic_cast<shard_dbm*>(dbm);
+    std::vector<std::vector<std::string>> shard_keys(sharded != nullptr ? sharded->GetNumShards() : 1);
+    shard_dbm::ForEachShard(dbm, [&](tkrzw::DBM* shard, size_t index) {
+        search_shard(shard, mode, pattern, re, max, cancel, &shard_keys[index]);
+        return tkrzw::Status(tkrzw::Status::SUCCESS);
+    });
+    *keys = std::move(shard_keys[0]);
+    for (size_t i = 1; i < shard_keys.size(); i++) {
+        keys->insert(keys->end(), std::make_move_iterator(shard_keys[i].begin()), std::make_move_iterator(shard_keys[i].end()));
+    }
+    if (shard_keys.size() > 1 && dbm->IsOrdered()) {
+        tkrzw::KeyComparator comp = sharded->GetKeyComparator();
+        std::sort(keys->begin(), keys->end(), [comp](const std::string& a, const std::string& b) { return comp(a, b) < 0; });
+    }
+    if (keys->size() > max) {
+        keys->resize(max);
+    }
+}
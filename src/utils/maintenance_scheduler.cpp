@@ -0,0 +1,206 @@
+#include "../../include/utils/maintenance_scheduler.hpp"
+#include "../../include/utils/rebuild_task.hpp"
+#include "../../include/utils/shard_dbm.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+bool maintenance_scheduler::options::ParseWindow(const std::string& text, window* result)
+{
+    int begin_hour, begin_min, end_hour, end_min, consumed = 0;
+    if (std::sscanf(text.c_str(), "%d:%d-%d:%d%n", &begin_hour, &begin_min, &end_hour, &end_min, &consumed) != 4 ||
+        consumed != static_cast<int>(text.size())) {
+        return false;
+    }
+    if (begin_hour < 0 || begin_hour > 24 || end_hour < 0 || end_hour > 24 ||
+        begin_min < 0 || begin_min > 59 || end_min < 0 || end_min > 59) {
+        return false;
+    }
+    result->begin_minute = begin_hour * 60 + begin_min;
+    result->end_minute = end_hour * 60 + end_min;
+    return true;
+}
+
+maintenance_scheduler::maintenance_scheduler(std::shared_ptr<tkrzw::ParamDBM> dbm, const options& opts)
+    : dbm(std::move(dbm)), opts(opts)
+{}
+
+maintenance_scheduler::~maintenance_scheduler()
+{
+    Stop();
+}
+
+void maintenance_scheduler::Start()
+{
+    current.running = true;
+    thread = std::thread(&maintenance_scheduler::Run, this);
+}
+
+void maintenance_scheduler::RequestStop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        if (rebuilding != nullptr) {
+            rebuilding->Cancel();
+        }
+    }
+    cond.notify_all();
+}
+
+void maintenance_scheduler::Stop()
+{
+    RequestStop();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool maintenance_scheduler::IsRunning()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return current.running;
+}
+
+maintenance_scheduler::status maintenance_scheduler::GetStatus()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
+
+bool maintenance_scheduler::InSchedule() const
+{
+    const time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    const int minute = local.tm_hour * 60 + local.tm_min;
+    for (const auto& w : opts.schedule)
+    {
+        const bool inside = w.begin_minute <= w.end_minute ?
+            minute >= w.begin_minute && minute < w.end_minute :
+            minute >= w.begin_minute || minute < w.end_minute;
+        if (inside) return true;
+    }
+    return false;
+}
+
+// Called with `mutex` held
+void maintenance_scheduler::Record(run_info* info, const tkrzw::Status& status, std::chrono::steady_clock::time_point start)
+{
+    info->count++;
+    info->last_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    info->last_duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    info->last_error = status == tkrzw::Status::SUCCESS ? "" : tkrzw::ToString(status);
+}
+
+void maintenance_scheduler::Run()
+{
+    rebuild_task::LowerThreadPriority();
+
+    std::vector<tkrzw::ParamDBM*> files;
+    if (auto* sharded = dynamic_cast<shard_dbm*>(dbm.get())) {
+        for (size_t i = 0; i < sharded->GetNumShards(); ++i) {
+            files.push_back(sharded->GetShard(i));
+        }
+    } else {
+        files.push_back(dbm.get());
+    }
+
+    //Overhead the estimate can't see (e.g. TreeDBM pages) is still there after a rebuild: it's measured
+    //then and not counted as fragmentation again
+    std::vector<double> baselines(files.size(), 0.0);
+    auto fragmentation_of = [](tkrzw::ParamDBM* file) {
+        const int64_t file_size = file->GetFileSizeSimple();
+        const int64_t rebuilt_size = rebuild_task::EstimateRebuiltSize(file);
+        if (file_size <= 0 || rebuilt_size < 0) return 0.0;
+        return std::max(0.0, 1.0 - static_cast<double>(rebuilt_size) / file_size);
+    };
+
+    auto last_check = std::chrono::steady_clock::now();
+    auto busy_time = last_check;                //Last time the write rate was above the idle rate
+    int64_t last_writes = writes.load();
+    int64_t synced_writes = -1;                 //Writes made before Start() may not be synced yet
+    auto rebuild_due = last_check;              //Throttle: no rebuild starts before this
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cond.wait_for(lock, std::chrono::duration<double>(opts.check_interval), [this] { return stopping; });
+        if (stopping) break;
+        lock.unlock();
+
+        const auto now = std::chrono::steady_clock::now();
+        const int64_t num_writes = writes.load();
+        const double elapsed = std::max(std::chrono::duration<double>(now - last_check).count(), 1e-3);
+        const double rate = (num_writes - last_writes) / elapsed;
+        last_writes = num_writes;
+        last_check = now;
+        if (rate > opts.idle_writes_per_sec) {
+            busy_time = now;
+        }
+        const bool idle = opts.idle && std::chrono::duration<double>(now - busy_time).count() >= opts.idle_time;
+        const bool in_schedule = InSchedule();
+
+        //The most fragmented file worth rebuilding
+        double max_fragmentation = 0, max_excess = 0;
+        size_t target = files.size();
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            const double fragmentation = fragmentation_of(files[i]);
+            const double excess = fragmentation - baselines[i];
+            max_fragmentation = std::max(max_fragmentation, fragmentation);
+            if (excess >= opts.rebuild_fragmentation && excess > max_excess &&
+                files[i]->GetFileSizeSimple() >= opts.min_rebuild_bytes) {
+                max_excess = excess;
+                target = i;
+            }
+        }
+
+        lock.lock();
+        current.writes_per_sec = rate;
+        current.fragmentation = max_fragmentation;
+        current.idle = idle;
+        current.in_schedule = in_schedule;
+        if (!idle && !in_schedule) continue;
+
+        if (opts.sync && num_writes != synced_writes)
+        {
+            current.state = "syncing";
+            lock.unlock();
+            const auto start = std::chrono::steady_clock::now();
+            tkrzw::Status s = dbm->Synchronize(false);
+            lock.lock();
+            Record(&current.sync, s, start);
+            current.state = "waiting";
+            synced_writes = num_writes;
+        }
+        if (target < files.size() && !stopping && std::chrono::steady_clock::now() >= rebuild_due)
+        {
+            rebuild_task::options rebuild_opts;
+            rebuild_opts.throttle_bytes_per_sec = opts.throttle_bytes_per_sec;
+            //Aliases the owner of the shard, which keeps it alive
+            rebuild_task task(std::shared_ptr<tkrzw::ParamDBM>(dbm, files[target]), {}, rebuild_opts);
+            const int64_t file_size = std::max<int64_t>(files[target]->GetFileSizeSimple(), 0);
+            current.state = "rebuilding";
+            rebuilding = &task;
+            lock.unlock();
+            const auto start = std::chrono::steady_clock::now();
+            tkrzw::Status s = task.Rebuild();
+            if (s == tkrzw::Status::SUCCESS) {
+                baselines[target] = fragmentation_of(files[target]);
+            }
+            if (opts.throttle_bytes_per_sec > 0) {
+                rebuild_due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(static_cast<double>(file_size) / opts.throttle_bytes_per_sec));
+            }
+            lock.lock();
+            rebuilding = nullptr;
+            if (s != tkrzw::Status::CANCELED_ERROR) {
+                Record(&current.rebuild, s, start);
+            }
+            current.state = "waiting";
+        }
+    }
+    current.running = false;
+}
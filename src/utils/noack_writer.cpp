@@ -0,0 +1,214 @@
+#include "../../include/utils/noack_writer.hpp"
+#include <tkrzw_str_util.h>
+
+// Runs on the main thread when a flush marker is reached, or to report failed writes
+void ReportNoAck(Napi::Env env, Napi::Function jsCallback, noack_context* context, noack_event* event)
+{
+    if (env != nullptr)
+    {
+        if (event->flushed)
+        {
+            auto it = context->flushes.find(event->flush_id);
+            if (it != context->flushes.end()) {
+                it->second.Resolve(Napi::Boolean::New(env, true));
+                context->flushes.erase(it);
+            }
+            if (context->flushes.empty()) {
+                context->tsfn.Unref(env);
+            }
+        }
+        else
+        {
+            context->report_pending.store(false);
+            const uint64_t failed = context->unreported.exchange(0);
+            if (failed > 0 && !context->on_error.IsEmpty())
+            {
+                Napi::Object info = Napi::Object::New(env);
+                info.Set("failed", Napi::Number::New(env, static_cast<double>(failed)));
+                {
+                    std::lock_guard<std::mutex> lock(context->mutex);
+                    info.Set("lastError", Napi::String::New(env, context->last_error));
+                }
+                try {
+                    context->on_error.Call({info});
+                } catch (const Napi::Error&) {
+                    //A failing handler doesn't stop the writer
+                }
+            }
+        }
+    }
+    delete event;
+}
+
+noack_writer::noack_writer(Napi::Env env, tkrzw::ParamDBM* dbm, uint64_t max_pending, std::function<void()> on_written)
+    : dbm(dbm), max_pending(max_pending), on_written(std::move(on_written)), context(new noack_context()),
+      head(new noack_write(noack_write::FLUSH)), tail(head.load())
+{
+    context->tsfn = NOACK_TSFN::New(env, "noack_writer tsfn", 0, 1, context,
+                                    [](Napi::Env, void*, noack_context* ctx) { delete ctx; });
+    context->tsfn.Unref(env);
+    thread = std::thread(&noack_writer::Run, this);
+}
+
+noack_writer::~noack_writer()
+{
+    Stop();
+    delete tail;
+}
+
+bool noack_writer::Push(noack_write* write)
+{
+    if (stopping.load() || (write->kind != noack_write::FLUSH && max_pending > 0 && Pending() >= max_pending))
+    {
+        if (write->kind != noack_write::FLUSH) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        delete write;
+        return false;
+    }
+    if (write->kind != noack_write::FLUSH) {
+        pushed.fetch_add(1, std::memory_order_relaxed);
+    }
+    write->next.store(nullptr, std::memory_order_relaxed);
+    noack_write* prev = head.exchange(write, std::memory_order_acq_rel);
+    prev->next.store(write);
+    //Pairs with the writer's store to `sleeping` and its recheck of the queue: one of the two sees the other
+    if (sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cond.notify_one();
+    }
+    return true;
+}
+
+Napi::Promise noack_writer::Flush(Napi::Env env)
+{
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    const uint64_t id = next_flush_id++;
+    auto* marker = new noack_write(noack_write::FLUSH);
+    marker->flush_id = id;
+    if (context->flushes.empty()) {
+        context->tsfn.Ref(env);
+    }
+    context->flushes.emplace(id, deferred);
+    if (!Push(marker))
+    {
+        context->flushes.erase(id);
+        if (context->flushes.empty()) {
+            context->tsfn.Unref(env);
+        }
+        deferred.Resolve(Napi::Boolean::New(env, true));    //Stopped: everything queued was applied
+    }
+    return deferred.Promise();
+}
+
+void noack_writer::SetErrorHandler(Napi::Function on_error)
+{
+    if (on_error.IsEmpty()) {
+        context->on_error.Reset();
+        context->has_handler.store(false);
+    } else {
+        context->on_error = Napi::Persistent(on_error);
+        context->unreported.store(0);       //The handler hears of failures from now on
+        context->has_handler.store(true);
+    }
+}
+
+std::string noack_writer::LastError()
+{
+    std::lock_guard<std::mutex> lock(context->mutex);
+    return context->last_error;
+}
+
+void noack_writer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped) return;
+        stopped = true;
+        stopping.store(true);
+    }
+    cond.notify_one();
+    thread.join();          //The thread applies whatever is still queued before it exits
+    context->tsfn.Release();
+}
+
+void noack_writer::Report(noack_event* event)
+{
+    if (context->tsfn.NonBlockingCall(event) != napi_ok) {
+        delete event;       //The environment is shutting down
+    }
+}
+
+noack_write* noack_writer::Pop()
+{
+    noack_write* next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+        return nullptr;
+    }
+    delete tail;
+    tail = next;
+    return next;
+}
+
+void noack_writer::Apply(noack_write* write)
+{
+    tkrzw::Status status;
+    switch (write->kind)
+    {
+        case noack_write::SET:
+            status = dbm->Set(write->key, write->value);
+            break;
+        case noack_write::APPEND:
+            status = dbm->Append(write->key, write->value, write->delimiter);
+            break;
+        case noack_write::INCREMENT:
+            status = dbm->Increment(write->key, write->increment, nullptr, write->initial);
+            break;
+        case noack_write::FLUSH:
+            Report(new noack_event{true, write->flush_id});
+            return;
+    }
+    if (status == tkrzw::Status::SUCCESS) {
+        written.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        failed.fetch_add(1, std::memory_order_relaxed);
+        context->unreported.fetch_add(1);
+        std::lock_guard<std::mutex> lock(context->mutex);
+        context->last_error = write->key + ": " + tkrzw::ToString(status);
+    }
+    applied.fetch_add(1, std::memory_order_relaxed);
+    //The node stays as the stub until the next Pop(): release its memory now
+    std::string().swap(write->key);
+    std::string().swap(write->value);
+}
+
+void noack_writer::Run()
+{
+    while (true)
+    {
+        const uint64_t failed_before = failed.load(std::memory_order_relaxed);
+        const uint64_t applied_before = applied.load(std::memory_order_relaxed);
+        while (noack_write* write = Pop()) {
+            Apply(write);
+        }
+        if (applied.load(std::memory_order_relaxed) != applied_before && on_written) {
+            on_written();
+        }
+        if (failed.load(std::memory_order_relaxed) != failed_before && context->has_handler.load() &&
+            !context->report_pending.exchange(true)) {
+            Report(new noack_event{false, 0});
+        }
+        sleeping.store(true);
+        if (!IsEmpty()) {
+            sleeping.store(false);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping.load() && IsEmpty()) {
+            break;
+        }
+        cond.wait_for(lock, std::chrono::milliseconds(100), [this] { return !IsEmpty() || stopping.load(); });
+        sleeping.store(false);
+    }
+}
@@ -0,0 +1,149 @@
+#include "../../include/utils/op_capture.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <tkrzw_hash_util.h>
+
+namespace
+{
+    constexpr size_t FLUSH_BYTES = 1 << 16;
+    constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(100);
+
+    template <typename T>
+    void put(std::vector<char>* buf, T value)
+    {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            buf->push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+        }
+    }
+
+    uint32_t clamp32(uint64_t value)
+    {
+        return static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+    }
+}
+
+op_capture::op_capture(const std::string& path, const options& opts, const std::vector<std::string>& op_names)
+    : path(path), opts(opts), op_names(op_names), start(std::chrono::steady_clock::now())
+{
+}
+
+op_capture::~op_capture()
+{
+    Close();
+}
+
+bool op_capture::Open(std::string* error)
+{
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        *error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    std::vector<char> header(8);
+    std::memcpy(header.data(), "TKZTRACE", 8);
+    put<uint32_t>(&header, VERSION);
+    put<uint32_t>(&header, RECORD_SIZE);
+    put<uint64_t>(&header, std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    put<uint16_t>(&header, static_cast<uint16_t>(op_names.size()));
+    for (const auto& name : op_names) {
+        put<uint8_t>(&header, static_cast<uint8_t>(name.size()));
+        header.insert(header.end(), name.begin(), name.begin() + std::min<size_t>(name.size(), 255));
+    }
+    if (std::fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        *error = path + ": " + std::strerror(errno);
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    writer = std::thread(&op_capture::Run, this);
+    return true;
+}
+
+void op_capture::Record(uint16_t operation, std::string_view key, uint32_t value_size, uint32_t result_size,
+                        std::chrono::steady_clock::time_point arrival, std::chrono::steady_clock::time_point end, bool error)
+{
+    const uint64_t hash = key.empty() ? 0 : tkrzw::HashFNV(key);
+    if (opts.sample_rate < 1.0)
+    {
+        if (key.empty()) {
+            keyless_credit += opts.sample_rate;
+            if (keyless_credit < 1.0) {
+                return;
+            }
+            keyless_credit -= 1.0;
+        } else if ((hash % 1000000) >= opts.sample_rate * 1000000) {
+            return;
+        }
+    }
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closing || file == nullptr) {
+            return;
+        }
+        put<uint64_t>(&pending, std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(arrival - start).count()));
+        put<uint64_t>(&pending, hash);
+        put<uint32_t>(&pending, clamp32(key.size()));
+        put<uint32_t>(&pending, value_size);
+        put<uint32_t>(&pending, result_size);
+        put<uint32_t>(&pending, clamp32(std::chrono::duration_cast<std::chrono::microseconds>(end - arrival).count()));
+        put<uint16_t>(&pending, operation);
+        put<uint16_t>(&pending, error ? FLAG_ERROR : 0);
+        put<uint32_t>(&pending, 0);
+        wake = pending.size() >= FLUSH_BYTES;
+    }
+    num_records++;
+    if (wake) {
+        cond.notify_one();
+    }
+}
+
+size_t op_capture::MemoryUsage()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return sizeof(*this) + pending.capacity();
+}
+
+void op_capture::Run()
+{
+    std::vector<char> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cond.wait_for(lock, FLUSH_INTERVAL, [this] { return closing || pending.size() >= FLUSH_BYTES; });
+        batch.swap(pending);
+        const bool last = closing;
+        lock.unlock();
+        if (!batch.empty()) {
+            std::fwrite(batch.data(), 1, batch.size(), file);
+            batch.clear();
+        }
+        if (last) {
+            return;
+        }
+        lock.lock();
+    }
+}
+
+void op_capture::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closing) {
+            return;
+        }
+        closing = true;
+    }
+    cond.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (file != nullptr) {
+        std::fflush(file);
+        num_bytes = static_cast<uint64_t>(std::max<long>(0, std::ftell(file)));
+        std::fclose(file);
+        file = nullptr;
+    }
+}
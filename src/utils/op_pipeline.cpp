@@ -0,0 +1,194 @@
+#include "../../include/utils/op_pipeline.hpp"
+#include <tkrzw_str_util.h>
+
+// Runs one step on its record, checking its condition against the results of the steps before it
+class op_pipeline::step_processor : public tkrzw::DBM::RecordProcessor
+{
+    public:
+        step_processor(const pipeline_step& step, std::vector<pipeline_result>& results, size_t index)
+            : step(step), results(results), result(results[index]) {}
+
+        std::string_view ProcessFull(std::string_view key, std::string_view current) override {
+            if (!Ready()) {
+                return NOOP;
+            }
+            switch (step.type)
+            {
+                case pipeline_step::GET:
+                    result.found = true;
+                    result.value = std::string(current);
+                    return NOOP;
+                case pipeline_step::REMOVE:
+                    result.found = true;
+                    return REMOVE;
+                case pipeline_step::APPEND:
+                    written = std::string(current) + step.delimiter + value;
+                    return written;
+                case pipeline_step::INCREMENT:
+                    return Increment(tkrzw::StrToIntBigEndian(current));
+                default:
+                    return value;
+            }
+        }
+
+        std::string_view ProcessEmpty(std::string_view key) override {
+            if (!Ready()) {
+                return NOOP;
+            }
+            switch (step.type)
+            {
+                case pipeline_step::GET: case pipeline_step::REMOVE:
+                    return NOOP;
+                case pipeline_step::INCREMENT:
+                    return Increment(step.initial);
+                default:
+                    return value;
+            }
+        }
+
+        // The operand as text; false if it refers to a `get` that read nothing (or was skipped)
+        static bool Resolve(const pipeline_operand& operand, const std::vector<pipeline_result>& results, std::string* text) {
+            if (operand.ref < 0) {
+                *text = operand.text;
+                return true;
+            }
+            const pipeline_result& source = results[operand.ref];
+            if (!source.ran || !source.found) {
+                return false;
+            }
+            *text = source.value;
+            return true;
+        }
+
+    private:
+        // Evaluated when the record is reached, so it sees every earlier step, then marks the step as run
+        bool Ready() {
+            if (step.condition != pipeline_step::ALWAYS) {
+                const pipeline_result& source = results[step.condition_step];
+                const bool exists = source.ran && source.found;
+                bool met = false;
+                switch (step.condition)
+                {
+                    case pipeline_step::EXISTS:
+                        met = exists;
+                        break;
+                    case pipeline_step::MISSING:
+                        met = !exists;
+                        break;
+                    default:
+                    {
+                        std::string expected;
+                        const bool equal = exists && Resolve(step.expected, results, &expected) && source.value == expected;
+                        met = step.condition == pipeline_step::EQUALS ? equal : !equal;
+                        break;
+                    }
+                }
+                if (!met) {
+                    return false;
+                }
+            }
+            if ((step.type == pipeline_step::SET || step.type == pipeline_step::APPEND) &&
+                !Resolve(step.value, results, &value)) {
+                return false;
+            }
+            result.ran = true;
+            return true;
+        }
+
+        std::string_view Increment(int64_t base) {
+            result.number = base + step.delta;
+            written = tkrzw::IntToStrBigEndian(result.number);
+            return written;
+        }
+
+        const pipeline_step& step;
+        std::vector<pipeline_result>& results;
+        pipeline_result& result;
+        std::string value;          // The resolved value of SET and APPEND
+        std::string written;
+};
+
+bool op_pipeline::Validate(std::string* error) const
+{
+    auto check_ref = [&](const pipeline_operand& operand, size_t index, const char* what) {
+        if (operand.ref < 0) {
+            return true;
+        }
+        if (static_cast<size_t>(operand.ref) >= index || steps[operand.ref].type != pipeline_step::GET) {
+            *error = "step " + std::to_string(index) + ": " + what + " must refer to an earlier get step";
+            return false;
+        }
+        return true;
+    };
+    for (size_t i = 0; i < steps.size(); i++)
+    {
+        const pipeline_step& step = steps[i];
+        if (!check_ref(step.key, i, "key") || !check_ref(step.value, i, "value") ||
+            !check_ref(step.expected, i, "equals")) {
+            return false;
+        }
+        if (step.condition != pipeline_step::ALWAYS &&
+            !check_ref(pipeline_operand{std::string(), step.condition_step}, i, "if.step")) {
+            return false;
+        }
+        if (atomic && step.key.ref >= 0) {
+            *error = "step " + std::to_string(i) + ": an atomic pipeline needs literal keys";
+            return false;
+        }
+    }
+    return true;
+}
+
+tkrzw::Status op_pipeline::Run(tkrzw::DBM* dbm, std::vector<pipeline_result>* results) const
+{
+    results->assign(steps.size(), pipeline_result());
+    std::vector<step_processor> processors;
+    processors.reserve(steps.size());       //Pointers to the elements are taken below
+    for (size_t i = 0; i < steps.size(); i++) {
+        processors.emplace_back(steps[i], *results, i);
+    }
+    if (atomic)
+    {
+        //ProcessMulti() calls the processors in order with every record locked, so each step sees the ones before
+        std::vector<std::pair<std::string_view, tkrzw::DBM::RecordProcessor*>> key_proc_pairs;
+        bool writable = false;
+        for (size_t i = 0; i < steps.size(); i++) {
+            key_proc_pairs.emplace_back(steps[i].key.text, &processors[i]);
+            writable |= steps[i].type != pipeline_step::GET;
+        }
+        return dbm->ProcessMulti(key_proc_pairs, writable);
+    }
+    std::string key;
+    for (size_t i = 0; i < steps.size(); i++)
+    {
+        if (!step_processor::Resolve(steps[i].key, *results, &key)) {
+            continue;           //Skipped: its key comes from a get that read nothing
+        }
+        tkrzw::Status status = dbm->Process(key, &processors[i], steps[i].type != pipeline_step::GET);
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+bool op_pipeline::Keys(std::vector<std::string_view>* keys) const
+{
+    for (const pipeline_step& step : steps)
+    {
+        if (step.key.ref >= 0) {
+            return false;
+        }
+        keys->emplace_back(step.key.text);
+    }
+    return true;
+}
+
+uint64_t op_pipeline::Bytes() const
+{
+    uint64_t bytes = 0;
+    for (const pipeline_step& step : steps) {
+        bytes += step.key.text.size() + step.value.text.size() + step.delimiter.size() + step.expected.text.size();
+    }
+    return bytes;
+}
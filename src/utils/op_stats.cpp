@@ -0,0 +1,190 @@
+#include "../../include/utils/op_stats.hpp"
+#include <cmath>
+
+int latency_histogram::BucketOf(uint64_t value)
+{
+    if (value < (2u << SUB_BITS)) {
+        return static_cast<int>(value);
+    }
+    const int msb = 63 - __builtin_clzll(value);
+    if (msb >= MAX_BITS) {
+        return NUM_BUCKETS - 1;
+    }
+    const int shift = msb - SUB_BITS;                                           // >= 1
+    const int sub = static_cast<int>(value >> shift) - (1 << SUB_BITS);        // [0, 32)
+    return (2 << SUB_BITS) + ((shift - 1) << SUB_BITS) + sub;
+}
+
+uint64_t latency_histogram::ValueOf(int bucket)
+{
+    if (bucket < (2 << SUB_BITS)) {
+        return bucket;
+    }
+    const int shift = ((bucket - (2 << SUB_BITS)) >> SUB_BITS) + 1;
+    const uint64_t sub = ((bucket - (2 << SUB_BITS)) & ((1 << SUB_BITS) - 1)) + (1 << SUB_BITS);
+    return (sub << shift) + ((uint64_t(1) << shift) >> 1);
+}
+
+void latency_histogram::Record(uint64_t value)
+{
+    buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+double latency_histogram::Mean() const
+{
+    const uint64_t n = count.load(std::memory_order_relaxed);
+    return n == 0 ? 0 : static_cast<double>(sum.load(std::memory_order_relaxed)) / n;
+}
+
+uint64_t latency_histogram::Percentile(double quantile) const
+{
+    uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * total)));
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i)
+    {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(ValueOf(i), Max());
+        }
+    }
+    return Max();
+}
+
+void latency_histogram::Reset()
+{
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+static int64_t steady_nanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+op_stats::op_stats(size_t num_operations)
+    : num_operations(num_operations), records(new std::atomic<op_record*>[num_operations]), since(steady_nanos())
+{
+    for (size_t i = 0; i < num_operations; ++i) {
+        records[i].store(nullptr);
+    }
+}
+
+op_stats::~op_stats()
+{
+    for (size_t i = 0; i < num_operations; ++i) {
+        delete records[i].load();
+    }
+}
+
+size_t op_stats::MemoryUsage() const
+{
+    size_t bytes = sizeof(*this) + num_operations * sizeof(std::atomic<op_record*>);
+    for (size_t i = 0; i < num_operations; ++i) {
+        if (records[i].load(std::memory_order_relaxed) != nullptr) {
+            bytes += sizeof(op_record);
+        }
+    }
+    return bytes;
+}
+
+op_stats::op_record* op_stats::Get(size_t operation)
+{
+    op_record* record = records[operation].load(std::memory_order_acquire);
+    if (record == nullptr)
+    {
+        auto* created = new op_record();
+        if (records[operation].compare_exchange_strong(record, created, std::memory_order_acq_rel)) {
+            record = created;
+        } else {
+            delete created;     //Another thread won the race; `record` holds its pointer
+        }
+    }
+    return record;
+}
+
+void op_stats::Record(size_t operation, uint64_t queue_wait_ns, uint64_t execute_ns, uint64_t bytes_in, uint64_t bytes_out)
+{
+    op_record* record = Get(operation);
+    record->queue_wait.Record(queue_wait_ns);
+    record->execute.Record(execute_ns);
+    record->count.fetch_add(1, std::memory_order_relaxed);
+    record->bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+    record->bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+}
+
+void op_stats::RecordError(size_t operation)
+{
+    Get(operation)->errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Latencies in microseconds
+static Napi::Object histogram_object(Napi::Env env, const latency_histogram& histogram)
+{
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("p50", Napi::Number::New(env, histogram.Percentile(0.5) / 1000.0));
+    obj.Set("p99", Napi::Number::New(env, histogram.Percentile(0.99) / 1000.0));
+    obj.Set("p999", Napi::Number::New(env, histogram.Percentile(0.999) / 1000.0));
+    obj.Set("max", Napi::Number::New(env, histogram.Max() / 1000.0));
+    obj.Set("mean", Napi::Number::New(env, histogram.Mean() / 1000.0));
+    return obj;
+}
+
+Napi::Object op_stats::ToObject(Napi::Env env, const std::function<const char*(size_t)>& name_of, bool reset)
+{
+    const int64_t now = steady_nanos();
+    const double elapsed = std::max((now - since.load()) / 1e9, 1e-9);
+    uint64_t total = 0;
+    Napi::Object operations = Napi::Object::New(env);
+    for (size_t i = 0; i < num_operations; ++i)
+    {
+        op_record* record = records[i].load(std::memory_order_acquire);
+        if (record == nullptr) continue;
+        const uint64_t count = record->count.load(std::memory_order_relaxed);
+        if (count == 0) continue;           //Not used since the last reset
+        total += count;
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("count", Napi::Number::New(env, static_cast<double>(count)));
+        obj.Set("opsPerSec", Napi::Number::New(env, count / elapsed));
+        obj.Set("errors", Napi::Number::New(env, static_cast<double>(record->errors.load(std::memory_order_relaxed))));
+        obj.Set("bytesIn", Napi::Number::New(env, static_cast<double>(record->bytes_in.load(std::memory_order_relaxed))));
+        obj.Set("bytesOut", Napi::Number::New(env, static_cast<double>(record->bytes_out.load(std::memory_order_relaxed))));
+        obj.Set("queueWait", histogram_object(env, record->queue_wait));
+        obj.Set("execute", histogram_object(env, record->execute));
+        operations.Set(name_of(i), obj);
+        if (reset)
+        {
+            record->queue_wait.Reset();
+            record->execute.Reset();
+            record->count.store(0, std::memory_order_relaxed);
+            record->errors.store(0, std::memory_order_relaxed);
+            record->bytes_in.store(0, std::memory_order_relaxed);
+            record->bytes_out.store(0, std::memory_order_relaxed);
+        }
+    }
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("elapsedMs", Napi::Number::New(env, elapsed * 1000.0));
+    result.Set("inFlight", Napi::Number::New(env, static_cast<double>(in_flight.load(std::memory_order_relaxed))));
+    result.Set("totalOps", Napi::Number::New(env, static_cast<double>(total)));
+    result.Set("opsPerSec", Napi::Number::New(env, total / elapsed));
+    result.Set("operations", operations);
+    if (reset) {
+        since.store(now);
+    }
+    return result;
+}
@@ -0,0 +1,122 @@
+#include "../../include/utils/op_tracer.hpp"
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+    double micros(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration<double, std::micro>(d).count();
+    }
+}
+
+op_tracer::op_tracer(const options& opts)
+    : opts(opts), start(std::chrono::steady_clock::now()), start_wall(std::chrono::system_clock::now())
+{
+    spans.reserve(std::min<size_t>(opts.max_spans, 4096));
+}
+
+int op_tracer::ThreadIndex(std::thread::id thread)
+{
+    return threads.emplace(thread, static_cast<int>(threads.size()) + 1).first->second;
+}
+
+void op_tracer::Record(const op_span& span)
+{
+    ThreadIndex(span.thread);
+    if (opts.max_spans > 0)
+    {
+        if (spans.size() < opts.max_spans) {
+            spans.push_back(span);
+        } else {
+            spans[next] = span;
+            next = (next + 1) % opts.max_spans;
+        }
+        recorded++;
+    }
+    if (opts.slow_threshold >= 0 &&
+        std::chrono::duration<double>(span.resolve_end - span.enqueue).count() >= opts.slow_threshold)
+    {
+        if (slow_ops.size() >= opts.max_slow_ops && !slow_ops.empty()) {
+            slow_ops.pop_front();
+        }
+        if (opts.max_slow_ops > 0) {
+            slow_ops.push_back(span);
+        }
+    }
+}
+
+// Each operation is an async slice (its own row in the viewer) with a nested "queue" slice; the
+// execute and resolve phases are complete events on the thread that ran them: tid 0 is the main
+// thread, tids from 1 the pool threads.
+bool op_tracer::WriteChromeTrace(const std::string& path, std::string* error) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        *error = "Cannot open " + path;
+        return false;
+    }
+    file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedSpans\":" << NumDropped() << "},\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}}";
+    for (const auto& [id, index] : threads) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << index
+             << ",\"args\":{\"name\":\"pool " << index << "\"}}";
+    }
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+        const op_span& span = spans[(next + i) % spans.size()];
+        const uint64_t id = recorded - spans.size() + i + 1;
+        const int tid = threads.at(span.thread);
+        auto event = [&](const char* name, const char* cat, const char* ph, std::chrono::steady_clock::time_point ts) {
+            file << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << cat << "\",\"ph\":\"" << ph << "\",\"id\":" << id
+                 << ",\"ts\":" << micros(ts - start) << ",\"pid\":1,\"tid\":0";
+        };
+        event(span.name, "op", "b", span.enqueue);
+        file << ",\"args\":{\"keyBytes\":" << span.key_bytes << ",\"bytesIn\":" << span.bytes_in
+             << ",\"error\":" << (span.error ? "true" : "false") << "}}";
+        event("queue", "op", "b", span.enqueue);
+        file << "}";
+        event("queue", "op", "e", span.execute_start);
+        file << "}";
+        event(span.name, "op", "e", span.resolve_end);
+        file << "}";
+        file << ",\n{\"name\":\"" << span.name << "\",\"cat\":\"execute\",\"ph\":\"X\",\"ts\":" << micros(span.execute_start - start)
+             << ",\"dur\":" << micros(span.execute_end - span.execute_start) << ",\"pid\":1,\"tid\":" << tid << "}";
+        file << ",\n{\"name\":\"" << span.name << "\",\"cat\":\"resolve\",\"ph\":\"X\",\"ts\":" << micros(span.resolve_start - start)
+             << ",\"dur\":" << micros(span.resolve_end - span.resolve_start) << ",\"pid\":1,\"tid\":0}";
+    }
+    file << "\n]}\n";
+    file.close();
+    if (!file) {
+        *error = "Cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+Napi::Array op_tracer::SlowOps(Napi::Env env, bool clear)
+{
+    Napi::Array result = Napi::Array::New(env, slow_ops.size());
+    for (size_t i = 0; i < slow_ops.size(); ++i)
+    {
+        const op_span& span = slow_ops[i];
+        const auto wall = start_wall + std::chrono::duration_cast<std::chrono::system_clock::duration>(span.enqueue - start);
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("op", Napi::String::New(env, span.name));
+        obj.Set("keyBytes", Napi::Number::New(env, static_cast<double>(span.key_bytes)));
+        obj.Set("bytesIn", Napi::Number::New(env, static_cast<double>(span.bytes_in)));
+        obj.Set("startTime", Napi::Number::New(env, static_cast<double>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(wall.time_since_epoch()).count())));
+        obj.Set("queueWaitUs", Napi::Number::New(env, micros(span.execute_start - span.enqueue)));
+        obj.Set("executeUs", Napi::Number::New(env, micros(span.execute_end - span.execute_start)));
+        obj.Set("callbackWaitUs", Napi::Number::New(env, micros(span.resolve_start - span.execute_end)));
+        obj.Set("resolveUs", Napi::Number::New(env, micros(span.resolve_end - span.resolve_start)));
+        obj.Set("totalUs", Napi::Number::New(env, micros(span.resolve_end - span.enqueue)));
+        obj.Set("error", Napi::Boolean::New(env, span.error));
+        result.Set(i, obj);
+    }
+    if (clear) {
+        slow_ops.clear();
+    }
+    return result;
+}
@@ -0,0 +1,245 @@
+#include "../../include/utils/open_task.hpp"
+#include "../../include/utils/dbm_registry.hpp"
+#include "../../include/utils/page_cache.hpp"
+#include "../../include/utils/shard_dbm.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <tkrzw_dbm_shard.h>
+#include <tkrzw_file_util.h>
+#include <tkrzw_str_util.h>
+
+namespace
+{
+    // Files of the database as it is on disk: one per shard for an existing sharded database
+    std::vector<std::string> files_on_disk(const std::string& path, bool sharded)
+    {
+        int32_t num_shards = 0;
+        if (!sharded || path.empty() || tkrzw::ShardDBM::GetNumberOfShards(path, &num_shards) != tkrzw::Status::SUCCESS) {
+            return {path};
+        }
+        std::vector<std::string> files;
+        for (int32_t i = 0; i < num_shards; ++i) {
+            files.push_back(tkrzw::SPrintF("%s-%05d-of-%05d", path.c_str(), i, num_shards));
+        }
+        return files;
+    }
+
+    bool was_restored(tkrzw::DBM* dbm)
+    {
+        std::vector<tkrzw::DBM*> units;
+        if (auto* sharded = dynamic_cast<shard_dbm*>(dbm)) {
+            for (size_t i = 0; i < sharded->GetNumShards(); ++i) {
+                units.push_back(sharded->GetShard(i));
+            }
+        } else {
+            units.push_back(dbm);
+        }
+        for (auto* unit : units) {
+            for (const auto& [name, value] : unit->Inspect()) {
+                if (name == "auto_restored" && value == "true") {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // The DBM the open produced, whichever of the two it is
+    tkrzw::ParamDBM* opened_dbm(open_context* context)
+    {
+        return context->dbm ? context->dbm.get() : context->index->GetInternalDBM();
+    }
+
+    // Closes what was opened if nobody adopts it
+    void discard(open_context* context)
+    {
+        if (context->dbm) {
+            dbm_registry::Release(&context->dbm);
+        }
+        if (context->index) {
+            context->index->Close();
+            context->index.reset();
+        }
+    }
+
+    void report(open_context* context, const open_progress& progress)
+    {
+        auto* copy = new open_progress(progress);
+        if (context->tsfn.BlockingCall(copy) != napi_ok) {
+            delete copy;        //The environment is shutting down
+        }
+    }
+}
+
+// Runs on the main thread for every progress report and, last, for the outcome
+void ReportOpen(Napi::Env env, Napi::Function jsCallback, open_context* context, open_progress* progress)
+{
+    static const char* const phases[] = {"open", "restore", "prefetch", "ready"};
+    const bool failed = progress->phase == open_progress::PHASE_DONE && progress->status != tkrzw::Status::SUCCESS;
+    if (env != nullptr && !failed && !context->on_progress.IsEmpty())
+    {
+        Napi::Object info = Napi::Object::New(env);
+        info.Set("phase", Napi::String::New(env, phases[progress->phase]));
+        info.Set("percent", Napi::Number::New(env, progress->bytes_total > 0 ?
+            std::min(100.0, 100.0 * progress->bytes_done / progress->bytes_total) : 0.0));
+        info.Set("bytesDone", Napi::Number::New(env, static_cast<double>(progress->bytes_done)));
+        info.Set("bytesTotal", Napi::Number::New(env, static_cast<double>(progress->bytes_total)));
+        info.Set("elapsedMs", Napi::Number::New(env, progress->elapsed * 1000.0));
+        if (progress->phase == open_progress::PHASE_DONE) {
+            info.Set("restored", Napi::Boolean::New(env, progress->restored));
+        }
+        try {
+            context->on_progress.Call({info});
+        } catch (const Napi::Error&) {
+            //A failing callback doesn't stop the open
+        }
+    }
+    if (env == nullptr && progress->phase == open_progress::PHASE_DONE && !failed) {
+        discard(context);      //Nobody left to adopt it
+    }
+    if (env != nullptr && progress->phase == open_progress::PHASE_DONE)
+    {
+        if (failed) {
+            context->deferred.Reject(Napi::Error::New(env, "Failed to open " + context->path + ": " +
+                                                      tkrzw::ToString(progress->status)).Value());
+        }
+        else {
+            try {
+                Napi::Value handle = context->index ?
+                    Napi::External<std::unique_ptr<tkrzw::PolyIndex>>::New(env, &context->index).As<Napi::Value>() :
+                    Napi::External<std::shared_ptr<tkrzw::ParamDBM>>::New(env, &context->dbm).As<Napi::Value>();
+                context->deferred.Resolve(context->constructor.New({context->config.Value(), Napi::String::New(env, context->path), handle}));
+            } catch (const Napi::Error& e) {
+                discard(context);
+                context->deferred.Reject(e.Value());
+            }
+        }
+        context->dbm.reset();
+        context->index.reset();        //Moved out by the constructor
+    }
+    delete progress;
+}
+
+Napi::Promise open_task::Start(Napi::Env env, Napi::Function constructor, Napi::Value config, const std::string& path,
+                               bool sharded, std::map<std::string, std::string> params, int32_t open_options,
+                               const options& opts, Napi::Function on_progress)
+{
+    return Launch(env, constructor, config, path, files_on_disk(path, sharded),
+        [sharded, params = std::move(params), open_options](open_context* context) {
+            return dbm_registry::Acquire(context->path, sharded,
+                [sharded]() -> std::shared_ptr<tkrzw::ParamDBM> {
+                    if (sharded) {
+                        return std::make_shared<shard_dbm>();
+                    }
+                    return std::make_shared<tkrzw::PolyDBM>();
+                },
+                [&](tkrzw::ParamDBM* unopened) {
+                    return unopened->OpenAdvanced(context->path, true, open_options, params);
+                },
+                &context->dbm);
+        },
+        opts, on_progress);
+}
+
+Napi::Promise open_task::StartIndex(Napi::Env env, Napi::Function constructor, Napi::Value config, const std::string& path,
+                                    std::map<std::string, std::string> params, int32_t open_options,
+                                    const options& opts, Napi::Function on_progress)
+{
+    return Launch(env, constructor, config, path, {path},
+        [params = std::move(params), open_options](open_context* context) {
+            auto index = std::make_unique<tkrzw::PolyIndex>();
+            tkrzw::Status status = index->Open(context->path, true, open_options, params);
+            if (status == tkrzw::Status::SUCCESS) {
+                context->index = std::move(index);
+            }
+            return status;
+        },
+        opts, on_progress);
+}
+
+Napi::Promise open_task::Launch(Napi::Env env, Napi::Function constructor, Napi::Value config, const std::string& path,
+                                std::vector<std::string> files, std::function<tkrzw::Status(open_context*)> open,
+                                const options& opts, Napi::Function on_progress)
+{
+    auto* context = new open_context{Napi::Promise::Deferred::New(env), {}, Napi::Persistent(constructor),
+                                     Napi::Persistent(config), path, nullptr, nullptr, {}, {}};
+    if (!on_progress.IsEmpty()) {
+        context->on_progress = Napi::Persistent(on_progress);
+    }
+    context->tsfn = OPEN_TSFN::New(env, "open_task tsfn", 0, 1, context,
+                                   [](Napi::Env, void*, open_context* ctx) {
+                                       ctx->thread.join();
+                                       delete ctx;
+                                   });
+    Napi::Promise promise = context->deferred.Promise();
+
+    context->thread = std::thread([context, files = std::move(files), open = std::move(open), opts]() {
+        const auto start = std::chrono::steady_clock::now();
+        auto elapsed = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+        open_progress progress{open_progress::PHASE_OPEN, 0, 0, 0, false, tkrzw::Status(tkrzw::Status::SUCCESS)};
+        for (const auto& file : files) {
+            progress.bytes_total += std::max<int64_t>(tkrzw::GetFileSize(file), 0);
+        }
+        report(context, progress);
+
+        //Recovery writes "<file>.tmp.restore" next to each file being restored
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool opened = false;
+        std::thread monitor([&] {
+            std::unique_lock<std::mutex> lock(mutex);
+            const auto interval = std::chrono::duration<double>(opts.progress_interval);
+            while (!cond.wait_for(lock, interval, [&] { return opened; }))
+            {
+                lock.unlock();
+                open_progress current = progress;
+                for (const auto& file : files) {
+                    current.bytes_done += std::max<int64_t>(tkrzw::GetFileSize(file + ".tmp.restore"), 0);
+                }
+                if (current.bytes_done > 0) {
+                    current.phase = open_progress::PHASE_RESTORE;
+                }
+                current.elapsed = elapsed();
+                report(context, current);
+                lock.lock();
+            }
+        });
+        tkrzw::Status status = open(context);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            opened = true;
+        }
+        cond.notify_all();
+        monitor.join();
+
+        if (status == tkrzw::Status::SUCCESS) {
+            progress.restored = was_restored(opened_dbm(context));
+            if (opts.prefetch) {
+                progress.phase = open_progress::PHASE_PREFETCH;
+                progress.elapsed = elapsed();
+                report(context, progress);
+                auto last_report = std::chrono::steady_clock::now();
+                int64_t resident = 0;
+                status = prefetch_pages(opened_dbm(context), &resident, [&](int64_t bytes_read) {
+                    const auto now = std::chrono::steady_clock::now();
+                    if (now - last_report >= std::chrono::duration<double>(opts.progress_interval)) {
+                        last_report = now;
+                        progress.bytes_done = bytes_read;
+                        progress.elapsed = elapsed();
+                        report(context, progress);
+                    }
+                });
+                if (status != tkrzw::Status::SUCCESS) {
+                    discard(context);
+                }
+            }
+        }
+        progress.phase = open_progress::PHASE_DONE;
+        progress.status = status;
+        progress.elapsed = elapsed();
+        report(context, progress);
+        context->tsfn.Release();
+    });
+    return promise;
+}
@@ -0,0 +1,211 @@
+#include "../../include/utils/page_cache.hpp"
+#include "../../include/utils/shard_dbm.hpp"
+#include <tkrzw_dbm_hash.h>
+#include <tkrzw_dbm_poly.h>
+#include <tkrzw_dbm_skip.h>
+#include <tkrzw_dbm_tree.h>
+#include <tkrzw_file_poly.h>
+#include <tkrzw_file_pos.h>
+#include <tkrzw_str_util.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22       //Linux 5.14; older kernels fail with EINVAL
+#endif
+
+namespace
+{
+    constexpr int64_t CHUNK = 256 << 20;       //Bytes mapped, queried or populated at a time
+
+    struct dbm_file
+    {
+        tkrzw::DBM* dbm;
+        tkrzw::File* file;
+    };
+
+    // The DBM behind each PolyDBM, and the file behind each PolyFile
+    std::vector<dbm_file> files_of(tkrzw::ParamDBM* dbm)
+    {
+        std::vector<tkrzw::PolyDBM*> polys;
+        if (auto* sharded = dynamic_cast<shard_dbm*>(dbm)) {
+            for (size_t i = 0; i < sharded->GetNumShards(); ++i) {
+                polys.push_back(sharded->GetShard(i));
+            }
+        } else if (auto* poly = dynamic_cast<tkrzw::PolyDBM*>(dbm)) {
+            polys.push_back(poly);
+        }
+        std::vector<dbm_file> result;
+        for (auto* poly : polys) {
+            tkrzw::DBM* internal = poly->GetInternalDBM();
+            tkrzw::File* file = nullptr;
+            if (auto* hash = dynamic_cast<tkrzw::HashDBM*>(internal)) {
+                file = hash->GetInternalFile();
+            } else if (auto* tree = dynamic_cast<tkrzw::TreeDBM*>(internal)) {
+                file = tree->GetInternalFile();
+            } else if (auto* skip = dynamic_cast<tkrzw::SkipDBM*>(internal)) {
+                file = skip->GetInternalFile();
+            }
+            if (auto* poly_file = dynamic_cast<tkrzw::PolyFile*>(file)) {
+                file = poly_file->GetInternalFile();
+            }
+            if (file != nullptr) {
+                result.push_back({internal, file});
+            }
+        }
+        return result;
+    }
+
+    // Applies `fn(addr, length)` to a read-only shared mapping of the file, chunk by chunk
+    template <typename FN>
+    bool for_each_chunk(int fd, int64_t size, FN fn)
+    {
+        for (int64_t offset = 0; offset < size; offset += CHUNK) {
+            const size_t length = static_cast<size_t>(std::min(CHUNK, size - offset));
+            void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, offset);
+            if (addr == MAP_FAILED) {
+                return false;
+            }
+            const bool ok = fn(addr, length);
+            munmap(addr, length);
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool resident_bytes(int fd, int64_t size, int64_t* resident)
+    {
+        const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        std::vector<unsigned char> pages;
+        *resident = 0;
+        return for_each_chunk(fd, size, [&](void* addr, size_t length) {
+            const size_t num_pages = (length + page_size - 1) / page_size;
+            pages.resize(num_pages);
+            if (mincore(addr, length, pages.data()) != 0) {
+                return false;
+            }
+            for (size_t i = 0; i < num_pages; ++i) {
+                if (pages[i] & 1) {
+                    *resident += static_cast<int64_t>(std::min(page_size, length - i * page_size));
+                }
+            }
+            return true;
+        });
+    }
+
+    tkrzw::Status errno_status(const std::string& path)
+    {
+        return tkrzw::Status(tkrzw::Status::SYSTEM_ERROR, path + ": " + std::strerror(errno));
+    }
+
+    // Opens each file of the DBM and calls `fn(fd, size)`, then adds up the resident bytes
+    template <typename FN>
+    tkrzw::Status for_each_file(tkrzw::ParamDBM* dbm, int64_t* resident, FN fn)
+    {
+        *resident = 0;
+        for (const auto& [internal, file] : files_of(dbm)) {
+            const std::string path = file->GetPathSimple();
+            const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return errno_status(path);
+            }
+            struct stat st;
+            int64_t file_resident = 0;
+            bool ok = fstat(fd, &st) == 0 && fn(fd, static_cast<int64_t>(st.st_size)) &&
+                      resident_bytes(fd, st.st_size, &file_resident);
+            tkrzw::Status status = ok ? tkrzw::Status(tkrzw::Status::SUCCESS) : errno_status(path);
+            close(fd);
+            if (status != tkrzw::Status::SUCCESS) {
+                return status;
+            }
+            *resident += file_resident;
+        }
+        return tkrzw::Status(tkrzw::Status::SUCCESS);
+    }
+}
+
+std::vector<file_memory> inspect_memory(tkrzw::ParamDBM* dbm, bool cache_buckets)
+{
+    std::vector<file_memory> result;
+    for (const auto& [internal, file] : files_of(dbm)) {
+        file_memory memory;
+        memory.path = file->GetPathSimple();
+        memory.memory_mapped = file->IsMemoryMapping();
+        const int fd = open(memory.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0) {
+                memory.size = st.st_size;
+                resident_bytes(fd, memory.size, &memory.resident);
+            }
+            close(fd);
+        }
+        std::map<std::string, std::string> meta;
+        for (auto& [name, value] : internal->Inspect()) {
+            meta.emplace(std::move(name), std::move(value));
+        }
+        if (cache_buckets && dynamic_cast<tkrzw::HashDBM*>(internal) != nullptr &&
+            dynamic_cast<tkrzw::PositionalFile*>(file) != nullptr) {
+            memory.bucket_cache = tkrzw::StrToInt(meta["record_base"]);
+        } else if (dynamic_cast<tkrzw::TreeDBM*>(internal) != nullptr) {
+            const int64_t nodes = tkrzw::StrToInt(meta["num_leaf_nodes"]) + tkrzw::StrToInt(meta["num_inner_nodes"]);
+            memory.page_cache = std::min(memory.size, std::min(nodes, tkrzw::StrToInt(meta["max_cached_pages"])) *
+                                                      tkrzw::StrToInt(meta["max_page_size"]));
+        }
+        result.push_back(std::move(memory));
+    }
+    return result;
+}
+
+tkrzw::Status prefetch_pages(tkrzw::ParamDBM* dbm, int64_t* resident, const std::function<void(int64_t)>& on_read)
+{
+    int64_t bytes_read = 0;
+    auto read = [&](int64_t bytes) {
+        bytes_read += bytes;
+        if (on_read) {
+            on_read(bytes_read);
+        }
+    };
+    return for_each_file(dbm, resident, [&](int fd, int64_t size) {
+        const int64_t before = bytes_read;
+        bool populated = for_each_chunk(fd, size, [&](void* addr, size_t length) {
+            if (madvise(addr, length, MADV_POPULATE_READ) != 0) {
+                return false;
+            }
+            read(static_cast<int64_t>(length));
+            return true;
+        });
+        if (populated) {
+            return true;
+        }
+        bytes_read = before;
+        std::vector<char> buf(1 << 20);
+        for (int64_t offset = 0; offset < size; ) {
+            const ssize_t n = pread(fd, buf.data(), buf.size(), offset);
+            if (n <= 0) {
+                return n == 0;
+            }
+            offset += n;
+            if (offset % CHUNK == 0 || offset >= size) {
+                read(offset - (bytes_read - before));
+            }
+        }
+        return true;
+    });
+}
+
+tkrzw::Status evict_pages(tkrzw::ParamDBM* dbm, int64_t* resident)
+{
+    return for_each_file(dbm, resident, [](int fd, int64_t size) {
+        //Dirty pages can't be dropped until they are written back
+        return fdatasync(fd) == 0 && posix_fadvise(fd, 0, size, POSIX_FADV_DONTNEED) == 0;
+    });
+}
@@ -0,0 +1,236 @@
+#include "../../include/utils/rebuild_task.hpp"
+#include "../../include/utils/shard_dbm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <tkrzw_file_util.h>
+#include <tkrzw_str_util.h>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Runs on the main thread for every progress report and, last, for the outcome
+void ReportRebuild(Napi::Env env, Napi::Function jsCallback, rebuild_context* context, rebuild_progress* progress)
+{
+    if (env != nullptr)
+    {
+        if (!progress->done)
+        {
+            if (!context->on_progress.IsEmpty())
+            {
+                Napi::Object info = Napi::Object::New(env);
+                info.Set("percent", Napi::Number::New(env, progress->percent));
+                info.Set("bytesDone", Napi::Number::New(env, progress->bytes_done));
+                info.Set("bytesTotal", Napi::Number::New(env, progress->bytes_total));
+                info.Set("shardsDone", Napi::Number::New(env, progress->shards_done));
+                info.Set("numShards", Napi::Number::New(env, progress->num_shards));
+                try {
+                    context->on_progress.Call({info});
+                } catch (const Napi::Error&) {
+                    //A failing callback doesn't stop the rebuild
+                }
+            }
+        }
+        else if (progress->status == tkrzw::Status::SUCCESS) {
+            context->deferred.Resolve(Napi::Boolean::New(env, true));
+        }
+        else if (progress->status == tkrzw::Status::CANCELED_ERROR && context->cancel && context->cancel->IsCancelled()) {
+            Napi::Error error = Napi::Error::New(env, std::string("Rebuild cancelled: ") + context->cancel->Message());
+            error.Value().Set("code", Napi::String::New(env, context->cancel->Code()));
+            context->deferred.Reject(error.Value());
+        }
+        else if (progress->status == tkrzw::Status::CANCELED_ERROR) {
+            context->deferred.Reject(Napi::Error::New(env, "Rebuild cancelled").Value());
+        }
+        else {
+            context->deferred.Reject(Napi::Error::New(env, "DBM Rebuild failed: " + tkrzw::ToString(progress->status)).Value());
+        }
+        if (progress->done) {
+            context->cancel_js.Detach();
+        }
+    }
+    delete progress;
+}
+
+// Lowest nice value and lowest best-effort I/O priority. Not the idle I/O class: a starved
+// rebuild would hold the DBM's locks in its final phase.
+void rebuild_task::LowerThreadPriority()
+{
+#ifdef __linux__
+    const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    setpriority(PRIO_PROCESS, tid, 19);
+#ifdef SYS_ioprio_set
+    const int IOPRIO_WHO_PROCESS = 1, IOPRIO_CLASS_BE = 2, IOPRIO_CLASS_SHIFT = 13;
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | 7);
+#endif
+#endif
+}
+
+int64_t rebuild_task::EstimateRebuiltSize(tkrzw::DBM* dbm)
+{
+    int64_t eff_data_size = -1, num_records = 0, record_base = 4096;
+    for (const auto& [name, value] : dbm->Inspect()) {
+        if (name == "eff_data_size") eff_data_size = tkrzw::StrToInt(value, -1);
+        if (name == "num_records") num_records = tkrzw::StrToInt(value, 0);
+        if (name == "record_base") record_base = tkrzw::StrToInt(value, record_base);
+    }
+    if (eff_data_size < 0 || dbm->GetFileSizeSimple() < 0) {
+        return -1;          //Not a file DBM
+    }
+    return record_base + eff_data_size + num_records * 16;
+}
+
+rebuild_task::rebuild_task(Napi::Env env, std::shared_ptr<tkrzw::ParamDBM> dbm, std::map<std::string, std::string> params,
+                           const options& opts, Napi::Promise::Deferred deferred, Napi::Function on_progress,
+                           Napi::Value cancel_options)
+    : dbm(std::move(dbm)), params(std::move(params)), opts(opts), context(new rebuild_context{deferred, {}, {}, {}, {}})
+{
+    context->cancel = cancel_binding::FromOptions(env, cancel_options, &context->cancel_js);
+    cancel = context->cancel;
+    if (!on_progress.IsEmpty()) {
+        context->on_progress = Napi::Persistent(on_progress);
+    }
+    context->tsfn = REBUILD_TSFN::New(env, "rebuild_task tsfn", 0, 1, context,
+                                      [](Napi::Env, void*, rebuild_context* ctx) { delete ctx; });
+}
+
+rebuild_task::rebuild_task(std::shared_ptr<tkrzw::ParamDBM> dbm, std::map<std::string, std::string> params,
+                           const options& opts)
+    : dbm(std::move(dbm)), params(std::move(params)), opts(opts)
+{}
+
+rebuild_task::~rebuild_task()
+{
+    Cancel();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void rebuild_task::Start()
+{
+    running.store(true);
+    thread = std::thread(&rebuild_task::Run, this);
+}
+
+void rebuild_task::Cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled.store(true);
+    }
+    cond.notify_all();
+}
+
+void rebuild_task::Report(const rebuild_progress& progress)
+{
+    if (context == nullptr) {
+        return;
+    }
+    auto* copy = new rebuild_progress(progress);
+    if (context->tsfn.BlockingCall(copy) != napi_ok) {
+        delete copy;        //The environment is shutting down
+    }
+}
+
+tkrzw::Status rebuild_task::RebuildUnit(tkrzw::ParamDBM* unit, int64_t unit_bytes, const rebuild_progress& before)
+{
+    //File DBMs rebuild into "<path>.tmp.rebuild", which ends up about as large as the live data
+    const std::string tmp_path = unit->GetFilePathSimple() + ".tmp.rebuild";
+    const int64_t estimate = EstimateRebuiltSize(unit);
+    const int64_t expected_size = estimate >= 0 ? std::min(unit_bytes, estimate) : unit_bytes;
+
+    bool unit_done = false;     //Guarded by `mutex`
+    std::thread monitor([&] {
+        LowerThreadPriority();
+        std::unique_lock<std::mutex> lock(mutex);
+        const auto interval = std::chrono::duration<double>(opts.progress_interval);
+        while (!cond.wait_for(lock, interval, [&] { return unit_done; }))
+        {
+            lock.unlock();
+            const int64_t tmp_size = tkrzw::GetFileSize(tmp_path);
+            if (tmp_size > 0 && expected_size > 0 && before.bytes_total > 0) {
+                const double ratio = std::min(0.99, static_cast<double>(tmp_size) / expected_size);
+                rebuild_progress progress = before;
+                progress.bytes_done += static_cast<int64_t>(unit_bytes * ratio);
+                progress.percent = 100.0 * progress.bytes_done / progress.bytes_total;
+                Report(progress);
+            }
+            lock.lock();
+        }
+    });
+    if (context == nullptr) {
+        return unit->RebuildAdvanced(params);     //Nobody to report progress to
+    }
+    tkrzw::Status status = unit->RebuildAdvanced(params);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        unit_done = true;
+    }
+    cond.notify_all();
+    monitor.join();
+    return status;
+}
+
+void rebuild_task::Run()
+{
+    LowerThreadPriority();
+    tkrzw::Status status = Rebuild();
+    rebuild_progress progress{true, 100, 0, 0, 0, 0, status};
+    running.store(false);
+    Report(progress);
+    context->tsfn.Release();
+}
+
+tkrzw::Status rebuild_task::Rebuild()
+{
+    std::vector<tkrzw::ParamDBM*> units;
+    if (auto* sharded = dynamic_cast<shard_dbm*>(dbm.get())) {
+        for (size_t i = 0; i < sharded->GetNumShards(); ++i) {
+            units.push_back(sharded->GetShard(i));
+        }
+    } else {
+        units.push_back(dbm.get());
+    }
+    std::vector<int64_t> unit_bytes;
+    rebuild_progress progress{false, 0, 0, 0, 0, static_cast<int32_t>(units.size()), tkrzw::Status(tkrzw::Status::SUCCESS)};
+    for (auto* unit : units) {
+        unit_bytes.push_back(std::max<int64_t>(unit->GetFileSizeSimple(), 0));
+        progress.bytes_total += unit_bytes.back();
+    }
+    Report(progress);
+
+    const auto start = std::chrono::steady_clock::now();
+    tkrzw::Status status(tkrzw::Status::SUCCESS);
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+        if (IsCancelled()) {
+            status = tkrzw::Status(tkrzw::Status::CANCELED_ERROR, "rebuild cancelled");
+            break;
+        }
+        status = RebuildUnit(units[i], unit_bytes[i], progress);
+        if (status != tkrzw::Status::SUCCESS) {
+            break;
+        }
+        progress.bytes_done += unit_bytes[i];
+        progress.shards_done++;
+        progress.percent = progress.bytes_total > 0 ? 100.0 * progress.bytes_done / progress.bytes_total
+                                                    : 100.0 * progress.shards_done / progress.num_shards;
+        Report(progress);
+
+        //Pace the next shard so that the average rate since the start stays under the limit
+        if (opts.throttle_bytes_per_sec > 0 && i + 1 < units.size()) {
+            const auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(progress.bytes_done) / opts.throttle_bytes_per_sec));
+            //Cancel() wakes the sleep; a signal or deadline is noticed within 100ms
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!IsCancelled() && std::chrono::steady_clock::now() < due) {
+                cond.wait_until(lock, std::min(due, std::chrono::steady_clock::now() + std::chrono::milliseconds(100)),
+                                [this] { return cancelled.load(); });
+            }
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,94 @@
+#include "../../include/utils/record_version.hpp"
+#include <tkrzw_hash_util.h>
+
+namespace
+{
+    constexpr uint64_t SEED = 0x7265636f72647631;      //"recordv1"
+
+    // Compares the version of the record and writes the new value only if it matches
+    class set_if_processor : public tkrzw::DBM::RecordProcessor
+    {
+        public:
+            set_if_processor(std::optional<uint64_t> expected, std::string_view value) : expected(expected), value(value) {}
+
+            std::string_view ProcessFull(std::string_view key, std::string_view current) override {
+                version = record_version::Of(current);
+                if (!expected || *expected != version) {
+                    return NOOP;
+                }
+                return Write();
+            }
+
+            std::string_view ProcessEmpty(std::string_view key) override {
+                if (expected) {
+                    return NOOP;
+                }
+                return Write();
+            }
+
+            bool written = false;
+            uint64_t version = 0;
+
+        private:
+            std::string_view Write() {
+                written = true;
+                version = record_version::Of(value);
+                return value;
+            }
+
+            std::optional<uint64_t> expected;
+            std::string_view value;
+    };
+}
+
+uint64_t record_version::Of(std::string_view value)
+{
+    return tkrzw::HashMurmur(value, SEED);
+}
+
+std::string record_version::ToString(uint64_t version)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int i = 15; i >= 0; --i, version >>= 4) {
+        text[i] = digits[version & 0xf];
+    }
+    return text;
+}
+
+bool record_version::Parse(const std::string& text, uint64_t* version)
+{
+    if (text.size() != 16) {
+        return false;
+    }
+    *version = 0;
+    for (char c : text)
+    {
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return false;
+        *version = (*version << 4) | digit;
+    }
+    return true;
+}
+
+tkrzw::Status record_version::Get(tkrzw::DBM* dbm, std::string_view key, std::string* value, uint64_t* version)
+{
+    tkrzw::Status status = dbm->Get(key, value);
+    if (status == tkrzw::Status::SUCCESS) {
+        *version = Of(*value);
+    }
+    return status;
+}
+
+tkrzw::Status record_version::SetIf(tkrzw::DBM* dbm, std::string_view key, std::optional<uint64_t> expected,
+                                    std::string_view value, bool* written, uint64_t* version)
+{
+    set_if_processor processor(expected, value);
+    tkrzw::Status status = dbm->Process(key, &processor, true);
+    *written = processor.written;
+    *version = processor.version;
+    return status;
+}
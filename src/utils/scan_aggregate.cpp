@@ -0,0 +1,237 @@
+#include "../../include/utils/scan_aggregate.hpp"
+#include "../../include/utils/shard_dbm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <map>
+#include <tkrzw_str_util.h>
+
+namespace
+{
+    struct partial
+    {
+        uint64_t records = 0;
+        uint64_t numbers = 0;
+        double sum = 0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+
+        void Add(double number) {
+            numbers++;
+            sum += number;
+            min = std::min(min, number);
+            max = std::max(max, number);
+        }
+
+        void Merge(const partial& other) {
+            records += other.records;
+            numbers += other.numbers;
+            sum += other.sum;
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+        }
+    };
+
+    using ranked = std::pair<double, std::string>;
+
+    // Keeps the `k` largest entries in a min-heap
+    void offer(std::vector<ranked>* top, size_t k, double number, std::string_view key)
+    {
+        auto later = std::greater<ranked>();
+        if (top->size() < k) {
+            top->emplace_back(number, std::string(key));
+            std::push_heap(top->begin(), top->end(), later);
+        } else if (k > 0 && number > top->front().first) {
+            std::pop_heap(top->begin(), top->end(), later);
+            top->back() = ranked(number, std::string(key));
+            std::push_heap(top->begin(), top->end(), later);
+        }
+    }
+
+    struct shard_scan
+    {
+        partial total;
+        std::map<std::string, partial> groups;
+        std::vector<ranked> top;
+        tkrzw::Status status;
+    };
+
+    // The number of a value per the query; false if it has none
+    bool parse_number(std::string_view value, const aggregate_query& query, double* number)
+    {
+        if (query.field >= 0)
+        {
+            size_t start = 0;
+            for (int i = 0; i < query.field; i++) {
+                size_t pos = query.delimiter.empty() ? std::string_view::npos : value.find(query.delimiter, start);
+                if (pos == std::string_view::npos) {
+                    return false;
+                }
+                start = pos + query.delimiter.size();
+            }
+            size_t end = query.delimiter.empty() ? std::string_view::npos : value.find(query.delimiter, start);
+            value = value.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        }
+        if (query.int64) {
+            if (value.size() != sizeof(int64_t)) {
+                return false;
+            }
+            *number = static_cast<double>(static_cast<int64_t>(tkrzw::StrToIntBigEndian(value)));
+            return true;
+        }
+        if (value.empty()) {
+            return false;
+        }
+        const std::string text(value);      //strtod() needs the terminator
+        char* end = nullptr;
+        *number = std::strtod(text.c_str(), &end);
+        return end == text.c_str() + text.size() && std::isfinite(*number);
+    }
+
+    // The first `depth` segments of the key, or the whole key if it has fewer
+    std::string_view group_of(std::string_view key, const aggregate_query& query)
+    {
+        size_t pos = 0;
+        for (int i = 0; i < query.group_depth; i++) {
+            pos = query.key_delimiter.empty() ? std::string_view::npos : key.find(query.key_delimiter, pos);
+            if (pos == std::string_view::npos) {
+                return key;
+            }
+            if (i + 1 < query.group_depth) {
+                pos += query.key_delimiter.size();
+            }
+        }
+        return key.substr(0, pos);
+    }
+
+    void scan_shard(tkrzw::DBM* dbm, const aggregate_query& query, const cancel_token* cancel, shard_scan* scan)
+    {
+        const bool ordered = dbm->IsOrdered();
+        const auto* poly = dynamic_cast<const tkrzw::PolyDBM*>(dbm);
+        const tkrzw::KeyComparator comp = ordered && poly != nullptr ? shard_dbm::KeyComparatorOf(poly) : tkrzw::LexicalKeyComparator;
+        const bool has_prefix = !query.prefix.empty();
+        //Only where the keys in range are contiguous can the scan start late and stop early
+        const bool ranged = ordered && (!has_prefix || comp == tkrzw::LexicalKeyComparator);
+
+        auto iter = dbm->MakeIterator();
+        tkrzw::Status s = ranged && has_prefix ? iter->Jump(query.prefix) :
+                          ranged && !query.from.empty() ? iter->Jump(query.from) : iter->First();
+        std::string key, value;
+        while (s == tkrzw::Status::SUCCESS)
+        {
+            if (cancel != nullptr && cancel->IsCancelled()) {
+                return;
+            }
+            s = iter->Get(&key, &value);
+            if (s != tkrzw::Status::SUCCESS) {
+                break;
+            }
+            bool in_range = true;
+            if (has_prefix) {
+                in_range = key.compare(0, query.prefix.size(), query.prefix) == 0;
+            } else {
+                in_range = (query.from.empty() || comp(key, query.from) >= 0) &&
+                           (query.to.empty() || comp(key, query.to) < 0);
+            }
+            if (!in_range) {
+                if (ranged) {
+                    break;          //Past the end: it was jumped to the start
+                }
+                s = iter->Next();
+                continue;
+            }
+            scan->total.records++;
+            partial* group = query.group_depth > 0 ? &scan->groups[std::string(group_of(key, query))] : nullptr;
+            if (group != nullptr) {
+                group->records++;
+            }
+            double number = 0;
+            if (query.op != aggregate_query::COUNT && parse_number(value, query, &number)) {
+                scan->total.Add(number);
+                if (group != nullptr) {
+                    group->Add(number);
+                } else if (query.op == aggregate_query::TOP_K) {
+                    offer(&scan->top, query.k, number, key);
+                }
+            }
+            s = iter->Next();
+        }
+        if (s != tkrzw::Status::NOT_FOUND_ERROR && s != tkrzw::Status::SUCCESS) {
+            scan->status = s;
+        }
+    }
+
+    // The aggregate of a total or a group; false if there is none (min/max of no number)
+    bool value_of(const partial& part, aggregate_query::OP_TYPE op, double* value)
+    {
+        switch (op)
+        {
+            case aggregate_query::COUNT:
+                *value = static_cast<double>(part.records);
+                return true;
+            case aggregate_query::MIN:
+                *value = part.min;
+                return part.numbers > 0;
+            case aggregate_query::MAX:
+                *value = part.max;
+                return part.numbers > 0;
+            default:
+                *value = part.sum;
+                return true;
+        }
+    }
+}
+
+tkrzw::Status aggregate_records(tkrzw::ParamDBM* dbm, const aggregate_query& query, aggregate_result* result,
+                                const cancel_token* cancel)
+{
+    //One scan per shard, in parallel, each with its own partial aggregate
+    auto* sharded = dynamic_cast<shard_dbm*>(dbm);
+    std::vector<shard_scan> scans(sharded != nullptr ? sharded->GetNumShards() : 1);
+    shard_dbm::ForEachShard(dbm, [&](tkrzw::DBM* shard, size_t index) {
+        scan_shard(shard, query, cancel, &scans[index]);
+        return tkrzw::Status(tkrzw::Status::SUCCESS);
+    });
+
+    partial total;
+    std::map<std::string, partial> groups;
+    std::vector<ranked> top;
+    for (shard_scan& scan : scans)
+    {
+        if (scan.status != tkrzw::Status::SUCCESS) {
+            return scan.status;
+        }
+        total.Merge(scan.total);
+        for (auto& [name, part] : scan.groups) {
+            groups[name].Merge(part);
+        }
+        for (ranked& entry : scan.top) {
+            offer(&top, query.k, entry.first, entry.second);
+        }
+    }
+
+    result->records = total.records;
+    result->skipped = query.op == aggregate_query::COUNT ? 0 : total.records - total.numbers;
+    if (query.op != aggregate_query::TOP_K) {
+        result->has_value = value_of(total, query.op, &result->value);
+        for (const auto& [name, part] : groups) {
+            double value = 0;
+            if (value_of(part, query.op, &value)) {
+                result->groups.emplace_back(name, value);
+            }
+        }
+    } else {
+        for (const auto& [name, part] : groups) {
+            if (part.numbers > 0) {
+                offer(&top, query.k, part.sum, name);
+            }
+        }
+        std::sort(top.begin(), top.end(), std::greater<ranked>());
+        for (ranked& entry : top) {
+            result->top.emplace_back(std::move(entry.second), entry.first);
+        }
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
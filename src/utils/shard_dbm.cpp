@@ -0,0 +1,776 @@
+#include "../../include/utils/shard_dbm.hpp"
+#include <algorithm>
+#include <thread>
+#include <tkrzw_dbm_baby.h>
+#include <tkrzw_dbm_common_impl.h>     // SecondaryHash, the routing function of tkrzw::ShardDBM
+#include <tkrzw_dbm_shard.h>
+#include <tkrzw_dbm_tree.h>
+#include <tkrzw_str_util.h>
+
+static const tkrzw::Status NOT_OPENED(tkrzw::Status::PRECONDITION_ERROR, "not opened database");
+
+static std::string shard_suffix(size_t index, size_t num_shards)
+{
+    return tkrzw::SPrintF("-%05d-of-%05d", static_cast<int32_t>(index), static_cast<int32_t>(num_shards));
+}
+
+shard_dbm::~shard_dbm()
+{
+    if (open) {
+        Close();
+    }
+}
+
+tkrzw::Status shard_dbm::OpenAdvanced(const std::string& path, bool writable, int32_t options,
+                                      const std::map<std::string, std::string>& params)
+{
+    if (open) {
+        return tkrzw::Status(tkrzw::Status::PRECONDITION_ERROR, "opened database");
+    }
+    int32_t num_shards = tkrzw::StrToInt(tkrzw::SearchMap(params, "num_shards", "0"));
+    if (num_shards < 1) {
+        tkrzw::Status status = tkrzw::ShardDBM::GetNumberOfShards(path, &num_shards);
+        if (status == tkrzw::Status::NOT_FOUND_ERROR) {
+            num_shards = 1;
+        } else if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+    }
+
+    //The update log is owned here rather than by every shard, so one log covers the whole database
+    std::map<std::string, std::string> shard_params;
+    std::map<std::string, std::string> ulog_params;
+    for (const auto& param : params) {
+        (tkrzw::StrBeginsWith(param.first, "ulog_") ? ulog_params : shard_params).emplace(param);
+    }
+    shard_params.erase("num_shards");
+
+    for (int32_t i = 0; i < num_shards; i++) {
+        auto shard = std::make_shared<tkrzw::PolyDBM>();
+        std::string shard_path = path.empty() ? "" : path + shard_suffix(i, num_shards);
+        tkrzw::Status status = shard->OpenAdvanced(shard_path, writable, options, shard_params);
+        if (status != tkrzw::Status::SUCCESS) {
+            for (auto it = dbms.rbegin(); it != dbms.rend(); ++it) {
+                (*it)->Close();
+            }
+            dbms.clear();
+            return status;
+        }
+        dbms.emplace_back(std::move(shard));
+    }
+
+    tkrzw::Status status(tkrzw::Status::SUCCESS);
+    std::string ulog_prefix = tkrzw::SearchMap(ulog_params, "ulog_prefix", "");
+    int64_t ulog_max_file_size = tkrzw::StrToIntMetric(tkrzw::SearchMap(ulog_params, "ulog_max_file_size", "1Gi"));
+    if (!ulog_prefix.empty() && ulog_max_file_size > 0) {
+        ulog_mq = std::make_unique<tkrzw::MessageQueue>();
+        status |= ulog_mq->Open(ulog_prefix, ulog_max_file_size);
+        ulog = std::make_unique<tkrzw::DBMUpdateLoggerMQ>(ulog_mq.get(),
+            tkrzw::StrToIntMetric(tkrzw::SearchMap(ulog_params, "ulog_server_id", "0")),
+            tkrzw::StrToIntMetric(tkrzw::SearchMap(ulog_params, "ulog_dbm_index", "0")));
+    }
+    for (const char* name : {"ulog_prefix", "ulog_max_file_size", "ulog_server_id", "ulog_dbm_index"}) {
+        ulog_params.erase(name);
+    }
+    if (!ulog_params.empty()) {
+        status |= tkrzw::Status(tkrzw::Status::INVALID_ARGUMENT_ERROR,
+                                "unsupported parameter: " + ulog_params.begin()->first);
+    }
+    if (status != tkrzw::Status::SUCCESS) {
+        ulog.reset();
+        ulog_mq.reset();
+        for (auto it = dbms.rbegin(); it != dbms.rend(); ++it) {
+            (*it)->Close();
+        }
+        dbms.clear();
+        return status;
+    }
+
+    open = true;
+    this->path = path;
+    if (ulog) {
+        SetUpdateLogger(ulog.get());
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+tkrzw::Status shard_dbm::Close()
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    tkrzw::Status status(tkrzw::Status::SUCCESS);
+    ulog.reset();
+    if (ulog_mq) {
+        status |= ulog_mq->Close();
+        ulog_mq.reset();
+    }
+    for (auto it = dbms.rbegin(); it != dbms.rend(); ++it) {
+        status |= (*it)->Close();
+    }
+    dbms.clear();
+    path.clear();
+    open = false;
+    return status;
+}
+
+tkrzw::Status shard_dbm::Process(std::string_view key, RecordProcessor* proc, bool writable)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    return dbms[tkrzw::SecondaryHash(key, dbms.size())]->Process(key, proc, writable);
+}
+
+tkrzw::Status shard_dbm::Get(std::string_view key, std::string* value)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    return dbms[tkrzw::SecondaryHash(key, dbms.size())]->Get(key, value);
+}
+
+tkrzw::Status shard_dbm::Set(std::string_view key, std::string_view value, bool overwrite, std::string* old_value)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    return dbms[tkrzw::SecondaryHash(key, dbms.size())]->Set(key, value, overwrite, old_value);
+}
+
+tkrzw::Status shard_dbm::Remove(std::string_view key, std::string* old_value)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    return dbms[tkrzw::SecondaryHash(key, dbms.size())]->Remove(key, old_value);
+}
+
+tkrzw::Status shard_dbm::Append(std::string_view key, std::string_view value, std::string_view delim)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    return dbms[tkrzw::SecondaryHash(key, dbms.size())]->Append(key, value, delim);
+}
+
+tkrzw::Status shard_dbm::ProcessFirst(RecordProcessor* proc, bool writable)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    Iterator iter(&dbms);
+    tkrzw::Status status = iter.First();
+    if (status != tkrzw::Status::SUCCESS) {
+        return status;
+    }
+    return iter.Process(proc, writable);
+}
+
+// Records of shard 0 are processed directly; every other record goes through a delegator
+// called from inside shard 0's ProcessMulti, so all the record locks are held together
+tkrzw::Status shard_dbm::ProcessMulti(const std::vector<std::pair<std::string_view, RecordProcessor*>>& key_proc_pairs,
+                                      bool writable)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    struct delegator : public RecordProcessor
+    {
+        delegator(tkrzw::Status* status, tkrzw::DBM* dbm, RecordProcessor* proc, bool writable)
+            : status(status), dbm(dbm), proc(proc), writable(writable) {}
+        tkrzw::Status* status;
+        tkrzw::DBM* dbm;
+        RecordProcessor* proc;
+        bool writable;
+        std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+            *status |= dbm->Process(key, proc, writable);
+            return NOOP;
+        }
+        std::string_view ProcessEmpty(std::string_view key) override {
+            *status |= dbm->Process(key, proc, writable);
+            return NOOP;
+        }
+    };
+    tkrzw::Status proc_status(tkrzw::Status::SUCCESS);
+    std::vector<delegator> delegators;
+    delegators.reserve(key_proc_pairs.size());      //Pointers to the elements are taken below
+    std::vector<std::pair<std::string_view, RecordProcessor*>> shard_pairs;
+    shard_pairs.reserve(key_proc_pairs.size());
+    for (const auto& key_proc : key_proc_pairs) {
+        size_t index = tkrzw::SecondaryHash(key_proc.first, dbms.size());
+        if (index == 0) {
+            shard_pairs.emplace_back(key_proc);
+        } else {
+            delegators.emplace_back(&proc_status, dbms[index].get(), key_proc.second, writable);
+            shard_pairs.emplace_back(key_proc.first, &delegators.back());
+        }
+    }
+    tkrzw::Status status = dbms[0]->ProcessMulti(shard_pairs, writable);
+    status |= proc_status;
+    return status;
+}
+
+// Each shard's ProcessMulti runs nested inside the previous shard's last processor, so the
+// records of every shard involved stay locked until all conditions have been checked
+tkrzw::Status shard_dbm::CompareExchangeMulti(const std::vector<std::pair<std::string_view, std::string_view>>& expected,
+                                              const std::vector<std::pair<std::string_view, std::string_view>>& desired)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    typedef std::vector<std::pair<std::string_view, std::string_view>> condition_list;
+    std::map<size_t, std::pair<condition_list, condition_list>> shard_conditions;
+    for (const auto& cond : expected) {
+        shard_conditions[tkrzw::SecondaryHash(cond.first, dbms.size())].first.emplace_back(cond);
+    }
+    for (const auto& cond : desired) {
+        shard_conditions[tkrzw::SecondaryHash(cond.first, dbms.size())].second.emplace_back(cond);
+    }
+    if (shard_conditions.empty()) {
+        return tkrzw::Status(tkrzw::Status::SUCCESS);
+    }
+
+    struct command
+    {
+        tkrzw::DBM* dbm;
+        std::vector<std::pair<std::string_view, RecordProcessor*>> params;
+    };
+    struct step : public RecordProcessor
+    {
+        step(tkrzw::Status* status, std::string_view data, command* next, bool checker)
+            : status(status), data(data), next(next), checker(checker) {}
+        tkrzw::Status* status;
+        std::string_view data;          //Expected value (checker) or desired value (setter)
+        command* next;
+        bool checker;
+        bool RunNext() {
+            if (next != nullptr) {
+                *status |= next->dbm->ProcessMulti(next->params, true);
+            }
+            return *status == tkrzw::Status::SUCCESS;
+        }
+        std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+            if (*status != tkrzw::Status::SUCCESS) {
+                return NOOP;
+            }
+            if (checker) {
+                if (data.data() == nullptr || (data.data() != ANY_DATA.data() && data != value)) {
+                    *status = tkrzw::Status(tkrzw::Status::INFEASIBLE_ERROR);
+                    return NOOP;
+                }
+                RunNext();
+                return NOOP;
+            }
+            if (!RunNext()) {
+                return NOOP;
+            }
+            return data.data() == nullptr ? REMOVE : data;
+        }
+        std::string_view ProcessEmpty(std::string_view key) override {
+            if (*status != tkrzw::Status::SUCCESS) {
+                return NOOP;
+            }
+            if (checker) {
+                if (data.data() != nullptr) {
+                    *status = tkrzw::Status(tkrzw::Status::INFEASIBLE_ERROR);
+                    return NOOP;
+                }
+                RunNext();
+                return NOOP;
+            }
+            if (!RunNext()) {
+                return NOOP;
+            }
+            return data.data() == nullptr ? NOOP : data;
+        }
+    };
+
+    tkrzw::Status proc_status(tkrzw::Status::SUCCESS);
+    std::vector<command> commands(shard_conditions.size());
+    std::vector<std::unique_ptr<step>> steps;
+    size_t command_index = 0;
+    for (const auto& [index, conditions] : shard_conditions) {
+        command& cmd = commands[command_index];
+        command* next = command_index + 1 < commands.size() ? &commands[command_index + 1] : nullptr;
+        const auto& [shard_expected, shard_desired] = conditions;
+        cmd.dbm = dbms[index].get();
+        //The next shard is entered from the last checker, or from the first setter if there is none
+        for (size_t i = 0; i < shard_expected.size(); i++) {
+            bool chain = i == shard_expected.size() - 1;
+            steps.emplace_back(std::make_unique<step>(&proc_status, shard_expected[i].second, chain ? next : nullptr, true));
+            cmd.params.emplace_back(shard_expected[i].first, steps.back().get());
+        }
+        for (size_t i = 0; i < shard_desired.size(); i++) {
+            bool chain = shard_expected.empty() && i == 0;
+            steps.emplace_back(std::make_unique<step>(&proc_status, shard_desired[i].second, chain ? next : nullptr, false));
+            cmd.params.emplace_back(shard_desired[i].first, steps.back().get());
+        }
+        command_index++;
+    }
+    tkrzw::Status status = commands[0].dbm->ProcessMulti(commands[0].params, true);
+    if (status != tkrzw::Status::SUCCESS) {
+        return status;
+    }
+    return proc_status;
+}
+
+// Sequential, like tkrzw::ShardDBM: a caller-supplied processor need not be thread-safe.
+// ProcessEmpty(NOOP) is called once before and once after the whole scan, as a single DBM does.
+tkrzw::Status shard_dbm::ProcessEach(RecordProcessor* proc, bool writable)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    full_only_processor proxy(proc);
+    proc->ProcessEmpty(RecordProcessor::NOOP);
+    for (auto& dbm : dbms) {
+        tkrzw::Status status = dbm->ProcessEach(&proxy, writable);
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+    }
+    proc->ProcessEmpty(RecordProcessor::NOOP);
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+tkrzw::Status shard_dbm::Count(int64_t* count)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    *count = 0;
+    for (auto& dbm : dbms) {
+        int64_t shard_count = 0;
+        tkrzw::Status status = dbm->Count(&shard_count);
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+        *count += shard_count;
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+tkrzw::Status shard_dbm::GetFileSize(int64_t* size)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    *size = 0;
+    for (auto& dbm : dbms) {
+        int64_t shard_size = 0;
+        tkrzw::Status status = dbm->GetFileSize(&shard_size);
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+        *size += shard_size;
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+tkrzw::Status shard_dbm::GetFilePath(std::string* path)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    *path = this->path;
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+// Oldest timestamp among the shards
+tkrzw::Status shard_dbm::GetTimestamp(double* timestamp)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    tkrzw::Status status(tkrzw::Status::SUCCESS);
+    double oldest = tkrzw::DOUBLEINF;
+    for (auto& dbm : dbms) {
+        double shard_timestamp = 0;
+        status |= dbm->GetTimestamp(&shard_timestamp);
+        if (status == tkrzw::Status::SUCCESS) {
+            oldest = std::min(oldest, shard_timestamp);
+        }
+    }
+    *timestamp = oldest;
+    return status;
+}
+
+tkrzw::Status shard_dbm::Clear()
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    tkrzw::Status status(tkrzw::Status::SUCCESS);
+    for (auto& dbm : dbms) {
+        status |= dbm->Clear();
+    }
+    return status;
+}
+
+tkrzw::Status shard_dbm::RebuildAdvanced(const std::map<std::string, std::string>& params)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    tkrzw::Status status(tkrzw::Status::SUCCESS);
+    for (auto& dbm : dbms) {
+        status |= dbm->RebuildAdvanced(params);
+    }
+    return status;
+}
+
+tkrzw::Status shard_dbm::ShouldBeRebuilt(bool* tobe)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    *tobe = false;
+    for (auto& dbm : dbms) {
+        bool shard_tobe = false;
+        tkrzw::Status status = dbm->ShouldBeRebuilt(&shard_tobe);
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+        *tobe = *tobe || shard_tobe;
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+tkrzw::Status shard_dbm::SynchronizeAdvanced(bool hard, FileProcessor* proc,
+                                             const std::map<std::string, std::string>& params)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    tkrzw::Status status(tkrzw::Status::SUCCESS);
+    for (auto& dbm : dbms) {
+        status |= dbm->SynchronizeAdvanced(hard, proc, params);
+    }
+    return status;
+}
+
+tkrzw::Status shard_dbm::CopyFileData(const std::string& dest_path, bool sync_hard)
+{
+    if (!open) {
+        return NOT_OPENED;
+    }
+    for (size_t i = 0; i < dbms.size(); i++) {
+        tkrzw::Status status = dbms[i]->CopyFileData(dest_path + shard_suffix(i, dbms.size()), sync_hard);
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+// Totals first, then every shard's own properties prefixed with its index ("00001-num_records")
+std::vector<std::pair<std::string, std::string>> shard_dbm::Inspect()
+{
+    std::vector<std::pair<std::string, std::string>> merged;
+    if (!open) {
+        return merged;
+    }
+    std::string class_name = "ShardDBM";
+    for (const auto& rec : dbms.front()->Inspect()) {
+        if (rec.first == "class") {
+            class_name = rec.second;
+        }
+    }
+    int64_t num_records = 0;
+    int64_t file_size = 0;
+    for (auto& dbm : dbms) {
+        num_records += dbm->CountSimple();
+        file_size += dbm->GetFileSizeSimple();
+    }
+    merged.emplace_back("class", class_name);
+    merged.emplace_back("healthy", tkrzw::ToString(IsHealthy()));
+    merged.emplace_back("num_records", tkrzw::ToString(num_records));
+    merged.emplace_back("file_size", tkrzw::ToString(file_size));
+    merged.emplace_back("path", path);
+    for (size_t i = 0; i < dbms.size(); i++) {
+        for (const auto& rec : dbms[i]->Inspect()) {
+            merged.emplace_back(tkrzw::SPrintF("%05d-%s", static_cast<int32_t>(i), rec.first.c_str()), rec.second);
+        }
+    }
+    return merged;
+}
+
+bool shard_dbm::IsWritable() const
+{
+    return open && dbms.front()->IsWritable();
+}
+
+bool shard_dbm::IsHealthy() const
+{
+    if (!open) {
+        return false;
+    }
+    for (const auto& dbm : dbms) {
+        if (!dbm->IsHealthy()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool shard_dbm::IsOrdered() const
+{
+    return open && dbms.front()->IsOrdered();
+}
+
+std::unique_ptr<tkrzw::DBM::Iterator> shard_dbm::MakeIterator()
+{
+    return std::make_unique<Iterator>(&dbms);
+}
+
+std::unique_ptr<tkrzw::DBM> shard_dbm::MakeDBM() const
+{
+    return std::make_unique<shard_dbm>();
+}
+
+tkrzw::DBM::UpdateLogger* shard_dbm::GetUpdateLogger() const
+{
+    return open ? dbms.front()->GetUpdateLogger() : nullptr;
+}
+
+void shard_dbm::SetUpdateLogger(UpdateLogger* update_logger)
+{
+    if (!open) {
+        return;
+    }
+    ulog_second.SetUpdateLogger(update_logger);
+    for (size_t i = 0; i < dbms.size(); i++) {
+        dbms[i]->SetUpdateLogger(i == 0 ? update_logger : &ulog_second);
+    }
+}
+
+tkrzw::Status shard_dbm::ForEachShard(tkrzw::DBM* dbm, const std::function<tkrzw::Status(tkrzw::DBM*, size_t)>& fn)
+{
+    auto* sharded = dynamic_cast<shard_dbm*>(dbm);
+    if (sharded == nullptr || !sharded->open) {
+        return fn(dbm, 0);
+    }
+    size_t num_shards = sharded->dbms.size();
+    std::vector<tkrzw::Status> statuses(num_shards);
+    std::vector<std::thread> threads;
+    threads.reserve(num_shards - 1);
+    for (size_t i = 1; i < num_shards; i++) {
+        threads.emplace_back([&, i]() { statuses[i] = fn(sharded->dbms[i].get(), i); });
+    }
+    statuses[0] = fn(sharded->dbms[0].get(), 0);       //The calling thread takes shard 0
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& status : statuses) {
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+// Ordered shards are merged with their own key comparator
+tkrzw::KeyComparator shard_dbm::KeyComparatorOf(const tkrzw::PolyDBM* dbm)
+{
+    const tkrzw::DBM* internal = dbm->GetInternalDBM();
+    if (internal != nullptr && internal->GetType() == typeid(tkrzw::TreeDBM)) {
+        return dynamic_cast<const tkrzw::TreeDBM*>(internal)->GetKeyComparator();
+    }
+    if (internal != nullptr && internal->GetType() == typeid(tkrzw::BabyDBM)) {
+        return dynamic_cast<const tkrzw::BabyDBM*>(internal)->GetKeyComparator();
+    }
+    return tkrzw::LexicalKeyComparator;
+}
+
+tkrzw::KeyComparator shard_dbm::GetKeyComparator() const
+{
+    return open ? KeyComparatorOf(dbms.front().get()) : tkrzw::LexicalKeyComparator;
+}
+
+shard_dbm::Iterator::Iterator(std::vector<std::shared_ptr<tkrzw::PolyDBM>>* dbms)
+    : slots(dbms->size()), comp(KeyComparatorOf(dbms->front().get()))
+{
+    for (size_t i = 0; i < dbms->size(); i++) {
+        slots[i].iter = (*dbms)[i]->MakeIterator();
+    }
+}
+
+shard_dbm::Iterator::~Iterator() = default;
+
+bool shard_dbm::Iterator::Later(const slot* lhs, const slot* rhs) const
+{
+    int32_t order = comp(lhs->key, rhs->key);
+    return asc ? order > 0 : order < 0;
+}
+
+tkrzw::Status shard_dbm::Iterator::Reset(const std::function<tkrzw::Status(tkrzw::DBM::Iterator*)>& position, bool asc)
+{
+    heap.clear();
+    this->asc = asc;
+    auto later = [this](const slot* lhs, const slot* rhs) { return Later(lhs, rhs); };
+    for (auto& s : slots) {
+        tkrzw::Status status = position(s.iter.get());
+        if (status == tkrzw::Status::SUCCESS) {
+            status = s.iter->Get(&s.key, &s.value);
+        }
+        if (status == tkrzw::Status::SUCCESS) {
+            heap.emplace_back(&s);
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else if (status != tkrzw::Status::NOT_FOUND_ERROR) {
+            heap.clear();
+            return status;
+        }
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+tkrzw::Status shard_dbm::Iterator::Advance(bool step)
+{
+    auto later = [this](const slot* lhs, const slot* rhs) { return Later(lhs, rhs); };
+    std::pop_heap(heap.begin(), heap.end(), later);
+    slot* s = heap.back();
+    tkrzw::Status status(tkrzw::Status::SUCCESS);
+    if (step) {
+        status = asc ? s->iter->Next() : s->iter->Previous();
+    }
+    if (status == tkrzw::Status::SUCCESS) {
+        status = s->iter->Get(&s->key, &s->value);
+    }
+    if (status == tkrzw::Status::SUCCESS) {
+        std::push_heap(heap.begin(), heap.end(), later);
+        return status;
+    }
+    heap.pop_back();        //This shard is exhausted
+    return status == tkrzw::Status::NOT_FOUND_ERROR ? tkrzw::Status(tkrzw::Status::SUCCESS) : status;
+}
+
+tkrzw::Status shard_dbm::Iterator::First()
+{
+    return Reset([](tkrzw::DBM::Iterator* iter) { return iter->First(); }, true);
+}
+
+tkrzw::Status shard_dbm::Iterator::Last()
+{
+    return Reset([](tkrzw::DBM::Iterator* iter) { return iter->Last(); }, false);
+}
+
+tkrzw::Status shard_dbm::Iterator::Jump(std::string_view key)
+{
+    return Reset([&](tkrzw::DBM::Iterator* iter) { return iter->Jump(key); }, true);
+}
+
+tkrzw::Status shard_dbm::Iterator::JumpLower(std::string_view key, bool inclusive)
+{
+    return Reset([&](tkrzw::DBM::Iterator* iter) { return iter->JumpLower(key, inclusive); }, false);
+}
+
+tkrzw::Status shard_dbm::Iterator::JumpUpper(std::string_view key, bool inclusive)
+{
+    return Reset([&](tkrzw::DBM::Iterator* iter) { return iter->JumpUpper(key, inclusive); }, true);
+}
+
+tkrzw::Status shard_dbm::Iterator::Next()
+{
+    if (heap.empty()) {
+        return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+    }
+    if (!asc) {
+        //Turning around: re-position every shard at the current key, ascending
+        std::string key = heap.front()->key;
+        tkrzw::Status status = Jump(key);
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+        if (heap.empty()) {
+            return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+        }
+    }
+    return Advance(true);
+}
+
+tkrzw::Status shard_dbm::Iterator::Previous()
+{
+    if (heap.empty()) {
+        return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+    }
+    if (asc) {
+        std::string key = heap.front()->key;
+        tkrzw::Status status = JumpLower(key, true);
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+        if (heap.empty()) {
+            return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+        }
+    }
+    return Advance(true);
+}
+
+tkrzw::Status shard_dbm::Iterator::Process(RecordProcessor* proc, bool writable)
+{
+    if (heap.empty()) {
+        return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+    }
+    //A removal moves the shard iterator to its next record, which must be re-read into the heap
+    class removal_checker final : public RecordProcessor
+    {
+        public:
+            explicit removal_checker(RecordProcessor* proc) : proc(proc) {}
+            std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+                std::string_view result = proc->ProcessFull(key, value);
+                removed = removed || result.data() == REMOVE.data();
+                return result;
+            }
+            std::string_view ProcessEmpty(std::string_view key) override {
+                return proc->ProcessEmpty(key);
+            }
+            bool removed = false;
+        private:
+            RecordProcessor* proc;
+    } checker(proc);
+    tkrzw::Status status = heap.front()->iter->Process(&checker, writable);
+    if (status == tkrzw::Status::SUCCESS && writable && checker.removed) {
+        Advance(false);
+    }
+    return status;
+}
+
+tkrzw::Status shard_dbm::Iterator::Get(std::string* key, std::string* value)
+{
+    if (heap.empty()) {
+        return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+    }
+    if (key != nullptr) {
+        *key = heap.front()->key;
+    }
+    if (value != nullptr) {
+        *value = heap.front()->value;
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+tkrzw::Status shard_dbm::Iterator::Set(std::string_view value, std::string* old_key, std::string* old_value)
+{
+    if (heap.empty()) {
+        return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+    }
+    slot* s = heap.front();
+    tkrzw::Status status = s->iter->Set(value, old_key, old_value);
+    if (status == tkrzw::Status::SUCCESS) {
+        s->value = value;
+    }
+    return status;
+}
+
+tkrzw::Status shard_dbm::Iterator::Remove(std::string* old_key, std::string* old_value)
+{
+    if (heap.empty()) {
+        return tkrzw::Status(tkrzw::Status::NOT_FOUND_ERROR);
+    }
+    tkrzw::Status status = heap.front()->iter->Remove(old_key, old_value);
+    if (status == tkrzw::Status::SUCCESS) {
+        Advance(false);
+    }
+    return status;
+}
@@ -0,0 +1,107 @@
+#include "../../include/utils/socket_client.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+socket_client::~socket_client()
+{
+    Close();
+}
+
+tkrzw::Status socket_client::Connect(const std::string& path, response_handler handler)
+{
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return tkrzw::Status(tkrzw::Status::INVALID_ARGUMENT_ERROR, "socket path is empty or too long");
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return tkrzw::Status(tkrzw::Status::SYSTEM_ERROR, std::strerror(errno));
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        tkrzw::Status status(tkrzw::Status::NETWORK_ERROR, std::string("cannot connect to ") + path + ": " + std::strerror(errno));
+        close(fd);
+        fd = -1;
+        return status;
+    }
+    this->handler = std::move(handler);
+    open.store(true);
+    writer = std::thread(&socket_client::Write, this);
+    reader = std::thread(&socket_client::Read, this);
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+bool socket_client::Send(const wire_message& request)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closing || !open.load()) {
+            return false;
+        }
+        wire_append(&outbound, request);
+    }
+    cond.notify_one();
+    return true;
+}
+
+void socket_client::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fd < 0 || closing) return;
+        closing = true;
+    }
+    cond.notify_one();
+    writer.join();
+    shutdown(fd, SHUT_RDWR);        //Ends the reader, which reports the connection as closed
+    reader.join();
+    close(fd);
+}
+
+void socket_client::Write()
+{
+    std::string batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cond.wait(lock, [this] { return !outbound.empty() || closing; });
+        if (outbound.empty()) break;        //Closing with nothing left to send
+        batch.swap(outbound);
+        lock.unlock();
+        size_t sent = 0;
+        while (sent < batch.size()) {
+            ssize_t written = send(fd, batch.data() + sent, batch.size() - sent, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) break;
+            sent += written;
+        }
+        batch.clear();      //On a send error the reader sees the connection end and fails what is pending
+        lock.lock();
+    }
+}
+
+void socket_client::Read()
+{
+    std::string in;
+    char buffer[65536];
+    std::vector<wire_message> responses;
+    while (true)
+    {
+        ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+        if (size < 0 && errno == EINTR) continue;
+        if (size <= 0) break;
+        in.append(buffer, size);
+        if (!wire_parse(&in, &responses)) break;
+        if (!responses.empty()) {
+            handler(&responses, false);
+            responses.clear();
+        }
+    }
+    open.store(false);
+    shutdown(fd, SHUT_RDWR);        //A failed read also ends the writer's sends
+    handler(&responses, true);
+}
@@ -0,0 +1,273 @@
+#include "../../include/utils/socket_server.hpp"
+#include "../../include/utils/key_search.hpp"
+#include <cerrno>
+#include <cstring>
+#include <regex>
+#include <set>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+socket_server::socket_server(std::shared_ptr<tkrzw::ParamDBM> dbm, const std::string& path)
+    : dbm(std::move(dbm)), path(path)
+{}
+
+socket_server::~socket_server()
+{
+    Stop();
+}
+
+tkrzw::Status socket_server::Start()
+{
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return tkrzw::Status(tkrzw::Status::INVALID_ARGUMENT_ERROR, "socket path is empty or too long");
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    //A socket file left by a crashed server would make bind() fail; a live one, or anything else, is not ours to remove
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        int probe_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool live = probe_fd >= 0 && connect(probe_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        if (probe_fd >= 0) {
+            close(probe_fd);
+        }
+        if (live) {
+            return tkrzw::Status(tkrzw::Status::DUPLICATION_ERROR, "address in use: " + path);
+        }
+        unlink(path.c_str());
+    }
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        return tkrzw::Status(tkrzw::Status::SYSTEM_ERROR, std::strerror(errno));
+    }
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd, SOMAXCONN) != 0 ||
+        lstat(path.c_str(), &st) != 0) {
+        tkrzw::Status status(tkrzw::Status::SYSTEM_ERROR, std::strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return status;
+    }
+    bound_dev = st.st_dev;
+    bound_ino = st.st_ino;
+    accept_thread = std::thread(&socket_server::Accept, this);
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+void socket_server::Stop()
+{
+    if (stopping.exchange(true) || listen_fd < 0) {
+        return;
+    }
+    shutdown(listen_fd, SHUT_RDWR);     //Wakes the blocked accept()
+    accept_thread.join();
+    close(listen_fd);
+    listen_fd = -1;
+    //Another server may have replaced the file since: only the one bound here is removed
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && st.st_dev == bound_dev && st.st_ino == bound_ino) {
+        unlink(path.c_str());
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& conn : connections) {
+            shutdown(conn.fd, SHUT_RDWR);       //Wakes the blocked recv(); the fd is closed by Reap()
+        }
+    }
+    Reap(true);
+}
+
+// Joins finished connection threads (all of them if `all`) and closes their sockets
+void socket_server::Reap(bool all)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = connections.begin(); it != connections.end();)
+    {
+        if (all || it->done.load()) {
+            it->thread.join();
+            close(it->fd);
+            it = connections.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void socket_server::Accept()
+{
+    while (!stopping.load())
+    {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;      //Listening socket shut down by Stop()
+        }
+        Reap(false);
+        std::lock_guard<std::mutex> lock(mutex);
+        connection& conn = connections.emplace_back();
+        conn.fd = fd;
+        conn.thread = std::thread(&socket_server::Serve, this, &conn);
+    }
+}
+
+void socket_server::Serve(connection* conn)
+{
+    active_connections.fetch_add(1);
+    std::string in;
+    std::string out;
+    std::vector<wire_message> requests;
+    char buffer[65536];
+    while (true)
+    {
+        ssize_t size = recv(conn->fd, buffer, sizeof(buffer), 0);
+        if (size < 0 && errno == EINTR) continue;
+        if (size <= 0) break;
+        in.append(buffer, size);
+        requests.clear();
+        if (!wire_parse(&in, &requests)) break;     //Malformed frame: drop the connection
+
+        for (const auto& request : requests) {
+            wire_message response;
+            response.id = request.id;
+            Execute(request, &response);
+            wire_append(&out, response);
+        }
+        request_count.fetch_add(requests.size());
+
+        size_t sent = 0;
+        while (sent < out.size()) {
+            ssize_t written = send(conn->fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) break;
+            sent += written;
+        }
+        if (sent < out.size()) break;
+        out.clear();
+    }
+    active_connections.fetch_sub(1);
+    conn->done.store(true);
+}
+
+// Error messages match the ones of the local polyDBM methods
+void socket_server::Execute(const wire_message& request, wire_message* response)
+{
+    const auto& f = request.fields;
+    auto fail = [&](const std::string& message) {
+        response->code = WIRE_ERROR;
+        response->fields.assign(1, message);
+    };
+    auto check = [&](const tkrzw::Status& status, const char* message) {
+        if (status != tkrzw::Status::SUCCESS) fail(message);
+        return status == tkrzw::Status::SUCCESS;
+    };
+    auto view = [](const std::string& s) -> std::string_view {
+        return s == tkrzw::DBM::ANY_DATA ? tkrzw::DBM::ANY_DATA : std::string_view(s);
+    };
+    static const size_t arity[WIRE_OPCODE_COUNT] = {0, 2, 2, 3, 1, 3, 3, 1, 4, 0, 0, 0, 0, 0, 1, 0, 3};
+
+    response->code = WIRE_OK;
+    if (request.code >= WIRE_OPCODE_COUNT || f.size() < arity[request.code]) {
+        fail("Invalid request");
+        return;
+    }
+    switch (request.code)
+    {
+        case WIRE_PING:
+            break;
+        case WIRE_GET:
+            response->fields.push_back(dbm->GetSimple(f[0], f[1]));
+            break;
+        case WIRE_SET:
+            check(dbm->Set(f[0], f[1]), "DBM Set failed");
+            break;
+        case WIRE_APPEND:
+            check(dbm->Append(f[0], f[1], f[2]), "DBM Append failed");
+            break;
+        case WIRE_REMOVE:
+            check(dbm->Remove(f[0]), "DBM Remove failed");
+            break;
+        case WIRE_COMPARE_EXCHANGE:
+            check(dbm->CompareExchange(f[0], view(f[1]), view(f[2])), "DBM CompareExchange failed");
+            break;
+        case WIRE_INCREMENT: {
+            int64_t current = 0;
+            if (check(dbm->Increment(f[0], wire_to_int64(f[1]), &current, wire_to_int64(f[2])), "DBM Increment failed")) {
+                response->fields.push_back(wire_int64(current));
+            }
+            break;
+        }
+        case WIRE_COMPARE_EXCHANGE_MULTI: {
+            size_t num_expected = wire_to_int64(f[0]);
+            if (f.size() % 2 != 1 || num_expected > (f.size() - 1) / 2) {
+                fail("Invalid request");
+                break;
+            }
+            std::vector<std::pair<std::string_view, std::string_view>> expected, desired;
+            for (size_t i = 1; i < f.size(); i += 2) {
+                (i / 2 < num_expected ? expected : desired).emplace_back(f[i], view(f[i + 1]));
+            }
+            check(dbm->CompareExchangeMulti(expected, desired), "DBM CompareExchangeMulti failed");
+            break;
+        }
+        case WIRE_REKEY:
+            check(dbm->Rekey(f[0], f[1], f[2] == "1", f[3] == "1"), "DBM Rekey failed");
+            break;
+        case WIRE_COUNT: {
+            int64_t count = 0;
+            if (check(dbm->Count(&count), "DBM Count failed")) {
+                response->fields.push_back(wire_int64(count));
+            }
+            break;
+        }
+        case WIRE_GET_FILE_SIZE: {
+            int64_t size = 0;
+            if (check(dbm->GetFileSize(&size), "DBM GetFileSize failed")) {
+                response->fields.push_back(wire_int64(size));
+            }
+            break;
+        }
+        case WIRE_GET_FILE_PATH: {
+            std::string file_path;
+            if (check(dbm->GetFilePath(&file_path), "DBM GetFilePath failed")) {
+                response->fields.push_back(file_path);
+            }
+            break;
+        }
+        case WIRE_GET_TIMESTAMP: {
+            double timestamp = 0;
+            if (check(dbm->GetTimestamp(&timestamp), "DBM GetTimestamp failed")) {
+                response->fields.push_back(wire_double(timestamp));
+            }
+            break;
+        }
+        case WIRE_CLEAR:
+            check(dbm->Clear(), "DBM Clear failed");
+            break;
+        case WIRE_SYNC:
+            check(dbm->Synchronize(f[0] == "1"), "DBM Sync failed");
+            break;
+        case WIRE_INSPECT:
+            for (auto& [name, value] : dbm->Inspect()) {
+                response->fields.push_back(std::move(name));
+                response->fields.push_back(std::move(value));
+            }
+            break;
+        case WIRE_SEARCH: {
+            static const std::set<std::string> supported_modes{"contain", "begin", "end", "regex", "edit", "token", "tokenprefix"};
+            if (supported_modes.find(f[0]) == supported_modes.end()) {
+                fail("Search failed: unknown search mode");
+                break;
+            }
+            try {
+                search_keys(dbm.get(), f[0], f[1], static_cast<size_t>(wire_to_int64(f[2])), &response->fields);
+            } catch (const std::regex_error& e) {
+                fail(e.what());
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#include "../../include/utils/ulog_feed.hpp"
+
+ulog_feed::ulog_feed(const std::string& prefix, int64_t min_timestamp, size_t batch_size, double wait_time,
+                     batch_handler handler)
+    : reader(prefix, min_timestamp), batch_size(batch_size), wait_time(wait_time), handler(std::move(handler))
+{}
+
+ulog_feed::~ulog_feed()
+{
+    Close();
+}
+
+void ulog_feed::Request()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requested++;
+        if (!thread.joinable()) {
+            thread = std::thread(&ulog_feed::Run, this);
+        }
+    }
+    cond.notify_one();
+}
+
+void ulog_feed::Cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    cond.notify_one();
+    reader.Cancel();            //Wakes a read waiting for records
+}
+
+void ulog_feed::Close()
+{
+    Cancel();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void ulog_feed::Run()
+{
+    std::vector<ulog_change> changes;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cond.wait(lock, [this] { return requested > 0 || cancelled; });
+        if (requested == 0) {
+            break;              //Cancelled with every request answered
+        }
+        lock.unlock();
+        //Once cancelled the reader fails at once, so the requests left are answered without waiting
+        tkrzw::Status status = reader.ReadBatch(batch_size, wait_time, &changes);
+        handler(&changes, status);
+        lock.lock();
+        requested--;
+    }
+}
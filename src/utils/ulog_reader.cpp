@@ -0,0 +1,192 @@
+#include "../../include/utils/ulog_reader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <tkrzw_file_util.h>
+
+// Layout constants of tkrzw_message_queue.cc (not exported by the header)
+static constexpr int64_t MQ_METADATA_SIZE = 32;
+static constexpr int64_t MQ_RECORD_HEADER_SIZE = 11;
+
+// How often a drained reader looks for new records while waiting
+static constexpr double POLL_INTERVAL = 0.005;
+
+ulog_reader::ulog_reader(const std::string& prefix, int64_t min_timestamp)
+    : prefix(prefix), min_timestamp(min_timestamp)
+{}
+
+std::string ulog_reader::MakeFilePath(int64_t id) const
+{
+    char numbuf[32];
+    std::snprintf(numbuf, sizeof(numbuf), ".%010lld", static_cast<long long>(id));
+    return prefix + numbuf;
+}
+
+tkrzw::Status ulog_reader::ReadBatch(size_t max_records, double wait_time, std::vector<ulog_change>* changes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    changes->clear();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(wait_time);
+
+    while (true)
+    {
+        if (canceled.load()) {
+            return tkrzw::Status(tkrzw::Status::CANCELED_ERROR, "change feed closed");
+        }
+        tkrzw::Status s = ReadAvailable(max_records, changes);
+        if (s != tkrzw::Status::SUCCESS) {
+            return s;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (!changes->empty() || now >= deadline) {
+            return tkrzw::Status(tkrzw::Status::SUCCESS);
+        }
+        std::unique_lock<std::mutex> wait_lock(wait_mutex);
+        wake.wait_for(wait_lock, std::min<std::chrono::duration<double>>(
+            std::chrono::duration<double>(POLL_INTERVAL), deadline - now), [this] { return canceled.load(); });
+    }
+}
+
+void ulog_reader::Cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        canceled.store(true);
+    }
+    wake.notify_all();
+}
+
+tkrzw::Status ulog_reader::ReadAvailable(size_t max_records, std::vector<ulog_change>* changes)
+{
+    std::vector<std::string> paths;
+    tkrzw::Status s = tkrzw::MessageQueue::FindFiles(prefix, &paths);
+    if (s != tkrzw::Status::SUCCESS) {
+        return s;
+    }
+    if (paths.empty()) {
+        return tkrzw::Status(tkrzw::Status::SUCCESS);       // Nothing has been logged yet
+    }
+    const int64_t last_id = tkrzw::MessageQueue::GetFileID(paths.back());
+
+    if (file_id < 0)
+    {
+        // Start from the oldest file whose newest record is not older than min_timestamp.
+        // The metadata of the newest file is only refreshed on sync, so it is always a candidate.
+        for (const auto& path : paths)
+        {
+            int64_t id = 0, timestamp = 0, size = 0;
+            if (tkrzw::MessageQueue::ReadFileMetadata(path, &id, &timestamp, &size) != tkrzw::Status::SUCCESS) {
+                continue;
+            }
+            if (timestamp >= min_timestamp || id == last_id) {
+                file_id = id;
+                file_offset = 0;
+                break;
+            }
+        }
+        if (file_id < 0) {
+            return tkrzw::Status(tkrzw::Status::SUCCESS);
+        }
+    }
+
+    std::string message;
+    while (changes->size() < max_records)
+    {
+        // A newer file exists only once the writer has rotated, so every file but the newest is sealed
+        const bool newest = file_id >= last_id;
+        const std::string path = MakeFilePath(file_id);
+        const int64_t file_size = tkrzw::GetFileSize(path);
+        if (file_size < 0 || std::max(file_offset, MQ_METADATA_SIZE) + MQ_RECORD_HEADER_SIZE > file_size)
+        {
+            if (newest) break;
+            file_id++;                      // Drained, or already removed by RemoveOldFiles
+            file_offset = 0;
+            continue;
+        }
+
+        tkrzw::PositionalParallelFile file;
+        s = file.Open(path, false, tkrzw::File::OPEN_NO_LOCK);
+        if (s != tkrzw::Status::SUCCESS) {
+            return s;
+        }
+        const int64_t readable_size = file.GetSizeSimple();
+        bool exhausted = false;
+        while (changes->size() < max_records)
+        {
+            int64_t offset = file_offset;
+            int64_t timestamp = 0;
+            if (std::max(offset, MQ_METADATA_SIZE) + MQ_RECORD_HEADER_SIZE > readable_size) {
+                exhausted = true;
+                break;
+            }
+            s = tkrzw::MessageQueue::ReadNextMessage(&file, &offset, &timestamp, &message, min_timestamp);
+            if (s != tkrzw::Status::SUCCESS)
+            {
+                // The newest file may end in a record that is still being written: retry on the next poll.
+                // A sealed file may end in a zero-filled region (CANCELED_ERROR).
+                if (newest || s == tkrzw::Status::CANCELED_ERROR) {
+                    exhausted = true;
+                    break;
+                }
+                file.Close();
+                return s;
+            }
+            file_offset = offset;
+            if (timestamp < min_timestamp) continue;
+
+            tkrzw::DBMUpdateLoggerMQ::UpdateLog op;
+            if (tkrzw::DBMUpdateLoggerMQ::ParseUpdateLog(message, &op) != tkrzw::Status::SUCCESS) continue;
+            changes->push_back(ulog_change{op.op_type, op.server_id, op.dbm_index, timestamp,
+                                           std::string(op.key), std::string(op.value)});
+            last_timestamp.store(timestamp);
+        }
+        file.Close();
+
+        if (exhausted)
+        {
+            if (newest) break;
+            file_id++;
+            file_offset = 0;
+        }
+    }
+    cursor_file_id.store(file_id);
+    cursor_file_offset.store(file_offset);
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
+
+int64_t ulog_reader::GetPendingBytes()
+{
+    std::vector<std::string> paths;
+    if (tkrzw::MessageQueue::FindFiles(prefix, &paths) != tkrzw::Status::SUCCESS) {
+        return -1;
+    }
+    const int64_t current_id = cursor_file_id.load();
+    const int64_t current_offset = std::max(cursor_file_offset.load(), MQ_METADATA_SIZE);
+    int64_t pending = 0;
+    for (const auto& path : paths)
+    {
+        const int64_t id = tkrzw::MessageQueue::GetFileID(path);
+        const int64_t size = tkrzw::GetFileSize(path);
+        if (size < 0 || id < current_id) continue;
+        if (id == current_id) {
+            pending += std::max<int64_t>(0, size - current_offset);
+        } else {
+            pending += std::max<int64_t>(0, size - MQ_METADATA_SIZE);
+        }
+    }
+    return pending;
+}
+
+int64_t ulog_reader::GetLatestTimestamp()
+{
+    std::vector<std::string> paths;
+    int64_t latest = last_timestamp.load();
+    if (tkrzw::MessageQueue::FindFiles(prefix, &paths) != tkrzw::Status::SUCCESS || paths.empty()) {
+        return latest;
+    }
+    int64_t id = 0, timestamp = 0, size = 0;
+    if (tkrzw::MessageQueue::ReadFileMetadata(paths.back(), &id, &timestamp, &size) == tkrzw::Status::SUCCESS) {
+        latest = std::max(latest, timestamp);
+    }
+    return latest;
+}
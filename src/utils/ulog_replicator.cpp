@@ -0,0 +1,125 @@
+#include "../../include/utils/ulog_replicator.hpp"
+#include <algorithm>
+#include <tkrzw_dbm_ulog.h>
+
+// First wait after a failed read; it doubles on every further failure, up to `wait_time`
+static constexpr double MIN_RETRY_WAIT = 0.01;
+
+ulog_replicator::ulog_replicator(tkrzw::DBM* dbm, const std::string& prefix, const options& opts)
+    : dbm(dbm), reader(prefix, opts.from_timestamp), opts(opts)
+{}
+
+ulog_replicator::~ulog_replicator()
+{
+    Stop();
+}
+
+void ulog_replicator::Start()
+{
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        stopping = false;
+    }
+    running.store(true);
+    thread = std::thread(&ulog_replicator::Run, this);
+}
+
+void ulog_replicator::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    reader.Cancel();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+// Same filter rule as DBMUpdateLoggerMQ::ApplyUpdateLog
+static bool filter_matches(int32_t filter, int32_t value)
+{
+    return filter < 0 ? value != -filter : value == filter;
+}
+
+tkrzw::Status ulog_replicator::Apply(const ulog_change& change)
+{
+    tkrzw::DBMUpdateLoggerMQ::OverwriteThreadServerID(change.server_id);
+    switch (change.op_type)
+    {
+        case tkrzw::DBMUpdateLoggerMQ::OP_SET:
+            return dbm->Set(change.key, change.value);
+        case tkrzw::DBMUpdateLoggerMQ::OP_REMOVE: {
+            tkrzw::Status s = dbm->Remove(change.key);
+            return s == tkrzw::Status::NOT_FOUND_ERROR ? tkrzw::Status(tkrzw::Status::SUCCESS) : s;
+        }
+        case tkrzw::DBMUpdateLoggerMQ::OP_CLEAR:
+            return dbm->Clear();
+        default:
+            return tkrzw::Status(tkrzw::Status::SUCCESS);
+    }
+}
+
+void ulog_replicator::Run()
+{
+    std::vector<ulog_change> changes;
+    double retry_wait = MIN_RETRY_WAIT;
+    while (true)
+    {
+        tkrzw::Status s = reader.ReadBatch(opts.batch_size, opts.wait_time, &changes);
+        if (s == tkrzw::Status::CANCELED_ERROR) {
+            break;
+        }
+        if (s != tkrzw::Status::SUCCESS)
+        {
+            //Reading is retried, after a backoff: log files may be rotated or removed under us,
+            //and a missing directory fails at once
+            std::unique_lock<std::mutex> lock(error_mutex);
+            last_error = "read failed: " + tkrzw::ToString(s);
+            if (wake.wait_for(lock, std::chrono::duration<double>(retry_wait), [this] { return stopping; })) {
+                break;
+            }
+            retry_wait = std::min(retry_wait * 2, std::max(opts.wait_time, MIN_RETRY_WAIT));
+            continue;
+        }
+        retry_wait = MIN_RETRY_WAIT;
+        for (const auto& change : changes)
+        {
+            if (filter_matches(opts.server_id, change.server_id) && filter_matches(opts.dbm_index, change.dbm_index))
+            {
+                s = Apply(change);
+                if (s != tkrzw::Status::SUCCESS)
+                {
+                    //Skipping a record would silently diverge from the master, so stop instead
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    last_error = "apply failed: " + tkrzw::ToString(s);
+                    running.store(false);
+                    return;
+                }
+                applied_count.fetch_add(1);
+            }
+            applied_timestamp.store(change.timestamp);
+        }
+    }
+    running.store(false);
+}
+
+ulog_replicator::status ulog_replicator::GetStatus()
+{
+    status st;
+    st.running = running.load();
+    st.applied_count = applied_count.load();
+    st.applied_timestamp = applied_timestamp.load();
+    st.lag_bytes = reader.GetPendingBytes();
+    if (st.lag_bytes == 0) {
+        st.lag_time = 0;
+    } else {
+        st.lag_time = std::max<int64_t>(0, reader.GetLatestTimestamp() - std::max<int64_t>(st.applied_timestamp, 0));
+    }
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        st.last_error = last_error;
+    }
+    return st;
+}
@@ -0,0 +1,102 @@
+#include "../../include/utils/wire_protocol.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+static void put_u32(std::string* out, uint32_t value)
+{
+    out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static uint32_t get_u32(const char* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+void wire_append(std::string* out, const wire_message& message)
+{
+    size_t body_size = sizeof(uint32_t) + 1;
+    for (const auto& field : message.fields) {
+        body_size += sizeof(uint32_t) + field.size();
+    }
+    out->reserve(out->size() + sizeof(uint32_t) + body_size);
+    put_u32(out, static_cast<uint32_t>(body_size));
+    put_u32(out, message.id);
+    out->push_back(static_cast<char>(message.code));
+    for (const auto& field : message.fields) {
+        put_u32(out, static_cast<uint32_t>(field.size()));
+        out->append(field);
+    }
+}
+
+bool wire_parse(std::string* in, std::vector<wire_message>* messages)
+{
+    size_t offset = 0;
+    bool valid = true;
+    while (in->size() - offset >= sizeof(uint32_t))
+    {
+        const char* frame = in->data() + offset;
+        uint32_t body_size = get_u32(frame);
+        if (body_size < sizeof(uint32_t) + 1 || body_size > WIRE_MAX_FRAME_SIZE) {
+            valid = false;
+            break;
+        }
+        if (in->size() - offset - sizeof(uint32_t) < body_size) {
+            break;      //Partial frame: wait for more bytes
+        }
+        const char* body = frame + sizeof(uint32_t);
+        const char* end = body + body_size;
+        wire_message message;
+        message.id = get_u32(body);
+        message.code = static_cast<uint8_t>(body[sizeof(uint32_t)]);
+        const char* cursor = body + sizeof(uint32_t) + 1;
+        while (valid && cursor < end)
+        {
+            if (end - cursor < static_cast<ptrdiff_t>(sizeof(uint32_t))) {
+                valid = false;
+                break;
+            }
+            uint32_t field_size = get_u32(cursor);
+            cursor += sizeof(uint32_t);
+            if (static_cast<size_t>(end - cursor) < field_size) {
+                valid = false;
+                break;
+            }
+            message.fields.emplace_back(cursor, field_size);
+            cursor += field_size;
+        }
+        if (!valid) {
+            break;
+        }
+        messages->push_back(std::move(message));
+        offset += sizeof(uint32_t) + body_size;
+    }
+    in->erase(0, offset);
+    return valid;
+}
+
+std::string wire_int64(int64_t value)
+{
+    return std::string(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+int64_t wire_to_int64(const std::string& field)
+{
+    int64_t value = 0;
+    std::memcpy(&value, field.data(), std::min(field.size(), sizeof(value)));
+    return value;
+}
+
+std::string wire_double(double value)
+{
+    return std::string(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+double wire_to_double(const std::string& field)
+{
+    double value = 0;
+    std::memcpy(&value, field.data(), std::min(field.size(), sizeof(value)));
+    return value;
+}
@@ -0,0 +1,142 @@
+#include "../../include/utils/write_batch.hpp"
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <tkrzw_str_util.h>
+
+// Applies the operations of one key, in order, to its record
+class write_batch::key_processor : public tkrzw::DBM::RecordProcessor
+{
+    public:
+        std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+            current = std::string(value);
+            return Apply(true);
+        }
+
+        std::string_view ProcessEmpty(std::string_view key) override {
+            return Apply(false);
+        }
+
+        std::vector<const op*> ops;
+
+    private:
+        std::string_view Apply(bool existed) {
+            for (const op* o : ops)
+            {
+                switch (o->type)
+                {
+                    case write_batch::SET:
+                        current = o->value;
+                        break;
+                    case write_batch::REMOVE:
+                        current.reset();
+                        break;
+                    case write_batch::APPEND:
+                        current = current ? *current + o->delimiter + o->value : o->value;
+                        break;
+                    case write_batch::INCREMENT:
+                        current = tkrzw::IntToStrBigEndian(
+                            (current ? tkrzw::StrToIntBigEndian(*current) : o->initial) + o->delta);
+                        break;
+                }
+            }
+            if (!current) {
+                return existed ? RecordProcessor::REMOVE : NOOP;      //Not the batch's REMOVE
+            }
+            return *current;
+        }
+
+        std::optional<std::string> current;
+};
+
+void write_batch::Set(std::string key, std::string value)
+{
+    bytes += key.size() + value.size();
+    ops.push_back(op{SET, std::move(key), std::move(value), std::string(), 0, 0});
+}
+
+void write_batch::Remove(std::string key)
+{
+    bytes += key.size();
+    ops.push_back(op{REMOVE, std::move(key), std::string(), std::string(), 0, 0});
+}
+
+void write_batch::Append(std::string key, std::string value, std::string delimiter)
+{
+    bytes += key.size() + value.size() + delimiter.size();
+    ops.push_back(op{APPEND, std::move(key), std::move(value), std::move(delimiter), 0, 0});
+}
+
+void write_batch::Increment(std::string key, int64_t delta, int64_t initial)
+{
+    bytes += key.size();
+    ops.push_back(op{INCREMENT, std::move(key), std::string(), std::string(), delta, initial});
+}
+
+std::vector<std::string_view> write_batch::Keys() const
+{
+    std::vector<std::string_view> keys;
+    keys.reserve(ops.size());
+    for (const op& o : ops) {
+        keys.emplace_back(o.key);
+    }
+    return keys;
+}
+
+tkrzw::Status write_batch::Apply(tkrzw::DBM* dbm, bool atomic) const
+{
+    if (ops.empty()) {
+        return tkrzw::Status(tkrzw::Status::SUCCESS);
+    }
+    return atomic ? ApplyAtomic(dbm) : ApplyEach(dbm);
+}
+
+tkrzw::Status write_batch::ApplyAtomic(tkrzw::DBM* dbm) const
+{
+    //One processor per distinct key: a record is visited once by ProcessMulti however often the batch touches it
+    std::vector<std::unique_ptr<key_processor>> processors;
+    std::unordered_map<std::string_view, key_processor*> by_key;
+    std::vector<std::pair<std::string_view, tkrzw::DBM::RecordProcessor*>> key_proc_pairs;
+    for (const op& o : ops)
+    {
+        auto [it, added] = by_key.try_emplace(o.key, nullptr);
+        if (added) {
+            processors.push_back(std::make_unique<key_processor>());
+            it->second = processors.back().get();
+            key_proc_pairs.emplace_back(o.key, it->second);
+        }
+        it->second->ops.push_back(&o);
+    }
+    return dbm->ProcessMulti(key_proc_pairs, true);
+}
+
+tkrzw::Status write_batch::ApplyEach(tkrzw::DBM* dbm) const
+{
+    for (const op& o : ops)
+    {
+        tkrzw::Status status(tkrzw::Status::SUCCESS);
+        int64_t current = 0;
+        switch (o.type)
+        {
+            case SET:
+                status = dbm->Set(o.key, o.value);
+                break;
+            case REMOVE:
+                status = dbm->Remove(o.key);
+                if (status == tkrzw::Status::NOT_FOUND_ERROR) {
+                    status.Set(tkrzw::Status::SUCCESS);
+                }
+                break;
+            case APPEND:
+                status = dbm->Append(o.key, o.value, o.delimiter);
+                break;
+            case INCREMENT:
+                status = dbm->Increment(o.key, o.delta, &current, o.initial);
+                break;
+        }
+        if (status != tkrzw::Status::SUCCESS) {
+            return status;
+        }
+    }
+    return tkrzw::Status(tkrzw::Status::SUCCESS);
+}
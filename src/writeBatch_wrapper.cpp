@@ -0,0 +1,109 @@
+#include "../include/writeBatch_wrapper.hpp"
+#include "../include/polyDBM_wrapper.hpp"
+#include "../include/utils/addon_data.hpp"
+
+// Constructor: new writeBatch(db)
+writeBatch_wrapper::writeBatch_wrapper(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<writeBatch_wrapper>(info) {
+    Napi::Env env = info.Env();
+    addon_data* data = env.GetInstanceData<addon_data>();
+    if (info.Length() < 1 || !info[0].IsObject() ||
+        (!info[0].As<Napi::Object>().InstanceOf(data->polyDBM_constructor.Value()) &&
+         !info[0].As<Napi::Object>().InstanceOf(data->polyShardDBM_constructor.Value()))) {
+        Napi::TypeError::New(env, "Invalid arguments for writeBatch").ThrowAsJavaScriptException();
+        return;
+    }
+    owner = Napi::Persistent(info[0].As<Napi::Object>());
+}
+
+Napi::Value writeBatch_wrapper::set(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for set").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    ops->Set(info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value());
+    return info.This();
+}
+
+Napi::Value writeBatch_wrapper::remove(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for remove").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    ops->Remove(info[0].As<Napi::String>().Utf8Value());
+    return info.This();
+}
+
+Napi::Value writeBatch_wrapper::append(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+        Napi::TypeError::New(env, "Invalid arguments for append").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string delimiter = info.Length() > 2 && info[2].IsString() ? info[2].As<Napi::String>().Utf8Value() : "";
+    ops->Append(info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value(), delimiter);
+    return info.This();
+}
+
+Napi::Value writeBatch_wrapper::increment(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString() ||
+        (info.Length() > 1 && !info[1].IsNumber()) || (info.Length() > 2 && !info[2].IsNumber())) {
+        Napi::TypeError::New(env, "Invalid arguments for increment").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    int64_t inc = info.Length() > 1 ? info[1].As<Napi::Number>().Int64Value() : 1;
+    int64_t init = info.Length() > 2 ? info[2].As<Napi::Number>().Int64Value() : 0;
+    ops->Increment(info[0].As<Napi::String>().Utf8Value(), inc, init);
+    return info.This();
+}
+
+// Number of operations added since the last commit() or clear()
+Napi::Value writeBatch_wrapper::size(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(), static_cast<double>(ops->Size()));
+}
+
+Napi::Value writeBatch_wrapper::clear(const Napi::CallbackInfo& info) {
+    ops = std::make_shared<write_batch>();
+    return info.This();
+}
+
+// commit({atomic, signal, deadlineMs}): applies the operations in one worker; `atomic: false` skips record locking
+Napi::Value writeBatch_wrapper::commit(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() > 0 && !info[0].IsObject() && !info[0].IsUndefined()) {
+        Napi::TypeError::New(env, "Invalid arguments for commit").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    bool atomic = true;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object opts = info[0].As<Napi::Object>();
+        if (opts.Has("atomic") && opts.Get("atomic").IsBoolean()) {
+            atomic = opts.Get("atomic").As<Napi::Boolean>();
+        }
+    }
+    //The worker takes the buffer; later calls fill a new one
+    std::shared_ptr<const write_batch> committed = std::move(ops);
+    ops = std::make_shared<write_batch>();
+    return polyDBM_wrapper::Unwrap(owner.Value())->commitBatch(committed, atomic, info);
+}
+
+Napi::Object writeBatch_wrapper::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function functionList = DefineClass(env, "writeBatch",
+    {
+        InstanceMethod<&writeBatch_wrapper::set>("set", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&writeBatch_wrapper::remove>("remove", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&writeBatch_wrapper::append>("append", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&writeBatch_wrapper::increment>("increment", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&writeBatch_wrapper::size>("size", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&writeBatch_wrapper::clear>("clear", static_cast<napi_property_attributes>(napi_writable | napi_configurable)),
+        InstanceMethod<&writeBatch_wrapper::commit>("commit", static_cast<napi_property_attributes>(napi_writable | napi_configurable))
+    });
+
+    env.GetInstanceData<addon_data>()->writeBatch_constructor = Napi::Persistent(functionList);
+
+    exports.Set("writeBatch", functionList);
+    return exports;
+}
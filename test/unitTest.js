@@ -1,4 +1,4 @@
-import {polyDBM, polyIndex} from 'tkrzw-node';
+import {polyDBM, polyShardDBM, polyIndex, changeFeed, polyDBMClient} from 'tkrzw-node';
 import fs from 'fs';
 import {expect} from 'chai';
 import {afterEach, beforeEach, describe, it} from 'mocha';
@@ -792,4 +792,1346 @@ describe('Tkrzw Node.js Bindings - Search Features', function() {
 			expect(err.message).to.include('Invalid arguments');
 		}
 	});
-});
\ No newline at end of file
+});
+
+describe('Tkrzw Node.js Bindings - Change Feed', function() {
+	this.timeout(10000);
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		db = new polyDBM(config, dbPath);
+		await db.clear();
+	});
+
+	after(() => {
+		db.close();
+	});
+
+	it('should deliver writes made after the feed was opened', async () => {
+		const feed = db.changes({ batchSize: 10, waitMs: 2000 });
+		await db.set('feed:1', 'one');
+		await db.remove('feed:1');
+
+		const seen = [];
+		while (seen.length < 2) {
+			const { value, done } = await feed.next();
+			expect(done).to.be.false;
+			seen.push(...value);
+		}
+		expect(seen[0]).to.include({ op: 'set', key: 'feed:1', value: 'one' });
+		expect(seen[1]).to.include({ op: 'remove', key: 'feed:1' });
+		expect(feed.getTimestamp()).to.equal(seen[1].timestamp);
+		feed.close();
+	});
+
+	it('should yield an empty batch when nothing is logged within waitMs', async () => {
+		const feed = db.changes({ waitMs: 50 });
+		const { value, done } = await feed.next();
+		expect(done).to.be.false;
+		expect(value).to.be.an('array').that.is.empty;
+		feed.close();
+	});
+
+	it('should end a for-await loop on break and after close', async () => {
+		const startedAt = Date.now();
+		await db.set('feed:2', 'two');
+		const feed = new changeFeed(config.ulog_prefix, { fromTimestamp: startedAt - 1000, waitMs: 100 });
+		for await (const batch of feed) {
+			if (batch.some(change => change.key === 'feed:2')) break;
+		}
+		const { done } = await feed.next();
+		expect(done).to.be.true;
+	});
+
+	it('should not hold pool threads while waiting', async () => {
+		const feeds = Array.from({ length: 8 }, () => db.changes({ waitMs: 5000 }));
+		const waiting = feeds.map(feed => feed.next());
+		const startedAt = Date.now();
+		await db.set('feed:3', 'three');
+		expect(await db.getSimple('feed:3', '')).to.equal('three');
+		expect(Date.now() - startedAt).to.be.below(1000);
+		feeds.forEach(feed => feed.close());
+		for (const { value, done } of await Promise.all(waiting)) {
+			expect(done || value.some(change => change.key === 'feed:3')).to.be.true;
+		}
+	});
+
+	it('should throw when the database has no update log', () => {
+		const { ulog_prefix, ...plainConfig } = config;
+		const plainDb = new polyDBM(plainConfig, 'db/changefeed_plain.tkh');
+		try {
+			expect(() => plainDb.changes()).to.throw('ulog_prefix');
+		} finally {
+			plainDb.close();
+		}
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Replication', function() {
+	this.timeout(10000);
+	const replicaPath = 'db/replica_test.tkh';
+	let replica;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		db = new polyDBM(config, dbPath);
+		await db.clear();
+		replica = new polyDBM({ dbm: 'HashDBM' }, replicaPath);
+		await replica.clear();
+	});
+
+	after(() => {
+		replica.close();
+		db.close();
+	});
+
+	const waitFor = async (predicate) => {
+		for (let i = 0; i < 200 && !(await predicate()); i++) {
+			await new Promise(resolve => setTimeout(resolve, 20));
+		}
+	};
+
+	it('should apply the master update log to the replica', async () => {
+		const startedAt = Date.now();
+		await db.set('rep:1', 'one');
+		await db.set('rep:2', 'two');
+		await db.remove('rep:1');
+
+		expect(replica.replicationStatus()).to.be.null;
+		expect(replica.replicate(config.ulog_prefix, { serverId: Number(config.ulog_server_id), fromTimestamp: startedAt - 1000, intervalMs: 10 })).to.be.true;
+		await waitFor(async () => (await replica.get('rep:2', '')) === 'two');
+
+		expect(await replica.get('rep:2', '')).to.equal('two');
+		expect(await replica.get('rep:1', 'missing')).to.equal('missing');
+	});
+
+	it('should report lag and progress', async () => {
+		await db.set('rep:3', 'three');
+		await waitFor(async () => (await replica.get('rep:3', '')) === 'three');
+		await waitFor(() => replica.replicationStatus().lagBytes === 0);
+
+		const status = replica.replicationStatus();
+		expect(status.running).to.be.true;
+		expect(status.masterUlogPrefix).to.equal(config.ulog_prefix);
+		expect(status.appliedCount).to.be.at.least(4);
+		expect(status.lagBytes).to.equal(0);
+		expect(status.lagMs).to.equal(0);
+		expect(status.lastError).to.be.null;
+	});
+
+	it('should reject a second replicate() and stop on request', () => {
+		expect(() => replica.replicate(config.ulog_prefix)).to.throw('already running');
+		expect(replica.stopReplication()).to.be.true;
+		expect(replica.replicationStatus().running).to.be.false;
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Durability Modes', function() {
+	this.timeout(10000);
+
+	it('should resolve concurrent writes after a group commit', async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		const groupDb = new polyDBM({ ...config, durability: 'group', group_commit_window_ms: '5' }, 'db/group_commit_test.tkh');
+		try {
+			await groupDb.clear();
+			const results = await Promise.all(Array.from({ length: 50 }, (_, i) => groupDb.set(`group:${i}`, `v${i}`)));
+			expect(results.every(r => r === true)).to.be.true;
+			expect(await groupDb.increment('group:counter', 2, 0)).to.equal(2);
+			expect(await groupDb.get('group:49', '')).to.equal('v49');
+			expect(await groupDb.count()).to.equal(51);
+		} finally {
+			groupDb.close();
+		}
+	});
+
+	it('should not hold calls that wrote nothing for the group commit', async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		const groupDb = new polyDBM({ ...config, durability: 'group', group_commit_window_ms: '500' }, 'db/group_readonly_test.tkh');
+		try {
+			await groupDb.clear();
+			await groupDb.set('group:key', 'value');
+			const start = Date.now();
+			expect(await groupDb.setIfVersion('group:key', '0000000000000000', 'stale')).to.be.null;
+			await groupDb.processEach(() => null, false);
+			expect(await groupDb.pipeline([{ op: 'get', key: 'group:key' }])).to.deep.equal(['value']);
+			expect(Date.now() - start).to.be.below(400);
+		} finally {
+			groupDb.close();
+		}
+	});
+
+	it('should accept periodic and none modes', async () => {
+		for (const durability of ['periodic', 'none']) {
+			const modeDb = new polyDBM({ dbm: 'HashDBM', durability, durability_interval_ms: '50' }, `db/durability_${durability}.tkh`);
+			await modeDb.set('k', durability);
+			expect(await modeDb.get('k', '')).to.equal(durability);
+			modeDb.close();
+		}
+	});
+
+	it('should reject an unknown durability mode', () => {
+		expect(() => new polyDBM({ dbm: 'HashDBM', durability: 'sometimes' }, 'db/durability_bad.tkh')).to.throw('unknown durability mode');
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Sharded Database', function() {
+	this.timeout(10000);
+	let shardDb;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		const { ulog_prefix, ...shardConfig } = config;
+		shardDb = new polyShardDBM({ ...shardConfig, num_shards: '4' }, 'db/sharded_test.tkh');
+		await shardDb.clear();
+	});
+
+	after(() => {
+		shardDb.close();
+	});
+
+	it('should spread records over the shard files', async () => {
+		await Promise.all(Array.from({ length: 100 }, (_, i) => shardDb.set(`shard:${i}`, `v${i}`)));
+		expect(await shardDb.count()).to.equal(100);
+		expect(await shardDb.get('shard:42', '')).to.equal('v42');
+		expect(fs.existsSync('db/sharded_test.tkh-00003-of-00004')).to.be.true;
+		const info = await shardDb.inspect();
+		expect(info.num_records).to.equal('100');
+	});
+
+	it('should iterate over all shards', async () => {
+		shardDb.makeIterator();
+		await shardDb.iteratorFirst();
+		const keys = new Set();
+		while (true) {
+			try {
+				const { key } = await shardDb.iteratorGet();
+				keys.add(key);
+				await shardDb.iteratorNext();
+			} catch (err) {
+				break;
+			}
+		}
+		shardDb.freeIterator();
+		expect(keys.size).to.equal(100);
+	});
+
+	it('should run multi-key operations across shards', async () => {
+		await shardDb.compareExchangeMulti(
+			[{ key: 'shard:1', value: 'v1' }, { key: 'shard:2', value: 'v2' }],
+			[{ key: 'shard:1', value: 'x1' }, { key: 'shard:2', value: 'x2' }]);
+		expect(await shardDb.get('shard:1', '')).to.equal('x1');
+		expect(await shardDb.get('shard:2', '')).to.equal('x2');
+		const matches = await shardDb.search('begin', 'shard:9', 100);
+		expect(matches).to.have.members(['shard:9', ...Array.from({ length: 10 }, (_, i) => `shard:9${i}`)]);
+	});
+
+	it('should process every shard in parallel', async () => {
+		let seen = 0;
+		let boundaries = 0;
+		await shardDb.processEach((exists, key, value) => {
+			if (!exists) {
+				boundaries++;
+				return polyDBM.NOOP;
+			}
+			seen++;
+			return key.endsWith('0') ? `${value}!` : polyDBM.NOOP;
+		}, true);
+		expect(seen).to.equal(100);
+		expect(boundaries).to.equal(2);
+		expect(await shardDb.get('shard:50', '')).to.equal('v50!');
+		expect(await shardDb.get('shard:51', '')).to.equal('v51');
+	});
+
+	it('should merge and cap search results across shards', async () => {
+		expect(await shardDb.search('contain', ':', 10)).to.have.lengthOf(10);
+		expect(await shardDb.search('end', '0', 100)).to.have.lengthOf(10);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Shared Handles', function() {
+	this.timeout(10000);
+	const sharedPath = 'db/shared_handle_test.tkh';
+	let first;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		first = new polyDBM(config, sharedPath);
+		await first.clear();
+	});
+
+	after(() => {
+		first.close();
+	});
+
+	it('should attach a second instance to the open database', async () => {
+		const second = new polyDBM(config, './db/../db/shared_handle_test.tkh');
+		await second.set('shared:1', 'one');
+		expect(await first.count()).to.equal(1);
+		expect(await second.close()).to.be.true;
+		expect(second.isOpen()).to.be.false;
+		expect(first.isOpen()).to.be.true;
+		expect(await first.get('shared:1', '')).to.equal('one');
+	});
+
+	it('should refuse to attach a polyShardDBM to an open polyDBM', () => {
+		expect(() => new polyShardDBM(config, sharedPath)).to.throw('already open as a polyDBM');
+	});
+
+	it('should share the database with worker threads', async () => {
+		const { Worker } = await import('node:worker_threads');
+		const worker = new Worker(`
+			const { polyDBM } = require('tkrzw-node');
+			const { parentPort, workerData } = require('node:worker_threads');
+			(async () => {
+				const db = new polyDBM(workerData.config, workerData.path);
+				for (let i = 0; i < 10; i++) {
+					await db.set('worker:' + i, String(i));
+				}
+				await db.close();
+				parentPort.postMessage('done');
+			})();
+		`, { eval: true, workerData: { config, path: sharedPath } });
+		await new Promise((resolve, reject) => {
+			worker.once('message', resolve);
+			worker.once('error', reject);
+		});
+		await worker.terminate();
+		expect(await first.count()).to.equal(11);
+		expect(await first.get('worker:7', '')).to.equal('7');
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Socket Server', function() {
+	this.timeout(10000);
+	const socketPath = 'db/socket_server_test.sock';
+	let served;
+	let client;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		served = new polyDBM(config, 'db/socket_server_test.tkh');
+		await served.clear();
+		expect(served.serve(socketPath)).to.be.true;
+		client = new polyDBMClient(socketPath);
+	});
+
+	after(() => {
+		client.close();
+		served.close();
+	});
+
+	it('should refuse to serve twice', () => {
+		expect(() => served.serve(socketPath)).to.throw('Already serving');
+	});
+
+	it('should not take over a socket another server listens on', async () => {
+		const other = new polyDBM(config, 'db/socket_server_other.tkh');
+		expect(() => other.serve(socketPath)).to.throw('address in use');
+		await other.close();
+		expect(fs.existsSync(socketPath)).to.be.true;
+		expect(await client.ping()).to.be.true;
+	});
+
+	it('should answer pipelined requests', async () => {
+		const results = await Promise.all(Array.from({ length: 100 }, (_, i) => client.set(`remote:${i}`, String(i))));
+		expect(results.every(r => r === true)).to.be.true;
+		expect(await client.count()).to.equal(100);
+		expect(await served.get('remote:42', '')).to.equal('42');
+		expect(await client.get('remote:7')).to.equal('7');
+		expect(await client.get('missing', 'none')).to.equal('none');
+	});
+
+	it('should support atomic operations and search', async () => {
+		expect(await client.increment('remote:counter', 5, 10)).to.equal(15);
+		expect(await client.compareExchange('remote:1', '1', 'one')).to.be.true;
+		expect(await client.compareExchangeMulti([{ key: 'remote:2', value: '2' }], [{ key: 'remote:2', value: 'two' }])).to.be.true;
+		expect(await served.get('remote:2', '')).to.equal('two');
+		const keys = await client.search('begin', 'remote:9', 100);
+		expect(keys).to.include.members(['remote:9', 'remote:99']);
+		expect((await client.inspect()).class).to.be.a('string');
+	});
+
+	it('should reject failed requests with the polyDBM error', async () => {
+		try {
+			await client.compareExchange('remote:3', 'wrong', 'x');
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.message).to.equal('DBM CompareExchange failed');
+		}
+	});
+
+	it('should reject requests after close', async () => {
+		const other = new polyDBMClient(socketPath);
+		expect(await other.ping()).to.be.true;
+		other.close();
+		expect(other.isOpen()).to.be.false;
+		try {
+			await other.ping();
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.message).to.equal('Connection closed');
+		}
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Background Rebuild', function() {
+	this.timeout(20000);
+	let shardDb;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		shardDb = new polyShardDBM({ ...config, num_shards: '4' }, 'db/rebuild_test.tkh');
+		await shardDb.clear();
+		await Promise.all(Array.from({ length: 2000 }, (_, i) => shardDb.set(`rebuild:${i}`, 'x'.repeat(100))));
+		await Promise.all(Array.from({ length: 1000 }, (_, i) => shardDb.remove(`rebuild:${i * 2}`)));
+	});
+
+	after(() => {
+		shardDb.close();
+	});
+
+	it('should report progress shard by shard', async () => {
+		const reports = [];
+		expect(await shardDb.rebuild({}, { onProgress: p => reports.push(p) })).to.be.true;
+		const last = reports[reports.length - 1];
+		expect(last.percent).to.equal(100);
+		expect(last.shardsDone).to.equal(4);
+		expect(last.numShards).to.equal(4);
+		expect(await shardDb.count()).to.equal(1000);
+	});
+
+	it('should keep serving writes while rebuilding', async () => {
+		const rebuilding = shardDb.rebuild();
+		await shardDb.set('rebuild:during', 'yes');
+		await rebuilding;
+		expect(await shardDb.get('rebuild:during', '')).to.equal('yes');
+	});
+
+	it('should refuse a second concurrent rebuild', async () => {
+		const first = shardDb.rebuild({}, { throttleBytesPerSec: 1024 * 1024 });
+		try {
+			await shardDb.rebuild();
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.message).to.equal('A rebuild is already running');
+		}
+		await first;
+	});
+
+	it('should cancel between shards', async () => {
+		//A low throttle holds the rebuild between shards long enough to cancel it
+		const rebuilding = shardDb.rebuild({}, { throttleBytesPerSec: 1 });
+		await new Promise(resolve => setTimeout(resolve, 100));
+		expect(shardDb.cancelRebuild()).to.be.true;
+		try {
+			await rebuilding;
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.message).to.equal('Rebuild cancelled');
+		}
+		expect(shardDb.cancelRebuild()).to.be.false;
+		expect(await shardDb.count()).to.equal(1001);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Maintenance Scheduler', function() {
+	this.timeout(10000);
+	let maintDb;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		maintDb = new polyDBM(config, 'db/maintenance_test.tkh');
+		await maintDb.clear();
+	});
+
+	after(() => {
+		maintDb.close();
+	});
+
+	it('should reject an invalid schedule', () => {
+		expect(() => maintDb.startMaintenance({ schedule: ['2am'] })).to.throw('Invalid schedule window');
+		expect(maintDb.maintenanceStatus()).to.be.null;
+	});
+
+	it('should rebuild and sync a fragmented database once it is idle', async () => {
+		await Promise.all(Array.from({ length: 5000 }, (_, i) => maintDb.set(`maint:${i}`, 'x'.repeat(200))));
+		await Promise.all(Array.from({ length: 4000 }, (_, i) => maintDb.remove(`maint:${i}`)));
+		expect(maintDb.startMaintenance({ checkIntervalMs: 50, idleMs: 200, minRebuildBytes: 0 })).to.be.true;
+		expect(() => maintDb.startMaintenance()).to.throw('already running');
+
+		let status = maintDb.maintenanceStatus();
+		for (let i = 0; i < 100 && status.rebuild.count === 0; i++) {
+			await new Promise(resolve => setTimeout(resolve, 50));
+			status = maintDb.maintenanceStatus();
+		}
+		expect(status.running).to.be.true;
+		expect(status.rebuild.count).to.be.at.least(1);
+		expect(status.rebuild.lastRun).to.be.a('number');
+		expect(status.rebuild.lastError).to.be.null;
+		expect(status.sync.count).to.be.at.least(1);
+		expect(await maintDb.count()).to.equal(1000);
+
+		expect(maintDb.stopMaintenance()).to.be.true;
+		expect(maintDb.maintenanceStatus()).to.be.null;
+		expect(maintDb.stopMaintenance()).to.be.false;
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Operation Stats', function() {
+	this.timeout(10000);
+	let statsDb;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		statsDb = new polyDBM(config, 'db/stats_test.tkh');
+		await statsDb.clear();
+		statsDb.stats(true);
+	});
+
+	after(() => {
+		statsDb.close();
+	});
+
+	it('should count operations with latency percentiles', async () => {
+		await Promise.all(Array.from({ length: 100 }, (_, i) => statsDb.set(`stats:${i}`, 'value')));
+		for (let i = 0; i < 10; i++) {
+			expect(await statsDb.get(`stats:${i}`)).to.equal('value');
+		}
+		const stats = statsDb.stats();
+		expect(stats.inFlight).to.equal(0);
+		expect(stats.totalOps).to.equal(110);
+		expect(stats.opsPerSec).to.be.above(0);
+
+		const set = stats.operations.set;
+		expect(set.count).to.equal(100);
+		expect(set.errors).to.equal(0);
+		expect(set.bytesIn).to.equal(100 * 'value'.length + 10 * 'stats:0'.length + 90 * 'stats:10'.length);
+		for (const latency of [set.queueWait, set.execute]) {
+			expect(latency.p50).to.be.at.least(0);
+			expect(latency.p99).to.be.at.least(latency.p50);
+			expect(latency.p999).to.be.at.least(latency.p99);
+			expect(latency.max).to.be.at.least(latency.p999 * 0.9);
+		}
+		expect(stats.operations.getSimple.count).to.equal(10);
+		expect(stats.operations.getSimple.bytesOut).to.equal(10 * 'value'.length);
+		expect(stats.operations.remove).to.be.undefined;
+	});
+
+	it('should count failed operations as errors', async () => {
+		try {
+			await statsDb.compareExchange('stats:0', 'wrong', 'new');
+		} catch (e) {
+			// expected
+		}
+		const op = statsDb.stats().operations.compareExchange;
+		expect(op.count).to.equal(1);
+		expect(op.errors).to.equal(1);
+	});
+
+	it('should track in-flight operations and reset', async () => {
+		const pending = Promise.all(Array.from({ length: 50 }, (_, i) => statsDb.set(`flight:${i}`, 'x')));
+		expect(statsDb.stats().inFlight).to.be.above(0);
+		await pending;
+
+		const before = statsDb.stats(true);
+		expect(before.operations.set.count).to.equal(150);
+		const after = statsDb.stats();
+		expect(after.totalOps).to.equal(0);
+		expect(after.operations).to.deep.equal({});
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Tracing', function() {
+	this.timeout(10000);
+	let traceDb;
+	const tracePath = 'db/trace_test.json';
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		traceDb = new polyDBM(config, 'db/trace_test.tkh');
+		await traceDb.clear();
+	});
+
+	after(() => {
+		traceDb.close();
+		if (fs.existsSync(tracePath)) fs.unlinkSync(tracePath);
+	});
+
+	it('should write the spans as Chrome trace-event JSON', async () => {
+		expect(() => traceDb.writeTrace(tracePath)).to.throw('startTrace');
+		expect(traceDb.startTrace({ maxSpans: 10, slowMs: -1 })).to.be.true;
+		expect(() => traceDb.startTrace()).to.throw('already running');
+		await Promise.all(Array.from({ length: 20 }, (_, i) => traceDb.set(`trace:${i}`, 'value')));
+		expect(traceDb.stopTrace()).to.be.true;
+		await traceDb.set('untraced', 'value');
+
+		expect(traceDb.writeTrace(tracePath)).to.equal(10);
+		const trace = JSON.parse(fs.readFileSync(tracePath, 'utf8'));
+		expect(trace.otherData.droppedSpans).to.equal(10);
+		const executes = trace.traceEvents.filter(e => e.cat === 'execute');
+		expect(executes).to.have.lengthOf(10);
+		expect(executes[0].name).to.equal('set');
+		expect(executes[0].dur).to.be.at.least(0);
+		expect(trace.traceEvents.filter(e => e.cat === 'resolve')).to.have.lengthOf(10);
+		expect(traceDb.slowOps()).to.be.empty;
+	});
+
+	it('should log slow operations with their phases', async () => {
+		traceDb.startTrace({ slowMs: 0 });
+		await traceDb.set('slow:key', 'value');
+		try {
+			await traceDb.compareExchange('slow:key', 'wrong', 'new');
+		} catch (e) {
+			// expected
+		}
+		traceDb.stopTrace();
+
+		const slow = traceDb.slowOps(true);
+		expect(slow).to.have.lengthOf(2);
+		expect(slow[0].op).to.equal('set');
+		expect(slow[0].keyBytes).to.equal('slow:key'.length);
+		expect(slow[0].error).to.be.false;
+		expect(slow[1].op).to.equal('compareExchange');
+		expect(slow[1].error).to.be.true;
+		for (const op of slow) {
+			expect(op.totalUs).to.be.at.least(op.executeUs);
+			expect(op.startTime).to.be.closeTo(Date.now(), 10000);
+		}
+		expect(traceDb.slowOps()).to.be.empty;
+	});
+
+	it('should record no key for operations that are not key-level', async () => {
+		traceDb.startTrace({ slowMs: 0 });
+		await traceDb.search('begin', 'slow:', 10);
+		traceDb.stopTrace();
+
+		const slow = traceDb.slowOps(true);
+		expect(slow).to.have.lengthOf(1);
+		expect(slow[0].op).to.equal('search');
+		expect(slow[0].keyBytes).to.equal(0);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Traffic Capture', function() {
+	this.timeout(10000);
+	let captureDb;
+	const capturePath = 'db/capture_test.trace';
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		captureDb = new polyDBM(config, 'db/capture_test.tkh');
+		await captureDb.clear();
+	});
+
+	after(() => {
+		captureDb.close();
+		if (fs.existsSync(capturePath)) fs.unlinkSync(capturePath);
+	});
+
+	it('should write a binary trace of the operations', async () => {
+		expect(captureDb.stopCapture()).to.be.null;
+		expect(captureDb.startCapture(capturePath)).to.be.true;
+		expect(() => captureDb.startCapture(capturePath)).to.throw('Already capturing');
+		await Promise.all(Array.from({ length: 10 }, (_, i) => captureDb.set(`capture:${i}`, 'x'.repeat(100))));
+		await captureDb.get('capture:0');
+		const result = captureDb.stopCapture();
+		expect(result.path).to.equal(capturePath);
+		expect(result.records).to.equal(11);
+
+		const trace = fs.readFileSync(capturePath);
+		expect(result.bytes).to.equal(trace.length);
+		expect(trace.toString('latin1', 0, 8)).to.equal('TKZTRACE');
+		const recordSize = trace.readUInt32LE(12);
+		expect(recordSize).to.equal(40);
+		const last = trace.length - recordSize;
+		expect(trace.readUInt32LE(last + 16)).to.equal('capture:0'.length);
+		expect(trace.readUInt32LE(last + 24)).to.equal(100);
+	});
+
+	it('should capture operations with no key without a key', async () => {
+		captureDb.startCapture(capturePath);
+		await captureDb.search('begin', 'capture:', 100);
+		expect(captureDb.stopCapture().records).to.equal(1);
+
+		const trace = fs.readFileSync(capturePath);
+		const last = trace.length - trace.readUInt32LE(12);
+		expect(trace.readBigUInt64LE(last + 8)).to.equal(0n);
+		expect(trace.readUInt32LE(last + 16)).to.equal(0);
+	});
+
+	it('should reject an unwritable path', () => {
+		expect(() => captureDb.startCapture('/nonexistent/dir/trace')).to.throw('startCapture() failed');
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Hot Keys', function() {
+	this.timeout(10000);
+	let hotDb;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		hotDb = new polyDBM(config, 'db/hotkeys_test.tkh');
+		await hotDb.clear();
+	});
+
+	after(() => {
+		hotDb.close();
+	});
+
+	it('should report the most used keys', async () => {
+		expect(hotDb.hotKeys()).to.be.null;
+		expect(hotDb.trackHotKeys({ k: 4 })).to.be.true;
+		for (let i = 0; i < 20; i++) {
+			await hotDb.set(`cold:${i}`, 'x');
+		}
+		await Promise.all(Array.from({ length: 50 }, () => hotDb.increment('hot:counter', 1, 0)));
+		await Promise.all(Array.from({ length: 30 }, () => hotDb.get('cold:0')));
+		await hotDb.set('big', 'x'.repeat(10000));
+
+		const hot = hotDb.hotKeys({ limit: 2 });
+		expect(hot.since).to.be.closeTo(Date.now(), 10000);
+		expect(hot.writes).to.have.lengthOf(2);
+		expect(hot.writes[0]).to.deep.equal({ key: 'hot:counter', count: 50 });
+		expect(hot.reads[0].key).to.equal('cold:0');
+		expect(hot.reads[0].count).to.be.at.least(30);
+		expect(hot.bytes[0].key).to.equal('big');
+		expect(hot.bytes[0].bytes).to.be.at.least(10000);
+	});
+
+	it('should reset and stop tracking', async () => {
+		hotDb.hotKeys({ reset: true });
+		expect(hotDb.hotKeys().writes).to.be.empty;
+		expect(hotDb.trackHotKeys(false)).to.be.true;
+		expect(hotDb.hotKeys()).to.be.null;
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Memory Stats', function() {
+	this.timeout(10000);
+	let memDb;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		memDb = new polyDBM(config, 'db/memory_test.tkh');
+		await memDb.clear();
+		for (let i = 0; i < 1000; i++) {
+			await memDb.set(`key:${i}`, 'x'.repeat(100));
+		}
+		await memDb.sync(false);
+	});
+
+	after(() => {
+		memDb.close();
+	});
+
+	it('should report the files and addon memory', async () => {
+		const mem = memDb.memoryStats();
+		expect(mem.files).to.have.lengthOf(1);
+		expect(mem.files[0].path).to.equal('db/memory_test.tkh');
+		expect(mem.fileBytes).to.equal(mem.files[0].size);
+		expect(mem.files[0].memoryMapped).to.equal(config.file === 'MemoryMapParallelFile');
+		expect(mem.residentBytes).to.be.within(0, mem.fileBytes);
+		expect(mem.addon.stats).to.be.above(0);
+		expect(mem.addonBytes).to.equal(mem.addon.stats + mem.addon.tracer + mem.addon.capture + mem.addon.hotKeys);
+		expect(mem.inFlight).to.equal(0);
+		expect(mem.inFlightResultBytes).to.equal(0);
+	});
+
+	it('should prefetch and evict the pages', async () => {
+		const resident = await memDb.prefetch();
+		expect(resident).to.equal(memDb.memoryStats().fileBytes);
+		const evicted = await memDb.evict();
+		expect(evicted).to.be.at.most(resident);
+		expect(memDb.stats().operations.prefetch.count).to.equal(1);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Async Open', function() {
+	this.timeout(10000);
+
+	before(() => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+	});
+
+	it('should open on a native thread with progress', async () => {
+		const phases = [];
+		const openDb = await polyDBM.open(config, 'db/open_test.tkh', {
+			prefetch: true,
+			onProgress: (progress) => phases.push(progress),
+		});
+		expect(openDb).to.be.instanceOf(polyDBM);
+		expect(openDb.isOpen()).to.be.true;
+		await openDb.set('key', 'value');
+		expect(await openDb.get('key')).to.equal('value');
+		expect(phases[0].phase).to.equal('open');
+		expect(phases.map(p => p.phase)).to.include('prefetch');
+		const ready = phases[phases.length - 1];
+		expect(ready.phase).to.equal('ready');
+		expect(ready.restored).to.be.false;
+		openDb.close();
+	});
+
+	it('should open a sharded database', async () => {
+		const shardDb = await polyShardDBM.open({ ...config, num_shards: '2' }, 'db/open_shard_test.tkh');
+		expect(shardDb).to.be.instanceOf(polyShardDBM);
+		await shardDb.set('key', 'value');
+		expect(await shardDb.count()).to.be.at.least(1);
+		shardDb.close();
+	});
+
+	it('should open an index on a native thread', async () => {
+		const phases = [];
+		const openIdx = await polyIndex.open(JSON.parse(fs.readFileSync(indexConfigPath, 'utf8')), 'db/open_index_test.tkt', {
+			onProgress: (progress) => phases.push(progress.phase),
+		});
+		expect(openIdx).to.be.instanceOf(polyIndex);
+		await openIdx.add('tags', 'nodejs');
+		expect(await openIdx.getValues('tags', 10)).to.include('nodejs');
+		expect(phases[phases.length - 1]).to.equal('ready');
+		openIdx.close();
+	});
+
+	it('should reject when the database cannot be opened', async () => {
+		let error;
+		try {
+			await polyDBM.open(config, 'db/missing_dir/open_test.tkh');
+		} catch (e) {
+			error = e;
+		}
+		expect(error).to.be.an('error');
+		expect(error.message).to.match(/^Failed to open db\/missing_dir\/open_test.tkh/);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Draining Close', function() {
+	this.timeout(10000);
+
+	before(() => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+	});
+
+	it('should drain the operations in flight before closing', async () => {
+		const closingDb = new polyDBM(config, 'db/close_test.tkh');
+		const writes = Array.from({ length: 100 }, (_, i) => closingDb.set(`close:${i}`, 'value'));
+		const closed = closingDb.close();
+		expect(closingDb.isOpen()).to.be.false;
+		expect(closingDb.close()).to.equal(closed);
+		try {
+			await closingDb.get('close:0');
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.message).to.equal('Database is closed');
+		}
+		expect((await Promise.all(writes)).every(r => r === true)).to.be.true;
+		expect(await closed).to.be.true;
+
+		const reopened = new polyDBM(config, 'db/close_test.tkh');
+		expect(await reopened.count()).to.equal(100);
+		await reopened.close();
+	});
+
+	it('should release the processor of an operation refused after close', async () => {
+		const closingDb = new polyDBM(config, 'db/close_test.tkh');
+		await closingDb.close();
+		try {
+			await closingDb.process('close:0', () => polyDBM.NOOP, false);
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.message).to.equal('Database is closed');
+		}
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Admission Control', function() {
+	this.timeout(10000);
+
+	before(() => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+	});
+
+	it('should hold operations over the limit in "wait" mode', async () => {
+		const limited = new polyDBM({ ...config, max_inflight_ops: '4' }, 'db/admission_wait.tkh');
+		const writes = Array.from({ length: 200 }, (_, i) => limited.set(`wait:${i}`, 'value'));
+		expect(limited.stats().admission.inFlight).to.equal(4);
+		expect(limited.stats().admission.waiting).to.equal(196);
+		expect((await Promise.all(writes)).every(r => r === true)).to.be.true;
+		const { admission } = limited.stats();
+		expect(admission.waited).to.equal(196);
+		expect(admission.rejected).to.equal(0);
+		expect(await limited.count()).to.equal(200);
+		await limited.close();
+	});
+
+	it('should reject operations over the limit with ERR_OVERLOADED in "reject" mode', async () => {
+		const limited = new polyDBM({ ...config, max_inflight_ops: '4', admission: 'reject' }, 'db/admission_reject.tkh');
+		const results = await Promise.allSettled(Array.from({ length: 20 }, (_, i) => limited.set(`reject:${i}`, 'value')));
+		const rejected = results.filter(r => r.status === 'rejected');
+		expect(rejected).to.have.lengthOf(16);
+		expect(rejected[0].reason.code).to.equal('ERR_OVERLOADED');
+		expect(limited.stats().admission.rejected).to.equal(16);
+		await limited.close();
+	});
+
+	it('should shed scans but hold other operations in "shed" mode', async () => {
+		const limited = new polyDBM({ ...config, max_inflight_bytes: '64', admission: 'shed' }, 'db/admission_shed.tkh');
+		const writes = Array.from({ length: 10 }, (_, i) => limited.set(`shed:${i}`, 'x'.repeat(32)));
+		try {
+			await limited.search('begin', 'shed:', 20);
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.code).to.equal('ERR_OVERLOADED');
+		}
+		expect((await Promise.all(writes)).every(r => r === true)).to.be.true;
+		expect(await limited.search('begin', 'shed:', 20)).to.have.lengthOf(10);
+		expect(limited.stats().admission.shed).to.equal(1);
+		await limited.close();
+	});
+
+	it('should hold iterator steps instead of shedding them', async () => {
+		const limited = new polyDBM({ ...config, max_inflight_bytes: '64', admission: 'shed' }, 'db/admission_shed_iter.tkh');
+		limited.makeIterator();
+		const writes = Array.from({ length: 10 }, (_, i) => limited.set(`shed:${i}`, 'x'.repeat(32)));
+		expect(await limited.iteratorFirst()).to.be.true;
+		await Promise.all(writes);
+		expect(limited.stats().admission.shed).to.equal(0);
+		limited.freeIterator();
+		await limited.close();
+	});
+
+	it('should refuse an invalid admission policy', () => {
+		expect(() => new polyDBM({ ...config, admission: 'drop' }, 'db/admission_invalid.tkh')).to.throw(/admission policy/);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Cancellation', function() {
+	this.timeout(10000);
+	let cancelDb;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		cancelDb = new polyDBM(config, 'db/cancel_test.tkh');
+		await Promise.all(Array.from({ length: 100 }, (_, i) => cancelDb.set(`cancel:${i}`, 'value')));
+	});
+
+	after(async () => {
+		await cancelDb.close();
+	});
+
+	it('should reject at once with an already aborted signal', async () => {
+		try {
+			await cancelDb.getSimple('cancel:0', '', { signal: AbortSignal.abort() });
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.code).to.equal('ABORT_ERR');
+		}
+	});
+
+	it('should drop an operation whose deadline has passed', async () => {
+		try {
+			await cancelDb.search('begin', 'cancel:', 100, { deadlineMs: 0 });
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.code).to.equal('ETIMEDOUT');
+		}
+	});
+
+	it('should stop processEach once the signal is aborted', async () => {
+		const controller = new AbortController();
+		let calls = 0;
+		try {
+			await cancelDb.processEach((exists) => {
+				if (exists && ++calls === 10) controller.abort();
+				return polyDBM.NOOP;
+			}, false, { signal: controller.signal });
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.code).to.equal('ABORT_ERR');
+		}
+		expect(calls).to.equal(10);
+	});
+
+	it('should resolve normally when neither fires', async () => {
+		const controller = new AbortController();
+		expect(await cancelDb.search('begin', 'cancel:', 1000, { signal: controller.signal, deadlineMs: 5000 })).to.have.lengthOf(100);
+		expect(await cancelDb.getSimple('cancel:1', '', { signal: controller.signal })).to.equal('value');
+	});
+
+	it('should trace and capture an operation dropped while queued', async () => {
+		const tracePath = 'db/cancel_trace.json';
+		const capturePath = 'db/cancel_capture.trace';
+		cancelDb.startTrace({ slowMs: 0 });
+		expect(cancelDb.startCapture(capturePath)).to.be.true;
+		try {
+			await cancelDb.getSimple('cancel:0', '', { deadlineMs: 0 });
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.code).to.equal('ETIMEDOUT');
+		}
+		cancelDb.stopTrace();
+		expect(cancelDb.stopCapture().records).to.equal(1);
+
+		expect(cancelDb.writeTrace(tracePath)).to.equal(1);
+		const trace = JSON.parse(fs.readFileSync(tracePath, 'utf8'));
+		for (const event of trace.traceEvents.filter(e => e.ph !== 'M')) {
+			expect(event.ts).to.be.at.least(0);
+			if (event.ph === 'X') expect(event.dur).to.be.at.least(0);
+		}
+		const [slow] = cancelDb.slowOps(true);
+		expect(slow.error).to.be.true;
+		expect(slow.queueWaitUs).to.be.at.least(0);
+		expect(slow.executeUs).to.equal(0);
+		expect(slow.totalUs).to.be.at.least(slow.queueWaitUs);
+
+		const capture = fs.readFileSync(capturePath);
+		const last = capture.length - 40;
+		expect(capture.readUInt32LE(last + 16)).to.equal('cancel:0'.length);
+		expect(capture.readUInt32LE(last + 20)).to.equal(0);
+		expect(capture.readUInt16LE(last + 34) & 1).to.equal(1);
+		fs.unlinkSync(tracePath);
+		fs.unlinkSync(capturePath);
+	});
+
+	it('should let the process exit after dropping queued processors', async () => {
+		const { spawn } = await import('node:child_process');
+		const child = spawn(process.execPath, ['-e', `
+			const { polyDBM } = require('tkrzw-node');
+			const db = new polyDBM(${JSON.stringify(config)}, 'db/cancel_exit_test.tkh');
+			const expired = () => ({ deadlineMs: 0 });
+			Promise.allSettled([
+				db.processEach(() => polyDBM.NOOP, false, expired()),
+				db.process('cancel:0', () => polyDBM.NOOP, false, expired()),
+			]).then(results => {
+				if (results.some(r => r.status !== 'rejected' || r.reason.code !== 'ETIMEDOUT')) process.exitCode = 1;
+				return db.close();
+			});
+		`], { stdio: 'inherit' });
+		const code = await new Promise((resolve) => {
+			const timer = setTimeout(() => {
+				child.kill();
+				resolve('timeout');
+			}, 5000);
+			child.once('exit', (exitCode) => {
+				clearTimeout(timer);
+				resolve(exitCode);
+			});
+		});
+		expect(code).to.equal(0);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Unacknowledged Writes', function() {
+	this.timeout(10000);
+	let noAckDb;
+
+	before(() => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		noAckDb = new polyDBM(config, 'db/noack_test.tkh');
+	});
+
+	after(async () => {
+		if (noAckDb.isOpen()) await noAckDb.close();
+	});
+
+	it('should apply queued writes in order by the time flushNoAck resolves', async () => {
+		for (let i = 0; i < 1000; i++) {
+			expect(noAckDb.setNoAck(`noack:${i}`, `value${i}`)).to.be.true;
+		}
+		noAckDb.appendNoAck('noack:0', 'more', ',');
+		expect(await noAckDb.flushNoAck()).to.be.true;
+		expect(await noAckDb.getSimple('noack:999', '')).to.equal('value999');
+		expect(await noAckDb.getSimple('noack:0', '')).to.equal('value0,more');
+		const stats = noAckDb.noAckStats();
+		expect(stats.written).to.equal(1001);
+		expect(stats.pending).to.equal(0);
+	});
+
+	it('should add up unacknowledged increments', async () => {
+		for (let i = 0; i < 100; i++) {
+			noAckDb.incrementNoAck('noack:counter', 2, 10);
+		}
+		await noAckDb.flushNoAck();
+		expect(await noAckDb.increment('noack:counter', 0)).to.equal(210);
+	});
+
+	it('should take an error handler or null', () => {
+		expect(noAckDb.onNoAckError(() => {})).to.be.true;
+		expect(noAckDb.onNoAckError(null)).to.be.true;
+		expect(() => noAckDb.onNoAckError('handler')).to.throw(/Invalid arguments for onNoAckError/);
+		expect(noAckDb.noAckStats().failed).to.equal(0);
+	});
+
+	it('should drop writes beyond noack_max_pending', async () => {
+		const bounded = new polyDBM({ ...config, noack_max_pending: '1' }, 'db/noack_bounded.tkh');
+		let queued = 0;
+		for (let i = 0; i < 10000; i++) {
+			if (bounded.setNoAck(`bounded:${i}`, 'value')) queued++;
+		}
+		await bounded.flushNoAck();
+		const stats = bounded.noAckStats();
+		expect(stats.dropped).to.equal(10000 - queued);
+		expect(stats.written).to.equal(queued);
+		await bounded.close();
+	});
+
+	it('should apply queued writes on close and refuse new ones', async () => {
+		for (let i = 0; i < 100; i++) {
+			noAckDb.setNoAck(`closing:${i}`, 'value');
+		}
+		const closing = noAckDb.close();
+		expect(noAckDb.setNoAck('closing:late', 'value')).to.be.false;
+		await closing;
+		const reopened = new polyDBM(config, 'db/noack_test.tkh');
+		expect(await reopened.getSimple('closing:99', '')).to.equal('value');
+		expect(await reopened.getSimple('closing:late', '')).to.equal('');
+		await reopened.close();
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Write-Behind Counters', function() {
+	this.timeout(10000);
+	let counterDb;
+	let direct;
+
+	before(() => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		counterDb = new polyDBM({ ...config, counters: 'write_behind', counter_flush_interval_ms: '60000', counter_flush_threshold: '0' },
+			'db/write_behind_test.tkh');
+		direct = new polyDBM(config, 'db/write_behind_test.tkh');      //Same DBM, increments written at once
+	});
+
+	after(async () => {
+		await direct.close();
+	});
+
+	it('should give each increment its own value', async () => {
+		const values = await Promise.all(Array.from({ length: 100 }, () => counterDb.increment('wb:hits', 1, 0)));
+		expect(new Set(values).size).to.equal(100);
+		expect(Math.max(...values)).to.equal(100);
+	});
+
+	it('should hold the deltas until they are flushed', async () => {
+		expect(await direct.increment('wb:hits', 0)).to.equal(0);
+		expect(counterDb.stats().counters.pending).to.equal(100);
+		expect(await counterDb.flushCounters()).to.be.true;
+		expect(await direct.increment('wb:hits', 0)).to.equal(100);
+		expect(counterDb.stats().counters.pending).to.equal(0);
+	});
+
+	it('should add pending deltas to direct increments', async () => {
+		await counterDb.increment('wb:hits', 5);
+		await direct.increment('wb:hits', 10);
+		expect(await counterDb.increment('wb:hits', 0)).to.equal(115);
+		await counterDb.flushCounters();
+		expect(await direct.increment('wb:hits', 0)).to.equal(115);
+	});
+
+	it('should not let a flush undo a set or remove of a counter', async () => {
+		await counterDb.increment('wb:reset', 3, 0);
+		expect(await counterDb.remove('wb:reset')).to.be.true;
+		await counterDb.increment('wb:set', 4, 0);
+		await counterDb.set('wb:set', 'plain');
+		await counterDb.flushCounters();
+		expect(await direct.getSimple('wb:reset', 'none')).to.equal('none');
+		expect(await direct.getSimple('wb:set', '')).to.equal('plain');
+		expect(await counterDb.increment('wb:reset', 2, 0)).to.equal(2);
+	});
+
+	it('should write the pending delta before another write of a counter', async () => {
+		await counterDb.increment('wb:old', 6, 0);
+		await counterDb.rekey('wb:old', 'wb:new', true, false);
+		await counterDb.flushCounters();
+		expect(await direct.increment('wb:new', 0)).to.equal(6);
+		expect(await direct.getSimple('wb:old', 'none')).to.equal('none');
+	});
+
+	it('should write the pending deltas on close', async () => {
+		await counterDb.increment('wb:closing', 7, 3);
+		await counterDb.close();
+		expect(await direct.increment('wb:closing', 0)).to.equal(10);
+	});
+
+	it('should refuse an invalid counters mode', () => {
+		expect(() => new polyDBM({ ...config, counters: 'lazy' }, 'db/write_behind_invalid.tkh')).to.throw(/counters mode/);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Record Versions', function() {
+	let versionDb;
+
+	before(() => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		versionDb = new polyDBM(config, 'db/version_test.tkh');
+	});
+
+	after(async () => {
+		await versionDb.close();
+	});
+
+	it('should resolve to null for a missing record', async () => {
+		expect(await versionDb.getWithVersion('version:missing')).to.be.null;
+	});
+
+	it('should create a record only if there is none with a null version', async () => {
+		const version = await versionDb.setIfVersion('version:doc', null, 'first');
+		expect(version).to.match(/^[0-9a-f]{16}$/);
+		expect(await versionDb.setIfVersion('version:doc', null, 'second')).to.be.null;
+		expect(await versionDb.getWithVersion('version:doc')).to.deep.equal({ value: 'first', version });
+	});
+
+	it('should write only while the version matches', async () => {
+		const { version } = await versionDb.getWithVersion('version:doc');
+		const next = await versionDb.setIfVersion('version:doc', version, 'updated');
+		expect(next).to.be.a('string').and.not.equal(version);
+		expect(await versionDb.setIfVersion('version:doc', version, 'stale')).to.be.null;
+		expect(await versionDb.getSimple('version:doc', '')).to.equal('updated');
+	});
+
+	it('should see writes made through other methods', async () => {
+		const { version } = await versionDb.getWithVersion('version:doc');
+		await versionDb.set('version:doc', 'overwritten');
+		expect(await versionDb.setIfVersion('version:doc', version, 'lost update')).to.be.null;
+	});
+
+	it('should reject a malformed version', async () => {
+		try {
+			await versionDb.setIfVersion('version:doc', 'v1', 'value');
+			expect.fail('Should have thrown');
+		} catch (err) {
+			expect(err.message).to.include('Invalid arguments for setIfVersion');
+		}
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Write Batches', function() {
+	let batchDb;
+
+	before(() => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		batchDb = new polyDBM(config, 'db/batch_test.tkh');
+	});
+
+	after(async () => {
+		await batchDb.close();
+	});
+
+	it('should apply mixed operations in order', async () => {
+		await batchDb.set('batch:gone', 'x');
+		const batch = batchDb.batch();
+		expect(batch.set('batch:a', '1').append('batch:a', '2', ',').remove('batch:gone').increment('batch:n', 5, 10)).to.equal(batch);
+		batch.increment('batch:n').set('batch:tmp', 'v').remove('batch:tmp').remove('batch:missing');
+		expect(batch.size()).to.equal(8);
+		expect(await batch.commit()).to.be.true;
+		expect(batch.size()).to.equal(0);
+		expect(await batchDb.getSimple('batch:a', '')).to.equal('1,2');
+		expect(await batchDb.getSimple('batch:gone', 'none')).to.equal('none');
+		expect(await batchDb.getSimple('batch:tmp', 'none')).to.equal('none');
+		expect(await batchDb.increment('batch:n', 0)).to.equal(16);
+	});
+
+	it('should apply the same operations without atomicity', async () => {
+		await batchDb.batch().set('batch:b', 'x').append('batch:b', 'y').increment('batch:m', 2).remove('batch:missing')
+			.commit({ atomic: false });
+		expect(await batchDb.getSimple('batch:b', '')).to.equal('xy');
+		expect(await batchDb.increment('batch:m', 0)).to.equal(2);
+	});
+
+	it('should be reusable after commit and clear', async () => {
+		const batch = batchDb.batch().set('batch:c', 'dropped');
+		expect(batch.clear().size()).to.equal(0);
+		await batch.set('batch:c', 'kept').commit();
+		expect(await batchDb.getSimple('batch:c', '')).to.equal('kept');
+		expect(await batch.commit()).to.be.true;
+	});
+
+	it('should reject invalid operations', () => {
+		expect(() => batchDb.batch().set('batch:d')).to.throw(/Invalid arguments for set/);
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Pipelines', function() {
+	let pipelineDb;
+
+	before(() => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		pipelineDb = new polyDBM(config, 'db/pipeline_test.tkh');
+	});
+
+	after(async () => {
+		await pipelineDb.close();
+	});
+
+	it('should run conditional steps with one result each', async () => {
+		const steps = [
+			{ op: 'get', key: 'pipe:a' },
+			{ op: 'set', key: 'pipe:b', value: 'default', if: { step: 0, exists: false } },
+			{ op: 'increment', key: 'pipe:c', increment: 2, initial: 10 }
+		];
+		expect(await pipelineDb.pipeline(steps)).to.deep.equal([null, true, 12]);
+		await pipelineDb.set('pipe:a', 'present');
+		expect(await pipelineDb.pipeline(steps, { atomic: true })).to.deep.equal(['present', undefined, 14]);
+	});
+
+	it('should resolve references to earlier reads', async () => {
+		await pipelineDb.set('pipe:pointer', 'pipe:a');
+		const results = await pipelineDb.pipeline([
+			{ op: 'get', key: 'pipe:pointer' },
+			{ op: 'get', key: { ref: 0 } },
+			{ op: 'append', key: 'pipe:copy', value: { ref: 1 }, if: { step: 1, equals: 'present' } },
+			{ op: 'remove', key: 'pipe:pointer', if: { step: 1, notEquals: 'present' } },
+			{ op: 'get', key: { ref: 0 }, if: { step: 0, equals: { ref: 0 } } }
+		]);
+		expect(results).to.deep.equal(['pipe:a', 'present', true, undefined, 'present']);
+		expect(await pipelineDb.getSimple('pipe:copy', '')).to.equal('present');
+	});
+
+	it('should validate the steps before running any', async () => {
+		expect(() => pipelineDb.pipeline([{ op: 'set', key: 'pipe:x', value: { ref: 0 } }])).to.throw(/earlier get step/);
+		expect(() => pipelineDb.pipeline([{ op: 'rename', key: 'pipe:x' }])).to.throw(/Invalid pipeline step 0: op/);
+		expect(() => pipelineDb.pipeline([{ op: 'get', key: 'pipe:pointer' }, { op: 'get', key: { ref: 0 } }], { atomic: true }))
+			.to.throw(/literal keys/);
+		expect(await pipelineDb.getSimple('pipe:x', 'none')).to.equal('none');
+	});
+});
+
+describe('Tkrzw Node.js Bindings - Aggregation', function() {
+	let aggregateDb;
+
+	before(async () => {
+		config = JSON.parse(fs.readFileSync(configPath, 'utf8'));
+		aggregateDb = new polyDBM(config, 'db/aggregate_test.tkh');
+		await aggregateDb.clear();
+		await aggregateDb.set('order:alice:1', '100,EUR');
+		await aggregateDb.set('order:alice:2', '20.5,EUR');
+		await aggregateDb.set('order:bob:1', '42,USD');
+		await aggregateDb.set('order:bob:2', 'refunded');
+		await aggregateDb.set('other', '1000');
+		await aggregateDb.increment('hits:a', 7);
+		await aggregateDb.increment('hits:b', 3);
+	});
+
+	after(async () => {
+		await aggregateDb.close();
+	});
+
+	it('should count and sum the records of a prefix', async () => {
+		expect(await aggregateDb.aggregate({ prefix: 'order:' })).to.deep.equal({ records: 4, skipped: 0, value: 4 });
+		expect(await aggregateDb.aggregate({ prefix: 'order:', op: 'sum', field: 0 }))
+			.to.deep.equal({ records: 4, skipped: 1, value: 162.5 });
+		expect((await aggregateDb.aggregate({ prefix: 'none:', op: 'max' })).value).to.be.null;
+	});
+
+	it('should group by key segments', async () => {
+		const result = await aggregateDb.aggregate({ prefix: 'order:', op: 'max', field: 0, groupBy: 2 });
+		expect(result.groups).to.deep.equal({ 'order:alice': 100, 'order:bob': 42 });
+	});
+
+	it('should rank counters with topK', async () => {
+		const result = await aggregateDb.aggregate({ range: { from: 'hits:', to: 'hits;' }, op: 'topK', k: 1, format: 'int64' });
+		expect(result.top).to.deep.equal([{ key: 'hits:a', value: 7 }]);
+		expect(result.records).to.equal(2);
+	});
+
+	it('should reject an unknown op', () => {
+		expect(() => aggregateDb.aggregate({ op: 'median' })).to.throw(/unknown op/);
+	});
+});